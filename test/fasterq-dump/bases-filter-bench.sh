@@ -0,0 +1,24 @@
+#!/bin/bash
+
+#wall-clock time of an unfiltered and a filtered dump ( --bases ) of the same accession
+
+ACC="SRR341578"
+TOOL="fasterq-dump"
+
+OUTDIR="./BASES_FILTER_BENCH"
+if [ -d "$OUTDIR" ]; then
+    rm -rf "$OUTDIR"
+fi
+mkdir -p "$OUTDIR"
+
+START=`date +%s.%N`
+$TOOL $ACC -O "$OUTDIR" -t "$OUTDIR" -f || exit 1
+MID=`date +%s.%N`
+$TOOL $ACC -O "$OUTDIR" -t "$OUTDIR" -f --bases "GATTACA|CCGGAATT" || exit 1
+END=`date +%s.%N`
+
+echo "unfiltered : `echo "$MID - $START" | bc` sec"
+echo "filtered   : `echo "$END - $MID" | bc` sec"
+
+rm -rf "$OUTDIR"
+echo "done"
@@ -0,0 +1,114 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#ifndef _h_cmn_iter_cols_
+#define _h_cmn_iter_cols_
+
+/* the accessions, columns and iterator-helpers shared by test-cmn-iter and slowtestCmnIter */
+
+#include "../../tools/fasterq-dump/cmn_iter.h"
+
+#include <kfs/directory.h> /* KDirectory */
+
+static const char * FLAT_ACC = "SRR053325";  /* small table */
+static const char * CSRA_ACC = "SRR619505";  /* small cSRA */
+
+enum col_type { ct_string, ct_u8_array, ct_u32_array, ct_u64_array };
+
+struct col_spec {
+    const char * name;
+    col_type type;
+};
+
+static const col_spec FLAT_COLUMNS [] = {
+    { "READ", ct_string }, { "QUALITY", ct_u8_array }, { "READ_LEN", ct_u32_array },
+    { "READ_TYPE", ct_u8_array }, { "NAME", ct_string }, { NULL, ct_string } };
+
+static const col_spec CSRA_COLUMNS [] = {
+    { "PRIMARY_ALIGNMENT_ID", ct_u64_array }, { "CMP_READ", ct_string },
+    { "READ_LEN", ct_u32_array }, { "READ_TYPE", ct_u8_array },
+    { "SPOT_GROUP", ct_string }, { NULL, ct_string } };
+
+#define MAX_COLS 8
+
+struct iter_holder {
+    struct cmn_iter * iter;
+    uint32_t ids [ MAX_COLS ];
+    uint32_t num_ids;
+
+    iter_holder () : iter ( NULL ), num_ids ( 0 ) {}
+    ~iter_holder () { destroy_cmn_iter ( iter ); }
+};
+
+static rc_t open_iter ( iter_holder & h, const KDirectory * dir, const char * acc,
+                        const char * tbl, const col_spec * columns, bool cell_reads ) {
+    cmn_params cp = { dir, NULL, acc, 0, 0, 0, cell_reads };
+    rc_t rc = make_cmn_iter ( & cp, tbl, & h . iter );
+    while ( rc == 0 && columns [ h . num_ids ] . name != NULL && h . num_ids < MAX_COLS ) {
+        rc = cmn_iter_add_column ( h . iter, columns [ h . num_ids ] . name,
+                                   & h . ids [ h . num_ids ] );
+        h . num_ids++;
+    }
+    if ( rc == 0 )
+        rc = cmn_iter_range ( h . iter, h . ids [ 0 ] );
+    return rc;
+}
+
+/* reads one cell through the matching cmn_read_xxx() helper */
+static rc_t read_cell ( iter_holder & h, uint32_t idx, col_type type,
+                        const void ** base, size_t * size ) {
+    rc_t rc = 0;
+    uint32_t count = 0;
+    switch ( type ) {
+        case ct_string : {
+            String s;
+            rc = cmn_read_String ( h . iter, h . ids [ idx ], & s );
+            * base = s . addr; * size = s . size;
+            break;
+        }
+        case ct_u8_array : {
+            uint8_t * v = NULL;
+            rc = cmn_read_uint8_array ( h . iter, h . ids [ idx ], & v, & count );
+            * base = v; * size = count;
+            break;
+        }
+        case ct_u32_array : {
+            uint32_t * v = NULL;
+            rc = cmn_read_uint32_array ( h . iter, h . ids [ idx ], & v, & count );
+            * base = v; * size = count * sizeof * v;
+            break;
+        }
+        case ct_u64_array : {
+            static uint64_t v [ 2 ];
+            rc = cmn_read_uint64_array ( h . iter, h . ids [ idx ], v, 2, & count );
+            * base = v; * size = count * sizeof v [ 0 ];
+            break;
+        }
+    }
+    return rc;
+}
+
+#endif /* _h_cmn_iter_cols_ */
@@ -0,0 +1,43 @@
+#!/bin/bash
+
+#fasterq-dump with --temp pointing to several directories has to produce
+#the same output as with a single temp-directory, and has to use all of them
+
+ACC="SRR341578"
+TOOL="fasterq-dump"
+
+OUTDIR="./MULTI_TEMP_TEST"
+if [ -d "$OUTDIR" ]; then
+    rm -rf "$OUTDIR"
+fi
+
+mkdir -p "$OUTDIR/A" "$OUTDIR/B" "$OUTDIR/T1" "$OUTDIR/T2" "$OUTDIR/T3"
+
+#the regular output with one temp-directory
+$TOOL $ACC -O "$OUTDIR/A" -t "$OUTDIR/T1" || exit 1
+
+#the same with 3 temp-directories, small mem-limit to force many sub-files
+$TOOL $ACC -O "$OUTDIR/B" -t "$OUTDIR/T1,$OUTDIR/T2,$OUTDIR/T3" -m 1M --details > "$OUTDIR/details.txt" 2>&1 || exit 1
+
+NUM_TEMP=`grep -c "scratch-path" "$OUTDIR/details.txt"`
+if [ "$NUM_TEMP" != "3" ]; then
+    echo "expected 3 scratch-paths, got $NUM_TEMP"
+    exit 1
+fi
+
+OPT1="--brief"
+OPT2="--report-identical-files"
+for F in `ls "$OUTDIR/A"`
+do
+    diff "$OPT1" "$OPT2" "$OUTDIR/A/$F" "$OUTDIR/B/$F" || exit 1
+done
+
+#nothing may be left behind in the temp-directories
+LEFT=`find "$OUTDIR/T1" "$OUTDIR/T2" "$OUTDIR/T3" -mindepth 1 | wc -l`
+if [ "$LEFT" != "0" ]; then
+    echo "$LEFT temp. files/dirs left behind"
+    exit 1
+fi
+
+rm -rf "$OUTDIR"
+echo "done"
@@ -0,0 +1,78 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "cmn_iter_cols.h"
+
+#include <kfs/directory.h> /* KDirectoryNativeDir */
+#include <klib/time.h> /* KTimeMsStamp */
+
+#include <ktst/unit_test.hpp> // TEST_SUITE
+
+#include <iostream>
+
+TEST_SUITE ( SlowTestCmnIter );
+
+/* rows-per-second of both modes, reading every column of every row */
+static rc_t bench_mode ( const char * acc, const char * tbl, const col_spec * columns,
+                         bool cell_reads ) {
+    KDirectory * dir = NULL;
+    rc_t rc = KDirectoryNativeDir ( & dir );
+    iter_holder h;
+    uint64_t rows = 0;
+    KTimeMs_t start = KTimeMsStamp ();
+    if ( rc == 0 )
+        rc = open_iter ( h, dir, acc, tbl, columns, cell_reads );
+    while ( rc == 0 && cmn_iter_next ( h . iter, & rc ) ) {
+        for ( uint32_t i = 0; rc == 0 && i < h . num_ids; ++i ) {
+            const void * base;
+            size_t size;
+            rc = read_cell ( h, i, columns [ i ] . type, & base, & size );
+        }
+        ++ rows;
+    }
+    KTimeMs_t ms = KTimeMsStamp () - start;
+    std :: cout << acc << ( cell_reads ? " cell-mode: " : " blob-mode: " ) << rows << " rows in "
+                << ms << " ms = " << ( ms > 0 ? ( rows * 1000 ) / ms : rows ) << " rows/sec\n";
+    KDirectoryRelease ( dir );
+    return rc;
+}
+
+TEST_CASE ( flat_table_rows_per_second ) {
+    REQUIRE_RC ( bench_mode ( FLAT_ACC, NULL, FLAT_COLUMNS, true ) );
+    REQUIRE_RC ( bench_mode ( FLAT_ACC, NULL, FLAT_COLUMNS, false ) );
+}
+
+TEST_CASE ( csra_sequence_rows_per_second ) {
+    REQUIRE_RC ( bench_mode ( CSRA_ACC, "SEQUENCE", CSRA_COLUMNS, true ) );
+    REQUIRE_RC ( bench_mode ( CSRA_ACC, "SEQUENCE", CSRA_COLUMNS, false ) );
+}
+
+extern "C" {
+    ver_t CC KAppVersion ( void ) { return 0; }
+    rc_t CC KMain ( int argc, char * argv [] ) {
+        return SlowTestCmnIter ( argc, argv );
+    }
+}
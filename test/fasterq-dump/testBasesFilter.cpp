@@ -0,0 +1,171 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+
+#include "../../tools/fasterq-dump/bases_filter.h"
+#include "../../tools/fasterq-dump/helper.h"
+
+#include <klib/time.h> /* KTimeMsStamp */
+
+#include <ktst/unit_test.hpp> // TEST_SUITE
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+TEST_SUITE ( TestBasesFilter );
+
+/* the NucStrstr-path in helper.c is the reference */
+struct both_filters {
+    struct bases_filter * direct;
+    struct Buf2NA * nss;
+
+    both_filters () : direct ( NULL ), nss ( NULL ) {}
+    ~both_filters () {
+        release_bases_filter ( direct );
+        release_Buf2NA ( nss );
+    }
+    rc_t make ( const char * pattern ) {
+        rc_t rc = make_bases_filter ( & direct, pattern );
+        if ( rc == 0 )
+            rc = make_Buf2NA ( & nss, 512, pattern );
+        return rc;
+    }
+};
+
+/* reads with mostly ACGT, some N and other IUPAC-codes, some lower-case */
+static void make_reads ( std :: vector < std :: string > & reads, size_t count, const char * alphabet ) {
+    size_t n = strlen ( alphabet );
+    srand ( 4711 );
+    for ( size_t i = 0; i < count; ++i ) {
+        size_t len = 1 + rand () % 300;
+        std :: string s;
+        for ( size_t j = 0; j < len; ++j )
+            s += alphabet [ rand () % n ];
+        reads . push_back ( s );
+    }
+}
+
+static const char * READ_ALPHABET = "ACGTACGTACGTACGTacgtNNRY";
+
+static rc_t compare ( const char * pattern, const std :: vector < std :: string > & reads,
+                      uint64_t * matches ) {
+    both_filters f;
+    rc_t rc = f . make ( pattern );
+    * matches = 0;
+    for ( size_t i = 0; rc == 0 && i < reads . size (); ++i ) {
+        String s;
+        StringInit ( & s, reads [ i ] . data (), reads [ i ] . size (), ( uint32_t ) reads [ i ] . size () );
+        bool m1 = bases_filter_match ( f . direct, & s );
+        bool m2 = match_Buf2NA ( f . nss, & s );
+        if ( m1 != m2 ) {
+            std :: cerr << "pattern '" << pattern << "' read '" << reads [ i ] << "' : "
+                        << m1 << " vs " << m2 << "\n";
+            rc = RC ( rcApp, rcNoTarg, rcComparing, rcData, rcInconsistent );
+        }
+        if ( m1 ) ++ * matches;
+    }
+    return rc;
+}
+
+TEST_CASE ( direct_patterns_equal_nucstrstr ) {
+    static const char * patterns [] = {
+        "A", "ACGT", "TTTT", "GATTACA", "AAAAAAAAAAAAAAAAAAAA",    /* plain */
+        "ACNGT", "RYRY", "GGSWGG", "NNNNA", "BDHV",                 /* IUPAC */
+        "AAAAA|CCCCC", "GATC || TTAA", "ACGTACGTACGTACGTACGTACGT|GG|TTTTTTTT", /* several */
+        NULL };
+    std :: vector < std :: string > reads;
+    make_reads ( reads, 20000, READ_ALPHABET );
+    for ( size_t i = 0; patterns [ i ] != NULL; ++i ) {
+        uint64_t matches;
+        REQUIRE_RC ( compare ( patterns [ i ], reads, & matches ) );
+        both_filters f;
+        REQUIRE_RC ( f . make ( patterns [ i ] ) );
+        REQUIRE ( bases_filter_is_direct ( f . direct ) );
+    }
+}
+
+/* an N in the read counts as 'A', the 2na-packing did that */
+TEST_CASE ( n_in_read_is_a ) {
+    both_filters f;
+    REQUIRE_RC ( f . make ( "AAAA" ) );
+    String s;
+    StringInitCString ( & s, "CCCCANNACCCC" );
+    REQUIRE ( bases_filter_match ( f . direct, & s ) );
+    REQUIRE ( match_Buf2NA ( f . nss, & s ) );
+}
+
+/* everything but a list of FASTA-strings still goes through NucStrstr */
+TEST_CASE ( expressions_fall_back ) {
+    static const char * patterns [] = { "ACGT && GG", "!AAAA", "( AC | GT ) && TTT", NULL };
+    std :: vector < std :: string > reads;
+    make_reads ( reads, 2000, READ_ALPHABET );
+    for ( size_t i = 0; patterns [ i ] != NULL; ++i ) {
+        both_filters f;
+        REQUIRE_RC ( f . make ( patterns [ i ] ) );
+        REQUIRE ( ! bases_filter_is_direct ( f . direct ) );
+        uint64_t matches;
+        REQUIRE_RC ( compare ( patterns [ i ], reads, & matches ) );
+    }
+}
+
+/* reads/sec of both filters, the way a filtered dump calls them ( both mates ) */
+TEST_CASE ( filtered_dump_benchmark ) {
+    std :: vector < std :: string > reads;
+    make_reads ( reads, 400000, "ACGT" );
+    const char * pattern = "GATTACA|CCGGAATT";
+    both_filters f;
+    REQUIRE_RC ( f . make ( pattern ) );
+    for ( int pass = 0; pass < 2; ++pass ) {
+        uint64_t matches = 0;
+        KTimeMs_t start = KTimeMsStamp ();
+        for ( int rep = 0; rep < 5; ++rep ) {
+            for ( size_t i = 0; i + 1 < reads . size (); i += 2 ) {
+                String s1, s2;
+                StringInit ( & s1, reads [ i ] . data (), reads [ i ] . size (), ( uint32_t ) reads [ i ] . size () );
+                StringInit ( & s2, reads [ i + 1 ] . data (), reads [ i + 1 ] . size (), ( uint32_t ) reads [ i + 1 ] . size () );
+                bool m = ( pass == 0 )
+                    ? ( match_Buf2NA ( f . nss, & s1 ) || match_Buf2NA ( f . nss, & s2 ) )
+                    : ( bases_filter_match ( f . direct, & s1 ) || bases_filter_match ( f . direct, & s2 ) );
+                if ( m ) ++ matches;
+            }
+        }
+        KTimeMs_t ms = KTimeMsStamp () - start;
+        uint64_t spots = 5 * ( reads . size () / 2 );
+        std :: cout << ( pass == 0 ? "NucStrstr   : " : "bases_filter: " ) << spots << " spots, "
+                    << matches << " matches, " << ms << " ms = "
+                    << ( ms > 0 ? ( spots * 1000 ) / ms : spots ) << " spots/sec\n";
+    }
+}
+
+extern "C" {
+    ver_t CC KAppVersion ( void ) { return 0; }
+    rc_t CC KMain ( int argc, char * argv [] ) {
+        return TestBasesFilter ( argc, argv );
+    }
+}
@@ -0,0 +1,102 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "cmn_iter_cols.h"
+
+#include <kfs/directory.h> /* KDirectoryNativeDir */
+
+#include <ktst/unit_test.hpp> // TEST_SUITE
+
+#include <cstring>
+#include <iostream>
+
+TEST_SUITE ( TestCmnIter );
+
+/* every cell of every row has to be the same in cell- and in blob-mode */
+static rc_t compare_modes ( const char * acc, const char * tbl, const col_spec * columns,
+                            uint64_t * rows ) {
+    KDirectory * dir = NULL;
+    rc_t rc = KDirectoryNativeDir ( & dir );
+    iter_holder by_cell, by_blob;
+    if ( rc == 0 )
+        rc = open_iter ( by_cell, dir, acc, tbl, columns, true );
+    if ( rc == 0 )
+        rc = open_iter ( by_blob, dir, acc, tbl, columns, false );
+    * rows = 0;
+    while ( rc == 0 ) {
+        rc_t rc1 = 0, rc2 = 0;
+        bool n1 = cmn_iter_next ( by_cell . iter, & rc1 );
+        bool n2 = cmn_iter_next ( by_blob . iter, & rc2 );
+        if ( rc1 != 0 ) { rc = rc1; break; }
+        if ( rc2 != 0 ) { rc = rc2; break; }
+        if ( n1 != n2 ) { rc = RC ( rcApp, rcNoTarg, rcComparing, rcRow, rcInconsistent ); break; }
+        if ( !n1 ) break;
+        if ( cmn_iter_row_id ( by_cell . iter ) != cmn_iter_row_id ( by_blob . iter ) ) {
+            rc = RC ( rcApp, rcNoTarg, rcComparing, rcId, rcInconsistent );
+            break;
+        }
+        for ( uint32_t i = 0; rc == 0 && i < by_cell . num_ids; ++i ) {
+            const void * base1 = NULL, * base2 = NULL;
+            size_t size1 = 0, size2 = 0;
+            uint64_t copy [ 2 ];
+            rc = read_cell ( by_cell, i, columns [ i ] . type, & base1, & size1 );
+            if ( rc == 0 && columns [ i ] . type == ct_u64_array ) {
+                /* read_cell() uses a static buffer for this type */
+                memmove ( copy, base1, size1 );
+                base1 = copy;
+            }
+            if ( rc == 0 )
+                rc = read_cell ( by_blob, i, columns [ i ] . type, & base2, & size2 );
+            if ( rc == 0 && ( size1 != size2 || memcmp ( base1, base2, size1 ) != 0 ) ) {
+                std :: cerr << acc << " row #" << cmn_iter_row_id ( by_cell . iter )
+                            << " column " << columns [ i ] . name << " differs\n";
+                rc = RC ( rcApp, rcNoTarg, rcComparing, rcData, rcInconsistent );
+            }
+        }
+        ++ * rows;
+    }
+    KDirectoryRelease ( dir );
+    return rc;
+}
+
+TEST_CASE ( flat_table_cells_equal ) {
+    uint64_t rows = 0;
+    REQUIRE_RC ( compare_modes ( FLAT_ACC, NULL, FLAT_COLUMNS, & rows ) );
+    REQUIRE_GT ( rows, ( uint64_t ) 0 );
+}
+
+TEST_CASE ( csra_sequence_cells_equal ) {
+    uint64_t rows = 0;
+    REQUIRE_RC ( compare_modes ( CSRA_ACC, "SEQUENCE", CSRA_COLUMNS, & rows ) );
+    REQUIRE_GT ( rows, ( uint64_t ) 0 );
+}
+
+extern "C" {
+    ver_t CC KAppVersion ( void ) { return 0; }
+    rc_t CC KMain ( int argc, char * argv [] ) {
+        return TestCmnIter ( argc, argv );
+    }
+}
@@ -0,0 +1,216 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+
+#include "../../tools/fasterq-dump/lookup_writer.h"
+#include "../../tools/fasterq-dump/lookup_reader.h"
+#include "../../tools/fasterq-dump/index.h"
+#include "../../tools/fasterq-dump/helper.h"
+
+#include <kfs/directory.h> /* KDirectoryNativeDir */
+#include <kfs/file.h> /* KFileSize */
+#include <klib/time.h> /* KTimeMsStamp */
+
+#include <ktst/unit_test.hpp> // TEST_SUITE
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+TEST_SUITE ( TestLookup );
+
+static const char * LOOKUP_FILE = "test-lookup.dat";
+static const char * INDEX_FILE  = "test-lookup.idx";
+
+/* 4na-values of A, C, G, T and N, the lookup-file stores bases this way */
+static const uint8_t BASES_4NA [] = { 1, 2, 4, 8, 15 };
+static const char BASES_ASCII [] = "ACGTN";
+
+/* a deterministic set of reads: every spot has 2 reads of 50...150 bases */
+struct spot_set {
+    std :: vector < std :: string > unpacked;   /* in 4na */
+    std :: vector < std :: string > ascii;      /* what lookup_bases() has to return */
+
+    spot_set ( uint64_t num_spots, bool with_n ) {
+        srand ( 12345 );
+        for ( uint64_t i = 0; i < num_spots * 2; ++i ) {
+            size_t len = 50 + rand () % 101;
+            std :: string u, a;
+            for ( size_t j = 0; j < len; ++j ) {
+                int b = rand () % ( with_n ? 5 : 4 );
+                u += ( char ) BASES_4NA [ b ];
+                a += BASES_ASCII [ b ];
+            }
+            unpacked . push_back ( u );
+            ascii . push_back ( a );
+        }
+    }
+    uint64_t spots () const { return unpacked . size () / 2; }
+};
+
+/* writes the spots into a lookup-file + index, the same way merge_sorter.c does */
+static rc_t write_lookup ( KDirectory * dir, const spot_set & set, uint64_t * logical ) {
+    struct index_writer * idx = NULL;
+    struct lookup_writer * writer = NULL;
+    rc_t rc = make_index_writer ( dir, & idx, 4096, DFLT_INDEX_FREQUENCY, "%s", INDEX_FILE );
+    if ( rc == 0 )
+        rc = make_lookup_writer ( dir, idx, & writer, 4096, "%s", LOOKUP_FILE );
+    * logical = 0;
+    for ( uint64_t i = 0; rc == 0 && i < set . unpacked . size (); ++i ) {
+        String s;
+        StringInit ( & s, set . unpacked [ i ] . data (), set . unpacked [ i ] . size (),
+                     ( uint32_t ) set . unpacked [ i ] . size () );
+        rc = write_unpacked_to_lookup_writer ( writer, ( int64_t ) ( i / 2 ) + 1,
+                                               ( uint32_t ) ( i % 2 ) + 1, & s );
+        * logical += sizeof ( uint64_t ) + 2 + ( s . len + 1 ) / 2;
+    }
+    release_lookup_writer ( writer );
+    release_index_writer ( idx );
+    return rc;
+}
+
+struct reader_holder {
+    KDirectory * dir;
+    struct index_reader * index;
+    struct lookup_reader * lookup;
+    SBuffer buf;
+
+    reader_holder () : dir ( NULL ), index ( NULL ), lookup ( NULL ) { memset ( & buf, 0, sizeof buf ); }
+    ~reader_holder () {
+        release_lookup_reader ( lookup );
+        release_index_reader ( index );
+        release_SBuffer ( & buf );
+    }
+    rc_t open ( KDirectory * d ) {
+        dir = d;
+        rc_t rc = make_index_reader ( dir, & index, 4096, "%s", INDEX_FILE );
+        if ( rc == 0 )
+            rc = make_lookup_reader ( dir, index, & lookup, 4096, "%s", LOOKUP_FILE );
+        if ( rc == 0 )
+            rc = make_SBuffer ( & buf, 4096 );
+        return rc;
+    }
+    rc_t bases ( uint64_t i, std :: string & s ) {
+        rc_t rc = lookup_bases ( lookup, ( int64_t ) ( i / 2 ) + 1, ( uint32_t ) ( i % 2 ) + 1,
+                                 & buf, false );
+        if ( rc == 0 )
+            s . assign ( buf . S . addr, buf . S . len );
+        return rc;
+    }
+};
+
+static void remove_files ( KDirectory * dir ) {
+    KDirectoryRemove ( dir, true, "%s", LOOKUP_FILE );
+    KDirectoryRemove ( dir, true, "%s", INDEX_FILE );
+}
+
+TEST_CASE ( sequential_lookup ) {
+    KDirectory * dir = NULL;
+    REQUIRE_RC ( KDirectoryNativeDir ( & dir ) );
+    spot_set set ( 50000, true );
+    uint64_t logical;
+    REQUIRE_RC ( write_lookup ( dir, set, & logical ) );
+    REQUIRE_RC ( lookup_check_file ( dir, 4096, LOOKUP_FILE ) );
+    {
+        reader_holder r;
+        REQUIRE_RC ( r . open ( dir ) );
+        for ( uint64_t i = 0; i < set . unpacked . size (); ++i ) {
+            std :: string s;
+            REQUIRE_RC ( r . bases ( i, s ) );
+            REQUIRE_EQ ( s, set . ascii [ i ] );
+        }
+    }
+    remove_files ( dir );
+    KDirectoryRelease ( dir );
+}
+
+/* every lookup has to seek: the reader is never positioned at the right place */
+TEST_CASE ( random_lookup ) {
+    KDirectory * dir = NULL;
+    REQUIRE_RC ( KDirectoryNativeDir ( & dir ) );
+    spot_set set ( 50000, true );
+    uint64_t logical;
+    REQUIRE_RC ( write_lookup ( dir, set, & logical ) );
+    {
+        reader_holder r;
+        REQUIRE_RC ( r . open ( dir ) );
+        srand ( 54321 );
+        for ( uint32_t n = 0; n < 2000; ++n ) {
+            uint64_t i = ( ( uint64_t ) rand () * RAND_MAX + rand () ) % set . unpacked . size ();
+            std :: string s;
+            REQUIRE_RC ( r . bases ( i, s ) );
+            REQUIRE_EQ ( s, set . ascii [ i ] );
+        }
+        /* the very last read is at the end of the last block */
+        std :: string s;
+        REQUIRE_RC ( r . bases ( set . unpacked . size () - 1, s ) );
+        REQUIRE_EQ ( s, set . ascii . back () );
+    }
+    remove_files ( dir );
+    KDirectoryRelease ( dir );
+}
+
+/* temp-bytes written vs. the uncompressed lookup-data, and the time it takes */
+TEST_CASE ( temp_bytes_written ) {
+    KDirectory * dir = NULL;
+    REQUIRE_RC ( KDirectoryNativeDir ( & dir ) );
+    spot_set set ( 200000, false );
+    uint64_t logical, stored = 0;
+    KTimeMs_t start = KTimeMsStamp ();
+    REQUIRE_RC ( write_lookup ( dir, set, & logical ) );
+    KTimeMs_t write_ms = KTimeMsStamp () - start;
+    {
+        const KFile * f = NULL;
+        REQUIRE_RC ( KDirectoryOpenFileRead ( dir, & f, "%s", LOOKUP_FILE ) );
+        REQUIRE_RC ( KFileSize ( f, & stored ) );
+        KFileRelease ( f );
+    }
+    start = KTimeMsStamp ();
+    {
+        reader_holder r;
+        REQUIRE_RC ( r . open ( dir ) );
+        for ( uint64_t i = 0; i < set . unpacked . size (); ++i ) {
+            std :: string s;
+            REQUIRE_RC ( r . bases ( i, s ) );
+        }
+    }
+    KTimeMs_t read_ms = KTimeMsStamp () - start;
+    std :: cout << "lookup-data: " << logical << " bytes, written to temp: " << stored
+                << " bytes ( " << ( stored * 100 ) / logical << "% ), write "
+                << write_ms << " ms, read " << read_ms << " ms\n";
+    REQUIRE_LT ( stored, logical );
+    remove_files ( dir );
+    KDirectoryRelease ( dir );
+}
+
+extern "C" {
+    ver_t CC KAppVersion ( void ) { return 0; }
+    rc_t CC KMain ( int argc, char * argv [] ) {
+        return TestLookup ( argc, argv );
+    }
+}
@@ -0,0 +1,127 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+
+#include "../../tools/fasterq-dump/temp_dir.h"
+
+#include <kfs/directory.h> /* KDirectoryNativeDir */
+#include <kfs/file.h> /* KFileRelease */
+
+#include <ktst/unit_test.hpp> // TEST_SUITE
+
+#include <cstring>
+#include <iostream>
+
+TEST_SUITE ( TestTempDir );
+
+static const char * TEMP_DIRS [] = { "tmp_a", "tmp_b", "tmp_c" };
+static const char * REQUESTED = "tmp_a,tmp_b/,tmp_c";
+#define NUM_DIRS ( sizeof TEMP_DIRS / sizeof TEMP_DIRS [ 0 ] )
+#define NUM_FILES 600
+
+/* returns the index of the requested dir the filename is in, or -1 */
+static int dir_of ( const char * filename ) {
+    for ( size_t i = 0; i < NUM_DIRS; ++i ) {
+        size_t len = strlen ( TEMP_DIRS [ i ] );
+        if ( strncmp ( filename, TEMP_DIRS [ i ], len ) == 0 && filename [ len ] == '/' )
+            return ( int ) i;
+    }
+    return -1;
+}
+
+TEST_CASE ( single_dir ) {
+    KDirectory * dir = NULL;
+    REQUIRE_RC ( KDirectoryNativeDir ( & dir ) );
+    struct temp_dir * t = NULL;
+    REQUIRE_RC ( make_temp_dir ( & t, "tmp_a", dir ) );
+    REQUIRE_EQ ( get_temp_dir_count ( t ), ( uint32_t ) 1 );
+    char name [ 4096 ];
+    REQUIRE_RC ( generate_bg_sub_filename ( t, name, sizeof name, 17 ) );
+    REQUIRE_EQ ( strncmp ( name, get_temp_dir ( t ), strlen ( get_temp_dir ( t ) ) ), 0 );
+    REQUIRE_RC ( remove_temp_dir ( t, dir ) );
+    destroy_temp_dir ( t );
+    KDirectoryRemove ( dir, true, "tmp_a" );
+    KDirectoryRelease ( dir );
+}
+
+/* sub-, merge- and joined files land in every dir, and the same id always maps to the same file */
+TEST_CASE ( files_spread_over_dirs ) {
+    KDirectory * dir = NULL;
+    REQUIRE_RC ( KDirectoryNativeDir ( & dir ) );
+    struct temp_dir * t = NULL;
+    REQUIRE_RC ( make_temp_dir ( & t, REQUESTED, dir ) );
+    REQUIRE_EQ ( get_temp_dir_count ( t ), ( uint32_t ) NUM_DIRS );
+
+    uint32_t per_dir [ NUM_DIRS ] = { 0 };
+    for ( uint32_t id = 0; id < NUM_FILES; ++id ) {
+        char name [ 4096 ], again [ 4096 ];
+        int idx;
+
+        REQUIRE_RC ( generate_bg_sub_filename ( t, name, sizeof name, id ) );
+        REQUIRE_RC ( generate_bg_sub_filename ( t, again, sizeof again, id ) );
+        REQUIRE_EQ ( strcmp ( name, again ), 0 );
+        idx = dir_of ( name );
+        REQUIRE_GE ( idx, 0 );
+        per_dir [ idx ]++;
+
+        REQUIRE_RC ( generate_bg_merge_filename ( t, name, sizeof name, id ) );
+        idx = dir_of ( name );
+        REQUIRE_GE ( idx, 0 );
+        per_dir [ idx ]++;
+
+        REQUIRE_RC ( make_joined_filename ( t, name, sizeof name, "SRR000001", id ) );
+        idx = dir_of ( name );
+        REQUIRE_GE ( idx, 0 );
+        per_dir [ idx ]++;
+
+        /* put something there, remove_temp_dir() has to clean it up */
+        if ( id < 10 ) {
+            KFile * f = NULL;
+            REQUIRE_RC ( KDirectoryCreateFile ( dir, & f, false, 0664, kcmInit, "%s", name ) );
+            KFileRelease ( f );
+        }
+    }
+    /* all dirs are on the same device: each one gets about a third */
+    for ( size_t i = 0; i < NUM_DIRS; ++i ) {
+        std :: cout << TEMP_DIRS [ i ] << " : " << per_dir [ i ] << " files\n";
+        REQUIRE_GT ( per_dir [ i ], ( uint32_t ) ( ( 3 * NUM_FILES ) / ( 2 * NUM_DIRS ) ) );
+    }
+
+    REQUIRE_RC ( remove_temp_dir ( t, dir ) );
+    for ( uint32_t i = 0; i < get_temp_dir_count ( t ); ++i )
+        REQUIRE_EQ ( KDirectoryPathType ( dir, "%s", get_temp_dir_by_idx ( t, i ) ), ( uint32_t ) kptNotFound );
+    destroy_temp_dir ( t );
+    for ( size_t i = 0; i < NUM_DIRS; ++i )
+        KDirectoryRemove ( dir, true, "%s", TEMP_DIRS [ i ] );
+    KDirectoryRelease ( dir );
+}
+
+extern "C" {
+    ver_t CC KAppVersion ( void ) { return 0; }
+    rc_t CC KMain ( int argc, char * argv [] ) {
+        return TestTempDir ( argc, argv );
+    }
+}
@@ -0,0 +1,74 @@
+#!/bin/bash
+
+# compares the output of 'bam-load --remap' when the SEQUENCE table of the
+# first output is carried across as blobs ( default ) and when it is
+# rewritten row by row ( --remap-row-copy )
+
+execute()
+{
+    echo "------------------------------------------------------"
+    echo $1
+    eval $1
+    echo "."
+}
+
+# call: produce_SAM "$SAMFILE" "$CONFIG" "$POS0" "$POS1"
+produce_SAM()
+{
+    SAMLINE_BINARY="samline"
+    QNAME="--qname 1"
+    REFNAME="NC_011752.1"
+    ALIG0="-r $REFNAME -p $3 -c 50M"
+    ALIG1="-r $REFNAME -p $4 -c 30M2D20M"
+    execute "$SAMLINE_BINARY $QNAME $ALIG0 $ALIG1 -d -n $2 > $1"
+}
+
+# call: remap_SAM "$CONFIG" "$SAM0" "$SAM1" "$OUT0" "$OUT1" "$EXTRA"
+remap_SAM()
+{
+    BAMLOAD_BINARY="bam-load"
+    execute "rm -rf $4 $5"
+    execute "$BAMLOAD_BINARY -L 3 -o $4 -k $1 -E0 -Q0 $2 --remap $6 -o $5 -k $1 -E0 -Q0 $3"
+}
+
+# call: md5_columns "$CSRA" "$OUTFILE"
+# the SEQUENCE columns that are created with an md5-file
+md5_columns()
+{
+    execute "( cd $1/tbl/SEQUENCE/col && ls -d */md5 | sort ) > $2"
+}
+
+# call: dump_CSRA "$CSRA" "$OUTFILE"
+dump_CSRA()
+{
+    VDBDUMP_BINARY="vdb-dump"
+    execute "$VDBDUMP_BINARY $1 -T SEQUENCE > $2"
+    execute "$VDBDUMP_BINARY $1 -T PRIMARY_ALIGNMENT >> $2"
+}
+
+PREFIX="REMAP"
+CONFIG="${PREFIX}.kfg"
+SAM0="${PREFIX}_0.SAM"
+SAM1="${PREFIX}_1.SAM"
+
+produce_SAM "$SAM0" "$CONFIG" 1000 3500
+produce_SAM "$SAM1" "$CONFIG" 2000 4500
+
+remap_SAM "$CONFIG" "$SAM0" "$SAM1" "${PREFIX}_blob_0" "${PREFIX}_blob_1" ""
+remap_SAM "$CONFIG" "$SAM0" "$SAM1" "${PREFIX}_row_0" "${PREFIX}_row_1" "--remap-row-copy"
+
+dump_CSRA "${PREFIX}_blob_1" "${PREFIX}_blob.txt"
+dump_CSRA "${PREFIX}_row_1" "${PREFIX}_row.txt"
+
+diff "${PREFIX}_blob.txt" "${PREFIX}_row.txt"
+RESULT=$?
+
+md5_columns "${PREFIX}_blob_1" "${PREFIX}_blob.md5"
+md5_columns "${PREFIX}_row_1" "${PREFIX}_row.md5"
+if [ $RESULT -eq 0 ] ; then
+    diff "${PREFIX}_blob.md5" "${PREFIX}_row.md5"
+    RESULT=$?
+fi
+
+execute "rm -rf $CONFIG $SAM0 $SAM1 ${PREFIX}_blob_* ${PREFIX}_row_* ${PREFIX}_blob.txt ${PREFIX}_row.txt ${PREFIX}_blob.md5 ${PREFIX}_row.md5"
+exit $RESULT
@@ -0,0 +1,40 @@
+#!/bin/bash
+
+#sra-pileup throughput with uncompressed, gzip and bzip2 output: the output
+#compressed in the background has to decode with gzip/bzip2 to the plain one
+
+TOOL=$1
+ACC=$2
+
+TMP="./compressed_output_throughput.tmp"
+rm -rf "$TMP"
+mkdir -p "$TMP"
+
+T0=$(date +%s%N)
+$TOOL $ACC -o "$TMP/plain.txt" || exit 1
+T1=$(date +%s%N)
+$TOOL $ACC --gzip -o "$TMP/out.gz" || exit 1
+T2=$(date +%s%N)
+$TOOL $ACC --gzip --disable-multithreading -o "$TMP/inline.gz" || exit 1
+T3=$(date +%s%N)
+$TOOL $ACC --bzip2 -o "$TMP/out.bz2" || exit 1
+T4=$(date +%s%N)
+
+echo "sra-pileup $ACC : plain $(( ( T1 - T0 ) / 1000000 )) ms, gzip $(( ( T2 - T1 ) / 1000000 )) ms, gzip inline $(( ( T3 - T2 ) / 1000000 )) ms, bzip2 $(( ( T4 - T3 ) / 1000000 )) ms"
+
+for F in out.gz inline.gz ; do
+    gzip -dc "$TMP/$F" > "$TMP/decoded.txt" || exit 1
+    if ! diff --brief "$TMP/plain.txt" "$TMP/decoded.txt" ; then
+        echo "sra-pileup --gzip ( $F ) does not decode to the plain output for $ACC"
+        exit 1
+    fi
+done
+
+bzip2 -dc "$TMP/out.bz2" > "$TMP/decoded.txt" || exit 1
+if ! diff --brief "$TMP/plain.txt" "$TMP/decoded.txt" ; then
+    echo "sra-pileup --bzip2 does not decode to the plain output for $ACC"
+    exit 1
+fi
+
+rm -rf "$TMP"
+echo "compressed_output_throughput: $ACC ok"
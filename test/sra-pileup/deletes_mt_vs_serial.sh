@@ -0,0 +1,22 @@
+#!/bin/bash
+
+#the parallel scan of 'sra-pileup --function deletes' has to produce
+#exactly the output of the serial scan ( --disable-multithreading )
+
+TOOL=$1
+ACC=$2
+
+TMP="./deletes_mt_vs_serial.tmp"
+rm -rf "$TMP"
+mkdir -p "$TMP"
+
+$TOOL --function deletes --disable-multithreading $ACC > "$TMP/serial.txt" || exit 1
+$TOOL --function deletes --threads 8 $ACC > "$TMP/parallel.txt" || exit 1
+
+if ! diff --brief "$TMP/serial.txt" "$TMP/parallel.txt" ; then
+    echo "parallel deletes-scan differs from serial scan for $ACC"
+    exit 1
+fi
+
+rm -rf "$TMP"
+echo "deletes_mt_vs_serial: $ACC ok"
@@ -0,0 +1,64 @@
+#!/bin/bash
+
+#sam-dump throughput with and without the MD-tag: the computed tag should
+#not cost much more than the plain dump, and the other columns stay the same;
+#the same for two inputs merged by position ( --dump-mode 2 ), where the
+#alignments of the inputs interleave and each one needs its reference-window
+
+TOOL=$1
+ACC=$2
+
+TMP="./md_flag_throughput.tmp"
+rm -rf "$TMP"
+mkdir -p "$TMP"
+
+T0=$(date +%s%N)
+$TOOL $ACC > "$TMP/plain.sam" || exit 1
+T1=$(date +%s%N)
+$TOOL --with-md-flag $ACC > "$TMP/md.sam" || exit 1
+T2=$(date +%s%N)
+
+PLAIN_MS=$(( ( T1 - T0 ) / 1000000 ))
+MD_MS=$(( ( T2 - T1 ) / 1000000 ))
+echo "sam-dump $ACC : plain ${PLAIN_MS} ms, with MD-tag ${MD_MS} ms"
+
+#removing the MD-field has to give back the plain dump
+sed -e 's/\tMD:Z:[^\t]*//' "$TMP/md.sam" > "$TMP/md_removed.sam"
+if ! diff --brief "$TMP/plain.sam" "$TMP/md_removed.sam" ; then
+    echo "sam-dump --with-md-flag changes more than the MD-field for $ACC"
+    exit 1
+fi
+
+#the run twice, merged: every position comes from both inputs in turn
+T0=$(date +%s%N)
+$TOOL --dump-mode 2 $ACC $ACC > "$TMP/merged_plain.sam" || exit 1
+T1=$(date +%s%N)
+$TOOL --dump-mode 2 --with-md-flag $ACC $ACC > "$TMP/merged_md.sam" || exit 1
+T2=$(date +%s%N)
+
+PLAIN_MS=$(( ( T1 - T0 ) / 1000000 ))
+MD_MS=$(( ( T2 - T1 ) / 1000000 ))
+echo "sam-dump --dump-mode 2 $ACC $ACC : plain ${PLAIN_MS} ms, with MD-tag ${MD_MS} ms"
+
+sed -e 's/\tMD:Z:[^\t]*//' "$TMP/merged_md.sam" > "$TMP/merged_md_removed.sam"
+if ! diff --brief "$TMP/merged_plain.sam" "$TMP/merged_md_removed.sam" ; then
+    echo "sam-dump --dump-mode 2 --with-md-flag changes more than the MD-field for $ACC"
+    exit 1
+fi
+
+#both inputs are the same run: their MD-fields have to be the same as the single one's
+grep -v '^@' "$TMP/md.sam" | grep -o 'MD:Z:[0-9A-Z^]*' | sort > "$TMP/md.tags"
+grep -v '^@' "$TMP/merged_md.sam" | grep -o 'MD:Z:[0-9A-Z^]*' | sort > "$TMP/merged.tags"
+if ! diff --brief <( cat "$TMP/md.tags" "$TMP/md.tags" | sort ) "$TMP/merged.tags" ; then
+    echo "sam-dump --dump-mode 2 --with-md-flag computes other MD-fields than a single input for $ACC"
+    exit 1
+fi
+
+#with a reference-window per input the merged MD-tag costs about twice the single one
+if [ $MD_MS -gt $(( 4 * PLAIN_MS + 4000 )) ] ; then
+    echo "sam-dump --dump-mode 2 --with-md-flag is too slow for $ACC: ${MD_MS} ms vs. ${PLAIN_MS} ms"
+    exit 1
+fi
+
+rm -rf "$TMP"
+echo "md_flag_throughput: $ACC ok"
@@ -0,0 +1,52 @@
+#!/bin/bash
+
+#sam-dump of many small runs at once: the inputs merged by position through a
+#heap ( --dump-mode 2 ) has to print the same as all references prepared in one
+#placement-set-iterator ( --dump-mode 1 ), then both are timed
+
+SAMDUMP=$1
+SAMLINE=$2
+BAMLOAD=$3
+
+RUNS=100
+REFNAME="NC_011752.1"
+
+TMP="./merge_inputs.tmp"
+rm -rf "$TMP"
+mkdir -p "$TMP"
+CONFIG="$TMP/merge.kfg"
+
+#100 synthetic runs, each with a pair of alignments at random positions
+RANDOM=89
+INPUTS=""
+for (( i = 0; i < RUNS; ++i )) ; do
+    P0=$(( 1000 + RANDOM % 20000 ))
+    P1=$(( P0 + 200 + RANDOM % 2000 ))
+    $SAMLINE --qname "R$i" -r $REFNAME -p $P0 -c 50M -r $REFNAME -p $P1 -c 30M2D20M -d -n $CONFIG > "$TMP/run_$i.sam" || exit 1
+    $BAMLOAD -L 3 -o "$TMP/run_$i" -k $CONFIG -E0 -Q0 "$TMP/run_$i.sam" > /dev/null 2>&1 || exit 1
+    INPUTS="$INPUTS $TMP/run_$i"
+done
+
+T0=$(date +%s%N)
+$SAMDUMP --dump-mode 1 $INPUTS > "$TMP/prepare_all.sam" || exit 1
+T1=$(date +%s%N)
+$SAMDUMP --dump-mode 2 $INPUTS > "$TMP/merged.sam" || exit 1
+T2=$(date +%s%N)
+if ! diff --brief "$TMP/prepare_all.sam" "$TMP/merged.sam" ; then
+    echo "sam-dump of $RUNS merged inputs differs from all references prepared at once"
+    exit 1
+fi
+
+#with a region, the windows of the inputs merged too
+REGION="--aligned-region $REFNAME:5000-15000"
+$SAMDUMP --dump-mode 1 $REGION $INPUTS > "$TMP/prepare_all_rgn.sam" || exit 1
+$SAMDUMP --dump-mode 2 $REGION $INPUTS > "$TMP/merged_rgn.sam" || exit 1
+if ! diff --brief "$TMP/prepare_all_rgn.sam" "$TMP/merged_rgn.sam" ; then
+    echo "sam-dump of $RUNS merged inputs differs from all references prepared at once ( region )"
+    exit 1
+fi
+
+echo "sam-dump of $RUNS runs : prepare all refs $(( ( T1 - T0 ) / 1000000 )) ms, merge inputs $(( ( T2 - T1 ) / 1000000 )) ms"
+
+rm -rf "$TMP"
+echo "merge_inputs_vs_prepare_all: ok"
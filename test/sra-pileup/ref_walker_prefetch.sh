@@ -0,0 +1,78 @@
+#!/bin/bash
+
+#the ref-walker ( sra-pileup --function test ) has to call its callbacks in the
+#same order, and print the same, with the next window loaded in the background
+#as with the windows loaded one after the other ( --disable-multithreading ),
+#then both are timed on the run served by a throttled local http-server
+
+PILEUP=$1
+SAMDUMP=$2
+SRAPATH=$3
+ACC=$4
+
+PORT=18088
+
+TMP="./ref_walker_prefetch.tmp"
+rm -rf "$TMP"
+mkdir -p "$TMP/www"
+
+#name and length of the first two references from the SAM-header
+$SAMDUMP $ACC 2>/dev/null | awk '/^@SQ/ { print } !/^@/ { exit }' | head -n 2 | \
+    sed -e 's/.*SN:\([^\t]*\).*LN:\([0-9]*\).*/\1 \2/' > "$TMP/refs.txt"
+if [ ! -s "$TMP/refs.txt" ] ; then
+    echo "no references found in $ACC"
+    exit 1
+fi
+
+#50 windows per reference, each one a window of the ref-walker
+ARGS=$( awk 'BEGIN { srand( 88 ) }
+             { for ( i = 0; i < 50; ++i ) { s = 1 + int( rand() * ( $2 - 5000 ) ); printf( " -r %s:%d-%d", $1, s, s + 2000 ) } }' \
+        "$TMP/refs.txt" )
+
+$PILEUP --function test --disable-multithreading $ARGS $ACC > "$TMP/serial.txt" || exit 1
+$PILEUP --function test $ARGS $ACC > "$TMP/prefetch.txt" || exit 1
+if ! diff --brief "$TMP/serial.txt" "$TMP/prefetch.txt" ; then
+    echo "ref-walker with prefetch differs from the serial ref-walker for $ACC"
+    exit 1
+fi
+
+#one window per reference
+$PILEUP --function test --disable-multithreading $ACC > "$TMP/serial_all.txt" || exit 1
+$PILEUP --function test $ACC > "$TMP/prefetch_all.txt" || exit 1
+if ! diff --brief "$TMP/serial_all.txt" "$TMP/prefetch_all.txt" ; then
+    echo "ref-walker with prefetch differs from the serial ref-walker for $ACC ( whole references )"
+    exit 1
+fi
+
+#benchmark: the run served with 20 ms latency and 8 MB/s per request
+SRC=$( $SRAPATH $ACC | head -n 1 )
+case "$SRC" in
+    http*) curl -s -o "$TMP/www/$ACC.sra" "$SRC" || exit 1 ;;
+    *) cp "$SRC" "$TMP/www/$ACC.sra" || exit 1 ;;
+esac
+python3 ./throttled_http_server.py "$TMP/www" $PORT 20 8192 &
+SERVER=$!
+sleep 1
+URL="http://127.0.0.1:$PORT/$ACC.sra"
+
+T0=$(date +%s%N)
+$PILEUP --function test --disable-multithreading $ARGS $URL > "$TMP/served_serial.txt"
+RC1=$?
+T1=$(date +%s%N)
+$PILEUP --function test $ARGS $URL > "$TMP/served_prefetch.txt"
+RC2=$?
+T2=$(date +%s%N)
+kill $SERVER
+
+if [ $RC1 -ne 0 -o $RC2 -ne 0 ] ; then
+    echo "sra-pileup failed on the served run $URL"
+    exit 1
+fi
+if ! diff --brief "$TMP/served_serial.txt" "$TMP/served_prefetch.txt" ; then
+    echo "ref-walker with prefetch differs from the serial ref-walker on the served run"
+    exit 1
+fi
+echo "ref-walker on throttled $ACC, 100 windows : serial $(( ( T1 - T0 ) / 1000000 )) ms, prefetch $(( ( T2 - T1 ) / 1000000 )) ms"
+
+rm -rf "$TMP"
+echo "ref_walker_prefetch: $ACC ok"
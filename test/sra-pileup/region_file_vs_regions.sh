@@ -0,0 +1,94 @@
+#!/bin/bash
+
+#sra-pileup and sam-dump with a BED region-file have to print the same as
+#per-region queries on the command line, then both are timed on a
+#200k-interval region-file
+
+PILEUP=$1
+SAMDUMP=$2
+ACC=$3
+
+TMP="./region_file_vs_regions.tmp"
+rm -rf "$TMP"
+mkdir -p "$TMP"
+
+#name and length of the first two references from the SAM-header
+$SAMDUMP $ACC 2>/dev/null | awk '/^@SQ/ { print } !/^@/ { exit }' | head -n 2 | \
+    sed -e 's/.*SN:\([^\t]*\).*LN:\([0-9]*\).*/\1 \2/' > "$TMP/refs.txt"
+if [ ! -s "$TMP/refs.txt" ] ; then
+    echo "no references found in $ACC"
+    exit 1
+fi
+
+#200 random intervals per reference, BED: 0-based, end exclusive
+awk 'BEGIN { srand( 86 ) }
+     { for ( i = 0; i < 200; ++i ) { s = int( rand() * ( $2 - 1000 ) ); print $1 "\t" s "\t" s + 1 + int( rand() * 500 ) } }' \
+    "$TMP/refs.txt" > "$TMP/small.bed"
+
+#the same intervals as 1-based, inclusive command-line regions
+awk '{ printf( "%s:%d-%d\n", $1, $2 + 1, $3 ) }' "$TMP/small.bed" > "$TMP/small.regions"
+PILEUP_ARGS=""
+SAMDUMP_ARGS=""
+while read R ; do
+    PILEUP_ARGS="$PILEUP_ARGS -r $R"
+    SAMDUMP_ARGS="$SAMDUMP_ARGS --aligned-region $R"
+done < "$TMP/small.regions"
+
+#per-region queries: no merging of neighboring regions
+$PILEUP $PILEUP_ARGS --merge-dist 0 $ACC > "$TMP/pileup_regions.txt" || exit 1
+$PILEUP --region-file "$TMP/small.bed" $ACC > "$TMP/pileup_file.txt" || exit 1
+if ! diff --brief "$TMP/pileup_regions.txt" "$TMP/pileup_file.txt" ; then
+    echo "sra-pileup --region-file differs from the per-region queries for $ACC"
+    exit 1
+fi
+
+$SAMDUMP --no-header $SAMDUMP_ARGS $ACC > "$TMP/sam_regions.sam" || exit 1
+$SAMDUMP --no-header --region-file "$TMP/small.bed" $ACC > "$TMP/sam_file.sam" || exit 1
+if ! diff --brief "$TMP/sam_regions.sam" "$TMP/sam_file.sam" ; then
+    echo "sam-dump --region-file differs from the per-region queries for $ACC"
+    exit 1
+fi
+
+#the first base of a reference: BED 'ref 0 1' is that base, not the whole reference,
+#alone and together with an other interval
+REF=$( head -n 1 "$TMP/refs.txt" | cut -d ' ' -f 1 )
+printf "%s\t0\t1\n" "$REF" > "$TMP/first.bed"
+printf "%s\t0\t1\n%s\t1000\t2000\n" "$REF" "$REF" > "$TMP/first_and_other.bed"
+$SAMDUMP --no-header --aligned-region "$REF" $ACC > "$TMP/sam_whole.sam" || exit 1
+for NAME in first first_and_other ; do
+    REGIONS="--aligned-region $REF:1-1"
+    [ "$NAME" = "first_and_other" ] && REGIONS="$REGIONS --aligned-region $REF:1001-2000"
+    $SAMDUMP --no-header $REGIONS $ACC > "$TMP/sam_${NAME}_regions.sam" || exit 1
+    $SAMDUMP --no-header --region-file "$TMP/$NAME.bed" $ACC > "$TMP/sam_${NAME}_file.sam" || exit 1
+    if ! diff --brief "$TMP/sam_${NAME}_regions.sam" "$TMP/sam_${NAME}_file.sam" ; then
+        echo "sam-dump --region-file $NAME.bed differs from the per-region queries for $ACC"
+        exit 1
+    fi
+    if [ $( wc -l < "$TMP/sam_${NAME}_file.sam" ) -ge $( wc -l < "$TMP/sam_whole.sam" ) ] ; then
+        echo "sam-dump --region-file $NAME.bed dumps the whole reference $REF of $ACC"
+        exit 1
+    fi
+done
+$PILEUP -r "$REF:1-1" $ACC > "$TMP/pileup_first_region.txt" || exit 1
+$PILEUP --region-file "$TMP/first.bed" $ACC > "$TMP/pileup_first_file.txt" || exit 1
+if ! diff --brief "$TMP/pileup_first_region.txt" "$TMP/pileup_first_file.txt" ; then
+    echo "sra-pileup --region-file first.bed differs from the first base of $REF for $ACC"
+    exit 1
+fi
+
+#BED-scale: 200k intervals over the references
+awk 'BEGIN { srand( 2086 ) }
+     { n[ NR ] = $1; l[ NR ] = $2 }
+     END { for ( i = 0; i < 200000; ++i ) { r = 1 + ( i % NR ); s = int( rand() * ( l[ r ] - 1000 ) );
+                                            print n[ r ] "\t" s "\t" s + 1 + int( rand() * 500 ) } }' \
+    "$TMP/refs.txt" > "$TMP/big.bed"
+
+T0=$(date +%s%N)
+$PILEUP --region-file "$TMP/big.bed" $ACC > /dev/null || exit 1
+T1=$(date +%s%N)
+$SAMDUMP --no-header --region-file "$TMP/big.bed" $ACC > /dev/null || exit 1
+T2=$(date +%s%N)
+echo "200k intervals on $ACC : sra-pileup $(( ( T1 - T0 ) / 1000000 )) ms, sam-dump $(( ( T2 - T1 ) / 1000000 )) ms"
+
+rm -rf "$TMP"
+echo "region_file_vs_regions: $ACC ok"
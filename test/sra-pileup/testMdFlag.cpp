@@ -0,0 +1,300 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "../../tools/sra-pileup/md_flag.h"
+
+#include <klib/time.h> /* KTimeMsStamp */
+
+#include <ktst/unit_test.hpp> // TEST_SUITE
+
+#include <cctype>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/* md_flag.c is compiled with ReferenceObj_Read redirected to here ( see Makefile ),
+   it reads its reference-window from an in-memory reference */
+static const char * spl_md_ref_bases = NULL;
+static uint32_t spl_md_ref_len = 0;
+static uint32_t spl_md_ref_reads = 0;
+
+extern "C" rc_t CC spl_md_ReferenceObj_Read( const struct ReferenceObj * cself, INSDC_coord_zero offset,
+                                             INSDC_coord_len len, uint8_t * buffer, INSDC_coord_len * written )
+{
+    spl_md_ref_reads++;
+    if ( offset < 0 || ( uint32_t )offset >= spl_md_ref_len )
+        return RC( rcApp, rcNoTarg, rcReading, rcParam, rcInvalid );
+    if ( ( uint32_t )offset + len > spl_md_ref_len )
+        len = spl_md_ref_len - offset;
+    memmove( buffer, &( spl_md_ref_bases[ offset ] ), len );
+    *written = len;
+    return 0;
+}
+
+TEST_SUITE ( TestMdFlag );
+
+/* the MD-generator as it was before: cigar parsed into an op/count array,
+   the tag printed piece by piece; returns false where it returned an error */
+static bool old_md ( const char * cigar, const std :: string & read, const std :: string & ref, std :: string & out ) {
+    std :: vector < std :: pair < char, int > > ops;
+    int count = 0;
+    for ( const char * c = cigar; * c != 0; ++c ) {
+        if ( isdigit ( * c ) )
+            count = count * 10 + ( * c - '0' );
+        else {
+            ops . push_back ( std :: make_pair ( * c, count == 0 ? 1 : count ) );
+            count = 0;
+        }
+    }
+    if ( read . empty () || ref . empty () )
+        return false;
+    int read_idx = 0, ref_idx = 0, match_count = 0;
+    int read_len = ( int ) read . size (), ref_len = ( int ) ref . size ();
+    std :: ostringstream ss;
+    for ( size_t i = 0; i < ops . size (); ++i ) {
+        int n = ops [ i ] . second;
+        switch ( ops [ i ] . first ) {
+            case 'D' :
+                if ( match_count > 0 ) { ss << match_count; match_count = 0; }
+                if ( ref_idx + n >= ref_len ) return false;
+                ss << '^' << ref . substr ( ref_idx, n );
+                ref_idx += n;
+                break;
+            case 'I' : read_idx += n; break;
+            case 'M' :
+                for ( int j = 0; j < n; ++j ) {
+                    if ( read_idx >= read_len || ref_idx >= ref_len ) return false;
+                    if ( read [ read_idx++ ] == ref [ ref_idx ] )
+                        match_count++;
+                    else {
+                        ss << match_count << ref [ ref_idx ];
+                        match_count = 0;
+                    }
+                    ref_idx++;
+                }
+                break;
+        }
+    }
+    if ( match_count > 0 ) ss << match_count;
+    out = ss . str ();
+    return true;
+}
+
+static bool new_md ( const char * cigar, const std :: string & read, const std :: string & ref,
+                     std :: string & out, uint32_t * nm ) {
+    std :: vector < char > buf ( ref . size () * 12 + 12 );
+    size_t written;
+    rc_t rc = md_tag_from_cigar_string ( cigar, strlen ( cigar ), read . c_str (), read . size (),
+                                         ( const uint8_t * ) ref . c_str (), ( INSDC_coord_len ) ref . size (),
+                                         & buf [ 0 ], buf . size (), & written, nm );
+    if ( rc != 0 )
+        return false;
+    out . assign ( & buf [ 0 ], written );
+    return true;
+}
+
+static bool same_as_old ( const char * cigar, const std :: string & read, const std :: string & ref ) {
+    std :: string o, n;
+    bool ok_old = old_md ( cigar, read, ref, o );
+    bool ok_new = new_md ( cigar, read, ref, n, NULL );
+    if ( ok_old != ok_new || ( ok_old && o != n ) ) {
+        std :: cerr << cigar << " : old " << ( ok_old ? o : "<error>" ) << " new " << ( ok_new ? n : "<error>" ) << "\n";
+        return false;
+    }
+    return true;
+}
+
+TEST_CASE ( all_matches ) {
+    std :: string md;
+    uint32_t nm = 99;
+    REQUIRE ( new_md ( "8M", "ACGTACGT", "ACGTACGT", md, & nm ) );
+    REQUIRE_EQ ( md, std :: string ( "8" ) );
+    REQUIRE_EQ ( nm, ( uint32_t ) 0 );
+}
+
+TEST_CASE ( mismatches_deletes_inserts ) {
+    std :: string md;
+    uint32_t nm;
+    /* ref: ACGTA CG TTGCA, read: ACCTA + 2 inserted + TTGGA */
+    REQUIRE ( new_md ( "5M2D2I5M", "ACCTAGGTTGGA", "ACGTACGTTGCAAA", md, & nm ) );
+    REQUIRE_EQ ( md, std :: string ( "2G2^CG3C1" ) );
+    REQUIRE_EQ ( nm, ( uint32_t ) 6 );
+    REQUIRE ( same_as_old ( "5M2D2I5M", "ACCTAGGTTGGA", "ACGTACGTTGCAAA" ) );
+}
+
+TEST_CASE ( edge_case_cigars ) {
+    const std :: string ref = "ACGTACGTTGCAAACCGGTTNACGT";
+    const std :: string read = "ACGTACGTAGCAAACCGGTTNACGT";
+    const char * cigars [] = {
+        "M",            /* missing count means 1 */
+        "1M",
+        "25M",
+        "24M",
+        "1X24M",        /* ops other than M, I, D are skipped */
+        "3S22M",        /* ... soft-clips too, as before */
+        "10M5N10M",
+        "1D10M",        /* delete first */
+        "10M1D",        /* delete last */
+        "9M1D1D9M",     /* adjacent deletes */
+        "8M1I8M",       /* insert right at the mismatch */
+        "MMMM",
+        "26M",          /* runs past read and reference */
+        "20M10D",       /* delete reaches the end of the reference */
+        "0M5M",
+        "",
+        "I",
+    };
+    for ( size_t i = 0; i < sizeof cigars / sizeof cigars [ 0 ]; ++i )
+        REQUIRE ( same_as_old ( cigars [ i ], read, ref ) );
+    REQUIRE ( same_as_old ( "5M", "", ref ) );
+    REQUIRE ( same_as_old ( "5M", read, "" ) );
+}
+
+TEST_CASE ( mismatch_after_zero_matches ) {
+    std :: string md;
+    REQUIRE ( new_md ( "3M", "TTT", "AAA", md, NULL ) );
+    REQUIRE_EQ ( md, std :: string ( "0A0A0A" ) );
+}
+
+TEST_CASE ( cigar_length_is_honored ) {
+    /* the cigar-column is not 0-terminated: only the first 3 bytes belong to it */
+    const char cigar [] = { '4', 'M', '9', 'D', '9', 'M' };
+    char buf [ 64 ];
+    size_t written;
+    REQUIRE_RC ( md_tag_from_cigar_string ( cigar, 2, "ACGT", 4, ( const uint8_t * ) "ACGTAAAA", 8,
+                                            buf, sizeof buf, & written, NULL ) );
+    REQUIRE_EQ ( std :: string ( buf, written ), std :: string ( "4" ) );
+}
+
+TEST_CASE ( too_small_buffer_is_an_error ) {
+    char buf [ 2 ];
+    size_t written;
+    rc_t rc = md_tag_from_cigar_string ( "4M", 2, "TTTT", 4, ( const uint8_t * ) "AAAA", 4,
+                                         buf, sizeof buf, & written, NULL );
+    REQUIRE ( rc != 0 );
+}
+
+struct lcg {
+    uint64_t state;
+    lcg () : state ( 0x853C49E6748FEA9BULL ) {}
+    uint32_t next ( uint32_t n ) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return ( uint32_t ) ( state >> 33 ) % n;
+    }
+};
+
+/* random alignments: read derived from the reference with mismatches, inserts and deletes */
+static void random_alignment ( lcg & r, std :: string & cigar, std :: string & read, std :: string & ref ) {
+    static const char bases [] = "ACGTN";
+    std :: ostringstream cg;
+    read . clear (); ref . clear ();
+    uint32_t ops = 1 + r . next ( 8 );
+    for ( uint32_t i = 0; i < ops; ++i ) {
+        uint32_t n = 1 + r . next ( 40 );
+        char op = ( i == 0 || i + 1 == ops || r . next ( 3 ) == 0 ) ? 'M' : ( r . next ( 2 ) ? 'I' : 'D' );
+        cg << n << op;
+        for ( uint32_t j = 0; j < n; ++j ) {
+            char b = bases [ r . next ( 5 ) ];
+            if ( op != 'I' ) ref += b;
+            if ( op == 'M' ) read += ( r . next ( 10 ) == 0 ) ? bases [ r . next ( 5 ) ] : b;
+            if ( op == 'I' ) read += bases [ r . next ( 4 ) ];
+        }
+    }
+    ref += "ACGT";  /* the old generator wants some reference after a final delete */
+    cigar = cg . str ();
+}
+
+TEST_CASE ( random_alignments_same_as_old ) {
+    lcg r;
+    std :: string cigar, read, ref;
+    for ( uint32_t i = 0; i < 20000; ++i ) {
+        random_alignment ( r, cigar, read, ref );
+        REQUIRE ( same_as_old ( cigar . c_str (), read, ref ) );
+    }
+}
+
+TEST_CASE ( reference_window_is_reused ) {
+    std :: string ref ( 200000, 'A' );
+    for ( size_t i = 0; i < ref . size (); ++i ) ref [ i ] = "ACGT" [ ( i * 7 + i / 3 ) % 4 ];
+    spl_md_ref_bases = ref . c_str ();
+    spl_md_ref_len = ( uint32_t ) ref . size ();
+    spl_md_ref_reads = 0;
+
+    int dummy_ref = 0;
+    struct ReferenceObj const * ref_obj = ( struct ReferenceObj const * ) & dummy_ref;
+    struct md_ref_cache * c = make_md_ref_cache ();
+    REQUIRE_NOT_NULL ( c );
+    const uint8_t * bases;
+    INSDC_coord_len len;
+    for ( INSDC_coord_zero pos = 0; pos < 199900; pos += 50 ) {
+        REQUIRE_RC ( md_ref_cache_get ( c, ref_obj, pos, 100, & bases, & len ) );
+        REQUIRE_EQ ( len, ( INSDC_coord_len ) 100 );
+        REQUIRE ( memcmp ( bases, ref . c_str () + pos, 100 ) == 0 );
+    }
+    REQUIRE_LT ( spl_md_ref_reads, ( uint32_t ) 10 );
+
+    /* at the end of the reference fewer bases come back, as from ReferenceObj_Read */
+    REQUIRE_RC ( md_ref_cache_get ( c, ref_obj, 199950, 100, & bases, & len ) );
+    REQUIRE_EQ ( len, ( INSDC_coord_len ) 50 );
+    REQUIRE ( memcmp ( bases, ref . c_str () + 199950, 50 ) == 0 );
+
+    /* going back re-reads */
+    REQUIRE_RC ( md_ref_cache_get ( c, ref_obj, 10, 100, & bases, & len ) );
+    REQUIRE ( memcmp ( bases, ref . c_str () + 10, 100 ) == 0 );
+    free_md_ref_cache ( c );
+}
+
+/* MD-values per second, one-pass generator vs. the old parse-then-print one */
+TEST_CASE ( md_benchmark ) {
+    lcg r;
+    std :: vector < std :: string > cigars, reads, refs;
+    for ( uint32_t i = 0; i < 200000; ++i ) {
+        std :: string c, rd, rf;
+        random_alignment ( r, c, rd, rf );
+        cigars . push_back ( c ); reads . push_back ( rd ); refs . push_back ( rf );
+    }
+    std :: string md;
+    size_t total = 0;
+    KTimeMs_t start = KTimeMsStamp ();
+    for ( size_t i = 0; i < cigars . size (); ++i )
+        if ( new_md ( cigars [ i ] . c_str (), reads [ i ], refs [ i ], md, NULL ) ) total += md . size ();
+    KTimeMs_t ms_new = KTimeMsStamp () - start;
+    start = KTimeMsStamp ();
+    for ( size_t i = 0; i < cigars . size (); ++i )
+        if ( old_md ( cigars [ i ] . c_str (), reads [ i ], refs [ i ], md ) ) total -= md . size ();
+    KTimeMs_t ms_old = KTimeMsStamp () - start;
+    REQUIRE_EQ ( total, ( size_t ) 0 );
+    std :: cout << cigars . size () << " MD-values : one-pass " << ms_new << " ms, parse-then-print " << ms_old << " ms\n";
+}
+
+extern "C" {
+    ver_t CC KAppVersion ( void ) { return 0; }
+    rc_t CC KMain ( int argc, char * argv [] ) {
+        return TestMdFlag ( argc, argv );
+    }
+}
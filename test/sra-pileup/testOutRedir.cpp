@@ -0,0 +1,242 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "../../tools/sra-pileup/out_redir.h"
+
+#include <klib/time.h>
+
+#include <ktst/unit_test.hpp> // TEST_SUITE
+
+#include <zlib.h>
+#include <bzlib.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+TEST_SUITE ( TestOutRedir );
+
+static const char * out_file = "./test_out_redir.out";
+
+static std::string read_file ( const char * path ) {
+    std::string res;
+    FILE * f = fopen ( path, "rb" );
+    if ( f != NULL ) {
+        char buf [ 64 * 1024 ];
+        size_t n;
+        while ( ( n = fread ( buf, 1, sizeof buf, f ) ) > 0 )
+            res.append ( buf, n );
+        fclose ( f );
+    }
+    return res;
+}
+
+/* decodes all gzip-members, as 'gzip -d' does */
+static bool gunzip ( const std::string & packed, std::string & res ) {
+    z_stream s = z_stream ();
+    if ( inflateInit2 ( & s, 15 + 16 ) != Z_OK )
+        return false;
+    s.next_in = ( Bytef * ) packed.data ();
+    s.avail_in = packed.size ();
+    bool ok = true;
+    while ( ok ) {
+        char buf [ 64 * 1024 ];
+        s.next_out = ( Bytef * ) buf;
+        s.avail_out = sizeof buf;
+        int zrc = inflate ( & s, Z_NO_FLUSH );
+        res.append ( buf, sizeof buf - s.avail_out );
+        if ( zrc == Z_STREAM_END ) {
+            if ( s.avail_in == 0 )
+                break;
+            ok = ( inflateReset ( & s ) == Z_OK ); /* the next member */
+        }
+        else
+            ok = ( zrc == Z_OK );
+    }
+    inflateEnd ( & s );
+    return ok;
+}
+
+/* decodes all concatenated bzip2-streams, as 'bzip2 -d' does */
+static bool bunzip2 ( const std::string & packed, std::string & res ) {
+    size_t used = 0;
+    do {
+        bz_stream s = bz_stream ();
+        if ( BZ2_bzDecompressInit ( & s, 0, 0 ) != BZ_OK )
+            return false;
+        s.next_in = ( char * ) packed.data () + used;
+        s.avail_in = packed.size () - used;
+        int brc = BZ_OK;
+        while ( brc == BZ_OK ) {
+            char buf [ 64 * 1024 ];
+            s.next_out = buf;
+            s.avail_out = sizeof buf;
+            brc = BZ2_bzDecompress ( & s );
+            res.append ( buf, sizeof buf - s.avail_out );
+            if ( brc == BZ_OK && s.avail_in == 0 && s.avail_out > 0 )
+                brc = BZ_UNEXPECTED_EOF;
+        }
+        used = packed.size () - s.avail_in;
+        BZ2_bzDecompressEnd ( & s );
+        if ( brc != BZ_STREAM_END )
+            return false;
+    } while ( used < packed.size () );
+    return true;
+}
+
+/* pileup-like lines, several MB to cross the block-boundaries */
+static std::string write_lines ( size_t count ) {
+    std::string expected;
+    char line [ 256 ];
+    srand ( 87 );
+    for ( size_t i = 0; i < count; ++i ) {
+        int n = snprintf ( line, sizeof line, "chr1\t%zu\t%c\t%d\t%.*s\n", i + 1, "ACGT" [ rand () % 4 ],
+                           rand () % 60, rand () % 60, "..,,..,,..,,..,..A..,,..,,..,,.,,..C..,,..,,..G,,..,,..,..,," );
+        expected.append ( line, n );
+        KOutMsg ( "%s", line );
+    }
+    return expected;
+}
+
+static std::string round_trip ( enum out_redir_mode mode, uint32_t threads, size_t lines, std::string & expected ) {
+    out_redir redir;
+    if ( init_out_redir_mt ( & redir, mode, out_file, 32 * 1024, threads ) != 0 )
+        return std::string ( "init failed" );
+    expected = write_lines ( lines );
+    if ( release_out_redir ( & redir ) != 0 ) {
+        remove ( out_file );
+        return std::string ( "release failed" );
+    }
+    std::string packed = read_file ( out_file ), res;
+    remove ( out_file );
+    bool ok = true;
+    switch ( mode ) {
+        case orm_gzip  : ok = gunzip ( packed, res ); break;
+        case orm_bzip2 : ok = bunzip2 ( packed, res ); break;
+        default : res = packed; break;
+    }
+    return ok ? res : std::string ( "decode failed" );
+}
+
+TEST_CASE ( gzip_round_trip ) {
+    const uint32_t threads [] = { 0, 1, 2, 4 };
+    for ( size_t i = 0; i < sizeof threads / sizeof threads [ 0 ]; ++i ) {
+        std::string expected;
+        std::string res = round_trip ( orm_gzip, threads [ i ], 120000, expected );
+        REQUIRE ( res == expected );
+    }
+}
+
+TEST_CASE ( bzip2_round_trip ) {
+    const uint32_t threads [] = { 0, 1, 3 };
+    for ( size_t i = 0; i < sizeof threads / sizeof threads [ 0 ]; ++i ) {
+        std::string expected;
+        std::string res = round_trip ( orm_bzip2, threads [ i ], 60000, expected );
+        REQUIRE ( res == expected );
+    }
+}
+
+TEST_CASE ( uncompressed_stays_plain ) {
+    std::string expected;
+    std::string res = round_trip ( orm_uncompressed, OUT_REDIR_COMPRESS_THREADS, 20000, expected );
+    REQUIRE ( res == expected );
+}
+
+TEST_CASE ( empty_output_is_decodable ) {
+    std::string expected;
+    REQUIRE ( round_trip ( orm_gzip, 4, 0, expected ).empty () );
+    REQUIRE ( round_trip ( orm_bzip2, 4, 0, expected ).empty () );
+}
+
+/* a write-error of the background stage is returned by the release */
+TEST_CASE ( background_error_is_returned ) {
+    FILE * full = fopen ( "/dev/full", "w" );
+    if ( full == NULL )
+        return; /* not on this platform */
+    fclose ( full );
+
+    const uint32_t threads [] = { 1, OUT_REDIR_COMPRESS_THREADS };
+    for ( size_t i = 0; i < sizeof threads / sizeof threads [ 0 ]; ++i ) {
+        out_redir redir;
+        REQUIRE_RC ( init_out_redir_mt ( & redir, orm_gzip, "/dev/full", 32 * 1024, threads [ i ] ) );
+        write_lines ( 20000 );
+        REQUIRE_RC_FAIL ( release_out_redir ( & redir ) );
+    }
+}
+
+/* one background thread feeds a single gzip/bzip2-writer: its trailer is written by the release */
+TEST_CASE ( single_background_thread ) {
+    std::string expected;
+    REQUIRE ( round_trip ( orm_gzip, 1, 30000, expected ) == expected );
+    REQUIRE ( round_trip ( orm_bzip2, 1, 30000, expected ) == expected );
+    REQUIRE ( round_trip ( orm_gzip, 1, 0, expected ).empty () );
+
+    FILE * full = fopen ( "/dev/full", "w" );
+    if ( full == NULL )
+        return; /* not on this platform */
+    fclose ( full );
+
+    /* too little output to fill a block: nothing fails before the writer is released */
+    const enum out_redir_mode modes [] = { orm_gzip, orm_bzip2 };
+    for ( size_t i = 0; i < sizeof modes / sizeof modes [ 0 ]; ++i ) {
+        out_redir redir;
+        REQUIRE_RC ( init_out_redir_mt ( & redir, modes [ i ], "/dev/full", 32 * 1024, 1 ) );
+        write_lines ( 10 );
+        REQUIRE_RC_FAIL ( release_out_redir ( & redir ) );
+    }
+}
+
+/* throughput of ~100 MB pileup-lines: uncompressed, compressed inline and in the background */
+TEST_CASE ( compression_benchmark ) {
+    struct { enum out_redir_mode mode; uint32_t threads; const char * name; } runs [] = {
+        { orm_uncompressed, 0, "uncompressed" },
+        { orm_gzip, 0, "gzip inline" },
+        { orm_gzip, 1, "gzip background" },
+        { orm_gzip, OUT_REDIR_COMPRESS_THREADS, "gzip parallel" },
+        { orm_bzip2, 0, "bzip2 inline" },
+        { orm_bzip2, OUT_REDIR_COMPRESS_THREADS, "bzip2 parallel" }
+    };
+    for ( size_t i = 0; i < sizeof runs / sizeof runs [ 0 ]; ++i ) {
+        out_redir redir;
+        KTimeMs_t t0 = KTimeMsStamp ();
+        REQUIRE_RC ( init_out_redir_mt ( & redir, runs [ i ] . mode, out_file, 32 * 1024, runs [ i ] . threads ) );
+        std::string written = write_lines ( 1500000 );
+        REQUIRE_RC ( release_out_redir ( & redir ) );
+        KTimeMs_t t1 = KTimeMsStamp ();
+        std::cerr << runs [ i ] . name << ": " << written.size () / ( 1024 * 1024 ) << " MB in "
+                  << ( t1 - t0 ) << " ms, " << read_file ( out_file ).size () / 1024 << " KB written" << std::endl;
+        remove ( out_file );
+    }
+}
+
+extern "C" {
+    ver_t CC KAppVersion ( void ) { return 0; }
+    rc_t CC KMain ( int argc, char * argv [] ) {
+        return TestOutRedir ( argc, argv );
+    }
+}
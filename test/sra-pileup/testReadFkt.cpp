@@ -0,0 +1,252 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "../../tools/sra-pileup/read_fkt.h"
+
+#include <klib/time.h>
+#include <kfs/directory.h>
+#include <vdb/manager.h>
+#include <vdb/schema.h>
+#include <vdb/table.h>
+#include <vdb/cursor.h>
+
+#include <ktst/unit_test.hpp> // TEST_SUITE
+
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+TEST_SUITE ( TestReadFkt );
+
+static const char * tbl_path = "./test_read_fkt.tbl";
+
+static const char * schema_text =
+    "table read_fkt_test #1.0.0\n"
+    "{\n"
+    " column U8 U8;\n"
+    " column U32 U32;\n"
+    " column I32 I32;\n"
+    " column I64 I64;\n"
+    "};\n";
+
+/* row r has r % 5 elements ( every 5th row is empty ), element k of it is r * 7 + k */
+static const int64_t row_count = 50000;
+static const int64_t blob_rows = 1000;
+
+#define CHECK_RC(call) { rc_t rc = call; if ( rc != 0 ) return rc; }
+
+template < typename T >
+static rc_t write_cell ( VCursor * curs, uint32_t idx, int64_t row ) {
+    T v [ 5 ];
+    uint32_t n = ( uint32_t ) ( row % 5 );
+    for ( uint32_t k = 0; k < n; ++k )
+        v [ k ] = ( T ) ( row * 7 + k );
+    return VCursorWrite ( curs, idx, 8 * sizeof ( T ), v, 0, n );
+}
+
+static rc_t make_table ( void ) {
+    VDBManager * mgr;
+    CHECK_RC ( VDBManagerMakeUpdate ( & mgr, NULL ) );
+    VSchema * schema;
+    CHECK_RC ( VDBManagerMakeSchema ( mgr, & schema ) );
+    CHECK_RC ( VSchemaParseText ( schema, NULL, schema_text, strlen ( schema_text ) ) );
+    VTable * tbl;
+    CHECK_RC ( VDBManagerCreateTable ( mgr, & tbl, schema, "read_fkt_test", kcmInit + kcmMD5, "%s", tbl_path ) );
+    VCursor * curs;
+    CHECK_RC ( VTableCreateCursorWrite ( tbl, & curs, kcmInsert ) );
+    uint32_t idx [ 4 ];
+    CHECK_RC ( VCursorAddColumn ( curs, & idx [ 0 ], "U8" ) );
+    CHECK_RC ( VCursorAddColumn ( curs, & idx [ 1 ], "U32" ) );
+    CHECK_RC ( VCursorAddColumn ( curs, & idx [ 2 ], "I32" ) );
+    CHECK_RC ( VCursorAddColumn ( curs, & idx [ 3 ], "I64" ) );
+    CHECK_RC ( VCursorOpen ( curs ) );
+    for ( int64_t row = 1; row <= row_count; ++row ) {
+        CHECK_RC ( VCursorOpenRow ( curs ) );
+        CHECK_RC ( write_cell < uint8_t > ( curs, idx [ 0 ], row ) );
+        CHECK_RC ( write_cell < uint32_t > ( curs, idx [ 1 ], row ) );
+        CHECK_RC ( write_cell < int32_t > ( curs, idx [ 2 ], row ) );
+        CHECK_RC ( write_cell < int64_t > ( curs, idx [ 3 ], row ) );
+        CHECK_RC ( VCursorCommitRow ( curs ) );
+        CHECK_RC ( VCursorCloseRow ( curs ) );
+        /* many blobs, the spans of the tests cross their boundaries */
+        if ( row % blob_rows == 0 )
+            CHECK_RC ( VCursorFlushPage ( curs ) );
+    }
+    CHECK_RC ( VCursorCommit ( curs ) );
+    CHECK_RC ( VCursorRelease ( curs ) );
+    CHECK_RC ( VTableRelease ( tbl ) );
+    CHECK_RC ( VSchemaRelease ( schema ) );
+    CHECK_RC ( VDBManagerRelease ( mgr ) );
+    return 0;
+}
+
+static void remove_table ( void ) {
+    KDirectory * dir;
+    if ( KDirectoryNativeDir ( & dir ) == 0 ) {
+        KDirectoryRemove ( dir, true, "%s", tbl_path );
+        KDirectoryRelease ( dir );
+    }
+}
+
+/* a read-cursor on the test-table, the table is made on first use */
+class ReadFktFixture {
+public:
+    ReadFktFixture () : mgr ( NULL ), tbl ( NULL ), curs ( NULL ) {
+        static bool made = false;
+        if ( ! made ) {
+            remove_table ();
+            if ( make_table () != 0 )
+                throw std :: logic_error ( "cannot make the test-table" );
+            made = true;
+        }
+        if ( VDBManagerMakeRead ( & mgr, NULL ) != 0 ||
+             VDBManagerOpenTableRead ( mgr, & tbl, NULL, "%s", tbl_path ) != 0 ||
+             VTableCreateCursorRead ( tbl, & curs ) != 0 ||
+             add_column ( curs, "U8", & idx [ 0 ] ) != 0 ||
+             add_column ( curs, "U32", & idx [ 1 ] ) != 0 ||
+             add_column ( curs, "I32", & idx [ 2 ] ) != 0 ||
+             add_column ( curs, "I64", & idx [ 3 ] ) != 0 ||
+             VCursorOpen ( curs ) != 0 )
+            throw std :: logic_error ( "cannot open the test-table" );
+    }
+    ~ReadFktFixture () {
+        VCursorRelease ( curs );
+        VTableRelease ( tbl );
+        VDBManagerRelease ( mgr );
+    }
+
+    const VDBManager * mgr;
+    const VTable * tbl;
+    const VCursor * curs;
+    uint32_t idx [ 4 ];
+};
+
+/* spans that start and end inside blobs, span several of them, or are a single row */
+static const int64_t span_first [] = { 1, 995, 1000, 1001, 7777, 49990, 12345 };
+static const uint32_t span_count [] = { 10, 10, 3000, 1, 2222, 11, 1 };
+static const size_t span_n = sizeof span_first / sizeof span_first [ 0 ];
+
+/* the ptr range-reader: the same length and the same elements as the single-row reader */
+#define PTR_EQUIVALENCE( T, SINGLE, RANGE, COL )                                            \
+    for ( size_t s = 0; s < span_n; ++s ) {                                                 \
+        std :: vector < const T * > res ( span_count [ s ] );                               \
+        std :: vector < uint32_t > len ( span_count [ s ] );                                \
+        row_span span;                                                                      \
+        row_span_init ( & span );                                                           \
+        REQUIRE_RC ( RANGE ( span_first [ s ], span_count [ s ], curs, idx [ COL ], & span, \
+                             res . data (), len . data (), #COL ) );                        \
+        for ( uint32_t i = 0; i < span_count [ s ]; ++i ) {                                 \
+            const T * single = NULL;                                                        \
+            uint32_t single_len;                                                            \
+            REQUIRE_RC ( SINGLE ( span_first [ s ] + i, curs, idx [ COL ], & single, & single_len, #COL ) ); \
+            REQUIRE_EQ ( single_len, len [ i ] );                                           \
+            REQUIRE_EQ ( len [ i ], ( uint32_t ) ( ( span_first [ s ] + i ) % 5 ) );        \
+            for ( uint32_t k = 0; k < len [ i ]; ++k )                                      \
+                REQUIRE_EQ ( single [ k ], res [ i ] [ k ] );                               \
+        }                                                                                   \
+        row_span_release ( & span );                                                        \
+    }
+
+FIXTURE_TEST_CASE ( uint8_range, ReadFktFixture ) {
+    PTR_EQUIVALENCE( uint8_t, read_uint8_ptr, read_uint8_ptr_range, 0 )
+}
+
+FIXTURE_TEST_CASE ( read_type_range, ReadFktFixture ) {
+    PTR_EQUIVALENCE( INSDC_read_type, read_INSDC_read_type_ptr, read_INSDC_read_type_ptr_range, 0 )
+}
+
+/* the cells of earlier spans stay valid while later ones are read into the same row_span */
+FIXTURE_TEST_CASE ( span_keeps_blobs, ReadFktFixture ) {
+    row_span span;
+    row_span_init ( & span );
+    const uint8_t * a [ 3 ], * b [ 3 ];
+    uint32_t a_len [ 3 ], b_len [ 3 ];
+    REQUIRE_RC ( read_uint8_ptr_range ( 998, 3, curs, idx [ 0 ], & span, a, a_len, "U8" ) );
+    REQUIRE_RC ( read_uint8_ptr_range ( 30001, 3, curs, idx [ 0 ], & span, b, b_len, "U8" ) );
+    REQUIRE_EQ ( a_len [ 0 ], ( uint32_t ) 3 );
+    REQUIRE_EQ ( a [ 0 ] [ 2 ], ( uint8_t ) ( 998 * 7 + 2 ) );
+    REQUIRE_EQ ( a_len [ 2 ], ( uint32_t ) 0 );
+    REQUIRE_NULL ( a [ 2 ] );
+    REQUIRE_EQ ( b [ 1 ] [ 1 ], ( uint8_t ) ( 30002 * 7 + 1 ) );
+    row_span_release ( & span );
+}
+
+FIXTURE_TEST_CASE ( invalid_column, ReadFktFixture ) {
+    const uint8_t * res [ 4 ];
+    uint32_t len [ 4 ];
+    REQUIRE_RC_FAIL ( read_uint8_ptr_range ( 1, 4, curs, INVALID_COLUMN, NULL, res, len, "NONE" ) );
+}
+
+/* a column with wider elements than the reader's is an error, not a misread */
+FIXTURE_TEST_CASE ( wrong_element_size, ReadFktFixture ) {
+    for ( uint32_t col = 1; col < 4; ++col ) {
+        const uint8_t * res [ 4 ];
+        uint32_t len [ 4 ];
+        row_span span;
+        row_span_init ( & span );
+        REQUIRE_RC_FAIL ( read_uint8_ptr_range ( 1, 4, curs, idx [ col ], & span, res, len, "WIDE" ) );
+        row_span_release ( & span );
+    }
+}
+
+/* rows per second for one column, row by row vs. blob by blob */
+FIXTURE_TEST_CASE ( read_fkt_benchmark, ReadFktFixture ) {
+    int64_t sum_single = 0, sum_range = 0;
+    KTimeMs_t start = KTimeMsStamp ();
+    for ( int64_t row = 1; row <= row_count; ++row ) {
+        const uint8_t * v;
+        uint32_t len;
+        REQUIRE_RC ( read_uint8_ptr ( row, curs, idx [ 0 ], & v, & len, "U8" ) );
+        sum_single += len;
+    }
+    KTimeMs_t ms_single = KTimeMsStamp () - start;
+
+    start = KTimeMsStamp ();
+    const uint32_t batch = 4096;
+    std :: vector < const uint8_t * > v ( batch );
+    std :: vector < uint32_t > len ( batch );
+    for ( int64_t row = 1; row <= row_count; row += batch ) {
+        uint32_t n = ( row_count - row + 1 < batch ) ? ( uint32_t ) ( row_count - row + 1 ) : batch;
+        row_span span;
+        row_span_init ( & span );
+        REQUIRE_RC ( read_uint8_ptr_range ( row, n, curs, idx [ 0 ], & span, v . data (), len . data (), "U8" ) );
+        for ( uint32_t i = 0; i < n; ++i )
+            sum_range += len [ i ];
+        row_span_release ( & span );
+    }
+    KTimeMs_t ms_range = KTimeMsStamp () - start;
+    REQUIRE_EQ ( sum_single, sum_range );
+    std :: cout << row_count << " rows : row by row " << ms_single << " ms, by range " << ms_range << " ms\n";
+    remove_table ();
+}
+
+extern "C" {
+    ver_t CC KAppVersion ( void ) { return 0; }
+    rc_t CC KMain ( int argc, char * argv [] ) {
+        return TestReadFkt ( argc, argv );
+    }
+}
@@ -0,0 +1,229 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "../../tools/sra-pileup/ref_regions.h"
+
+#include <klib/time.h>
+
+#include <ktst/unit_test.hpp> // TEST_SUITE
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+TEST_SUITE ( TestRefRegions );
+
+static const char * bed_file = "./test_ref_regions.bed";
+
+static void write_file ( const char * path, const char * content ) {
+    FILE * f = fopen ( path, "wb" );
+    fputs ( content, f );
+    fclose ( f );
+}
+
+/* the 1-based, inclusive ranges of a reference after check_ref_regions() */
+static std::vector < std::pair < uint64_t, uint64_t > > ranges_of ( BSTree * regions, const char * name ) {
+    std::vector < std::pair < uint64_t, uint64_t > > res;
+    for ( const struct reference_region * node = get_first_ref_node ( regions );
+          node != NULL; node = get_next_ref_node ( node ) ) {
+        if ( std::string ( get_ref_node_name ( node ) ) == name ) {
+            for ( uint32_t i = 0; i < get_ref_node_range_count ( node ); ++i ) {
+                const struct reference_range * r = get_ref_range ( node, i );
+                res.push_back ( std::make_pair ( get_ref_range_start ( r ), get_ref_range_end ( r ) ) );
+            }
+        }
+    }
+    return res;
+}
+
+TEST_CASE ( bed_lines ) {
+    write_file ( bed_file,
+                 "browser position chr1:1-1000\n"
+                 "track name=test\n"
+                 "# a comment\n"
+                 "\n"
+                 "chr1\t100\t200\tname\t0\t+\n"
+                 "chr2 0 10\r\n"
+                 "chr1\t9\t10\n"
+                 "chr1\t50\t50\n"          /* empty interval */
+                 "chr2\t500\t600" );       /* no newline at the end */
+    BSTree regions;
+    BSTreeInit ( & regions );
+    REQUIRE_RC ( add_regions_from_file ( & regions, bed_file ) );
+    check_ref_regions ( & regions, 0 );
+    REQUIRE_EQ ( count_ref_regions ( & regions ), ( uint32_t ) 4 );
+
+    std::vector < std::pair < uint64_t, uint64_t > > chr1 = ranges_of ( & regions, "chr1" );
+    REQUIRE_EQ ( chr1.size (), ( size_t ) 2 );
+    REQUIRE_EQ ( chr1 [ 0 ].first, ( uint64_t ) 10 );
+    REQUIRE_EQ ( chr1 [ 0 ].second, ( uint64_t ) 10 );
+    REQUIRE_EQ ( chr1 [ 1 ].first, ( uint64_t ) 101 );
+    REQUIRE_EQ ( chr1 [ 1 ].second, ( uint64_t ) 200 );
+
+    std::vector < std::pair < uint64_t, uint64_t > > chr2 = ranges_of ( & regions, "chr2" );
+    REQUIRE_EQ ( chr2.size (), ( size_t ) 2 );
+    REQUIRE_EQ ( chr2 [ 0 ].first, ( uint64_t ) 1 );
+    REQUIRE_EQ ( chr2 [ 0 ].second, ( uint64_t ) 10 );
+    REQUIRE_EQ ( chr2 [ 1 ].first, ( uint64_t ) 501 );
+    REQUIRE_EQ ( chr2 [ 1 ].second, ( uint64_t ) 600 );
+
+    free_ref_regions ( & regions );
+    remove ( bed_file );
+}
+
+TEST_CASE ( bed_invalid_lines ) {
+    const char * bad [] = { "chr1\t100\n", "chr1\tabc\t200\n", "chr1\t200\t100\n", "chr1\t1x\t5\n" };
+    for ( size_t i = 0; i < sizeof bad / sizeof bad [ 0 ]; ++i ) {
+        write_file ( bed_file, bad [ i ] );
+        BSTree regions;
+        BSTreeInit ( & regions );
+        REQUIRE ( add_regions_from_file ( & regions, bed_file ) != 0 );
+        free_ref_regions ( & regions );
+    }
+    remove ( bed_file );
+
+    BSTree regions;
+    BSTreeInit ( & regions );
+    REQUIRE ( add_regions_from_file ( & regions, "./not_there.bed" ) != 0 );
+    free_ref_regions ( & regions );
+}
+
+/* random, unsorted, overlapping ranges: the merged ranges have to cover exactly the same positions */
+TEST_CASE ( merge_matches_coverage ) {
+    const uint64_t ref_len = 100000;
+    std::vector < bool > covered ( ref_len + 2, false );
+    BSTree regions;
+    BSTreeInit ( & regions );
+    srand ( 86 );
+    for ( int i = 0; i < 5000; ++i ) {
+        uint64_t start = 1 + rand () % ( ref_len - 1000 );
+        uint64_t end = start + rand () % 300;
+        for ( uint64_t p = start; p <= end; ++p )
+            covered [ p ] = true;
+        REQUIRE_RC ( add_region ( & regions, "chrX", start, end ) );
+    }
+    check_ref_regions ( & regions, 0 );
+
+    std::vector < bool > merged ( ref_len + 2, false );
+    std::vector < std::pair < uint64_t, uint64_t > > r = ranges_of ( & regions, "chrX" );
+    for ( size_t i = 0; i < r.size (); ++i ) {
+        REQUIRE_LE ( r [ i ].first, r [ i ].second );
+        if ( i > 0 ) /* sorted, with a gap in between */
+            REQUIRE_LT ( r [ i - 1 ].second + 1, r [ i ].first );
+        for ( uint64_t p = r [ i ].first; p <= r [ i ].second; ++p )
+            merged [ p ] = true;
+    }
+    REQUIRE ( merged == covered );
+    free_ref_regions ( & regions );
+}
+
+/* the gaps of ranges merged into one pass are skipped, also if the positions jump over several of them */
+TEST_CASE ( skiplist_matches_coverage ) {
+    const uint64_t ref_len = 200000;
+    std::vector < bool > covered ( ref_len + 2, false );
+    BSTree regions;
+    BSTreeInit ( & regions );
+    srand ( 860 );
+    for ( int i = 0; i < 3000; ++i ) {
+        uint64_t start = 1 + rand () % ( ref_len - 1000 );
+        uint64_t end = start + rand () % 50;
+        for ( uint64_t p = start; p <= end; ++p )
+            covered [ p ] = true;
+        REQUIRE_RC ( add_region ( & regions, "chrY", start, end ) );
+    }
+    check_ref_regions ( & regions, ( uint64_t ) -1 );
+    std::vector < std::pair < uint64_t, uint64_t > > r = ranges_of ( & regions, "chrY" );
+    REQUIRE_EQ ( r.size (), ( size_t ) 1 );
+
+    struct skiplist * skl = skiplist_make ( & regions );
+    REQUIRE_NOT_NULL ( skl );
+    skiplist_enter_ref ( skl, "chrY", NULL );
+    uint64_t pos = r [ 0 ].first;
+    while ( pos <= r [ 0 ].second ) {
+        REQUIRE_EQ ( skiplist_is_skip_position ( skl, pos ), ! covered [ pos ] );
+        pos += 1 + rand () % 200;
+    }
+    skiplist_release ( skl );
+    free_ref_regions ( & regions );
+}
+
+TEST_CASE ( whole_reference_covers_all ) {
+    BSTree regions;
+    BSTreeInit ( & regions );
+    REQUIRE_RC ( add_region ( & regions, "chr1", 5000, 6000 ) );
+    REQUIRE_RC ( parse_and_add_region ( & regions, "chr1" ) );
+    REQUIRE_RC ( add_region ( & regions, "chr1", 100, 200 ) );
+    check_ref_regions ( & regions, 10000 );
+    std::vector < std::pair < uint64_t, uint64_t > > r = ranges_of ( & regions, "chr1" );
+    REQUIRE_EQ ( r.size (), ( size_t ) 1 );
+    REQUIRE_EQ ( r [ 0 ].first, ( uint64_t ) 0 );
+    REQUIRE_EQ ( r [ 0 ].second, ( uint64_t ) 0 );
+    REQUIRE_NULL ( skiplist_make ( & regions ) );
+    free_ref_regions ( & regions );
+}
+
+/* a BED-scale region-set: 200k intervals over 24 references, loaded, coalesced into one pass
+   per reference and turned into a skiplist */
+TEST_CASE ( region_file_benchmark ) {
+    const int refs = 24;
+    const int intervals = 200000;
+    FILE * f = fopen ( bed_file, "wb" );
+    REQUIRE_NOT_NULL ( f );
+    srand ( 2086 );
+    for ( int i = 0; i < intervals; ++i ) {
+        unsigned ref = i % refs;
+        unsigned start = ( i / refs ) * 1200 + rand () % 600;
+        fprintf ( f, "chr%u\t%u\t%u\tiv%d\n", ref + 1, start, start + 50 + rand () % 800, i );
+    }
+    fclose ( f );
+
+    KTimeMs_t t0 = KTimeMsStamp ();
+    BSTree regions;
+    BSTreeInit ( & regions );
+    REQUIRE_RC ( add_regions_from_file ( & regions, bed_file ) );
+    KTimeMs_t t1 = KTimeMsStamp ();
+    check_ref_regions ( & regions, ( uint64_t ) -1 );
+    struct skiplist * skl = skiplist_make ( & regions );
+    KTimeMs_t t2 = KTimeMsStamp ();
+
+    REQUIRE_EQ ( count_ref_regions ( & regions ), ( uint32_t ) refs );
+    REQUIRE_NOT_NULL ( skl );
+    std::cerr << intervals << " intervals: load " << ( t1 - t0 ) << " ms, coalesce + skiplist "
+              << ( t2 - t1 ) << " ms" << std::endl;
+
+    skiplist_release ( skl );
+    free_ref_regions ( & regions );
+    remove ( bed_file );
+}
+
+extern "C" {
+    ver_t CC KAppVersion ( void ) { return 0; }
+    rc_t CC KMain ( int argc, char * argv [] ) {
+        return TestRefRegions ( argc, argv );
+    }
+}
@@ -0,0 +1,343 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "../../tools/sra-pileup/rna_splice_log.h"
+#include "../../tools/sra-pileup/cg_tools.h"
+
+#include <klib/vector.h> /* KVector, the dict the log used before */
+#include <klib/time.h> /* KTimeMsStamp */
+
+#include <ktst/unit_test.hpp> // TEST_SUITE
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/* rna_splice_log.c is compiled with ReferenceObj_Read redirected to here ( see Makefile ),
+   it reads its edges from an in-memory reference */
+static const char * spl_test_ref_bases = NULL;
+static uint32_t spl_test_ref_len = 0;
+
+extern "C" rc_t CC spl_test_ReferenceObj_Read( const struct ReferenceObj * cself, INSDC_coord_zero offset,
+                                               INSDC_coord_len len, uint8_t * buffer, INSDC_coord_len * written )
+{
+    if ( offset < 0 || ( uint32_t )offset >= spl_test_ref_len )
+        return RC( rcApp, rcNoTarg, rcReading, rcParam, rcInvalid );
+    if ( ( uint32_t )offset + len > spl_test_ref_len )
+        len = spl_test_ref_len - offset;
+    memmove( buffer, &( spl_test_ref_bases[ offset ] ), len );
+    *written = len;
+    return 0;
+}
+
+TEST_SUITE ( TestRnaSpliceLog );
+
+static const char * log_path = "rna_splice_log.test.txt";
+static const char * ref_name = "chrT";
+static const int dummy_ref = 0; /* ReferenceObj_Read is redirected, the pointer is never looked at */
+
+static std :: string read_file ( const char * path ) {
+    std :: ifstream f ( path, std :: ios :: binary );
+    std :: stringstream ss;
+    ss << f . rdbuf ();
+    return ss . str ();
+}
+
+struct observation {
+    uint32_t pos, len, intron_type;
+    bool window_start;  /* a new ref-window begins before this one */
+    uint32_t window_pos;
+};
+
+/* the log as it was written before: a KVector keyed by ( pos, len ), edges
+   copied and reverse-complemented into a scratch buffer, visited at the end */
+struct old_log {
+    KVector * v;
+    std :: string out;
+
+    old_log () : v ( NULL ) { KVectorMake ( & v ); }
+    ~old_log () { KVectorRelease ( v ); }
+
+    static uint64_t key ( uint32_t pos, uint32_t len ) { return ( ( uint64_t ) pos << 32 ) | len; }
+
+    void add ( uint32_t pos, uint32_t len, uint32_t intron_type ) {
+        uint64_t value;
+        if ( KVectorGetU64 ( v, key ( pos, len ), & value ) == 0 )
+            value += 1;
+        else
+            value = ( ( uint64_t ) intron_type << 32 ) | 1;
+        KVectorSetU64 ( v, key ( pos, len ), value );
+    }
+
+    static char compl_base ( char c ) {
+        switch ( c ) {
+            case 'A' : return 'T';
+            case 'C' : return 'G';
+            case 'G' : return 'C';
+            case 'T' : return 'A';
+        }
+        return 'N';
+    }
+
+    void edge ( uint32_t pos, bool rev, bool nl ) {
+        uint32_t pre = 10, post = 10, rd = 0;
+        if ( pos >= 10 ) rd = pos - 10; else pre = pos;
+        std :: string b ( spl_test_ref_bases + rd, std :: min < uint32_t > ( pre + post + 2, spl_test_ref_len - rd ) );
+        if ( b . size () < pre + post + 2 )
+            post -= ( pre + post + 2 - b . size () );
+        if ( rev ) {
+            std :: string r ( b . rbegin (), b . rend () );
+            for ( size_t i = 0; i < r . size (); ++i ) r [ i ] = compl_base ( r [ i ] );
+            b = r;
+        }
+        out += b . substr ( 0, pre ) + '\t' + b . substr ( pre, 2 ) + '\t' + b . substr ( pre + 2, post ) + ( nl ? '\n' : '\t' );
+    }
+
+    static rc_t CC on_key_value ( uint64_t k, uint64_t value, void * data ) {
+        old_log * self = ( old_log * ) data;
+        uint32_t pos = ( uint32_t ) ( k >> 32 ), len = ( uint32_t ) k;
+        uint32_t count = ( uint32_t ) value, type = ( uint32_t ) ( value >> 32 ) & 3;
+        static const char to_ascii [] = { 'u', '+', '-', 'u' };
+        std :: ostringstream ss;
+        ss << ref_name << '\t' << pos + 1 << '\t' << len << '\t' << count << '\t' << to_ascii [ type ] << '\t';
+        self -> out += ss . str ();
+        if ( type == INTRON_REV ) {
+            self -> edge ( pos + len - 2, true, false );
+            self -> edge ( pos, true, true );
+        } else {
+            self -> edge ( pos, false, false );
+            self -> edge ( pos + len - 2, false, true );
+        }
+        return 0;
+    }
+
+    void finish () { KVectorVisitU64 ( v, false, on_key_value, this ); }
+};
+
+/* alignments starting window by window, with 1..2 junctions each;
+   a few intron-lengths are common so junctions repeat */
+struct synthetic {
+    uint64_t state;
+    synthetic () : state ( 0x2545F4914F6CDD1DULL ) {}
+    uint32_t next ( uint32_t n ) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return ( uint32_t ) ( state >> 33 ) % n;
+    }
+    void make ( uint32_t windows, uint32_t window_len, uint32_t per_window,
+                std :: vector < observation > & obs, std :: string & ref ) {
+        static const uint32_t common_len [] = { 85, 120, 450, 1200, 5000 };
+        obs . clear ();
+        for ( uint32_t w = 0; w < windows; ++w ) {
+            uint32_t w_start = w * window_len;
+            for ( uint32_t a = 0; a < per_window; ++a ) {
+                uint32_t start = w_start + ( a * window_len ) / per_window;
+                uint32_t n = 1 + next ( 2 );
+                for ( uint32_t j = 0; j < n; ++j ) {
+                    observation o;
+                    o . pos = start + next ( 150 );
+                    o . len = ( next ( 4 ) == 0 ) ? 20 + next ( 20000 ) : common_len [ next ( 5 ) ];
+                    o . intron_type = next ( 3 );
+                    o . window_start = ( a == 0 && j == 0 );
+                    o . window_pos = w_start;
+                    obs . push_back ( o );
+                }
+            }
+        }
+        uint32_t ref_len = windows * window_len + 20000 + 200;
+        static const char bases [] = "ACGT";
+        ref . resize ( ref_len );
+        for ( uint32_t i = 0; i < ref_len; ++i ) ref [ i ] = bases [ next ( 4 ) ];
+    }
+};
+
+static rc_t write_new_log ( const std :: vector < observation > & obs ) {
+    struct rna_splice_log * sl = make_rna_splice_log ( log_path, "test" );
+    struct rna_splice_dict * dict = make_rna_splice_dict ();
+    rc_t rc = 0;
+    if ( sl == NULL || dict == NULL )
+        rc = RC ( rcApp, rcNoTarg, rcAllocating, rcMemory, rcExhausted );
+    else {
+        rna_splice_log_enter_ref ( sl, ref_name, ( struct ReferenceObj const * ) & dummy_ref );
+        for ( size_t i = 0; rc == 0 && i < obs . size (); ++i ) {
+            if ( obs [ i ] . window_start )
+                rc = rna_splice_log_flush ( sl, dict, obs [ i ] . window_pos );
+            rna_splice_dict_add ( dict, obs [ i ] . pos, obs [ i ] . len, obs [ i ] . intron_type );
+        }
+        rna_splice_log_exit_ref ( sl, dict );
+    }
+    free_rna_splice_dict ( dict );
+    free_rna_splice_log ( sl );
+    return rc;
+}
+
+static rc_t compare_with_old_log ( uint32_t windows, uint32_t per_window ) {
+    std :: vector < observation > obs;
+    std :: string ref;
+    synthetic ( ) . make ( windows, 5000, per_window, obs, ref );
+    spl_test_ref_bases = ref . c_str ();
+    spl_test_ref_len = ( uint32_t ) ref . size ();
+
+    old_log old;
+    for ( size_t i = 0; i < obs . size (); ++i )
+        old . add ( obs [ i ] . pos, obs [ i ] . len, obs [ i ] . intron_type );
+    old . finish ();
+
+    rc_t rc = write_new_log ( obs );
+    if ( rc == 0 ) {
+        std :: string now = read_file ( log_path );
+        if ( now != old . out ) {
+            size_t i = 0;
+            while ( i < now . size () && i < old . out . size () && now [ i ] == old . out [ i ] ) ++i;
+            std :: cerr << "logs differ at byte " << i << " ( " << now . size () << " vs " << old . out . size () << " bytes )\n";
+            rc = RC ( rcApp, rcNoTarg, rcComparing, rcData, rcInconsistent );
+        }
+    }
+    remove ( log_path );
+    return rc;
+}
+
+TEST_CASE ( known_lines ) {
+    spl_test_ref_bases = "ACGTTGCAACGGTACCATGACCTTGGAACCGTTAACCGGA";
+    spl_test_ref_len = 40;
+    std :: vector < observation > obs;
+    observation o = { 15, 12, INTRON_REV, true, 0 };
+    obs . push_back ( o );
+    observation f = { 12, 10, INTRON_FWD, false, 0 };
+    obs . push_back ( f );
+    f . intron_type = INTRON_REV; /* the first observation decides */
+    obs . push_back ( f );
+    REQUIRE_RC ( write_new_log ( obs ) );
+    REQUIRE_EQ ( read_file ( log_path ), std :: string (
+        "chrT\t13\t10\t2\t+\tGTTGCAACGG\tTA\tCCATGACCTT\tGGTACCATGA\tCC\tTTGGAACCGT\n"
+        "chrT\t16\t12\t1\t-\tGGTTAACGGT\tTC\tCAAGGTCATG\tTCCAAGGTCA\tTG\tGTACCGTTGC\n" ) );
+    remove ( log_path );
+}
+
+TEST_CASE ( dict_get_set ) {
+    struct rna_splice_dict * dict = make_rna_splice_dict ();
+    REQUIRE_NOT_NULL ( dict );
+    splice_dict_entry e;
+    for ( uint32_t i = 0; i < 100000; ++i ) {
+        e . count = i;
+        e . intron_type = i % 3;
+        rna_splice_dict_set ( dict, i * 7, 100 + ( i % 13 ), & e );
+    }
+    REQUIRE_EQ ( rna_splice_dict_count ( dict ), ( uint32_t ) 100000 );
+    for ( uint32_t i = 0; i < 100000; ++i ) {
+        REQUIRE ( rna_splice_dict_get ( dict, i * 7, 100 + ( i % 13 ), & e ) );
+        REQUIRE_EQ ( e . count, i );
+        REQUIRE_EQ ( e . intron_type, i % 3 );
+    }
+    REQUIRE ( ! rna_splice_dict_get ( dict, 1, 100, & e ) );
+    free_rna_splice_dict ( dict );
+}
+
+/* the one-pass count of the parallel deletes-scan vs. the candidates of the serial one,
+   with a trailing D or N, too short ones and more than MAX_RNA_SPLICE_CANDIDATES */
+TEST_CASE ( splice_candidates_count ) {
+    struct { const char * cigar; uint32_t expected; } cases [] = {
+        { "50M", 0 },
+        { "20M100N30M", 1 },
+        { "20M100D30M", 1 },
+        { "20M9N30M", 0 },
+        { "50M100N", 1 },
+        { "50M100D", 1 },
+        { "50M9D", 0 },
+        { "100N50M100D", 2 },
+        { "10M10N10M10D10M10N", 3 },
+        { "2M10N", 1 },
+        { "10N", 1 },
+        { "", 0 },
+    };
+    for ( size_t i = 0; i < sizeof cases / sizeof cases [ 0 ]; ++i ) {
+        const char * cigar = cases [ i ] . cigar;
+        uint32_t cigar_len = ( uint32_t ) strlen ( cigar );
+        rna_splice_candidates candidates;
+        memset ( & candidates, 0, sizeof candidates );
+        REQUIRE_RC ( discover_rna_splicing_candidates ( cigar_len, cigar, 10, & candidates ) );
+        free ( candidates . cigops );
+        REQUIRE_EQ ( candidates . count, cases [ i ] . expected );
+        REQUIRE_EQ ( count_rna_splicing_candidates ( cigar_len, cigar, 10 ), cases [ i ] . expected );
+    }
+
+    std :: string many;
+    for ( uint32_t i = 0; i < MAX_RNA_SPLICE_CANDIDATES + 5; ++i )
+        many += "5M20N";
+    rna_splice_candidates candidates;
+    memset ( & candidates, 0, sizeof candidates );
+    REQUIRE_RC ( discover_rna_splicing_candidates ( ( uint32_t ) many . size (), many . c_str (), 10, & candidates ) );
+    free ( candidates . cigops );
+    REQUIRE_EQ ( candidates . count, ( uint32_t ) MAX_RNA_SPLICE_CANDIDATES );
+    REQUIRE_EQ ( count_rna_splicing_candidates ( ( uint32_t ) many . size (), many . c_str (), 10 ),
+                 ( uint32_t ) MAX_RNA_SPLICE_CANDIDATES );
+}
+
+/* few junctions: everything is written at the end of the reference */
+TEST_CASE ( equals_old_log_without_flush ) {
+    REQUIRE_RC ( compare_with_old_log ( 20, 100 ) );
+}
+
+/* enough distinct junctions to flush finished windows several times on the way */
+TEST_CASE ( equals_old_log_with_flushes ) {
+    REQUIRE_RC ( compare_with_old_log ( 200, 1500 ) );
+}
+
+/* millions of junction-observations on one reference */
+TEST_CASE ( junction_table_benchmark ) {
+    std :: vector < observation > obs;
+    std :: string ref;
+    synthetic ( ) . make ( 1000, 5000, 2000, obs, ref );
+    spl_test_ref_bases = ref . c_str ();
+    spl_test_ref_len = ( uint32_t ) ref . size ();
+
+    KTimeMs_t start = KTimeMsStamp ();
+    REQUIRE_RC ( write_new_log ( obs ) );
+    KTimeMs_t ms_new = KTimeMsStamp () - start;
+    remove ( log_path );
+
+    start = KTimeMsStamp ();
+    {
+        old_log old;
+        for ( size_t i = 0; i < obs . size (); ++i )
+            old . add ( obs [ i ] . pos, obs [ i ] . len, obs [ i ] . intron_type );
+        old . finish ();
+    }
+    KTimeMs_t ms_old = KTimeMsStamp () - start;
+    std :: cout << obs . size () << " junction-observations : open-addressing table "
+                << ms_new << " ms, KVector " << ms_old << " ms\n";
+}
+
+extern "C" {
+    ver_t CC KAppVersion ( void ) { return 0; }
+    rc_t CC KMain ( int argc, char * argv [] ) {
+        return TestRnaSpliceLog ( argc, argv );
+    }
+}
@@ -0,0 +1,205 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "../../tools/sra-pileup/stat_window.h"
+
+#include <klib/time.h> /* KTimeMsStamp */
+
+#include <ktst/unit_test.hpp> // TEST_SUITE
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+TEST_SUITE ( TestStatWindow );
+
+/* the window as pileup_stat.c kept it before: flat arrays, memmove to slide, sort to report */
+struct old_strand {
+    std :: vector < uint32_t > tlen_w, tlen_l, zeros;
+    uint32_t tlen_w_zeros, window_size, window_max, seq_len_accu_count;
+    uint64_t seq_len_accu;
+
+    old_strand () : tlen_w_zeros ( 0 ), window_size ( 0 ), window_max ( 50 ),
+                    seq_len_accu_count ( 0 ), seq_len_accu ( 0 ) {}
+
+    static void remove_front ( std :: vector < uint32_t > & a, uint32_t count ) {
+        if ( count > 0 ) {
+            if ( a . size () < count )
+                a . clear ();
+            else
+                a . erase ( a . begin (), a . begin () + count );
+        }
+    }
+    void enter_window () { tlen_w . clear (); tlen_l . clear (); }
+    void enter_pos () {
+        if ( seq_len_accu_count < 500000 && seq_len_accu_count > 0 ) {
+            uint64_t w = seq_len_accu / seq_len_accu_count;
+            if ( w > window_max ) window_max = ( uint32_t ) w;
+        }
+        if ( window_size >= window_max ) {
+            if ( ! tlen_l . empty () )
+                remove_front ( tlen_w, tlen_l [ 0 ] );
+            remove_front ( tlen_l, 1 );
+            tlen_w_zeros -= zeros [ 0 ];
+            remove_front ( zeros, 1 );
+        }
+        else
+            window_size++;
+        tlen_l . push_back ( 0 );
+        zeros . push_back ( 0 );
+    }
+    void placement ( int32_t tlen, uint32_t seq_len ) {
+        uint32_t value = ( tlen < 0 ) ? -tlen : tlen;
+        if ( value != 0 ) {
+            tlen_w . push_back ( value );
+            tlen_l . back ()++;
+        } else {
+            tlen_w_zeros++;
+            zeros . back ()++;
+        }
+        if ( seq_len_accu_count < 500000 ) {
+            seq_len_accu += seq_len;
+            seq_len_accu_count++;
+        }
+    }
+    void stats ( uint32_t * z, uint32_t * p10, uint32_t * med, uint32_t * p90 ) {
+        uint32_t n = ( uint32_t ) tlen_w . size ();
+        std :: sort ( tlen_w . begin (), tlen_w . end () );
+        * z = tlen_w_zeros;
+        * p10 = n == 0 ? 0 : tlen_w [ ( n * 10 ) / 100 ];
+        * med = n == 0 ? 0 : tlen_w [ n >> 1 ];
+        * p90 = n == 0 ? 0 : tlen_w [ ( n * 90 ) / 100 ];
+    }
+};
+
+/* a synthetic pileup: 'starts' alignments begin at every position, on average */
+struct synthetic {
+    uint32_t starts;
+    uint32_t seed;
+    synthetic ( uint32_t s ) : starts ( s ), seed ( 815 ) {}
+    uint32_t next () { seed = seed * 1103515245 + 12345; return ( seed >> 8 ) & 0xFFFFFF; }
+    uint32_t count_at_pos () { return starts / 2 + next () % ( starts + 1 ); }
+    int32_t tlen () {
+        uint32_t r = next () % 100;
+        if ( r < 5 ) return 0;                                  /* unpaired */
+        if ( r < 7 ) return 70000 + next () % 100000;           /* very long templates */
+        int32_t t = 200 + next () % 600;                        /* amplicon-like */
+        return ( r & 1 ) ? -t : t;
+    }
+    uint32_t seq_len () { return 100 + next () % 200; }
+};
+
+static rc_t compare_windows ( uint32_t starts, uint32_t positions, uint32_t window_every ) {
+    stat_strand s;
+    old_strand o;
+    synthetic syn ( starts );
+    rc_t rc = stat_strand_init ( & s );
+    for ( uint32_t pos = 0; rc == 0 && pos < positions; ++pos ) {
+        if ( window_every > 0 && ( pos % window_every ) == 0 ) {
+            stat_strand_enter_window ( & s );
+            o . enter_window ();
+        }
+        rc = stat_strand_enter_pos ( & s );
+        o . enter_pos ();
+        uint32_t n = syn . count_at_pos ();
+        for ( uint32_t i = 0; rc == 0 && i < n; ++i ) {
+            int32_t tlen = syn . tlen ();
+            uint32_t seq_len = syn . seq_len ();
+            rc = stat_strand_placement ( & s, tlen, seq_len );
+            o . placement ( tlen, seq_len );
+        }
+        uint32_t a [ 4 ], b [ 4 ];
+        stat_strand_tlen_stats ( & s, & a [ 0 ], & a [ 1 ], & a [ 2 ], & a [ 3 ] );
+        o . stats ( & b [ 0 ], & b [ 1 ], & b [ 2 ], & b [ 3 ] );
+        if ( rc == 0 && memcmp ( a, b, sizeof a ) != 0 ) {
+            std :: cerr << "pos " << pos << " : " << a [ 0 ] << "/" << a [ 1 ] << "/" << a [ 2 ] << "/" << a [ 3 ]
+                        << " vs " << b [ 0 ] << "/" << b [ 1 ] << "/" << b [ 2 ] << "/" << b [ 3 ] << "\n";
+            rc = RC ( rcApp, rcNoTarg, rcComparing, rcData, rcInconsistent );
+        }
+    }
+    stat_strand_finish ( & s );
+    return rc;
+}
+
+TEST_CASE ( shallow_equals_old_window ) {
+    REQUIRE_RC ( compare_windows ( 2, 5000, 0 ) );
+}
+
+TEST_CASE ( deep_equals_old_window ) {
+    REQUIRE_RC ( compare_windows ( 60, 3000, 0 ) );
+}
+
+/* a new ref-window drops the tlen's but not the zero-counters, as before */
+TEST_CASE ( window_changes_equal_old_window ) {
+    REQUIRE_RC ( compare_windows ( 20, 6000, 1000 ) );
+}
+
+/* positions/sec at 10,000x and 50,000x: 'starts' alignments begin per position, with reads
+   of ~200 bases that is a coverage of 200 * starts */
+static void bench ( uint32_t starts, uint32_t positions ) {
+    synthetic syn_new ( starts ), syn_old ( starts );
+    stat_strand s;
+    old_strand o;
+    uint32_t z, p10, med, p90;
+    if ( stat_strand_init ( & s ) != 0 )
+        return;
+    KTimeMs_t start = KTimeMsStamp ();
+    for ( uint32_t pos = 0; pos < positions; ++pos ) {
+        stat_strand_enter_pos ( & s );
+        uint32_t n = syn_new . count_at_pos ();
+        for ( uint32_t i = 0; i < n; ++i )
+            stat_strand_placement ( & s, syn_new . tlen (), syn_new . seq_len () );
+        stat_strand_tlen_stats ( & s, & z, & p10, & med, & p90 );
+    }
+    KTimeMs_t ms_new = KTimeMsStamp () - start;
+    stat_strand_finish ( & s );
+
+    start = KTimeMsStamp ();
+    for ( uint32_t pos = 0; pos < positions; ++pos ) {
+        o . enter_pos ();
+        uint32_t n = syn_old . count_at_pos ();
+        for ( uint32_t i = 0; i < n; ++i )
+            o . placement ( syn_old . tlen (), syn_old . seq_len () );
+        o . stats ( & z, & p10, & med, & p90 );
+    }
+    KTimeMs_t ms_old = KTimeMsStamp () - start;
+    std :: cout << "~" << starts * 200 << "x, " << positions << " positions : ring-buffer "
+                << ms_new << " ms, sorted array " << ms_old << " ms\n";
+}
+
+TEST_CASE ( deep_coverage_benchmark ) {
+    bench ( 50, 2000 );     /* ~10,000x */
+    bench ( 250, 500 );     /* ~50,000x */
+}
+
+extern "C" {
+    ver_t CC KAppVersion ( void ) { return 0; }
+    rc_t CC KMain ( int argc, char * argv [] ) {
+        return TestStatWindow ( argc, argv );
+    }
+}
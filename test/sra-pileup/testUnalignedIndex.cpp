@@ -0,0 +1,169 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "../../tools/sra-pileup/unaligned_index.h"
+
+#include <kfs/directory.h>
+
+#include <ktst/unit_test.hpp> // TEST_SUITE
+
+#include <cstdio>
+#include <cstring> // memcmp
+#include <unistd.h> // truncate
+#include <vector>
+
+TEST_SUITE ( TestUnalignedIndex );
+
+static const char * idx_dir = ".";
+static const char * run_path = "/some/where/SRRTEST.sra/";
+static const char * idx_file = "./SRRTEST.sra.unaligned.idx";
+static const KTime_t mod_date = 1500000000;
+
+TEST_CASE ( rows_become_runs ) {
+    struct unaligned_index * idx = make_unaligned_index ( 1, 100 );
+    REQUIRE_NOT_NULL ( idx );
+    const int64_t rows [] = { 3, 4, 5, 9, 20, 21, 100 };
+    for ( size_t i = 0; i < sizeof rows / sizeof rows [ 0 ]; ++i )
+        REQUIRE_RC ( unaligned_index_add_row ( idx, rows [ i ] ) );
+    REQUIRE_EQ ( unaligned_index_run_count ( idx ), ( uint64_t ) 4 );
+    int64_t start;
+    uint64_t count;
+    unaligned_index_get_run ( idx, 0, & start, & count );
+    REQUIRE_EQ ( start, ( int64_t ) 3 );
+    REQUIRE_EQ ( count, ( uint64_t ) 3 );
+    unaligned_index_get_run ( idx, 3, & start, & count );
+    REQUIRE_EQ ( start, ( int64_t ) 100 );
+    REQUIRE_EQ ( count, ( uint64_t ) 1 );
+    free_unaligned_index ( idx );
+}
+
+TEST_CASE ( save_and_load ) {
+    struct unaligned_index * idx = make_unaligned_index ( 1, 1000000 );
+    REQUIRE_NOT_NULL ( idx );
+    for ( int64_t row = 1; row <= 1000000; row += 1 + ( row % 7 ) )
+        REQUIRE_RC ( unaligned_index_add_row ( idx, row ) );
+    REQUIRE_RC ( unaligned_index_save ( idx, idx_dir, run_path, mod_date ) );
+
+    struct unaligned_index * loaded;
+    REQUIRE_RC ( unaligned_index_load ( idx_dir, run_path, mod_date, 1, 1000000, & loaded ) );
+    REQUIRE_NOT_NULL ( loaded );
+    REQUIRE_EQ ( unaligned_index_run_count ( loaded ), unaligned_index_run_count ( idx ) );
+    for ( uint64_t i = 0; i < unaligned_index_run_count ( idx ); ++i ) {
+        int64_t s1, s2;
+        uint64_t c1, c2;
+        unaligned_index_get_run ( idx, i, & s1, & c1 );
+        unaligned_index_get_run ( loaded, i, & s2, & c2 );
+        REQUIRE_EQ ( s1, s2 );
+        REQUIRE_EQ ( c1, c2 );
+    }
+    free_unaligned_index ( loaded );
+    free_unaligned_index ( idx );
+    remove ( idx_file );
+}
+
+TEST_CASE ( empty_index ) {
+    struct unaligned_index * idx = make_unaligned_index ( 1, 50 );
+    REQUIRE_RC ( unaligned_index_save ( idx, idx_dir, run_path, mod_date ) );
+    struct unaligned_index * loaded;
+    REQUIRE_RC ( unaligned_index_load ( idx_dir, run_path, mod_date, 1, 50, & loaded ) );
+    REQUIRE_NOT_NULL ( loaded );
+    REQUIRE_EQ ( unaligned_index_run_count ( loaded ), ( uint64_t ) 0 );
+    free_unaligned_index ( loaded );
+    free_unaligned_index ( idx );
+    remove ( idx_file );
+}
+
+TEST_CASE ( missing_index ) {
+    struct unaligned_index * loaded;
+    REQUIRE_RC ( unaligned_index_load ( idx_dir, "NOT_THERE", mod_date, 1, 50, & loaded ) );
+    REQUIRE_NULL ( loaded );
+}
+
+TEST_CASE ( stale_index ) {
+    struct unaligned_index * idx = make_unaligned_index ( 1, 50 );
+    REQUIRE_RC ( unaligned_index_add_row ( idx, 7 ) );
+    REQUIRE_RC ( unaligned_index_save ( idx, idx_dir, run_path, mod_date ) );
+    free_unaligned_index ( idx );
+
+    struct unaligned_index * loaded;
+    /* the table has grown since */
+    REQUIRE_RC ( unaligned_index_load ( idx_dir, run_path, mod_date, 1, 60, & loaded ) );
+    REQUIRE_NULL ( loaded );
+
+    /* a truncated file */
+    REQUIRE ( truncate ( idx_file, 20 ) == 0 );
+    REQUIRE_RC ( unaligned_index_load ( idx_dir, run_path, mod_date, 1, 50, & loaded ) );
+    REQUIRE_NULL ( loaded );
+    remove ( idx_file );
+}
+
+TEST_CASE ( other_run_same_name ) {
+    struct unaligned_index * idx = make_unaligned_index ( 1, 50 );
+    REQUIRE_RC ( unaligned_index_add_row ( idx, 7 ) );
+    REQUIRE_RC ( unaligned_index_save ( idx, idx_dir, run_path, mod_date ) );
+    free_unaligned_index ( idx );
+
+    struct unaligned_index * loaded;
+    /* the same leaf-name in a different directory */
+    REQUIRE_RC ( unaligned_index_load ( idx_dir, "/else/where/SRRTEST.sra", mod_date, 1, 50, & loaded ) );
+    REQUIRE_NULL ( loaded );
+
+    /* the run has been replaced, with the same row-range */
+    REQUIRE_RC ( unaligned_index_load ( idx_dir, run_path, mod_date + 1, 1, 50, & loaded ) );
+    REQUIRE_NULL ( loaded );
+
+    REQUIRE_RC ( unaligned_index_load ( idx_dir, run_path, mod_date, 1, 50, & loaded ) );
+    REQUIRE_NOT_NULL ( loaded );
+    free_unaligned_index ( loaded );
+    remove ( idx_file );
+}
+
+TEST_CASE ( little_endian_file ) {
+    struct unaligned_index * idx = make_unaligned_index ( 1, 0x102 );
+    REQUIRE_RC ( unaligned_index_add_row ( idx, 0x101 ) );
+    REQUIRE_RC ( unaligned_index_save ( idx, idx_dir, run_path, mod_date ) );
+    free_unaligned_index ( idx );
+
+    /* the same bytes on every host: magic, version, first_row, row_count, ... */
+    unsigned char hdr [ 24 ];
+    FILE * f = fopen ( idx_file, "rb" );
+    REQUIRE_NOT_NULL ( f );
+    REQUIRE_EQ ( fread ( hdr, 1, sizeof hdr, f ), sizeof hdr );
+    fclose ( f );
+    const unsigned char expected [ 24 ] = {
+        'S', 'D', 'U', 'I',  2, 0, 0, 0,
+        1, 0, 0, 0, 0, 0, 0, 0,
+        2, 1, 0, 0, 0, 0, 0, 0 };
+    REQUIRE ( memcmp ( hdr, expected, sizeof hdr ) == 0 );
+    remove ( idx_file );
+}
+
+extern "C" {
+    ver_t CC KAppVersion ( void ) { return 0; }
+    rc_t CC KMain ( int argc, char * argv [] ) {
+        return TestUnalignedIndex ( argc, argv );
+    }
+}
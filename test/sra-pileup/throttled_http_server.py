@@ -0,0 +1,64 @@
+#!/usr/bin/env python3
+
+# serves the files of a directory over http with byte-range support, every
+# request is delayed by a fixed latency and limited to a bandwidth - to look
+# like remote data to the tools under test
+#
+# usage: throttled_http_server.py DIR PORT LATENCY_MS KBYTES_PER_SEC
+
+import http.server
+import os
+import re
+import sys
+import time
+
+DIR = sys.argv[ 1 ]
+PORT = int( sys.argv[ 2 ] )
+LATENCY = float( sys.argv[ 3 ] ) / 1000.0
+BANDWIDTH = int( sys.argv[ 4 ] ) * 1024
+
+class ThrottledHandler( http.server.BaseHTTPRequestHandler ) :
+    protocol_version = "HTTP/1.1"
+
+    def log_message( self, format, *args ) :
+        pass
+
+    def send_file_part( self, with_body ) :
+        path = os.path.join( DIR, os.path.basename( self.path ) )
+        if not os.path.isfile( path ) :
+            self.send_error( 404 )
+            return
+        size = os.path.getsize( path )
+        start, end = 0, size - 1
+        m = re.match( r"bytes=(\d+)-(\d*)", self.headers.get( "Range", "" ) )
+        if m :
+            start = int( m.group( 1 ) )
+            if m.group( 2 ) :
+                end = min( int( m.group( 2 ) ), size - 1 )
+            self.send_response( 206 )
+            self.send_header( "Content-Range", "bytes %d-%d/%d" % ( start, end, size ) )
+        else :
+            self.send_response( 200 )
+        self.send_header( "Accept-Ranges", "bytes" )
+        self.send_header( "Content-Length", str( end - start + 1 ) )
+        self.end_headers()
+        time.sleep( LATENCY )
+        if with_body :
+            with open( path, "rb" ) as f :
+                f.seek( start )
+                left = end - start + 1
+                while left > 0 :
+                    chunk = f.read( min( left, 64 * 1024 ) )
+                    if not chunk :
+                        break
+                    self.wfile.write( chunk )
+                    left -= len( chunk )
+                    time.sleep( len( chunk ) / float( BANDWIDTH ) )
+
+    def do_HEAD( self ) :
+        self.send_file_part( False )
+
+    def do_GET( self ) :
+        self.send_file_part( True )
+
+http.server.ThreadingHTTPServer( ( "127.0.0.1", PORT ), ThrottledHandler ).serve_forever()
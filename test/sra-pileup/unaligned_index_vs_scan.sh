@@ -0,0 +1,37 @@
+#!/bin/bash
+
+#sam-dump --unaligned-spots-only has to print the same with and without an
+#unaligned-index: the first run builds it, the second one uses it, a damaged
+#index falls back to scanning
+
+TOOL=$1
+ACC=$2
+
+TMP="./unaligned_index_vs_scan.tmp"
+rm -rf "$TMP"
+mkdir -p "$TMP/idx"
+
+$TOOL --unaligned-spots-only $ACC > "$TMP/scan.sam" || exit 1
+
+$TOOL --unaligned-spots-only --unaligned-index "$TMP/idx" $ACC > "$TMP/build.sam" || exit 1
+IDX="$TMP/idx/$(basename $ACC).unaligned.idx"
+if [ ! -f "$IDX" ] ; then
+    echo "sam-dump did not write $IDX"
+    exit 1
+fi
+
+$TOOL --unaligned-spots-only --unaligned-index "$TMP/idx" $ACC > "$TMP/indexed.sam" || exit 1
+
+#a truncated index is stale: scanned again and rewritten
+truncate -s 20 "$IDX"
+$TOOL --unaligned-spots-only --unaligned-index "$TMP/idx" $ACC > "$TMP/stale.sam" || exit 1
+
+for F in build indexed stale ; do
+    if ! diff --brief "$TMP/scan.sam" "$TMP/$F.sam" ; then
+        echo "sam-dump --unaligned-spots-only differs with unaligned-index ( $F ) for $ACC"
+        exit 1
+    fi
+done
+
+rm -rf "$TMP"
+echo "unaligned_index_vs_scan: $ACC ok"
@@ -0,0 +1,71 @@
+#!/bin/bash
+
+#sra-sort --checkpoint is killed after each finished table and in the middle of
+#a table, the same command is then run again: the resumed output has to be the
+#same as that of a run without interruption, and the checkpoint has to be gone
+
+SORT=$1
+VDBDUMP=$2
+SRC=$3
+
+TMP="./checkpoint_resume.tmp"
+rm -rf "$TMP"
+mkdir -p "$TMP"
+REF="$TMP/reference"
+DST="$TMP/resumed"
+LOG="$TMP/sort.log"
+
+$SORT -f --tempdir "$TMP" --mmapdir "$TMP" $SRC $REF || exit 1
+
+#starts the sort in the background and kills it once PATTERN shows up in its log
+kill_at()
+{
+    rm -f "$LOG"
+    $SORT --checkpoint -v -v -v --tempdir "$TMP" --mmapdir "$TMP" $SRC $DST 2> "$LOG" &
+    PID=$!
+    while kill -0 $PID 2>/dev/null ; do
+        if grep -q "$1" "$LOG" ; then
+            kill -9 $PID
+            break
+        fi
+        sleep 0.1
+    done
+    wait $PID 2>/dev/null
+}
+
+kill_at "checkpoint: committed table 'REFERENCE'"
+kill_at "PRIMARY_ALIGNMENT' mapped columns"
+kill_at "checkpoint: committed table 'PRIMARY_ALIGNMENT'"
+kill_at "checkpoint: committed table 'SECONDARY_ALIGNMENT'"
+
+if [ ! -d "$DST.sra-sort-checkpoint" ] ; then
+    echo "sra-sort --checkpoint left no checkpoint behind when killed"
+    exit 1
+fi
+
+$SORT --checkpoint -v --tempdir "$TMP" --mmapdir "$TMP" $SRC $DST 2> "$LOG"
+if [ $? -ne 0 ] ; then
+    cat "$LOG"
+    echo "sra-sort --checkpoint failed to resume on $SRC"
+    exit 1
+fi
+if ! grep -q "resuming from checkpoint" "$LOG" ; then
+    echo "sra-sort --checkpoint did not resume on $SRC"
+    exit 1
+fi
+if [ -d "$DST.sra-sort-checkpoint" ] ; then
+    echo "sra-sort --checkpoint did not remove its checkpoint after finishing"
+    exit 1
+fi
+
+for T in REFERENCE PRIMARY_ALIGNMENT SECONDARY_ALIGNMENT SEQUENCE ; do
+    $VDBDUMP -T $T -f tab $REF > "$TMP/ref.$T.txt" 2>/dev/null
+    $VDBDUMP -T $T -f tab $DST > "$TMP/dst.$T.txt" 2>/dev/null
+    if ! diff --brief "$TMP/ref.$T.txt" "$TMP/dst.$T.txt" ; then
+        echo "$T of the resumed sort differs from an uninterrupted sort of $SRC"
+        exit 1
+    fi
+done
+
+rm -rf "$TMP"
+echo "checkpoint_resume: $SRC ok"
@@ -0,0 +1,44 @@
+#!/bin/bash
+
+#the id maps of sra-sort are kept in memory or in files depending on
+#--map-mem-limit: the output has to be the same either way, also when the
+#limit is small enough for the poslen of an alignment table to move from
+#memory to a file in the middle of the copy; the sorts are timed
+
+SORT=$1
+VDBDUMP=$2
+SRC=$3
+
+TMP="./map_file_backend.tmp"
+rm -rf "$TMP"
+mkdir -p "$TMP"
+
+for LIMIT in 0 1048576 4294967296 ; do
+    T0=$(date +%s%N)
+    $SORT -f -v -v --map-mem-limit $LIMIT --tempdir "$TMP" --mmapdir "$TMP" $SRC "$TMP/sorted.$LIMIT" 2> "$TMP/log.$LIMIT" || exit 1
+    T1=$(date +%s%N)
+    echo "sra-sort $SRC with --map-mem-limit $LIMIT : $(( ( T1 - T0 ) / 1000000 )) ms"
+done
+
+if grep -q "in memory" "$TMP/log.0" ; then
+    echo "sra-sort kept an id map in memory with --map-mem-limit 0"
+    exit 1
+fi
+if grep -q "in files" "$TMP/log.4294967296" ; then
+    echo "sra-sort kept an id map in files with --map-mem-limit 4294967296"
+    exit 1
+fi
+
+for T in REFERENCE PRIMARY_ALIGNMENT SECONDARY_ALIGNMENT SEQUENCE ; do
+    $VDBDUMP -T $T -f tab "$TMP/sorted.0" > "$TMP/files.$T.txt" 2>/dev/null
+    for LIMIT in 1048576 4294967296 ; do
+        $VDBDUMP -T $T -f tab "$TMP/sorted.$LIMIT" > "$TMP/mem.$T.txt" 2>/dev/null
+        if ! diff --brief "$TMP/files.$T.txt" "$TMP/mem.$T.txt" ; then
+            echo "$T sorted with --map-mem-limit $LIMIT differs from the one sorted with id map files"
+            exit 1
+        fi
+    done
+done
+
+rm -rf "$TMP"
+echo "map_file_backend: $SRC ok"
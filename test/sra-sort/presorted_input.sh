@@ -0,0 +1,96 @@
+#!/bin/bash
+
+#sra-sort scans its input first and copies it in row order when it is in
+#sorted order already: the output has to be the same as the one of a full
+#sort ( --full-sort ) for input that is sorted, nearly sorted and unsorted,
+#and only the sorted one may be taken for sorted; the sort of a sorted run
+#is timed both ways
+
+SORT=$1
+VDBDUMP=$2
+SAMLINE=$3
+BAMLOAD=$4
+SRC=$5
+
+SPOTS=200
+REFNAME="NC_011752.1"
+
+TMP="./presorted_input.tmp"
+rm -rf "$TMP"
+mkdir -p "$TMP"
+CONFIG="$TMP/presorted.kfg"
+
+#call: sort_both NAME INPUT
+#sorts INPUT after a scan and with --full-sort, compares the outputs
+sort_both()
+{
+    T0=$(date +%s%N)
+    $SORT -f -v -v --tempdir "$TMP" --mmapdir "$TMP" $2 "$TMP/$1.scan" 2> "$TMP/$1.log" || exit 1
+    T1=$(date +%s%N)
+    $SORT -f --full-sort --tempdir "$TMP" --mmapdir "$TMP" $2 "$TMP/$1.full" || exit 1
+    T2=$(date +%s%N)
+    echo "sra-sort $1 : $(( ( T1 - T0 ) / 1000000 )) ms, with --full-sort $(( ( T2 - T1 ) / 1000000 )) ms"
+
+    for T in REFERENCE PRIMARY_ALIGNMENT SECONDARY_ALIGNMENT SEQUENCE ; do
+        $VDBDUMP -T $T -f tab "$TMP/$1.scan" > "$TMP/scan.$T.txt" 2>/dev/null
+        $VDBDUMP -T $T -f tab "$TMP/$1.full" > "$TMP/full.$T.txt" 2>/dev/null
+        if ! diff --brief "$TMP/scan.$T.txt" "$TMP/full.$T.txt" ; then
+            echo "$T of $1 differs from the one of a full sort"
+            exit 1
+        fi
+    done
+}
+
+#call: expect_sorted NAME yes|no
+expect_sorted()
+{
+    if grep -q "is already sorted" "$TMP/$1.log" ; then
+        FOUND=yes
+    else
+        FOUND=no
+    fi
+    if [ "$FOUND" != "$2" ] ; then
+        echo "sra-sort took $1 for sorted: $FOUND, expected: $2"
+        exit 1
+    fi
+}
+
+#synthetic spots with a pair of alignments at random positions each
+RANDOM=95
+for (( i = 0; i < SPOTS; ++i )) ; do
+    P0=$(( 1000 + RANDOM % 20000 ))
+    P1=$(( P0 + 200 + RANDOM % 2000 ))
+    $SAMLINE --qname "R$i" -r $REFNAME -p $P0 -c 50M -r $REFNAME -p $P1 -c 30M2D20M -d -n $CONFIG > "$TMP/spot.sam" || exit 1
+    if [ $i -eq 0 ] ; then
+        grep "^@" "$TMP/spot.sam" > "$TMP/header.sam"
+    fi
+    grep -v "^@" "$TMP/spot.sam" >> "$TMP/records.sam"
+done
+
+#unsorted: in spot order
+cat "$TMP/header.sam" "$TMP/records.sam" > "$TMP/unsorted.sam"
+
+#nearly sorted: in position order, but for two neighbours at different positions
+sort -s -t "$( printf '\t' )" -k4,4n "$TMP/records.sam" | \
+    awk -F '\t' 'NR > 100 && ! swapped && prev_pos != "" && $4 != prev_pos { print; print prev; swapped = 1; prev = ""; next }
+                 { if ( prev != "" ) print prev; prev = $0; prev_pos = $4 }
+                 END { if ( prev != "" ) print prev }' > "$TMP/nearly.records.sam"
+cat "$TMP/header.sam" "$TMP/nearly.records.sam" > "$TMP/nearly.sam"
+
+for NAME in unsorted nearly ; do
+    $BAMLOAD -L 3 -o "$TMP/$NAME" -k $CONFIG -E0 -Q0 "$TMP/$NAME.sam" > /dev/null 2>&1 || exit 1
+    sort_both $NAME "$TMP/$NAME"
+    expect_sorted $NAME no
+done
+
+#sorted: the output of a full sort
+sort_both sorted "$TMP/unsorted.full"
+expect_sorted sorted yes
+
+#benchmark: a sorted run, copied in row order and fully sorted again
+$SORT -f --tempdir "$TMP" --mmapdir "$TMP" $SRC "$TMP/src.sorted" || exit 1
+sort_both "$SRC-sorted" "$TMP/src.sorted"
+expect_sorted "$SRC-sorted" yes
+
+rm -rf "$TMP"
+echo "presorted_input: $SRC ok"
@@ -0,0 +1,70 @@
+#!/bin/bash
+
+#sra-sort relays SEQUENCE in first-alignment order: the output has to hold the
+#same spots and alignments as the input, the SEQUENCE row-ids seen walking
+#PRIMARY_ALIGNMENT have to appear in increasing order, and the unaligned spots
+#have to follow the aligned ones; then a region-dump with unaligned mates is
+#timed on the input and on the sorted output
+
+SORT=$1
+VDBDUMP=$2
+SAMDUMP=$3
+SRC=$4
+
+TMP="./seq_alignment_order.tmp"
+rm -rf "$TMP"
+mkdir -p "$TMP"
+DST="$TMP/sorted"
+
+$SORT -f --tempdir "$TMP" --mmapdir "$TMP" $SRC $DST || exit 1
+
+#logical identity: the content of the id-free columns, in any order
+for T in "SEQUENCE READ,QUALITY,NAME,READ_LEN" "PRIMARY_ALIGNMENT REF_NAME,REF_POS,CIGAR_SHORT,READ" ; do
+    set -- $T
+    $VDBDUMP -T $1 -C $2 -f tab $SRC | sort > "$TMP/src.$1.txt" || exit 1
+    $VDBDUMP -T $1 -C $2 -f tab $DST | sort > "$TMP/dst.$1.txt" || exit 1
+    if ! diff --brief "$TMP/src.$1.txt" "$TMP/dst.$1.txt" ; then
+        echo "$1 of the sorted $SRC differs from the source"
+        exit 1
+    fi
+done
+
+#first occurrences of SEQ_SPOT_ID, in PRIMARY_ALIGNMENT row order, are increasing
+$VDBDUMP -T PRIMARY_ALIGNMENT -C SEQ_SPOT_ID -f tab $DST | \
+    awk '!( $1 in seen ) { seen[ $1 ] = 1; if ( $1 < last ) { bad = 1; exit } last = $1 }
+         END { exit bad }'
+if [ $? -ne 0 ] ; then
+    echo "SEQUENCE of the sorted $SRC is not in first-alignment order"
+    exit 1
+fi
+
+#no aligned spot behind an unaligned one
+$VDBDUMP -T SEQUENCE -C PRIMARY_ALIGNMENT_ID -f tab $DST | \
+    awk '{ aligned = 0; for ( i = 1; i <= NF; ++i ) if ( $i != 0 ) aligned = 1 }
+         !aligned { unaligned = 1 }
+         aligned && unaligned { bad = 1; exit }
+         END { exit bad }'
+if [ $? -ne 0 ] ; then
+    echo "SEQUENCE of the sorted $SRC has aligned spots behind unaligned ones"
+    exit 1
+fi
+
+#benchmark: a region of the first reference, with the unaligned mates
+REF=$( $SAMDUMP $DST 2>/dev/null | awk '/^@SQ/ { print } !/^@/ { exit }' | head -n 1 | \
+       sed -e 's/.*SN:\([^\t]*\).*LN:\([0-9]*\).*/\1 \2/' )
+set -- $REF
+if [ -z "$2" ] ; then
+    echo "no references found in $DST"
+    exit 1
+fi
+REGION="$1:1-$(( $2 / 2 ))"
+
+T0=$(date +%s%N)
+$SAMDUMP -u --aligned-region $REGION $SRC > "$TMP/region_src.sam" || exit 1
+T1=$(date +%s%N)
+$SAMDUMP -u --aligned-region $REGION $DST > "$TMP/region_dst.sam" || exit 1
+T2=$(date +%s%N)
+echo "sam-dump -u of $REGION : source $(( ( T1 - T0 ) / 1000000 )) ms, sorted $(( ( T2 - T1 ) / 1000000 )) ms"
+
+rm -rf "$TMP"
+echo "seq_alignment_order: $SRC ok"
@@ -0,0 +1,85 @@
+#!/bin/bash
+
+#the cross-check of REFERENCE against the alignment tables runs on ranges of
+#REFERENCE rows, on a thread per worker: a clean sort has to pass it, and a
+#wrong REF_ID injected on the first, a middle and the last alignment row, and
+#on both sides of every boundary between ranges, has to be caught each time;
+#--xcheck-inject exists in debug builds only
+
+SORT=$1
+VDBDUMP=$2
+SRC=$3
+
+TMP="./xcheck_inject.tmp"
+rm -rf "$TMP"
+mkdir -p "$TMP"
+DST="$TMP/sorted"
+
+if ! $SORT --help 2>&1 | grep -q "xcheck-inject" ; then
+    echo "xcheck_inject: skipped, $SORT is not a debug build"
+    rm -rf "$TMP"
+    exit 0
+fi
+
+T0=$(date +%s%N)
+$SORT -f -v -v --tempdir "$TMP" --mmapdir "$TMP" $SRC $DST 2> "$TMP/clean.log"
+if [ $? -ne 0 ] ; then
+    cat "$TMP/clean.log"
+    echo "cross-check failed on a clean sort of $SRC"
+    exit 1
+fi
+T1=$(date +%s%N)
+grep "REFERENCE rows against" "$TMP/clean.log"
+echo "sra-sort $SRC with cross-check : $(( ( T1 - T0 ) / 1000000 )) ms"
+
+ROWS=$( $VDBDUMP -T PRIMARY_ALIGNMENT --id_range $DST | sed -e 's/.*row-count = //' -e 's/,//g' )
+if [ -z "$ROWS" ] || [ "$ROWS" -lt 3 ] ; then
+    echo "too few rows in PRIMARY_ALIGNMENT of $SRC"
+    exit 1
+fi
+
+#the ranges of REFERENCE rows as the check made them
+set -- $( sed -n -e 's/.*checking \([0-9,]*\) REFERENCE rows against PRIMARY_ALIGNMENT in \([0-9]*\) ranges on \([0-9]*\) workers.*/\1 \2 \3/p' \
+          "$TMP/clean.log" | tr -d ',' )
+REF_ROWS=$1
+RANGES=$2
+WORKERS=$3
+if [ -z "$WORKERS" ] || [ "$WORKERS" -lt 2 ] ; then
+    echo "the cross-check of $SRC does not run on several workers"
+    exit 1
+fi
+REF_FIRST=$( $VDBDUMP -T REFERENCE --id_range $DST | sed -e 's/.*first-row = \([0-9,]*\),.*/\1/' -e 's/,//g' )
+PER_RANGE=$(( ( REF_ROWS + RANGES - 1 ) / RANGES ))
+
+#the first alignment of every range but the first, and the last alignment of the range before
+BOUNDARIES=""
+for (( K = 1; K < RANGES; ++K )) ; do
+    START=$(( REF_FIRST + K * PER_RANGE ))
+    END=$(( START + PER_RANGE - 1 ))
+    [ $START -ge $(( REF_FIRST + REF_ROWS )) ] && break
+    FIRST=$( $VDBDUMP -T REFERENCE -C PRIMARY_ALIGNMENT_IDS -R $START-$END -f tab $DST | \
+             tr ',' '\n' | tr -d ' ' | grep -m 1 "[0-9]" )
+    if [ -n "$FIRST" ] && [ "$FIRST" -gt 1 ] ; then
+        BOUNDARIES="$BOUNDARIES $(( FIRST - 1 )) $FIRST"
+    fi
+done
+if [ -z "$BOUNDARIES" ] ; then
+    echo "no alignments on the boundaries between the ranges of $SRC"
+    exit 1
+fi
+
+for ROW in 1 $(( ROWS / 2 )) $ROWS $BOUNDARIES ; do
+    $SORT -f --xcheck-inject $ROW --tempdir "$TMP" --mmapdir "$TMP" $SRC $DST 2> "$TMP/inject.log"
+    if [ $? -eq 0 ] ; then
+        echo "cross-check missed a wrong REF_ID on row $ROW of $SRC"
+        exit 1
+    fi
+    if ! grep -q "REF_ID.$ROW: expected id" "$TMP/inject.log" ; then
+        cat "$TMP/inject.log"
+        echo "cross-check failed, but not on the wrong REF_ID of row $ROW"
+        exit 1
+    fi
+done
+
+rm -rf "$TMP"
+echo "xcheck_inject: $SRC ok"
@@ -0,0 +1,74 @@
+#!/bin/bash
+
+#sra-stat has to report the same XML for a database whether its files are
+#counted by one or by many threads: the <Size> has to be the sum of the
+#sizes of all files in the database, everything else must not change when
+#hundreds of columns are added; the reports of both databases are timed
+
+SRASTAT=$1
+BAMLOAD=$2
+
+SPOTS=2000
+COPIES=20
+
+TMP="./size_columns.tmp"
+rm -rf "$TMP"
+mkdir -p "$TMP"
+
+#unaligned reads
+awk -v spots=$SPOTS 'BEGIN {
+        srand( 100 )
+        print "@HD\tVN:1.4\tSO:unsorted"
+        for ( i = 0; i < spots; ++i ) {
+            len = 50 + i % 51
+            seq = ""
+            for ( j = 0; j < len; ++j )
+                seq = seq substr( "ACGT", 1 + int( rand() * 4 ), 1 )
+            qual = sprintf( "%" len "s", "" )
+            gsub( / /, "I", qual )
+            printf( "R%05d\t4\t*\t0\t0\t*\t*\t0\t0\t%s\t%s\n", i, seq, qual )
+        }
+    }' > "$TMP/reads.sam"
+
+$BAMLOAD -L 3 -o "$TMP/narrow" -E0 -Q0 "$TMP/reads.sam" > /dev/null 2>&1 || exit 1
+
+#the same database with every physical column copied: the schema does not
+#know the copies, they only add directories and files
+cp -r "$TMP/narrow" "$TMP/wide" || exit 1
+for COL in "$TMP"/wide/tbl/*/col/* ; do
+    for (( K = 1; K <= COPIES; ++K )) ; do
+        cp -r "$COL" "${COL}_COPY_$K" || exit 1
+    done
+done
+NCOLS=$( ls -d "$TMP"/wide/tbl/*/col/* | wc -l )
+
+for NAME in narrow wide ; do
+    T0=$(date +%s%N)
+    $SRASTAT -x "$TMP/$NAME" > "$TMP/$NAME.xml" || exit 1
+    T1=$(date +%s%N)
+    COLS=$( ls -d "$TMP"/$NAME/tbl/*/col/* | wc -l )
+    echo "sra-stat $NAME, $COLS columns : $(( ( T1 - T0 ) / 1000000 )) ms"
+
+    EXPECTED=$( find "$TMP/$NAME" -type f -printf "%s\n" | awk '{ s += $1 } END { print s }' )
+    if ! grep -q "<Size value=\"$EXPECTED\" units=\"bytes\"/>" "$TMP/$NAME.xml" ; then
+        echo "sra-stat reports a size of $NAME different from $EXPECTED bytes"
+        exit 1
+    fi
+done
+
+#the report of the wide database again: nothing depends on the order of the threads
+$SRASTAT -x "$TMP/wide" > "$TMP/wide.again.xml" || exit 1
+if ! diff --brief "$TMP/wide.xml" "$TMP/wide.again.xml" ; then
+    echo "sra-stat reports $NCOLS columns differently from one run to the next"
+    exit 1
+fi
+
+grep -v "<Size " "$TMP/narrow.xml" | sed -e "s|$TMP/narrow|PATH|g" > "$TMP/narrow.rest"
+grep -v "<Size " "$TMP/wide.xml" | sed -e "s|$TMP/wide|PATH|g" > "$TMP/wide.rest"
+if ! diff --brief "$TMP/narrow.rest" "$TMP/wide.rest" ; then
+    echo "sra-stat reports more than the size differently for $NCOLS columns"
+    exit 1
+fi
+
+rm -rf "$TMP"
+echo "size_columns: ok"
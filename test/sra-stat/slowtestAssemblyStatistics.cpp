@@ -0,0 +1,76 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "../../tools/sra-stat/assembly-statistics.c" /* Contigs */
+
+#include <ktst/unit_test.hpp> // TEST_SUITE
+
+#include <cstdlib> // rand
+#include <ctime> // clock
+#include <iostream> // cerr
+
+/* the N50/L50 of a large assembly is timed here, not in testAssemblyStatistics:
+   it is run by 'make slowtests' only */
+
+TEST_SUITE ( SlowTestAssemblyStatistics );
+
+static const uint64_t ZERO = 0;
+
+/* a fragmented assembly: 50M contigs, every 1000th of them long */
+TEST_CASE ( benchmark50M ) {
+    const uint64_t N = 50000000;
+
+    Contigs contigs;
+    ContigsInit ( & contigs );
+
+    srand ( 50 );
+    clock_t start = clock ();
+    for ( uint64_t i = 0; i < N; ++ i ) {
+        uint32_t length = i % 1000 == 0
+            ? CONTIG_SHORT + rand () % 1000000 : 200 + rand () % 3000;
+        REQUIRE_RC ( ContigsAdd ( & contigs, length ) );
+    }
+    ContigsCalculateStatistics ( & contigs );
+    clock_t end = clock ();
+
+    std::cerr << "N50/L50 of " << N << " contigs: "
+        << ( end - start ) * 1000 / CLOCKS_PER_SEC << " ms\n";
+
+    REQUIRE_EQ ( contigs . count, N );
+    REQUIRE_EQ ( contigs . length, contigs . assemblyLength );
+    REQUIRE_GT ( contigs . l50, ZERO );
+    REQUIRE_LE ( contigs . l50, contigs . l90 );
+    REQUIRE_GE ( contigs . n50, contigs . n90 );
+
+    ContigsFini ( & contigs );
+}
+
+extern "C" {
+    ver_t CC KAppVersion ( void ) { return 0; }
+    rc_t CC KMain ( int argc, char * argv [] ) {
+        return SlowTestAssemblyStatistics ( argc, argv );
+    }
+}
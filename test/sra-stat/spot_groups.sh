@@ -0,0 +1,75 @@
+#!/bin/bash
+
+#sra-stat has to report the same <Member> lines for a run with thousands
+#of spot-groups whether the spots of a group come one after the other or
+#interleaved with all other groups, with the counts that are in the input;
+#the scans of both runs are timed
+
+SRASTAT=$1
+BAMLOAD=$2
+
+NGROUPS=3000
+SPOTS_PER_GROUP=20
+
+TMP="./spot_groups.tmp"
+rm -rf "$TMP"
+mkdir -p "$TMP"
+
+#unaligned reads with a barcode as read-group, read-length depends on the group
+awk -v groups=$NGROUPS -v per_group=$SPOTS_PER_GROUP 'BEGIN {
+        srand( 97 )
+        print "@HD\tVN:1.4\tSO:unsorted"
+        for ( g = 0; g < groups; ++g )
+            printf( "@RG\tID:BC%05d\tSM:S%d\n", g, g % 10 )
+        for ( g = 0; g < groups; ++g ) {
+            len = 30 + g % 41
+            for ( i = 0; i < per_group; ++i ) {
+                seq = ""
+                for ( j = 0; j < len; ++j )
+                    seq = seq substr( "ACGT", 1 + int( rand() * 4 ), 1 )
+                qual = sprintf( "%" len "s", "" )
+                gsub( / /, "I", qual )
+                printf( "G%05dS%03d\t4\t*\t0\t0\t*\t*\t0\t0\t%s\t%s\tRG:Z:BC%05d\n",
+                        g, i, seq, qual, g )
+            }
+        }
+    }' > "$TMP/grouped.sam"
+
+#the same spots, group after group in every round
+( grep "^@" "$TMP/grouped.sam" ;
+  grep -v "^@" "$TMP/grouped.sam" | \
+    awk -F '\t' '{ print substr( $1, 8 ) "\t" $0 }' | sort -s -t "$( printf '\t' )" -k1,1n | cut -f 2- ) \
+    > "$TMP/interleaved.sam"
+
+#the expected members: spots and bases per read-group
+grep -v "^@" "$TMP/grouped.sam" | \
+    awk -F '\t' '{ g = substr( $12, 6 ); n[ g ]++; b[ g ] += length( $10 ) }
+                 END { for ( g in n ) printf( "%s %d %d\n", g, n[ g ], b[ g ] ) }' | \
+    sort > "$TMP/expected.txt"
+
+for NAME in grouped interleaved ; do
+    $BAMLOAD -L 3 -o "$TMP/$NAME" -E0 -Q0 "$TMP/$NAME.sam" > /dev/null 2>&1 || exit 1
+done
+
+for NAME in grouped interleaved ; do
+    T0=$(date +%s%N)
+    $SRASTAT -x "$TMP/$NAME" > "$TMP/$NAME.xml" || exit 1
+    T1=$(date +%s%N)
+    echo "sra-stat $NAME, $NGROUPS spot-groups : $(( ( T1 - T0 ) / 1000000 )) ms"
+    grep "<Member " "$TMP/$NAME.xml" > "$TMP/$NAME.members"
+done
+
+if ! diff --brief "$TMP/grouped.members" "$TMP/interleaved.members" ; then
+    echo "sra-stat reports different spot-groups for grouped and interleaved spots"
+    exit 1
+fi
+
+sed -e 's/.*member_name="\([^"]*\)" spot_count="\([0-9]*\)" base_count="\([0-9]*\)".*/\1 \2 \3/' \
+    "$TMP/grouped.members" | sort > "$TMP/reported.txt"
+if ! diff --brief "$TMP/expected.txt" "$TMP/reported.txt" ; then
+    echo "sra-stat reports spot-groups different from the input"
+    exit 1
+fi
+
+rm -rf "$TMP"
+echo "spot_groups: ok"
@@ -28,6 +28,11 @@
 
 #include <ktst/unit_test.hpp> // TEST_SUITE
 
+#include <algorithm> // sort
+#include <cstdlib> // rand
+#include <functional> // greater
+#include <vector>
+
 TEST_SUITE ( TestAssemblyStatistics );
 
 TEST_CASE ( empty ) {
@@ -144,6 +149,82 @@ TEST_CASE ( test7 ) {
     REQUIRE_NE ( memcmp ( & contigs, & empty, sizeof empty ), 0 );
 }
 
+/* the statistics as they were calculated from a tree of contigs:
+   every contig visited from the longest to the shortest */
+static void Reference ( std::vector < uint32_t > lengths,
+    uint64_t & l50, uint64_t & n50, uint64_t & l90, uint64_t & n90 )
+{
+    uint64_t assemblyLength = 0;
+    uint64_t length = 0;
+
+    std::sort ( lengths . begin (), lengths . end (),
+        std::greater < uint32_t > () );
+    for ( size_t i = 0; i < lengths . size (); ++ i )
+        assemblyLength += lengths [ i ];
+
+    l50 = n50 = l90 = n90 = 0;
+    for ( size_t i = 0; i < lengths . size (); ++ i ) {
+        length += lengths [ i ];
+        if ( l50 == 0 && length * 2 >= assemblyLength ) {
+            n50 = lengths [ i ];
+            l50 = i + 1;
+        }
+        if ( l90 == 0 && .9 * assemblyLength <= length ) {
+            n90 = lengths [ i ];
+            l90 = i + 1;
+        }
+    }
+}
+
+TEST_CASE ( sameAsTree ) {
+    for ( unsigned seed = 0; seed < 200; ++ seed ) {
+        srand ( seed );
+
+        size_t n = 1 + rand () % ( seed < 100 ? 50 : 20000 );
+        std::vector < uint32_t > lengths;
+
+        Contigs contigs;
+        ContigsInit ( & contigs );
+
+        for ( size_t i = 0; i < n; ++ i ) {
+            uint32_t length = 0;
+            switch ( seed % 4 ) {
+                case 0: /* just short ones, many ties */
+                    length = rand () % 100;
+                    break;
+                case 1: /* short and long ones */
+                    length = rand () % 200000;
+                    break;
+                case 2: /* a few long lengths, many ties */
+                    length = ( rand () % 5 ) * 70000 + rand () % 3;
+                    break;
+                default: /* short ones with some very long ones */
+                    length = rand () % 10 == 0
+                        ? static_cast < uint32_t > ( rand () ) * 2
+                        : rand () % 1000;
+                    break;
+            }
+            lengths . push_back ( length );
+            REQUIRE_RC ( ContigsAdd ( & contigs, length ) );
+        }
+
+        ContigsCalculateStatistics ( & contigs );
+
+        uint64_t l50, n50, l90, n90;
+        Reference ( lengths, l50, n50, l90, n90 );
+
+        REQUIRE_EQ ( contigs . contigLength, static_cast <uint64_t> ( n ) );
+        REQUIRE_EQ ( contigs . count, contigs . contigLength );
+        REQUIRE_EQ ( contigs . length, contigs . assemblyLength );
+        REQUIRE_EQ ( contigs . l50, l50 );
+        REQUIRE_EQ ( contigs . n50, n50 );
+        REQUIRE_EQ ( contigs . l90, l90 );
+        REQUIRE_EQ ( contigs . n90, n90 );
+
+        ContigsFini ( & contigs );
+    }
+}
+
 extern "C" {
     ver_t CC KAppVersion ( void ) { return 0; }
     rc_t CC KMain ( int argc, char * argv [] ) {
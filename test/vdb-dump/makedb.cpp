@@ -29,6 +29,11 @@
 */
 
 #include <fstream>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
 
 #include <vdb/manager.h>
 #include <vdb/schema.h>
@@ -196,6 +201,295 @@ NestedDatabase()
     return 0;
 }
 
+//////////////////////////////////////////// Numbers
+// one column per integer/float type, with a file of the expected text for every
+// column next to the table: the values formated with the C-library's printf
+
+template < typename T >
+rc_t
+AddNumberCell ( VCursor* p_curs, uint32_t p_colIdx, const vector< T >& p_values )
+{
+    return VCursorWrite ( p_curs, p_colIdx, sizeof ( T ) * 8, p_values.empty() ? NULL : & p_values [ 0 ], 0, p_values.size() );
+}
+
+template < typename T >
+void
+AddExpectedLine ( ofstream& p_out, const vector< T >& p_values, const char * p_fmt )
+{
+    char buf [ 64 ];
+    for ( size_t i = 0; i < p_values.size(); ++i )
+    {
+        if ( i > 0 )
+            p_out << ", ";
+        snprintf ( buf, sizeof buf, p_fmt, p_values [ i ] );
+        p_out << buf;
+    }
+    p_out << endl;
+}
+
+struct NumberRows
+{
+    vector< vector< uint8_t > > u8;
+    vector< vector< uint16_t > > u16;
+    vector< vector< uint32_t > > u32;
+    vector< vector< uint64_t > > u64;
+    vector< vector< int8_t > > i8;
+    vector< vector< int16_t > > i16;
+    vector< vector< int32_t > > i32;
+    vector< vector< int64_t > > i64;
+    vector< vector< float > > f32;
+    vector< vector< double > > f64;
+
+    void Add ( const vector< uint64_t >& p_bits, const vector< double >& p_reals )
+    {
+        u8 . push_back ( vector< uint8_t > () );
+        u16 . push_back ( vector< uint16_t > () );
+        u32 . push_back ( vector< uint32_t > () );
+        u64 . push_back ( vector< uint64_t > () );
+        i8 . push_back ( vector< int8_t > () );
+        i16 . push_back ( vector< int16_t > () );
+        i32 . push_back ( vector< int32_t > () );
+        i64 . push_back ( vector< int64_t > () );
+        f32 . push_back ( vector< float > () );
+        f64 . push_back ( vector< double > () );
+        for ( size_t i = 0; i < p_bits.size(); ++i )
+        {
+            uint64_t v = p_bits [ i ];
+            u8 . back() . push_back ( ( uint8_t ) v );
+            u16 . back() . push_back ( ( uint16_t ) v );
+            u32 . back() . push_back ( ( uint32_t ) v );
+            u64 . back() . push_back ( v );
+            i8 . back() . push_back ( ( int8_t ) v );
+            i16 . back() . push_back ( ( int16_t ) v );
+            i32 . back() . push_back ( ( int32_t ) v );
+            i64 . back() . push_back ( ( int64_t ) v );
+        }
+        for ( size_t i = 0; i < p_reals.size(); ++i )
+        {
+            // beyond the range of float: infinity, without relying on the conversion
+            if ( std::isfinite ( p_reals [ i ] ) && std::fabs ( p_reals [ i ] ) > FLT_MAX )
+                f32 . back() . push_back ( p_reals [ i ] < 0 ? -HUGE_VALF : HUGE_VALF );
+            else
+                f32 . back() . push_back ( ( float ) p_reals [ i ] );
+            f64 . back() . push_back ( p_reals [ i ] );
+        }
+    }
+};
+
+template < typename T >
+void
+WriteExpected ( const string& p_path, const vector< vector< T > >& p_rows, const char * p_fmt )
+{
+    ofstream out ( p_path . c_str() );
+    for ( size_t r = 0; r < p_rows.size(); ++r )
+        AddExpectedLine ( out, p_rows [ r ], p_fmt );
+}
+
+template < typename T >
+void
+WriteExpectedInt ( const string& p_path, const vector< vector< T > >& p_rows, bool p_signed )
+{
+    // vdb-dump widens every element to 64 bit before printing
+    vector< vector< uint64_t > > hex;
+    vector< vector< int64_t > > dec;
+    for ( size_t r = 0; r < p_rows.size(); ++r )
+    {
+        hex . push_back ( vector< uint64_t > () );
+        dec . push_back ( vector< int64_t > () );
+        for ( size_t i = 0; i < p_rows [ r ] . size(); ++i )
+        {
+            hex . back() . push_back ( ( uint64_t ) ( int64_t ) p_rows [ r ] [ i ] );
+            dec . back() . push_back ( ( int64_t ) p_rows [ r ] [ i ] );
+        }
+    }
+    if ( p_signed )
+        WriteExpected ( p_path + ".dec", dec, "%ld" );
+    else
+        WriteExpected ( p_path + ".dec", hex, "%lu" );
+    WriteExpected ( p_path + ".hex", hex, "0x%lX" );
+}
+
+rc_t
+NumberTable()
+{
+    const string ScratchDir         = "./data/";
+    const string DefaultSchemaText  =
+        "table numbers #1.0.0\n"
+        "{\n"
+        " column U8 C_U8;\n"
+        " column U16 C_U16;\n"
+        " column U32 C_U32;\n"
+        " column U64 C_U64;\n"
+        " column I8 C_I8;\n"
+        " column I16 C_I16;\n"
+        " column I32 C_I32;\n"
+        " column I64 C_I64;\n"
+        " column F32 C_F32;\n"
+        " column F64 C_F64;\n"
+        "};\n"
+    ;
+    const char * Columns [] =
+        { "C_U8", "C_U16", "C_U32", "C_U64", "C_I8", "C_I16", "C_I32", "C_I64", "C_F32", "C_F64" };
+    const size_t NumColumns = sizeof Columns / sizeof Columns [ 0 ];
+
+    NumberRows rows;
+    {   // the edges of every width
+        const uint64_t edges [] =
+        {
+            0, 1, 9, 10, 99, 100, 101, 999, 1000, 12345, 0x7F, 0x80, 0xFF, 0x100,
+            0x7FFF, 0x8000, 0xFFFF, 0x10000, 0x7FFFFFFF, 0x80000000, 0xFFFFFFFF,
+            0x100000000ULL, 9999999999ULL, 10000000000ULL, 0x7FFFFFFFFFFFFFFFULL,
+            0x8000000000000000ULL, 0xFFFFFFFFFFFFFFFFULL, 0xFFFFFFFFFFFFFFFEULL
+        };
+        const double reals [] = { 0.0, 1.0, -1.0, 0.5, 1e-10, 123456.789, -9.87654321e+20, 3.14159265358979 };
+        rows . Add ( vector< uint64_t > ( edges, edges + sizeof edges / sizeof edges [ 0 ] ),
+                     vector< double > ( reals, reals + sizeof reals / sizeof reals [ 0 ] ) );
+    }
+    {   // the edges of the float-types: signed zero, rounding of the 7th digit,
+        // denormals, overflow of float, infinity and not-a-number
+        const double reals [] =
+        {
+            -0.0, 1.0000005, 1.0000015, 9.9999995, 9.9999996, 2.5e-7, 0.1, 1.0 / 3.0,
+            DBL_MIN, DBL_MIN / 4096, DBL_MAX, -DBL_MAX, FLT_MIN, FLT_MIN / 64, FLT_MAX, 1e300,
+            HUGE_VAL, -HUGE_VAL, nan ( "" ), -nan ( "" ), 1e-320, 12345678901234567890.0
+        };
+        const size_t count = sizeof reals / sizeof reals [ 0 ];
+        rows . Add ( vector< uint64_t > ( count, 7 ), vector< double > ( reals, reals + count ) );
+    }
+    {   // more text than one formating-chunk of vdb-dump
+        vector< uint64_t > bits;
+        vector< double > reals;
+        srand ( 3937 );
+        for ( size_t i = 0; i < 5000; ++i )
+        {
+            uint64_t v = ( ( uint64_t ) rand() << 42 ) ^ ( ( uint64_t ) rand() << 21 ) ^ ( uint64_t ) rand();
+            bits . push_back ( v >> ( rand() % 64 ) );
+            reals . push_back ( ( double ) rand() / ( ( double ) rand() + 1.0 ) - 0.5 );
+        }
+        rows . Add ( bits, reals );
+    }
+    {   // a single element
+        rows . Add ( vector< uint64_t > ( 1, 42 ), vector< double > ( 1, 42.0 ) );
+    }
+
+    VDBManager* mgr;
+    CHECK_RC ( VDBManagerMakeUpdate ( & mgr, NULL ) );
+    VSchema* schema;
+    CHECK_RC ( VDBManagerMakeSchema ( mgr, & schema ) );
+    CHECK_RC ( VSchemaParseText ( schema, NULL, DefaultSchemaText.c_str(), DefaultSchemaText.size() ) );
+
+    VTable *tab;
+    CHECK_RC ( VDBManagerCreateTable ( mgr,
+                                       & tab,
+                                       schema,
+                                       "numbers",
+                                       kcmInit + kcmMD5,
+                                       "%s",
+                                       ( ScratchDir + "NumberTable" ) . c_str() ) );
+    VCursor *curs;
+    CHECK_RC ( VTableCreateCursorWrite ( tab, & curs, kcmInsert ) ) ;
+    uint32_t idx [ NumColumns ];
+    for ( size_t c = 0; c < NumColumns; ++c )
+        CHECK_RC ( VCursorAddColumn ( curs, & idx [ c ], "%s", Columns [ c ] ) );
+    CHECK_RC ( VCursorOpen ( curs ) );
+    for ( size_t r = 0; r < rows . u8 . size(); ++r )
+    {
+        CHECK_RC ( VCursorSetRowId ( curs, r + 1 ) );
+        CHECK_RC ( VCursorOpenRow ( curs ) );
+        CHECK_RC ( AddNumberCell ( curs, idx [ 0 ], rows . u8 [ r ] ) );
+        CHECK_RC ( AddNumberCell ( curs, idx [ 1 ], rows . u16 [ r ] ) );
+        CHECK_RC ( AddNumberCell ( curs, idx [ 2 ], rows . u32 [ r ] ) );
+        CHECK_RC ( AddNumberCell ( curs, idx [ 3 ], rows . u64 [ r ] ) );
+        CHECK_RC ( AddNumberCell ( curs, idx [ 4 ], rows . i8 [ r ] ) );
+        CHECK_RC ( AddNumberCell ( curs, idx [ 5 ], rows . i16 [ r ] ) );
+        CHECK_RC ( AddNumberCell ( curs, idx [ 6 ], rows . i32 [ r ] ) );
+        CHECK_RC ( AddNumberCell ( curs, idx [ 7 ], rows . i64 [ r ] ) );
+        CHECK_RC ( AddNumberCell ( curs, idx [ 8 ], rows . f32 [ r ] ) );
+        CHECK_RC ( AddNumberCell ( curs, idx [ 9 ], rows . f64 [ r ] ) );
+        CHECK_RC ( VCursorCommitRow ( curs ) );
+        CHECK_RC ( VCursorCloseRow ( curs ) );
+    }
+    CHECK_RC ( VCursorCommit ( curs ) );
+    CHECK_RC ( VCursorRelease ( curs ) );
+    CHECK_RC ( VTableRelease ( tab ) );
+
+    const string Expected = ScratchDir + "NumberTable.";
+    WriteExpectedInt ( Expected + "C_U8", rows . u8, false );
+    WriteExpectedInt ( Expected + "C_U16", rows . u16, false );
+    WriteExpectedInt ( Expected + "C_U32", rows . u32, false );
+    WriteExpectedInt ( Expected + "C_U64", rows . u64, false );
+    WriteExpectedInt ( Expected + "C_I8", rows . i8, true );
+    WriteExpectedInt ( Expected + "C_I16", rows . i16, true );
+    WriteExpectedInt ( Expected + "C_I32", rows . i32, true );
+    WriteExpectedInt ( Expected + "C_I64", rows . i64, true );
+    // float is promoted to double by printf, the same happens in vdb-dump
+    WriteExpected ( Expected + "C_F32.dec", rows . f32, "%e" );
+    WriteExpected ( Expected + "C_F64.dec", rows . f64, "%e" );
+
+    CHECK_RC ( VSchemaRelease ( schema ) );
+    CHECK_RC ( VDBManagerRelease ( mgr ) );
+    return 0;
+}
+
+//////////////////////////////////////////// Numbers, big enough to time a column-dump
+
+rc_t
+NumberBenchTable()
+{
+    const string ScratchDir         = "./data/";
+    const string DefaultSchemaText  =
+        "table numbers_bench #1.0.0 { column U32 C_U32; column I64 C_I64; column F64 C_F64; };\n";
+
+    VDBManager* mgr;
+    CHECK_RC ( VDBManagerMakeUpdate ( & mgr, NULL ) );
+    VSchema* schema;
+    CHECK_RC ( VDBManagerMakeSchema ( mgr, & schema ) );
+    CHECK_RC ( VSchemaParseText ( schema, NULL, DefaultSchemaText.c_str(), DefaultSchemaText.size() ) );
+
+    VTable *tab;
+    CHECK_RC ( VDBManagerCreateTable ( mgr,
+                                       & tab,
+                                       schema,
+                                       "numbers_bench",
+                                       kcmInit + kcmMD5,
+                                       "%s",
+                                       ( ScratchDir + "NumberBenchTable" ) . c_str() ) );
+    VCursor *curs;
+    CHECK_RC ( VTableCreateCursorWrite ( tab, & curs, kcmInsert ) ) ;
+    uint32_t idx_u32, idx_i64, idx_f64;
+    CHECK_RC ( VCursorAddColumn ( curs, & idx_u32, "C_U32" ) );
+    CHECK_RC ( VCursorAddColumn ( curs, & idx_i64, "C_I64" ) );
+    CHECK_RC ( VCursorAddColumn ( curs, & idx_f64, "C_F64" ) );
+    CHECK_RC ( VCursorOpen ( curs ) );
+
+    srand ( 88 );
+    vector< uint32_t > u32 ( 1000 );
+    vector< int64_t > i64 ( 1000 );
+    vector< double > f64 ( 1000 );
+    for ( int64_t r = 1; r <= 2000; ++r )
+    {
+        for ( size_t i = 0; i < u32.size(); ++i )
+        {
+            u32 [ i ] = ( uint32_t ) rand();
+            i64 [ i ] = ( int64_t ) rand() - ( int64_t ) rand() * 1000003;
+            f64 [ i ] = ( ( double ) rand() - RAND_MAX / 2 ) / ( ( double ) rand() + 1.0 );
+        }
+        CHECK_RC ( VCursorSetRowId ( curs, r ) );
+        CHECK_RC ( VCursorOpenRow ( curs ) );
+        CHECK_RC ( AddNumberCell ( curs, idx_u32, u32 ) );
+        CHECK_RC ( AddNumberCell ( curs, idx_i64, i64 ) );
+        CHECK_RC ( AddNumberCell ( curs, idx_f64, f64 ) );
+        CHECK_RC ( VCursorCommitRow ( curs ) );
+        CHECK_RC ( VCursorCloseRow ( curs ) );
+    }
+    CHECK_RC ( VCursorCommit ( curs ) );
+    CHECK_RC ( VCursorRelease ( curs ) );
+    CHECK_RC ( VTableRelease ( tab ) );
+    CHECK_RC ( VSchemaRelease ( schema ) );
+    CHECK_RC ( VDBManagerRelease ( mgr ) );
+    return 0;
+}
+
 //////////////////////////////////////////// Main
 extern "C"
 {
@@ -223,7 +517,9 @@ rc_t CC KMain ( int argc, char *argv [] )
 {
     KConfigDisableUserSettings();
 
-    return NestedDatabase();
+    CHECK_RC ( NestedDatabase() );
+    CHECK_RC ( NumberTable() );
+    return NumberBenchTable();
 }
 
 }
@@ -0,0 +1,97 @@
+#!/bin/bash
+
+if [ $# -ne 2 ]
+then
+cat <<EOF >&2
+
+That script tests that vdb-dump prints integer- and float-columns exactly
+like the printf-formats "%lu", "%ld", "0x%lX" and "%e", and times a column-dump
+
+Syntax : `basename $0` vdb-dump-path data-path
+
+where :
+           vdb-dump-path - path to testing utility
+               data-path - directory made by vdb-dump-makedb, with NumberTable,
+                           NumberBenchTable and the expected text per column
+
+EOF
+
+exit 1
+fi
+
+VDB_D=$1
+DATA=$2
+
+if [ ! -x "$VDB_D" ]
+then
+    echo Can not stat executable \'$VDB_D\' >&2
+    exit 1
+fi
+
+if [ ! -d "$DATA/NumberTable" ]
+then
+    echo Can not stat table \'$DATA/NumberTable\' >&2
+    exit 1
+fi
+
+echo "TEST: number formating"
+
+TMP="./test_number_format.tmp"
+rm -rf "$TMP"
+mkdir -p "$TMP"
+
+#$1 ... expected file, $2 ... actual file, $3 ... what was tested
+compare()
+{
+    if ! cmp -s "$1" "$2"
+    then
+        echo "TEST: FAILED ( $3 )"
+        diff "$1" "$2" | head -n 5
+        exit 1
+    fi
+}
+
+for COL in C_U8 C_U16 C_U32 C_U64 C_I8 C_I16 C_I32 C_I64 C_F32 C_F64
+do
+    for MODE in dec hex
+    do
+        EXPECTED="$DATA/NumberTable.$COL.$MODE"
+        [ -f "$EXPECTED" ] || continue
+        OPT=""
+        [ "$MODE" = "hex" ] && OPT="-X"
+
+        #tab: elements separated by ", "
+        NCBI_SETTINGS=/ $VDB_D $DATA/NumberTable -C $COL -f tab $OPT > "$TMP/tab" || exit 1
+        compare "$EXPECTED" "$TMP/tab" "$COL $MODE -f tab"
+
+        #sra-dump: elements separated by ",", row-id and column-name in front
+        awk -v col=$COL '{ gsub( ", ", "," ); printf( "%d. %s: %s\n\n", NR, col, $0 ) }' \
+            "$EXPECTED" > "$TMP/sra-dump.expected"
+        NCBI_SETTINGS=/ $VDB_D $DATA/NumberTable -C $COL -f sra-dump $OPT > "$TMP/sra-dump" || exit 1
+        compare "$TMP/sra-dump.expected" "$TMP/sra-dump" "$COL $MODE -f sra-dump"
+
+        #limited line-length: within the first formating-chunk and beyond it
+        for LIMIT in 100 5000
+        do
+            cut -c 1-$LIMIT "$EXPECTED" > "$TMP/limit.expected"
+            NCBI_SETTINGS=/ $VDB_D $DATA/NumberTable -C $COL -f tab -M $LIMIT $OPT > "$TMP/limit" || exit 1
+            compare "$TMP/limit.expected" "$TMP/limit" "$COL $MODE -f tab -M $LIMIT"
+        done
+    done
+done
+
+#benchmark: 2000 rows x 1000 elements per column
+for COL in C_U32 C_I64 C_F64
+do
+    for OPT in "" "-X"
+    do
+        T0=$(date +%s%N)
+        NCBI_SETTINGS=/ $VDB_D $DATA/NumberBenchTable -C $COL -f tab $OPT > /dev/null || exit 1
+        T1=$(date +%s%N)
+        echo "column-dump of $COL $OPT ( 2,000,000 values ) : $(( ( T1 - T0 ) / 1000000 )) ms"
+    done
+done
+
+rm -rf "$TMP"
+echo TEST: PASSED
+exit 0
@@ -0,0 +1,130 @@
+#!/bin/bash
+
+if [ $# -ne 2 ]
+then
+cat <<EOF >&2
+
+That script tests that vdb-dump answers --id_range, --spread and --col-stats
+with a statistics-sidecar exactly like without it, that the sidecar is used
+while it is valid and made again after the table has been modified, and
+times the queries with and without it
+
+Syntax : `basename $0` vdb-dump-path data-path
+
+where :
+           vdb-dump-path - path to testing utility
+               data-path - directory made by vdb-dump-makedb, with NumberTable
+                           and NumberBenchTable
+
+EOF
+
+exit 1
+fi
+
+VDB_D=$1
+DATA=$2
+
+if [ ! -x "$VDB_D" ]
+then
+    echo Can not stat executable \'$VDB_D\' >&2
+    exit 1
+fi
+
+if [ ! -d "$DATA/NumberTable" ]
+then
+    echo Can not stat table \'$DATA/NumberTable\' >&2
+    exit 1
+fi
+
+echo "TEST: statistics-sidecar"
+
+TMP="./test_stats_cache.tmp"
+CACHE="$TMP/cache"
+rm -rf "$TMP"
+mkdir -p "$TMP"
+
+#the tables are modified below, the copies keep the data-directory intact
+cp -r "$DATA/NumberTable" "$DATA/NumberBenchTable" "$TMP/" || exit 1
+
+#$1 ... expected file, $2 ... actual file, $3 ... what was tested
+compare()
+{
+    if ! cmp -s "$1" "$2"
+    then
+        echo "TEST: FAILED ( $3 )"
+        diff "$1" "$2" | head -n 5
+        exit 1
+    fi
+}
+
+#cached and recomputed answers: the first run with the sidecar makes it ( --id_range
+#only reads an existing one ), the second reads it
+for TAB in NumberTable NumberBenchTable
+do
+    for QUERY in "--id_range" "--spread" "--spread -C C_U32,C_I64" "--col-stats"
+    do
+        NCBI_SETTINGS=/ $VDB_D $TMP/$TAB $QUERY > "$TMP/plain" || exit 1
+        NCBI_SETTINGS=/ $VDB_D $TMP/$TAB $QUERY --stats-cache $CACHE > "$TMP/cold" || exit 1
+        compare "$TMP/plain" "$TMP/cold" "$TAB $QUERY, sidecar made"
+        NCBI_SETTINGS=/ $VDB_D $TMP/$TAB $QUERY --stats-cache $CACHE > "$TMP/warm" || exit 1
+        compare "$TMP/plain" "$TMP/warm" "$TAB $QUERY, sidecar read"
+    done
+done
+
+SIDECAR=$( ls $CACHE/*NumberTable.stats 2>/dev/null | head -n 1 )
+if [ ! -f "$SIDECAR" ]
+then
+    echo "TEST: FAILED ( no sidecar for NumberTable in $CACHE )"
+    exit 1
+fi
+
+NCBI_SETTINGS=/ $VDB_D $TMP/NumberTable --id_range > "$TMP/expected" || exit 1
+
+#--id_range does not scan the table to make a missing sidecar
+NCBI_SETTINGS=/ $VDB_D $TMP/NumberTable --id_range --stats-cache "$TMP/empty_cache" > "$TMP/miss" || exit 1
+compare "$TMP/expected" "$TMP/miss" "--id_range without a sidecar"
+if ls "$TMP"/empty_cache/*.stats > /dev/null 2>&1
+then
+    echo "TEST: FAILED ( --id_range made a sidecar )"
+    exit 1
+fi
+
+#a valid sidecar is used: a row-count written into it is reported
+sed -i -e 's/^rows\t\([-0-9]*\)\t.*$/rows\t\1\t12345/' "$SIDECAR"
+NCBI_SETTINGS=/ $VDB_D $TMP/NumberTable --id_range --stats-cache $CACHE > "$TMP/tampered" || exit 1
+if ! grep -q "row-count = 12,345" "$TMP/tampered"
+then
+    echo "TEST: FAILED ( the valid sidecar was not used )"
+    exit 1
+fi
+
+#a sidecar of an other version is not used
+sed -i -e '1s/\t.*$/\t0/' "$SIDECAR"
+NCBI_SETTINGS=/ $VDB_D $TMP/NumberTable --id_range --stats-cache $CACHE > "$TMP/version" || exit 1
+compare "$TMP/expected" "$TMP/version" "sidecar of an other version"
+NCBI_SETTINGS=/ $VDB_D $TMP/NumberTable --col-stats --stats-cache $CACHE > /dev/null || exit 1
+
+#a sidecar older than the table is not used, and made again by --col-stats
+sed -i -e 's/^rows\t\([-0-9]*\)\t.*$/rows\t\1\t12345/' "$SIDECAR"
+find "$TMP/NumberTable" -exec touch -d "2001-02-03 04:05:06" {} +
+NCBI_SETTINGS=/ $VDB_D $TMP/NumberTable --id_range --stats-cache $CACHE > "$TMP/modified" || exit 1
+compare "$TMP/expected" "$TMP/modified" "sidecar of a modified table"
+NCBI_SETTINGS=/ $VDB_D $TMP/NumberTable --col-stats > "$TMP/plain" || exit 1
+NCBI_SETTINGS=/ $VDB_D $TMP/NumberTable --col-stats --stats-cache $CACHE > "$TMP/warm" || exit 1
+compare "$TMP/plain" "$TMP/warm" "sidecar made again for the modified table"
+
+#benchmark: 2000 rows x 1000 elements per integer-column
+rm -rf "$CACHE"
+for RUN in "recomputed" "sidecar made" "sidecar read"
+do
+    OPT="--stats-cache $CACHE"
+    [ "$RUN" = "recomputed" ] && OPT=""
+    T0=$(date +%s%N)
+    NCBI_SETTINGS=/ $VDB_D $TMP/NumberBenchTable --spread $OPT > /dev/null || exit 1
+    T1=$(date +%s%N)
+    echo "spread of NumberBenchTable, $RUN : $(( ( T1 - T0 ) / 1000000 )) ms"
+done
+
+rm -rf "$TMP"
+echo TEST: PASSED
+exit 0
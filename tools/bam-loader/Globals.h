@@ -88,6 +88,7 @@ typedef struct globals
     bool allowMultiMapping; /* allow multiple reference names to map to the same real reference */
     bool assembleWithSecondary;
     bool deferSecondary;
+    bool remapRowCopy; /* copy SEQUENCE row by row instead of by blob in remap mode */
 } Globals;
 
 extern Globals G;
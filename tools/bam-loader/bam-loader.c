@@ -98,6 +98,7 @@ Rare or Esoteric Options:
   unsorted                          expect unsorted input (requires more memory)
   sorted                            require sorted input
   TI                                look for trace id optional tag
+  remap-row-copy                    rewrite SEQUENCE row by row in remap mode instead of copying blobs
   unaligned <file>                  file without aligned reads
 
 Deprecated Options:
@@ -149,6 +150,7 @@ static char const option_accept_hard_clip[] = "accept-hard-clip";
 static char const option_allow_multi_map[] = "allow-multi-map";
 static char const option_allow_secondary[] = "make-spots-with-secondary";
 static char const option_defer_secondary[] = "defer-secondary";
+static char const option_remap_row_copy[] = "remap-row-copy";
 
 #define OPTION_INPUT option_input
 #define OPTION_OUTPUT option_output
@@ -174,6 +176,7 @@ static char const option_defer_secondary[] = "defer-secondary";
 #define OPTION_ALLOW_MULTI_MAP option_allow_multi_map
 #define OPTION_ALLOW_SECONDARY option_allow_secondary
 #define OPTION_DEFER_SECONDARY option_defer_secondary
+#define OPTION_REMAP_ROW_COPY option_remap_row_copy
 
 #define ALIAS_INPUT  "i"
 #define ALIAS_OUTPUT "o"
@@ -423,6 +426,14 @@ char const * use_defer_secondary[] =
     NULL
 };
 
+static
+char const * use_remap_row_copy[] =
+{
+    "in remap mode, rewrite the SEQUENCE table row by row",
+    "(default is to carry unchanged columns across as whole blobs)",
+    NULL
+};
+
 OptDef Options[] = 
 {
     /* order here is same as in param array below!!! */
@@ -458,7 +469,8 @@ OptDef Options[] =
     { OPTION_ACCEPT_HARD_CLIP, NULL, NULL, use_accept_hard_clip, 1, false, false },
     { OPTION_ALLOW_MULTI_MAP, NULL, NULL, use_allow_multi_map, 1, false, false },
     { OPTION_ALLOW_SECONDARY, NULL, NULL, use_allow_secondary, 1, false, false },
-    { OPTION_DEFER_SECONDARY, NULL, NULL, use_defer_secondary, 1, false, false }
+    { OPTION_DEFER_SECONDARY, NULL, NULL, use_defer_secondary, 1, false, false },
+    { OPTION_REMAP_ROW_COPY, NULL, NULL, use_remap_row_copy, 1, false, false }
 };
 
 const char* OptHelpParam[] =
@@ -496,7 +508,8 @@ const char* OptHelpParam[] =
     NULL,				/* allow hard clipping */
     NULL,				/* allow multimapping */
     NULL,				/* allow secondary */
-    NULL				/* defer secondary */
+    NULL,				/* defer secondary */
+    NULL				/* remap row copy */
 };
 
 rc_t UsageSummary (char const * progname)
@@ -983,6 +996,11 @@ static rc_t main_1(int argc, char *argv[], bool const continuing, unsigned const
             break;
         G.deferSecondary |= (pcount > 0);
         
+        rc = ArgsOptionCount (args, OPTION_REMAP_ROW_COPY, &pcount);
+        if (rc)
+            break;
+        G.remapRowCopy |= (pcount > 0);
+        
         rc = ArgsOptionCount (args, OPTION_NOMATCH_LOG, &pcount);
         if (rc)
             break;
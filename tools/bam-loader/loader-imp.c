@@ -2992,7 +2992,9 @@ static rc_t ArchiveBAM(VDBManager *mgr, VDatabase *db,
     if (rc == 0)
         rc = rc2;
 
-    SequenceWhack(&seq, rc == 0);
+    rc2 = SequenceWhack(&seq, rc == 0);
+    if (rc == 0)
+        rc = rc2;
 
     ContextRelease(ctx, continuing);
 
@@ -26,11 +26,16 @@
 
 #include <klib/rc.h>
 #include <klib/log.h>
+#include <klib/data-buffer.h>
 
 #include <vdb/database.h>
 #include <vdb/vdb-priv.h>
 
 #include <kdb/manager.h>
+#include <kdb/table.h>
+#include <kdb/column.h>
+
+#include <kfs/directory.h>
 
 #include <insdc/sra.h>
 #include <insdc/insdc.h>
@@ -371,94 +376,542 @@ static rc_t ReadSequenceData(TableWriterSeqData *const data, VCursor const *cons
     return 0;
 }
 
-rc_t SequenceDoneWriting(Sequence *self)
+static rc_t OpenFirstOutSequence(Sequence const *self, VTable const **tbl)
 {
-    if (G.mode == mode_Remap) {
-        /* copy the SEQUENCE table from the first output */
-        VDBManager *mgr = NULL;
-        rc_t rc;
-        
-        getTable(self, false);
+    VDBManager *mgr = NULL;
+    rc_t rc = VDatabaseOpenManagerUpdate(self->db, &mgr);
+
+    if (rc == 0) {
+        VDatabase const *db = NULL;
+
+        rc = VDBManagerOpenDBRead(mgr, &db, NULL, G.firstOut);
+        VDBManagerRelease(mgr);
+        if (rc == 0) {
+            rc = VDatabaseOpenTableRead(db, tbl, "SEQUENCE");
+            VDatabaseRelease(db);
+        }
+    }
+    return rc;
+}
 
-        rc = VDatabaseOpenManagerUpdate(self->db, &mgr);
+static rc_t CopySequenceRows(Sequence *self)
+{
+    /* copy the SEQUENCE table from the first output */
+    VTable const *tbl = NULL;
+    rc_t rc = OpenFirstOutSequence(self, &tbl);
+    assert(rc == 0);
+
+    if (rc == 0) {
+        VCursor const *curs = NULL;
+        rc = VTableCreateCursorRead(tbl, &curs);
         assert(rc == 0);
-        
+        VTableRelease(tbl);
         if (rc == 0) {
-            VDatabase const *db = NULL;
-            
-            rc = VDBManagerOpenDBRead(mgr, &db, NULL, G.firstOut);
+            uint32_t colId[9];
+
+            rc = VCursorAddColumn(curs, &colId[0], "TMP_KEY_ID");
+            assert(rc == 0);
+            rc = VCursorAddColumn(curs, &colId[1], "(INSDC:dna:text)READ");
+            assert(rc == 0);
+            rc = VCursorAddColumn(curs, &colId[2], "QUALITY");
+            assert(rc == 0);
+            rc = VCursorAddColumn(curs, &colId[3], "READ_TYPE");
+            assert(rc == 0);
+            rc = VCursorAddColumn(curs, &colId[4], "READ_START");
+            assert(rc == 0);
+            rc = VCursorAddColumn(curs, &colId[5], "READ_LEN");
+            assert(rc == 0);
+            rc = VCursorAddColumn(curs, &colId[6], "SPOT_GROUP");
+            assert(rc == 0);
+            rc = VCursorAddColumn(curs, &colId[7], "READ_FILTER");
+            assert(rc == 0);
+            rc = VCursorAddColumn(curs, &colId[8], "PLATFORM");
             assert(rc == 0);
-            
-            VDBManagerRelease(mgr);
             if (rc == 0) {
-                VTable const *tbl = NULL;
-                
-                rc = VDatabaseOpenTableRead(db, &tbl, "SEQUENCE");
+                rc = VCursorOpen(curs);
                 assert(rc == 0);
-                VDatabaseRelease(db);
                 if (rc == 0) {
-                    VCursor const *curs = NULL;
-                    rc = VTableCreateCursorRead(tbl, &curs);
+                    int64_t first;
+                    uint64_t count;
+                    uint64_t row;
+                    TableWriterSeqData data;
+
+                    rc = VCursorIdRange(curs, colId[0], &first, &count);
                     assert(rc == 0);
-                    VTableRelease(tbl);
-                    if (rc == 0) {
-                        uint32_t colId[9];
-                        
-                        rc = VCursorAddColumn(curs, &colId[0], "TMP_KEY_ID");
-                        assert(rc == 0);
-                        rc = VCursorAddColumn(curs, &colId[1], "(INSDC:dna:text)READ");
-                        assert(rc == 0);
-                        rc = VCursorAddColumn(curs, &colId[2], "QUALITY");
-                        assert(rc == 0);
-                        rc = VCursorAddColumn(curs, &colId[3], "READ_TYPE");
-                        assert(rc == 0);
-                        rc = VCursorAddColumn(curs, &colId[4], "READ_START");
-                        assert(rc == 0);
-                        rc = VCursorAddColumn(curs, &colId[5], "READ_LEN");
-                        assert(rc == 0);
-                        rc = VCursorAddColumn(curs, &colId[6], "SPOT_GROUP");
-                        assert(rc == 0);
-                        rc = VCursorAddColumn(curs, &colId[7], "READ_FILTER");
+                    for (row = 0; row < count; ++row) {
+                        int64_t dummyRowId = 0;
+
+                        rc = ReadSequenceData(&data, curs, row+first, colId);
                         assert(rc == 0);
-                        rc = VCursorAddColumn(curs, &colId[8], "PLATFORM");
+                        if (rc) break;
+
+                        data.nreads = data.read_start.elements;
+
+                        rc = TableWriterSeq_Write(self->tbl, &data, &dummyRowId);
                         assert(rc == 0);
+                        if (rc) break;
+                    }
+                }
+            }
+            VCursorRelease(curs);
+        }
+    }
+    return rc;
+}
+
+/* MARK: Blob-level copy of the first output's SEQUENCE table
+ *
+ * Remapping only changes which alignments a spot points to.
+ * The columns below are (re)written by this load, everything else
+ * in the first output's SEQUENCE table is carried across as whole
+ * compressed blobs, no decoding or re-encoding is done for them.
+ * TMP_KEY_ID and READ are dropped from this output when it is done,
+ * so they are not copied either; spot keys are read straight from
+ * the first output instead.
+ */
+static char const *const remapRewrittenColumns[] = {
+    "PRIMARY_ALIGNMENT_ID",
+    "ALIGNMENT_COUNT",
+    "CMP_READ",
+    "TMP_KEY_ID",
+    "READ",
+    "ALTREAD",
+    NULL
+};
+
+static bool IsRewrittenColumn(char const name[])
+{
+    unsigned i;
+
+    for (i = 0; remapRewrittenColumns[i]; ++i) {
+        if (strcmp(name, remapRewrittenColumns[i]) == 0)
+            return true;
+    }
+    return false;
+}
+
+static rc_t OpenRemapKeys(Sequence *self)
+{
+    VTable const *tbl = NULL;
+    rc_t rc = OpenFirstOutSequence(self, &tbl);
+
+    if (rc == 0) {
+        rc = VTableCreateCursorRead(tbl, &self->keyCurs);
+        VTableRelease(tbl);
+        if (rc == 0) {
+            rc = VCursorAddColumn(self->keyCurs, &self->keyCol, "TMP_KEY_ID");
+            if (rc == 0)
+                rc = VCursorOpen(self->keyCurs);
+        }
+    }
+    if (rc)
+        (void)LOGERR(klogErr, rc, "Failed to open spot keys of the first output");
+    return rc;
+}
+
+static rc_t CopyMetaNode(KMDataNode const *src, KMDataNode *dst)
+{
+    char buffer[4096];
+    size_t offset = 0;
+    size_t num_read;
+    size_t remaining;
+    KNamelist *names = NULL;
+    rc_t rc;
+
+    do {
+        rc = KMDataNodeRead(src, offset, buffer, sizeof(buffer), &num_read, &remaining);
+        if (rc == 0 && num_read > 0) {
+            rc = offset == 0 ? KMDataNodeWrite(dst, buffer, num_read)
+                             : KMDataNodeAppend(dst, buffer, num_read);
+            offset += num_read;
+        }
+    } while (rc == 0 && remaining > 0);
+
+    if (rc == 0)
+        rc = KMDataNodeListAttr(src, &names);
+    if (rc == 0) {
+        uint32_t count = 0;
+        uint32_t i;
+
+        rc = KNamelistCount(names, &count);
+        for (i = 0; i < count && rc == 0; ++i) {
+            char const *name = NULL;
+
+            rc = KNamelistGet(names, i, &name);
+            if (rc == 0)
+                rc = KMDataNodeReadAttr(src, name, buffer, sizeof(buffer), &num_read);
+            if (rc == 0)
+                rc = KMDataNodeWriteAttr(dst, name, buffer);
+        }
+        KNamelistRelease(names);
+    }
+
+    if (rc == 0)
+        rc = KMDataNodeListChild(src, &names);
+    if (rc == 0) {
+        uint32_t count = 0;
+        uint32_t i;
+
+        rc = KNamelistCount(names, &count);
+        for (i = 0; i < count && rc == 0; ++i) {
+            char const *name = NULL;
+
+            rc = KNamelistGet(names, i, &name);
+            if (rc == 0) {
+                KMDataNode const *schild = NULL;
+                KMDataNode *dchild = NULL;
+
+                rc = KMDataNodeOpenNodeRead(src, &schild, "%s", name);
+                if (rc == 0) {
+                    rc = KMDataNodeOpenNodeUpdate(dst, &dchild, "%s", name);
+                    if (rc == 0) {
+                        rc = CopyMetaNode(schild, dchild);
+                        KMDataNodeRelease(dchild);
+                    }
+                    KMDataNodeRelease(schild);
+                }
+            }
+        }
+        KNamelistRelease(names);
+    }
+    return rc;
+}
+
+static rc_t CopyMetadata(KMetadata const *src, KMetadata *dst, char const path[])
+{
+    KMDataNode const *snode = NULL;
+    rc_t rc = KMetadataOpenNodeRead(src, &snode, "%s", path);
+
+    if (rc == 0) {
+        KMDataNode *dnode = NULL;
+
+        rc = KMetadataOpenNodeUpdate(dst, &dnode, "%s", path);
+        if (rc == 0) {
+            rc = CopyMetaNode(snode, dnode);
+            KMDataNodeRelease(dnode);
+        }
+        KMDataNodeRelease(snode);
+    }
+    return rc;
+}
+
+static rc_t CopyColumnBlobs(KColumn const *src, KColumn *dst)
+{
+    void *buffer = NULL;
+    size_t bsize = 0;
+    int64_t first = 0;
+    uint64_t count = 0;
+    int64_t row;
+    int64_t end;
+    rc_t rc = KColumnIdRange(src, &first, &count);
+
+    for (row = first, end = first + count; rc == 0 && row < end; ) {
+        KColumnBlob const *sblob = NULL;
+        int64_t bfirst = 0;
+        uint32_t bcount = 0;
+
+        rc = KColumnOpenBlobRead(src, &sblob, row);
+        if (rc) {
+            if (GetRCState(rc) == rcNotFound) {
+                /* a gap in the column */
+                rc = 0;
+                ++row;
+            }
+            continue;
+        }
+        rc = KColumnBlobIdRange(sblob, &bfirst, &bcount);
+        if (rc == 0) {
+            size_t num_read = 0;
+            size_t remaining = 0;
+
+            rc = KColumnBlobRead(sblob, 0, buffer, 0, &num_read, &remaining);
+            if (rc == 0 && remaining > bsize) {
+                void *const tmp = realloc(buffer, remaining);
+                if (tmp == NULL)
+                    rc = RC(rcAlign, rcTable, rcCopying, rcMemory, rcExhausted);
+                else {
+                    buffer = tmp;
+                    bsize = remaining;
+                }
+            }
+            if (rc == 0) {
+                size_t const blobSize = remaining;
+                size_t offset;
+
+                for (offset = 0; rc == 0 && offset < blobSize; offset += num_read) {
+                    rc = KColumnBlobRead(sblob, offset, (char *)buffer + offset, blobSize - offset, &num_read, &remaining);
+                }
+                if (rc == 0) {
+                    KColumnBlob *dblob = NULL;
+
+                    rc = KColumnCreateBlob(dst, &dblob);
+                    if (rc == 0) {
+                        rc = KColumnBlobAppend(dblob, buffer, blobSize);
+                        if (rc == 0)
+                            rc = KColumnBlobAssignRange(dblob, bfirst, bcount);
+                        if (rc == 0)
+                            rc = KColumnBlobCommit(dblob);
+                        KColumnBlobRelease(dblob);
+                    }
+                }
+            }
+            row = bfirst + bcount;
+        }
+        KColumnBlobRelease(sblob);
+    }
+    free(buffer);
+    return rc;
+}
+
+/* The copy is made with the checksum and md5 settings of the source column.
+ * kdb does not report the checksum type of a column, the checksum data of
+ * its first blob shows it: none is all zero, crc32 uses only the first four
+ * bytes, md5 uses all sixteen.
+ */
+static rc_t ColumnCreateParams(KTable const *tbl, KColumn const *col, char const name[],
+                               KCreateMode *cmode, KChecksum *checksum)
+{
+    KDirectory const *dir = NULL;
+    int64_t first = 0;
+    uint64_t count = 0;
+    rc_t rc = KTableOpenDirectoryRead(tbl, &dir);
+
+    /* kcmInit: the writer may have created it empty */
+    *cmode = kcmInit;
+    *checksum = kcsCRC32;
+    if (rc == 0) {
+        if (KDirectoryPathType(dir, "col/%s/md5", name) == kptFile)
+            *cmode |= kcmMD5;
+        KDirectoryRelease(dir);
+        rc = KColumnIdRange(col, &first, &count);
+    }
+    if (rc == 0 && count > 0) {
+        KColumnBlob const *blob = NULL;
+
+        rc = KColumnOpenBlobRead(col, &blob, first);
+        if (rc == 0) {
+            KDataBuffer data;
+            KColumnBlobCSData cs;
+
+            memset(&data, 0, sizeof(data));
+            memset(&cs, 0, sizeof(cs));
+            rc = KColumnBlobReadAll(blob, &data, &cs, sizeof(cs));
+            if (rc == 0) {
+                bool any = false;
+                bool md5 = false;
+                unsigned i;
+
+                for (i = 0; i < sizeof(cs.md5_digest); ++i) {
+                    if (cs.md5_digest[i] != 0) {
+                        any = true;
+                        if (i >= sizeof(cs.crc32))
+                            md5 = true;
+                    }
+                }
+                *checksum = md5 ? kcsMD5 : any ? kcsCRC32 : kcsNone;
+            }
+            KDataBufferWhack(&data);
+            KColumnBlobRelease(blob);
+        }
+    }
+    return rc;
+}
+
+static rc_t CopyColumn(KTable const *src, KTable *dst, char const name[])
+{
+    KColumn const *scol = NULL;
+    KCreateMode cmode = kcmInit;
+    KChecksum checksum = kcsNone;
+    rc_t rc = KTableOpenColumnRead(src, &scol, "%s", name);
+
+    if (rc == 0)
+        rc = ColumnCreateParams(src, scol, name, &cmode, &checksum);
+    if (rc == 0) {
+        KColumn *dcol = NULL;
+
+        rc = KTableCreateColumn(dst, &dcol, cmode, checksum, 0, "%s", name);
+        if (rc == 0) {
+            KMetadata const *smeta = NULL;
+
+            rc = CopyColumnBlobs(scol, dcol);
+            if (rc == 0)
+                rc = KColumnOpenMetadataRead(scol, &smeta);
+            if (rc == 0) {
+                KMetadata *dmeta = NULL;
+
+                rc = KColumnOpenMetadataUpdate(dcol, &dmeta);
+                if (rc == 0) {
+                    KMDataNode const *sroot = NULL;
+                    KMDataNode *droot = NULL;
+
+                    rc = KMetadataOpenNodeRead(smeta, &sroot, NULL);
+                    if (rc == 0) {
+                        rc = KMetadataOpenNodeUpdate(dmeta, &droot, NULL);
                         if (rc == 0) {
-                            rc = VCursorOpen(curs);
-                            assert(rc == 0);
-                            if (rc == 0) {
-                                int64_t first;
-                                uint64_t count;
-                                uint64_t row;
-                                TableWriterSeqData data;
-                                
-                                rc = VCursorIdRange(curs, colId[0], &first, &count);
-                                assert(rc == 0);
-                                for (row = 0; row < count; ++row) {
-                                    int64_t dummyRowId = 0;
-                                    
-                                    rc = ReadSequenceData(&data, curs, row+first, colId);
-                                    assert(rc == 0);
-                                    if (rc) return rc;
-
-                                    data.nreads = data.read_start.elements;
-
-                                    rc = TableWriterSeq_Write(self->tbl, &data, &dummyRowId);
-                                    assert(rc == 0);
-                                    if (rc) return rc;
-                                }
-                            }
+                            rc = CopyMetaNode(sroot, droot);
+                            KMDataNodeRelease(droot);
                         }
-                        VCursorRelease(curs);
+                        KMDataNodeRelease(sroot);
                     }
+                    KMetadataRelease(dmeta);
                 }
+                KMetadataRelease(smeta);
             }
+            KColumnRelease(dcol);
+        }
+        KColumnRelease(scol);
+    }
+    if (rc)
+        (void)PLOGERR(klogErr, (klogErr, rc, "Failed to copy SEQUENCE column '$(name)'", "name=%s", name));
+    return rc;
+}
+
+/* CMP_READ has to be rewritten, it depends on which reads are aligned */
+static rc_t RewriteCompressedRead(VTable const *src, VTable *dst)
+{
+    VCursor const *scurs = NULL;
+    VCursor *dcurs = NULL;
+    uint32_t scol = 0;
+    uint32_t dcol = 0;
+    rc_t rc = VTableCreateCursorRead(src, &scurs);
+
+    if (rc == 0)
+        rc = VCursorAddColumn(scurs, &scol, "(INSDC:dna:text)READ");
+    if (rc == 0)
+        rc = VCursorOpen(scurs);
+    if (rc == 0)
+        rc = VTableCreateCursorWrite(dst, &dcurs, kcmInsert);
+    if (rc == 0)
+        rc = VCursorAddColumn(dcurs, &dcol, "(INSDC:dna:text)CMP_READ");
+    if (rc == 0)
+        rc = VCursorOpen(dcurs);
+    if (rc == 0) {
+        int64_t first = 0;
+        uint64_t count = 0;
+        uint64_t i;
+
+        rc = VCursorIdRange(scurs, scol, &first, &count);
+        if (rc == 0 && count > 0)
+            rc = VCursorSetRowId(dcurs, first);
+        for (i = 0; i < count && rc == 0; ++i) {
+            uint32_t elem_bits = 0;
+            uint32_t boff = 0;
+            uint32_t row_len = 0;
+            void const *base = NULL;
+
+            rc = VCursorCellDataDirect(scurs, first + i, scol, &elem_bits, &base, &boff, &row_len);
+            if (rc == 0)
+                rc = VCursorOpenRow(dcurs);
+            if (rc == 0)
+                rc = VCursorWrite(dcurs, dcol, elem_bits, base, boff, row_len);
+            if (rc == 0)
+                rc = VCursorCommitRow(dcurs);
+            if (rc == 0)
+                rc = VCursorCloseRow(dcurs);
         }
+        if (rc == 0)
+            rc = VCursorCommit(dcurs);
+    }
+    VCursorRelease(dcurs);
+    VCursorRelease(scurs);
+    if (rc)
+        (void)LOGERR(klogErr, rc, "Failed to rewrite SEQUENCE CMP_READ");
+    return rc;
+}
+
+static rc_t CopySequenceBlobs(Sequence *self)
+{
+    VTable const *stbl = NULL;
+    rc_t rc = OpenFirstOutSequence(self, &stbl);
+
+    if (rc == 0) {
+        VTable *dtbl = NULL;
+
+        rc = VDatabaseOpenTableUpdate(self->db, &dtbl, "SEQUENCE");
+        if (rc == 0) {
+            rc = RewriteCompressedRead(stbl, dtbl);
+            if (rc == 0) {
+                KTable const *sktbl = NULL;
+                KTable *dktbl = NULL;
+                KNamelist *names = NULL;
+
+                rc = VTableOpenKTableRead(stbl, &sktbl);
+                if (rc == 0)
+                    rc = VTableOpenKTableUpdate(dtbl, &dktbl);
+                if (rc == 0)
+                    rc = KTableListCol(sktbl, &names);
+                if (rc == 0) {
+                    uint32_t count = 0;
+                    uint32_t i;
+
+                    rc = KNamelistCount(names, &count);
+                    for (i = 0; i < count && rc == 0; ++i) {
+                        char const *name = NULL;
+
+                        rc = KNamelistGet(names, i, &name);
+                        if (rc == 0 && !IsRewrittenColumn(name))
+                            rc = CopyColumn(sktbl, dktbl, name);
+                    }
+                    KNamelistRelease(names);
+                }
+                if (rc == 0) {
+                    /* the spots are the same, so are their statistics */
+                    KMetadata const *smeta = NULL;
+                    KMetadata *dmeta = NULL;
+
+                    rc = KTableOpenMetadataRead(sktbl, &smeta);
+                    if (rc == 0) {
+                        rc = KTableOpenMetadataUpdate(dktbl, &dmeta);
+                        if (rc == 0) {
+                            rc = CopyMetadata(smeta, dmeta, "STATS");
+                            if (rc && GetRCState(rc) == rcNotFound)
+                                rc = 0;
+                            KMetadataRelease(dmeta);
+                        }
+                        KMetadataRelease(smeta);
+                    }
+                }
+                KTableRelease(dktbl);
+                KTableRelease(sktbl);
+            }
+            VTableRelease(dtbl);
+        }
+        VTableRelease(stbl);
+    }
+    return rc;
+}
+
+rc_t SequenceDoneWriting(Sequence *self)
+{
+    if (G.mode == mode_Remap) {
+        rc_t rc;
+
+        getTable(self, false);
+        if (!G.remapRowCopy)
+            return OpenRemapKeys(self);
+
+        rc = CopySequenceRows(self);
+        if (rc) return rc;
     }
     return TableWriterSeq_TmpKeyStart(self->tbl);
 }
 
 rc_t SequenceReadKey(const Sequence *cself, int64_t row, uint64_t *keyId)
 {
+    if (cself->keyCurs) {
+        uint32_t elem_bits = 0;
+        uint32_t boff = 0;
+        uint32_t row_len = 0;
+        void const *base = NULL;
+        rc_t const rc = VCursorCellDataDirect(cself->keyCurs, row, cself->keyCol, &elem_bits, &base, &boff, &row_len);
+
+        if (rc == 0) {
+            assert(elem_bits == sizeof(*keyId) * 8);
+            assert(row_len == 1);
+            memmove(keyId, base, sizeof(*keyId));
+        }
+        return rc;
+    }
     return TableWriterSeq_TmpKey(cself->tbl, row, keyId);
 }
 
@@ -474,12 +927,16 @@ rc_t SequenceUpdateAlignData(Sequence *self, int64_t rowId, unsigned nreads,
     return TableWriterSeq_WriteAlignmentData(self->tbl, rowId, &data[0], &data[1]);
 }
 
-void SequenceWhack(Sequence *self, bool commit) {
+rc_t SequenceWhack(Sequence *self, bool commit) {
     uint64_t dummyRows;
+    rc_t rc = 0;
     
     if (self->tbl == NULL)
-        return;
+        return 0;
     
+    VCursorRelease(self->keyCurs);
+    self->keyCurs = NULL;
+
     (void)TableWriterSeq_Whack(self->tbl, commit, &dummyRows);
     if (G.mode == mode_Remap) {
         /* This only happens for the second and subsequent loads.
@@ -487,11 +944,21 @@ void SequenceWhack(Sequence *self, bool commit) {
          * when everything is done.
          */
         VTable *tbl = NULL;
-        rc_t rc = VDatabaseOpenTableUpdate(self->db, &tbl, "SEQUENCE");
-        assert(rc == 0);
-        VTableDropColumn(tbl, "TMP_KEY_ID");
-        VTableDropColumn(tbl, "READ");
-        VTableRelease(tbl);
+        rc_t rc2;
+
+        if (commit && !G.remapRowCopy) {
+            rc = CopySequenceBlobs(self);
+            if (rc)
+                (void)LOGERR(klogErr, rc, "Failed to copy SEQUENCE from the first output");
+        }
+        rc2 = VDatabaseOpenTableUpdate(self->db, &tbl, "SEQUENCE");
+        assert(rc2 == 0);
+        if (rc2 == 0) {
+            VTableDropColumn(tbl, "TMP_KEY_ID");
+            VTableDropColumn(tbl, "READ");
+            VTableRelease(tbl);
+        }
     }
     VDatabaseRelease(self->db);
+    return rc;
 }
@@ -70,6 +70,8 @@ typedef struct s_sequence_record_storage {
 typedef struct s_sequence {
     VDatabase *db;
     struct TableWriterSeq const *tbl;
+    VCursor const *keyCurs; /* remap: spot keys from the first output */
+    uint32_t keyCol;
 } Sequence;
 
 Sequence *SequenceInit(Sequence *self, VDatabase *db);
@@ -83,7 +85,7 @@ rc_t SequenceUpdateAlignData(Sequence *self, int64_t row, unsigned nreads,
                              const int64_t primeId[/* nreads */],
                              const uint8_t alignCount[/* nreads */]);
 
-void SequenceWhack(Sequence *self, bool commit);
+rc_t SequenceWhack(Sequence *self, bool commit);
 
 
 #endif /* ndef BAM_LOAD_SEQUENCE_WRITER_H_ */
@@ -0,0 +1,288 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "bases_filter.h"
+#include "helper.h"
+
+#include <sysalloc.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined( __SSE2__ )
+#include <emmintrin.h>
+#endif
+
+#define MAX_FILTER_PATTERNS 16
+
+/* bit-values of the bases, an IUPAC-code in the pattern is the OR of them */
+#define BF_A 1
+#define BF_C 2
+#define BF_G 4
+#define BF_T 8
+
+typedef struct bf_pattern
+{
+    uint8_t * sets;     /* per position: which bases match here */
+    uint32_t len;
+} bf_pattern;
+
+typedef struct bases_filter
+{
+    uint8_t read_class[ 256 ];      /* ASCII-base in the read ---> BF_A ... BF_T */
+    bf_pattern patterns[ MAX_FILTER_PATTERNS ];
+    uint32_t count;
+    struct Buf2NA * buf2na;         /* helper.h, for expressions we do not handle directly */
+} bases_filter;
+
+static uint8_t iupac_set( char c )
+{
+    switch( c )
+    {
+        case 'A' : case 'a' : return BF_A;
+        case 'C' : case 'c' : return BF_C;
+        case 'G' : case 'g' : return BF_G;
+        case 'T' : case 't' : return BF_T;
+        case 'R' : case 'r' : return BF_A | BF_G;
+        case 'Y' : case 'y' : return BF_C | BF_T;
+        case 'S' : case 's' : return BF_C | BF_G;
+        case 'W' : case 'w' : return BF_A | BF_T;
+        case 'K' : case 'k' : return BF_G | BF_T;
+        case 'M' : case 'm' : return BF_A | BF_C;
+        case 'B' : case 'b' : return BF_C | BF_G | BF_T;
+        case 'D' : case 'd' : return BF_A | BF_G | BF_T;
+        case 'H' : case 'h' : return BF_A | BF_C | BF_T;
+        case 'V' : case 'v' : return BF_A | BF_C | BF_G;
+        case 'N' : case 'n' : return BF_A | BF_C | BF_G | BF_T;
+    }
+    return 0;
+}
+
+void release_bases_filter( bases_filter * self )
+{
+    if ( self != NULL )
+    {
+        uint32_t i;
+        for ( i = 0; i < self -> count; ++i )
+        {
+            if ( self -> patterns[ i ] . sets != NULL )
+                free( ( void * ) self -> patterns[ i ] . sets );
+        }
+        release_Buf2NA( self -> buf2na ); /* helper.c */
+        free( ( void * ) self );
+    }
+}
+
+static bool add_direct_pattern( bases_filter * self, const char * start, size_t len )
+{
+    bf_pattern * p;
+    size_t i;
+    if ( self -> count >= MAX_FILTER_PATTERNS )
+        return false;
+    p = &self -> patterns[ self -> count ];
+    p -> sets = malloc( len );
+    if ( p -> sets == NULL )
+        return false;
+    for ( i = 0; i < len; ++i )
+        p -> sets[ i ] = iupac_set( start[ i ] );
+    p -> len = ( uint32_t )len;
+    self -> count++;
+    return true;
+}
+
+/* splits the pattern at '|' or '||', returns false if it is anything else than a list of FASTA-strings */
+static bool parse_direct( bases_filter * self, const char * pattern )
+{
+    const char * s = pattern;
+    bool res = true;
+    while ( res && *s != 0 )
+    {
+        const char * start;
+        size_t len = 0;
+        while ( *s == ' ' ) ++s;
+        start = s;
+        while ( iupac_set( *s ) != 0 ) { ++s; ++len; }
+        while ( *s == ' ' ) ++s;
+        if ( len == 0 )
+            res = false;
+        else if ( *s == '|' )
+        {
+            ++s;
+            if ( *s == '|' ) ++s;
+            res = ( *s != 0 ); /* a trailing '|' is a syntax-error, NucStrstr will report it */
+        }
+        else if ( *s != 0 )
+            res = false;
+
+        if ( res )
+            res = add_direct_pattern( self, start, len );
+    }
+    return res && self -> count > 0;
+}
+
+rc_t make_bases_filter( bases_filter ** self, const char * pattern )
+{
+    rc_t rc = 0;
+    if ( self == NULL || pattern == NULL )
+    {
+        rc = RC( rcVDB, rcNoTarg, rcConstructing, rcParam, rcInvalid );
+        ErrMsg( "bases_filter.c make_bases_filter() -> %R", rc );
+    }
+    else
+    {
+        bases_filter * f = calloc( 1, sizeof * f );
+        if ( f == NULL )
+        {
+            rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+            ErrMsg( "bases_filter.c make_bases_filter().calloc( %d ) -> %R", ( sizeof * f ), rc );
+        }
+        else
+        {
+            uint32_t i;
+            /* same as the 2na-packing did: everything unknown is an 'A' */
+            for ( i = 0; i < 256; ++i )
+                f -> read_class[ i ] = BF_A;
+            f -> read_class[ 'C' ] = f -> read_class[ 'c' ] = BF_C;
+            f -> read_class[ 'G' ] = f -> read_class[ 'g' ] = BF_G;
+            f -> read_class[ 'T' ] = f -> read_class[ 't' ] = BF_T;
+
+            if ( !parse_direct( f, pattern ) )
+            {
+                for ( i = 0; i < f -> count; ++i )
+                {
+                    free( ( void * ) f -> patterns[ i ] . sets );
+                    f -> patterns[ i ] . sets = NULL;
+                }
+                f -> count = 0;
+                rc = make_Buf2NA( &f -> buf2na, 512, pattern ); /* helper.c */
+            }
+            if ( rc == 0 )
+                *self = f;
+            else
+                release_bases_filter( f );
+        }
+    }
+    return rc;
+}
+
+bool bases_filter_is_direct( const bases_filter * self )
+{
+    return ( self != NULL && self -> buf2na == NULL );
+}
+
+static bool verify_at( const bases_filter * self, const bf_pattern * p, const uint8_t * src )
+{
+    uint32_t j;
+    for ( j = 0; j < p -> len; ++j )
+    {
+        if ( 0 == ( self -> read_class[ src[ j ] ] & p -> sets[ j ] ) )
+            return false;
+    }
+    return true;
+}
+
+#if defined( __SSE2__ )
+/* classifies 16 ASCII-bases at once into BF_A ... BF_T, then tests them against a set:
+   the bit for position i of the returned mask is set if the base there is in the set */
+static int class_in_set( __m128i v, __m128i set )
+{
+    const __m128i upper = _mm_and_si128( v, _mm_set1_epi8( ( char )0xDF ) );
+    const __m128i is_c = _mm_cmpeq_epi8( upper, _mm_set1_epi8( 'C' ) );
+    const __m128i is_g = _mm_cmpeq_epi8( upper, _mm_set1_epi8( 'G' ) );
+    const __m128i is_t = _mm_cmpeq_epi8( upper, _mm_set1_epi8( 'T' ) );
+    __m128i cls = _mm_or_si128( _mm_and_si128( is_c, _mm_set1_epi8( BF_C ) ),
+                  _mm_or_si128( _mm_and_si128( is_g, _mm_set1_epi8( BF_G ) ),
+                                _mm_and_si128( is_t, _mm_set1_epi8( BF_T ) ) ) );
+    /* nothing of C/G/T ---> A */
+    cls = _mm_or_si128( cls, _mm_and_si128( _mm_cmpeq_epi8( cls, _mm_setzero_si128() ),
+                                            _mm_set1_epi8( BF_A ) ) );
+    return 0xFFFF & ~_mm_movemask_epi8( _mm_cmpeq_epi8( _mm_and_si128( cls, set ),
+                                                         _mm_setzero_si128() ) );
+}
+#endif
+
+/* one pass over the read: in each 16-byte window all patterns are checked
+   at their first and last position with vector-compares, only the candidates are verified */
+static bool match_direct( const bases_filter * self, const uint8_t * src, size_t len )
+{
+    size_t pos = 0;
+    uint32_t i, min_len = self -> patterns[ 0 ] . len, max_len = 0;
+    for ( i = 0; i < self -> count; ++i )
+    {
+        uint32_t l = self -> patterns[ i ] . len;
+        if ( l < min_len ) min_len = l;
+        if ( l > max_len ) max_len = l;
+    }
+    if ( len < min_len )
+        return false;
+
+#if defined( __SSE2__ )
+    while ( pos + 16 + max_len - 1 <= len )
+    {
+        for ( i = 0; i < self -> count; ++i )
+        {
+            const bf_pattern * p = &self -> patterns[ i ];
+            const __m128i first = _mm_loadu_si128( ( const __m128i * )( src + pos ) );
+            const __m128i last = _mm_loadu_si128( ( const __m128i * )( src + pos + p -> len - 1 ) );
+            int mask = class_in_set( first, _mm_set1_epi8( ( char )p -> sets[ 0 ] ) ) &
+                       class_in_set( last, _mm_set1_epi8( ( char )p -> sets[ p -> len - 1 ] ) );
+            while ( mask != 0 )
+            {
+                int bit = __builtin_ctz( mask );
+                if ( verify_at( self, p, src + pos + bit ) )
+                    return true;
+                mask &= mask - 1;
+            }
+        }
+        pos += 16;
+    }
+#endif
+
+    /* the tail, or everything without SSE2 */
+    for ( ; pos + min_len <= len; ++pos )
+    {
+        for ( i = 0; i < self -> count; ++i )
+        {
+            const bf_pattern * p = &self -> patterns[ i ];
+            if ( pos + p -> len <= len && verify_at( self, p, src + pos ) )
+                return true;
+        }
+    }
+    return false;
+}
+
+bool bases_filter_match( bases_filter * self, const String * ascii )
+{
+    bool res = false;
+    if ( self != NULL && ascii != NULL )
+    {
+        if ( self -> buf2na != NULL )
+            res = match_Buf2NA( self -> buf2na, ascii ); /* helper.c */
+        else
+            res = match_direct( self, ( const uint8_t * )ascii -> addr, ascii -> len );
+    }
+    return res;
+}
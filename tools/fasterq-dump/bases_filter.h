@@ -0,0 +1,70 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#ifndef _h_bases_filter_
+#define _h_bases_filter_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _h_klib_rc_
+#include <klib/rc.h>
+#endif
+
+#ifndef _h_klib_text_
+#include <klib/text.h>
+#endif
+
+/* --------------------------------------------------------------------------------------------
+    filter for the --bases option:
+    searches the ASCII-bases of a read directly, without packing them into 2na first.
+
+    a pattern is one or more FASTA-strings, separated by '|' or '||', IUPAC-codes allowed:
+        "ACGTTA", "ACRT", "AAAAAA|CCCCCC|GGNNGG"
+    all of them are searched for in a single pass over the read.
+
+    everything else the NucStrstr-expression-syntax allows ( '&&', '!', '(', '^', '$', quotes )
+    is handed over to NucStrstr ( match_Buf2NA() in helper.c ), as before.
+
+    as in the 2na-path, a base that is not A/C/G/T in the read counts as 'A'.
+-------------------------------------------------------------------------------------------- */
+
+struct bases_filter;
+
+rc_t make_bases_filter( struct bases_filter ** self, const char * pattern );
+void release_bases_filter( struct bases_filter * self );
+
+bool bases_filter_match( struct bases_filter * self, const String * ascii );
+
+/* true if the pattern is handled without NucStrstr */
+bool bases_filter_is_direct( const struct bases_filter * self );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,372 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "block_file.h"
+#include "helper.h"
+
+#include <zlib.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#define BLOCK_FILE_MAGIC 0x4B4C4246  /* 'FBLK' */
+#define BLOCK_FILE_TRAILER ( 8 + 4 + 4 + 4 )
+#define BLOCK_FILE_LEVEL Z_BEST_SPEED
+
+typedef struct block_writer
+{
+    struct KFile * f;
+    uint8_t * raw;          /* the block being filled */
+    uint8_t * stored;       /* compression buffer */
+    uint64_t * offsets;     /* file-offset of each block written */
+    uint64_t file_pos, raw_total;
+    size_t raw_used, stored_cap;
+    uint32_t num_blocks, offsets_cap;
+} block_writer;
+
+uint64_t block_writer_raw_bytes( const struct block_writer * self )
+{
+    return self == NULL ? 0 : self -> raw_total;
+}
+
+uint64_t block_writer_stored_bytes( const struct block_writer * self )
+{
+    return self == NULL ? 0 : self -> file_pos;
+}
+
+static rc_t block_writer_write_exactly( block_writer * self, const void * src, size_t len )
+{
+    rc_t rc = KFileWriteExactly( self -> f, self -> file_pos, src, len );
+    if ( rc != 0 )
+        ErrMsg( "block_file.c block_writer_write_exactly( at %lu ) -> %R", self -> file_pos, rc );
+    else
+        self -> file_pos += len;
+    return rc;
+}
+
+static rc_t block_writer_flush( block_writer * self )
+{
+    rc_t rc = 0;
+    if ( self -> raw_used > 0 )
+    {
+        uLongf stored_size = ( uLongf )self -> stored_cap;
+        uint32_t hdr[ 2 ];
+        const uint8_t * data = self -> stored;
+
+        if ( self -> num_blocks >= self -> offsets_cap )
+        {
+            uint32_t cap = self -> offsets_cap == 0 ? 1024 : self -> offsets_cap * 2;
+            uint64_t * tmp = realloc( self -> offsets, cap * sizeof * tmp );
+            if ( tmp == NULL )
+            {
+                rc = RC( rcVDB, rcNoTarg, rcWriting, rcMemory, rcExhausted );
+                ErrMsg( "block_file.c block_writer_flush().realloc( %u ) -> %R", cap, rc );
+                return rc;
+            }
+            self -> offsets = tmp;
+            self -> offsets_cap = cap;
+        }
+
+        if ( compress2( self -> stored, &stored_size, self -> raw, self -> raw_used,
+                        BLOCK_FILE_LEVEL ) != Z_OK || stored_size >= self -> raw_used )
+        {
+            /* not compressible: store it as is */
+            stored_size = self -> raw_used;
+            data = self -> raw;
+        }
+
+        self -> offsets[ self -> num_blocks++ ] = self -> file_pos;
+        hdr[ 0 ] = ( uint32_t )stored_size;
+        hdr[ 1 ] = ( uint32_t )self -> raw_used;
+        rc = block_writer_write_exactly( self, hdr, sizeof hdr );
+        if ( rc == 0 )
+            rc = block_writer_write_exactly( self, data, stored_size );
+        self -> raw_used = 0;
+    }
+    return rc;
+}
+
+rc_t make_block_writer( struct block_writer ** writer, struct KFile * f )
+{
+    rc_t rc = 0;
+    block_writer * w = calloc( 1, sizeof * w );
+    if ( w == NULL )
+    {
+        rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+        ErrMsg( "block_file.c make_block_writer().calloc( %d ) -> %R", ( sizeof * w ), rc );
+        KFileRelease( f );
+    }
+    else
+    {
+        w -> f = f;
+        w -> stored_cap = compressBound( BLOCK_FILE_SIZE );
+        w -> raw = malloc( BLOCK_FILE_SIZE );
+        w -> stored = malloc( w -> stored_cap );
+        if ( w -> raw == NULL || w -> stored == NULL )
+        {
+            rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+            ErrMsg( "block_file.c make_block_writer().malloc() -> %R", rc );
+            release_block_writer( w );
+        }
+        else
+            *writer = w;
+    }
+    return rc;
+}
+
+rc_t block_writer_write( struct block_writer * self, const void * src, size_t len )
+{
+    rc_t rc = 0;
+    const uint8_t * s = src;
+    while ( rc == 0 && len > 0 )
+    {
+        size_t n = BLOCK_FILE_SIZE - self -> raw_used;
+        if ( n > len ) n = len;
+        memmove( self -> raw + self -> raw_used, s, n );
+        self -> raw_used += n;
+        self -> raw_total += n;
+        s += n;
+        len -= n;
+        if ( self -> raw_used == BLOCK_FILE_SIZE )
+            rc = block_writer_flush( self );
+    }
+    return rc;
+}
+
+rc_t release_block_writer( struct block_writer * self )
+{
+    rc_t rc = 0;
+    if ( self != NULL )
+    {
+        if ( self -> f != NULL )
+        {
+            rc = block_writer_flush( self );
+            if ( rc == 0 && self -> num_blocks > 0 )
+                rc = block_writer_write_exactly( self, self -> offsets,
+                                                 self -> num_blocks * sizeof self -> offsets[ 0 ] );
+            if ( rc == 0 )
+            {
+                uint8_t trailer[ BLOCK_FILE_TRAILER ];
+                uint32_t v32;
+                memmove( trailer, &( self -> raw_total ), 8 );
+                memmove( trailer + 8, &( self -> num_blocks ), 4 );
+                v32 = BLOCK_FILE_SIZE;
+                memmove( trailer + 12, &v32, 4 );
+                v32 = BLOCK_FILE_MAGIC;
+                memmove( trailer + 16, &v32, 4 );
+                rc = block_writer_write_exactly( self, trailer, sizeof trailer );
+            }
+            KFileRelease( self -> f );
+        }
+        if ( self -> raw != NULL ) free( self -> raw );
+        if ( self -> stored != NULL ) free( self -> stored );
+        if ( self -> offsets != NULL ) free( self -> offsets );
+        free( ( void * ) self );
+    }
+    return rc;
+}
+
+/* ---------------------------------------------------------------------------------- */
+
+typedef struct block_reader
+{
+    const struct KFile * f;
+    uint64_t * offsets;
+    uint8_t * raw;          /* the cached, uncompressed block */
+    uint8_t * stored;
+    uint64_t raw_total;
+    size_t raw_size, stored_cap;
+    uint32_t num_blocks, block_size, cached;
+} block_reader;
+
+void release_block_reader( struct block_reader * self )
+{
+    if ( self != NULL )
+    {
+        if ( self -> f != NULL ) KFileRelease( self -> f );
+        if ( self -> offsets != NULL ) free( self -> offsets );
+        if ( self -> raw != NULL ) free( self -> raw );
+        if ( self -> stored != NULL ) free( self -> stored );
+        free( ( void * ) self );
+    }
+}
+
+uint64_t block_reader_size( const struct block_reader * self )
+{
+    return self == NULL ? 0 : self -> raw_total;
+}
+
+static rc_t block_reader_read_directory( block_reader * self )
+{
+    uint64_t file_size;
+    rc_t rc = KFileSize( self -> f, &file_size );
+    if ( rc != 0 )
+        ErrMsg( "block_file.c block_reader_read_directory().KFileSize() -> %R", rc );
+    else if ( file_size < BLOCK_FILE_TRAILER )
+    {
+        rc = RC( rcVDB, rcNoTarg, rcReading, rcFormat, rcInvalid );
+        ErrMsg( "block_file.c block_reader_read_directory() file too short -> %R", rc );
+    }
+    else
+    {
+        uint8_t trailer[ BLOCK_FILE_TRAILER ];
+        rc = KFileReadExactly( self -> f, file_size - BLOCK_FILE_TRAILER, trailer, sizeof trailer );
+        if ( rc != 0 )
+            ErrMsg( "block_file.c block_reader_read_directory().KFileReadExactly( trailer ) -> %R", rc );
+        else
+        {
+            uint32_t magic;
+            uint64_t dir_size;
+            memmove( &( self -> raw_total ), trailer, 8 );
+            memmove( &( self -> num_blocks ), trailer + 8, 4 );
+            memmove( &( self -> block_size ), trailer + 12, 4 );
+            memmove( &magic, trailer + 16, 4 );
+            dir_size = ( uint64_t )self -> num_blocks * sizeof self -> offsets[ 0 ];
+            if ( magic != BLOCK_FILE_MAGIC || self -> block_size == 0 ||
+                 dir_size + BLOCK_FILE_TRAILER > file_size )
+            {
+                rc = RC( rcVDB, rcNoTarg, rcReading, rcFormat, rcInvalid );
+                ErrMsg( "block_file.c block_reader_read_directory() invalid trailer -> %R", rc );
+            }
+            else if ( self -> num_blocks > 0 )
+            {
+                self -> offsets = malloc( dir_size );
+                self -> raw = malloc( self -> block_size );
+                self -> stored_cap = compressBound( self -> block_size );
+                self -> stored = malloc( self -> stored_cap );
+                if ( self -> offsets == NULL || self -> raw == NULL || self -> stored == NULL )
+                {
+                    rc = RC( rcVDB, rcNoTarg, rcReading, rcMemory, rcExhausted );
+                    ErrMsg( "block_file.c block_reader_read_directory().malloc() -> %R", rc );
+                }
+                else
+                {
+                    rc = KFileReadExactly( self -> f, file_size - BLOCK_FILE_TRAILER - dir_size,
+                                           self -> offsets, dir_size );
+                    if ( rc != 0 )
+                        ErrMsg( "block_file.c block_reader_read_directory().KFileReadExactly( dir ) -> %R", rc );
+                }
+            }
+        }
+    }
+    return rc;
+}
+
+rc_t make_block_reader( struct block_reader ** reader, const struct KFile * f )
+{
+    rc_t rc = 0;
+    block_reader * r = calloc( 1, sizeof * r );
+    if ( r == NULL )
+    {
+        rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+        ErrMsg( "block_file.c make_block_reader().calloc( %d ) -> %R", ( sizeof * r ), rc );
+        KFileRelease( f );
+    }
+    else
+    {
+        r -> f = f;
+        r -> cached = ( uint32_t )-1;
+        rc = block_reader_read_directory( r );
+        if ( rc == 0 )
+            *reader = r;
+        else
+            release_block_reader( r );
+    }
+    return rc;
+}
+
+static rc_t block_reader_load( block_reader * self, uint32_t block )
+{
+    uint32_t hdr[ 2 ];
+    uint64_t pos = self -> offsets[ block ];
+    rc_t rc = KFileReadExactly( self -> f, pos, hdr, sizeof hdr );
+    if ( rc != 0 )
+        ErrMsg( "block_file.c block_reader_load( #%u ).KFileReadExactly( hdr ) -> %R", block, rc );
+    else if ( hdr[ 1 ] > self -> block_size || hdr[ 0 ] > self -> stored_cap )
+    {
+        rc = RC( rcVDB, rcNoTarg, rcReading, rcFormat, rcInvalid );
+        ErrMsg( "block_file.c block_reader_load( #%u ) invalid header -> %R", block, rc );
+    }
+    else if ( hdr[ 0 ] == hdr[ 1 ] )
+    {
+        /* stored uncompressed */
+        rc = KFileReadExactly( self -> f, pos + sizeof hdr, self -> raw, hdr[ 1 ] );
+        if ( rc != 0 )
+            ErrMsg( "block_file.c block_reader_load( #%u ).KFileReadExactly( raw ) -> %R", block, rc );
+    }
+    else
+    {
+        rc = KFileReadExactly( self -> f, pos + sizeof hdr, self -> stored, hdr[ 0 ] );
+        if ( rc != 0 )
+            ErrMsg( "block_file.c block_reader_load( #%u ).KFileReadExactly( stored ) -> %R", block, rc );
+        else
+        {
+            uLongf raw_size = self -> block_size;
+            if ( uncompress( self -> raw, &raw_size, self -> stored, hdr[ 0 ] ) != Z_OK ||
+                 raw_size != hdr[ 1 ] )
+            {
+                rc = RC( rcVDB, rcNoTarg, rcDecoding, rcData, rcCorrupt );
+                ErrMsg( "block_file.c block_reader_load( #%u ).uncompress() -> %R", block, rc );
+            }
+        }
+    }
+    if ( rc == 0 )
+    {
+        self -> cached = block;
+        self -> raw_size = hdr[ 1 ];
+    }
+    else
+        self -> cached = ( uint32_t )-1;
+    return rc;
+}
+
+rc_t block_reader_read( struct block_reader * self, uint64_t pos,
+                        void * dst, size_t len, size_t * num_read )
+{
+    rc_t rc = 0;
+    uint8_t * d = dst;
+    *num_read = 0;
+    while ( rc == 0 && len > 0 && pos < self -> raw_total )
+    {
+        uint32_t block = ( uint32_t )( pos / self -> block_size );
+        size_t ofs = ( size_t )( pos % self -> block_size );
+        if ( block != self -> cached )
+            rc = block_reader_load( self, block );
+        if ( rc == 0 )
+        {
+            size_t n = self -> raw_size > ofs ? self -> raw_size - ofs : 0;
+            if ( n == 0 )
+                break;
+            if ( n > len ) n = len;
+            memmove( d, self -> raw + ofs, n );
+            d += n;
+            pos += n;
+            len -= n;
+            *num_read += n;
+        }
+    }
+    return rc;
+}
@@ -0,0 +1,90 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#ifndef _h_block_file_
+#define _h_block_file_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _h_klib_rc_
+#include <klib/rc.h>
+#endif
+
+#ifndef _h_kfs_file_
+#include <kfs/file.h>
+#endif
+
+/* ----------------------------------------------------------------------------------
+    A file made of independently compressed blocks ( zlib ), used for the lookup-files
+    in the temp-directory. Every block holds BLOCK_FILE_SIZE uncompressed bytes,
+    except the last one. The callers only see uncompressed ( logical ) positions,
+    these are what the index-file stores.
+
+    layout : block[ 0 ] ... block[ n-1 ] directory trailer
+
+    block     : uint32_t stored_size, uint32_t raw_size, data[ stored_size ]
+                ( stored_size == raw_size : the data is not compressed )
+    directory : uint64_t file_offset[ n ] of each block
+    trailer   : uint64_t raw_total, uint32_t n, uint32_t block_size, uint32_t magic
+   ---------------------------------------------------------------------------------- */
+
+#define BLOCK_FILE_SIZE ( 256 * 1024 )
+
+struct block_writer;
+
+/* takes ownership of f */
+rc_t make_block_writer( struct block_writer ** writer, struct KFile * f );
+
+/* appends at the logical end */
+rc_t block_writer_write( struct block_writer * writer, const void * src, size_t len );
+
+/* compresses the last block, writes the directory and releases the file */
+rc_t release_block_writer( struct block_writer * writer );
+
+/* number of uncompressed / of stored bytes so far */
+uint64_t block_writer_raw_bytes( const struct block_writer * writer );
+uint64_t block_writer_stored_bytes( const struct block_writer * writer );
+
+struct block_reader;
+
+/* takes ownership of f */
+rc_t make_block_reader( struct block_reader ** reader, const struct KFile * f );
+void release_block_reader( struct block_reader * reader );
+
+/* the uncompressed size of the file */
+uint64_t block_reader_size( const struct block_reader * reader );
+
+/* random access by logical position */
+rc_t block_reader_read( struct block_reader * reader, uint64_t pos,
+                        void * dst, size_t len, size_t * num_read );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
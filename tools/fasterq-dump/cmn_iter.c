@@ -38,11 +38,24 @@
 #include <vdb/schema.h>
 #include <vdb/table.h>
 #include <vdb/cursor.h>
+#include <vdb/blob.h>
 #include <vdb/database.h>
 
 #include <os-native.h>
 #include <sysalloc.h>
 
+/* in blob-mode every column keeps the blob containing the current row,
+   the cells are handed out of it until the iterator leaves the blob */
+#define CMN_ITER_MAX_BLOBS 16
+
+typedef struct cmn_blob
+{
+    const VBlob * blob;
+    int64_t first;
+    uint64_t count;
+    uint32_t col_id;
+} cmn_blob;
+
 typedef struct cmn_iter
 {
     const VCursor * cursor;
@@ -50,6 +63,9 @@ typedef struct cmn_iter
     const struct num_gen_iter * row_iter;
     uint64_t row_count;
     int64_t first_row, row_id;
+    cmn_blob blobs[ CMN_ITER_MAX_BLOBS ];
+    uint32_t num_blobs;
+    bool blob_mode;
 } cmn_iter;
 
 
@@ -57,6 +73,12 @@ void destroy_cmn_iter( cmn_iter * self )
 {
     if ( self != NULL )
     {
+        uint32_t idx;
+        for ( idx = 0; idx < self -> num_blobs; ++idx )
+        {
+            if ( self -> blobs[ idx ] . blob != NULL )
+                VBlobRelease( self -> blobs[ idx ] . blob );
+        }
         if ( self -> row_iter != NULL )
             num_gen_iterator_destroy( self -> row_iter );
         if ( self -> ranges != NULL )
@@ -164,6 +186,7 @@ rc_t make_cmn_iter( const cmn_params * cp, const char * tblname, cmn_iter ** ite
                         i -> cursor = cur;
                         i -> first_row = cp -> first_row;
                         i -> row_count = cp -> row_count;
+                        i -> blob_mode = !( cp -> cell_reads );
                         *iter = i;
                     }
                 }
@@ -192,6 +215,64 @@ rc_t cmn_iter_add_column( struct cmn_iter * self, const char * name, uint32_t *
         rc = VCursorAddColumn( self -> cursor, id, name );
         if ( rc != 0 )
             ErrMsg( "cmn_iter.c cmn_iter_add_column().VCursorAddColumn( '%s' ) -> %R", name, rc );
+        else if ( self -> num_blobs < CMN_ITER_MAX_BLOBS )
+        {
+            /* columns beyond CMN_ITER_MAX_BLOBS are read cell by cell */
+            cmn_blob * b = &( self -> blobs[ self -> num_blobs++ ] );
+            b -> blob = NULL;
+            b -> first = 0;
+            b -> count = 0;
+            b -> col_id = *id;
+        }
+    }
+    return rc;
+}
+
+static cmn_blob * cmn_iter_find_blob( struct cmn_iter * self, uint32_t col_id )
+{
+    uint32_t idx;
+    for ( idx = 0; idx < self -> num_blobs; ++idx )
+    {
+        if ( self -> blobs[ idx ] . col_id == col_id )
+            return &( self -> blobs[ idx ] );
+    }
+    return NULL;
+}
+
+/* the common entry for all cmn_read_xxx() functions:
+   in blob-mode the cell is taken out of the cached blob for this column,
+   a new blob is only fetched if the current row is not in it */
+static rc_t cmn_read_cell( struct cmn_iter * self, uint32_t col_id, uint32_t * elem_bits,
+                           const void ** base, uint32_t * boff, uint32_t * row_len )
+{
+    rc_t rc;
+    cmn_blob * b = self -> blob_mode ? cmn_iter_find_blob( self, col_id ) : NULL;
+    if ( b == NULL )
+        rc = VCursorCellDataDirect( self -> cursor, self -> row_id, col_id, elem_bits, base, boff, row_len );
+    else
+    {
+        rc = 0;
+        if ( b -> blob == NULL ||
+             self -> row_id < b -> first ||
+             self -> row_id >= b -> first + ( int64_t )b -> count )
+        {
+            if ( b -> blob != NULL )
+            {
+                VBlobRelease( b -> blob );
+                b -> blob = NULL;
+            }
+            rc = VCursorGetBlobDirect( self -> cursor, &( b -> blob ), self -> row_id, col_id );
+            if ( rc != 0 )
+                ErrMsg( "cmn_iter.c cmn_read_cell( #%ld ).VCursorGetBlobDirect() -> %R\n", self -> row_id, rc );
+            else
+            {
+                rc = VBlobIdRange( b -> blob, &( b -> first ), &( b -> count ) );
+                if ( rc != 0 )
+                    ErrMsg( "cmn_iter.c cmn_read_cell( #%ld ).VBlobIdRange() -> %R\n", self -> row_id, rc );
+            }
+        }
+        if ( rc == 0 )
+            rc = VBlobCellData( b -> blob, self -> row_id, elem_bits, base, boff, row_len );
     }
     return rc;
 }
@@ -300,10 +381,10 @@ rc_t cmn_read_uint64( struct cmn_iter * self, uint32_t col_id, uint64_t *value )
 {
     uint32_t elem_bits, boff, row_len;
     const uint64_t * value_ptr;
-    rc_t rc = VCursorCellDataDirect( self -> cursor, self -> row_id, col_id, &elem_bits,
+    rc_t rc = cmn_read_cell( self, col_id, &elem_bits,
                                  (const void **)&value_ptr, &boff, &row_len );
     if ( rc != 0 )
-        ErrMsg( "cmn_iter.c cmn_read_uint64( #%ld ).VCursorCellDataDirect() -> %R\n", self -> row_id, rc );
+        ErrMsg( "cmn_iter.c cmn_read_uint64( #%ld ).cmn_read_cell() -> %R\n", self -> row_id, rc );
     else if ( elem_bits != 64 || boff != 0 )
     {
         ErrMsg( "cmn_iter.c cmn_read_uint64( #%ld ) : bits=%d, boff=%d\n", self -> row_id, elem_bits, boff );
@@ -325,10 +406,10 @@ rc_t cmn_read_uint64_array( struct cmn_iter * self, uint32_t col_id, uint64_t *v
 {
     uint32_t elem_bits, boff, row_len;
     const uint64_t * value_ptr;
-    rc_t rc = VCursorCellDataDirect( self -> cursor, self -> row_id, col_id, &elem_bits,
+    rc_t rc = cmn_read_cell( self, col_id, &elem_bits,
                                  (const void **)&value_ptr, &boff, &row_len );
     if ( rc != 0 )
-        ErrMsg( "cmn_iter.c cmn_read_uint64_array( #%ld ).VCursorCellDataDirect() -> %R\n", self -> row_id, rc );
+        ErrMsg( "cmn_iter.c cmn_read_uint64_array( #%ld ).cmn_read_cell() -> %R\n", self -> row_id, rc );
     else if ( elem_bits != 64 || boff != 0 )
     {
         ErrMsg( "cmn_iter.c cmn_read_uint64_array( #%ld ) : bits=%d, boff=%d\n", self -> row_id, elem_bits, boff );
@@ -352,10 +433,10 @@ rc_t cmn_read_uint32( struct cmn_iter * self, uint32_t col_id, uint32_t *value )
 {
     uint32_t elem_bits, boff, row_len;
     const uint32_t * value_ptr;
-    rc_t rc = VCursorCellDataDirect( self -> cursor, self -> row_id, col_id, &elem_bits,
+    rc_t rc = cmn_read_cell( self, col_id, &elem_bits,
                                  (const void **)&value_ptr, &boff, &row_len );
     if ( rc != 0 )
-        ErrMsg( "cmn_iter.c cmn_read_uint32( #%ld ).VCursorCellDataDirect() -> %R\n", self -> row_id, rc );
+        ErrMsg( "cmn_iter.c cmn_read_uint32( #%ld ).cmn_read_cell() -> %R\n", self -> row_id, rc );
     else if ( elem_bits != 32 || boff != 0 )
     {
         ErrMsg( "cmn_iter.c cmn_read_uint32( #%ld ) : bits=%d, boff=%d\n", self -> row_id, elem_bits, boff );
@@ -375,10 +456,10 @@ rc_t cmn_read_uint32_array( struct cmn_iter * self, uint32_t col_id, uint32_t **
                             uint32_t * values_read )
 {
     uint32_t elem_bits, boff, row_len;
-    rc_t rc = VCursorCellDataDirect( self -> cursor, self -> row_id, col_id, &elem_bits,
+    rc_t rc = cmn_read_cell( self, col_id, &elem_bits,
                                  (const void **)values, &boff, &row_len );
     if ( rc != 0 )
-        ErrMsg( "cmn_iter.c cmn_read_uint32_array( #%ld ).VCursorCellDataDirect() -> %R\n", self -> row_id, rc );
+        ErrMsg( "cmn_iter.c cmn_read_uint32_array( #%ld ).cmn_read_cell() -> %R\n", self -> row_id, rc );
     else if ( elem_bits != 32 || boff != 0 || row_len < 1 )
     {
         ErrMsg( "row#%ld : bits=%d, boff=%d, len=%d\n", self -> row_id, elem_bits, boff, row_len );
@@ -396,10 +477,10 @@ rc_t cmn_read_uint8_array( struct cmn_iter * self, uint32_t col_id, uint8_t ** v
                             uint32_t * values_read )
 {
     uint32_t elem_bits, boff, row_len;
-    rc_t rc = VCursorCellDataDirect( self -> cursor, self -> row_id, col_id, &elem_bits,
+    rc_t rc = cmn_read_cell( self, col_id, &elem_bits,
                                  (const void **)values, &boff, &row_len );
     if ( rc != 0 )
-        ErrMsg( "cmn_iter.c cmn_read_uint8_array( #%ld ).VCursorCellDataDirect() -> %R\n", self -> row_id, rc );
+        ErrMsg( "cmn_iter.c cmn_read_uint8_array( #%ld ).cmn_read_cell() -> %R\n", self -> row_id, rc );
     else if ( elem_bits != 8 || boff != 0 )
     {
         ErrMsg( "cmn_iter.c cmn_read_uint8_array( #%ld ) : bits=%d, boff=%d\n", self -> row_id, elem_bits, boff );
@@ -416,10 +497,10 @@ rc_t cmn_read_uint8_array( struct cmn_iter * self, uint32_t col_id, uint8_t ** v
 rc_t cmn_read_String( struct cmn_iter * self, uint32_t col_id, String * value )
 {
     uint32_t elem_bits, boff;
-    rc_t rc = VCursorCellDataDirect( self -> cursor, self -> row_id, col_id, &elem_bits,
+    rc_t rc = cmn_read_cell( self, col_id, &elem_bits,
                                  (const void **)&value->addr, &boff, &value -> len );
     if ( rc != 0 )
-        ErrMsg( "cmn_iter.c cmn_read_String( #%ld ).VCursorCellDataDirect() -> %R\n", self -> row_id, rc );
+        ErrMsg( "cmn_iter.c cmn_read_String( #%ld ).cmn_read_cell() -> %R\n", self -> row_id, rc );
     else if ( elem_bits != 8 || boff != 0 )
     {
         ErrMsg( "cmn_iter.c cmn_read_String( #%ld ) : bits=%d, boff=%d\n", self -> row_id, elem_bits, boff );
@@ -79,7 +79,8 @@ static const char * mem_usage[] = { "memory limit for sorting dflt=100MB", NULL
 #define OPTION_MEM      "mem"
 #define ALIAS_MEM       "m"
 
-static const char * temp_usage[] = { "where to put temp. files dflt=curr dir", NULL };
+static const char * temp_usage[] = { "where to put temp. files dflt=curr dir",
+                                     "comma-separated list to spread them over several dirs", NULL };
 #define OPTION_TEMP     "temp"
 #define ALIAS_TEMP      "t"
 
@@ -308,7 +309,11 @@ static rc_t show_details( tool_ctx_t * tool_ctx )
     if ( rc == 0 )
         rc = KOutMsg( "threads      : %d\n", tool_ctx -> num_threads );
     if ( rc == 0 )
-        rc = KOutMsg( "scratch-path : '%s'\n", get_temp_dir( tool_ctx -> temp_dir ) );
+    {
+        uint32_t i, n = get_temp_dir_count( tool_ctx -> temp_dir ); /* temp_dir.c */
+        for ( i = 0; rc == 0 && i < n; ++i )
+            rc = KOutMsg( "scratch-path : '%s'\n", get_temp_dir_by_idx( tool_ctx -> temp_dir, i ) );
+    }
     if ( rc == 0 )
         rc = KOutMsg( "output-format: " );
     if ( rc == 0 )
@@ -596,8 +601,12 @@ static rc_t populate_tool_ctx( tool_ctx_t * tool_ctx, const Args * args )
     if ( rc == 0 )
         rc = Make_FastDump_Cleanup_Task ( &( tool_ctx -> cleanup_task ) ); /* cleanup_task.c */
     if ( rc == 0 )
-        rc = Add_Directory_to_Cleanup_Task ( tool_ctx -> cleanup_task, 
-                get_temp_dir( tool_ctx -> temp_dir ) );
+    {
+        uint32_t i, n = get_temp_dir_count( tool_ctx -> temp_dir ); /* temp_dir.c */
+        for ( i = 0; rc == 0 && i < n; ++i )
+            rc = Add_Directory_to_Cleanup_Task ( tool_ctx -> cleanup_task, 
+                    get_temp_dir_by_idx( tool_ctx -> temp_dir, i ) );
+    }
                 
     if ( rc == 0 )
     {
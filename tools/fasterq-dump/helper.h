@@ -127,6 +127,7 @@ typedef struct cmn_params
     int64_t first_row;
     uint64_t row_count;
     size_t cursor_cache;
+    bool cell_reads;    /* read cell by cell instead of blob by blob */
 } cmn_params;
 
 rc_t ErrMsg( const char * fmt, ... );
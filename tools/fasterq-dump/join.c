@@ -786,7 +786,7 @@ static rc_t extract_csra_row_count( KDirectory * dir,
                                     size_t cur_cache,
                                     uint64_t * res )
 {
-    cmn_params cp = { dir, vdb_mgr, accession_path, 0, 0, cur_cache };
+    cmn_params cp = { dir, vdb_mgr, accession_path, 0, 0, cur_cache, false };
     struct fastq_csra_iter * iter;
     fastq_iter_opt opt = { false, false, false, false }; /* fastq_iter.h */
     rc_t rc = make_fastq_csra_iter( &cp, opt, &iter ); /* fastq_iter.c */
@@ -1101,7 +1101,7 @@ static rc_t CC cmn_thread_func( const KThread * self, void * data )
     {
         join j;
         cmn_params cp = { jtd -> dir, jtd -> vdb_mgr,
-                          jtd -> accession_path, jtd -> first_row, jtd -> row_count, jtd -> cur_cache };
+                          jtd -> accession_path, jtd -> first_row, jtd -> row_count, jtd -> cur_cache, false };
 
         rc = init_join( &cp,
                         results,
@@ -1318,6 +1318,7 @@ rc_t check_lookup( const KDirectory * dir,
             params . first_row = 0;
             params . row_count = 0;
             params . cursor_cache = cursor_cache;
+            params . cell_reads = false;
             
             rc = make_raw_read_iter( &params, &iter ); /* raw_read_iter.c */
             if ( rc == 0 )
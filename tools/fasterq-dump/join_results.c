@@ -24,6 +24,7 @@
 *
 */
 #include "join_results.h"
+#include "bases_filter.h"
 #include "helper.h"
 #include <klib/vector.h>
 #include <klib/printf.h>
@@ -58,7 +59,7 @@ typedef struct join_results
     struct temp_registry * registry;
     const char * output_base;
     const char * accession_short;
-    struct Buf2NA * buf2na;
+    struct bases_filter * filter;   /* bases_filter.h */
     print_v1 v1_print_name_null;
     print_v1 v1_print_name_not_null;
     print_v2 v2_print_name_null;
@@ -85,8 +86,8 @@ void destroy_join_results( join_results * self )
     {
         VectorWhack ( &self -> printers, destroy_join_printer, NULL );
         release_SBuffer( &self -> print_buffer );
-        if ( self -> buf2na != NULL )
-            release_Buf2NA( self -> buf2na );
+        if ( self -> filter != NULL )
+            release_bases_filter( self -> filter ); /* bases_filter.c */
         free( ( void * ) self );
     }
 }
@@ -413,12 +414,12 @@ rc_t make_join_results( struct KDirectory * dir,
                         const char * filter_bases )
 {
     rc_t rc = 0;
-    struct Buf2NA * buf2na = NULL;
+    struct bases_filter * filter = NULL;
     if ( filter_bases != NULL )
     {
-        rc = make_Buf2NA( &buf2na, 512, filter_bases );
+        rc = make_bases_filter( &filter, filter_bases ); /* bases_filter.c */
         if ( rc != 0 )
-            ErrMsg( "error creating nucstrstr-filter from ( %s ) -> %R", filter_bases, rc );
+            ErrMsg( "error creating bases-filter from ( %s ) -> %R", filter_bases, rc );
     }
     if ( rc == 0 )
     {
@@ -438,7 +439,7 @@ rc_t make_join_results( struct KDirectory * dir,
             p -> registry = registry;
             p -> print_frag_nr = print_frag_nr;
             p -> print_name = print_name;
-            p -> buf2na = buf2na;
+            p -> filter = filter;
             
             /* available:
                 print_v1_no_name_no_frag_nr()       print_v2_no_name_no_frag_nr()
@@ -491,24 +492,25 @@ rc_t make_join_results( struct KDirectory * dir,
             }
         }
     }
-    if ( rc != 0 && buf2na != NULL )
-        release_Buf2NA( buf2na );
+    if ( rc != 0 && filter != NULL )
+        release_bases_filter( filter ); /* bases_filter.c */
     return rc;
 }
 
 bool join_results_match( join_results * self, const String * bases )
 {
     bool res = true;
-    if ( self != NULL && bases != NULL && self -> buf2na != NULL )
-        res = match_Buf2NA( self -> buf2na, bases ); /* helper.c */
+    if ( self != NULL && bases != NULL && self -> filter != NULL )
+        res = bases_filter_match( self -> filter, bases ); /* bases_filter.c */
     return res;
 }
 
 bool join_results_match2( struct join_results * self, const String * bases1, const String * bases2 )
 {
     bool res = true;
-    if ( self != NULL && bases1 != NULL && bases2 != NULL && self -> buf2na != NULL )
-        res = ( match_Buf2NA( self -> buf2na, bases1 ) || match_Buf2NA( self -> buf2na, bases2 ) ); /* helper.c */
+    if ( self != NULL && bases1 != NULL && bases2 != NULL && self -> filter != NULL )
+        res = ( bases_filter_match( self -> filter, bases1 ) ||
+                bases_filter_match( self -> filter, bases2 ) ); /* bases_filter.c */
     return res;
 }
 
@@ -26,6 +26,7 @@
 
 #include "lookup_reader.h"
 #include "file_printer.h"
+#include "block_file.h"
 #include "helper.h"
 
 #include <klib/printf.h>
@@ -37,7 +38,7 @@
 
 typedef struct lookup_reader
 {
-    const struct KFile * f;
+    struct block_reader * f;    /* block_file.h */
     const struct index_reader * index;
     SBuffer buf;
     uint64_t pos, f_size, max_key;
@@ -48,7 +49,7 @@ void release_lookup_reader( struct lookup_reader * self )
 {
     if ( self != NULL )
     {
-        if ( self -> f != NULL ) KFileRelease( self -> f );
+        if ( self -> f != NULL ) release_block_reader( self -> f ); /* block_file.c */
         release_SBuffer( &self -> buf );
         free( ( void * ) self );
     }
@@ -56,7 +57,7 @@ void release_lookup_reader( struct lookup_reader * self )
 
 static rc_t make_lookup_reader_obj( struct lookup_reader ** reader,
                                     const struct index_reader * index,
-                                    const struct KFile * f )
+                                    struct block_reader * f )
 {
     rc_t rc = 0;
     lookup_reader * r = calloc( 1, sizeof * r );
@@ -64,14 +65,14 @@ static rc_t make_lookup_reader_obj( struct lookup_reader ** reader,
     {
         rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
         ErrMsg( "lookup_reader.c make_lookup_reader_obj().calloc( %d ) -> %R", ( sizeof * r ), rc );
+        release_block_reader( f );
     }
     else
     {
         r -> f = f;
         r -> index = index;
-        rc = KFileSize( f, & r -> f_size );
-        if ( rc == 0 )
-            rc = make_SBuffer( &( r -> buf ), 4096 );
+        r -> f_size = block_reader_size( f ); /* the uncompressed size */
+        rc = make_SBuffer( &( r -> buf ), 4096 );
         if ( rc == 0 && index != NULL )
             rc = get_max_key( index, & r -> max_key );
 
@@ -111,7 +112,16 @@ rc_t make_lookup_reader( const KDirectory *dir, const struct index_reader * inde
         }
         
         if ( rc == 0 )
-            rc = make_lookup_reader_obj( reader, index, f );
+        {
+            struct block_reader * br;
+            rc = make_block_reader( &br, f ); /* block_file.c, takes ownership of f */
+            if ( rc != 0 )
+                ErrMsg( "lookup_reader.c make_lookup_reader().make_block_reader() -> %R", rc );
+            else
+                rc = make_lookup_reader_obj( reader, index, br ); /* owns br, even on error */
+        }
+        else
+            KFileRelease( f );
     }
     va_end ( args );
     return rc;
@@ -122,10 +132,10 @@ static rc_t read_key_and_len( struct lookup_reader * self, uint64_t pos, uint64_
 {
     size_t num_read;
     uint8_t buffer[ 10 ];
-    rc_t rc = KFileReadAll( self -> f, pos, buffer, sizeof buffer, &num_read );
+    rc_t rc = block_reader_read( self -> f, pos, buffer, sizeof buffer, &num_read );
     if ( rc != 0 )
     {
-        ErrMsg( "lookup_reader.c read_key_and_len().KFileReadAll( at %ld, to_read %u ) -> %R", pos, sizeof buffer, rc );
+        ErrMsg( "lookup_reader.c read_key_and_len().block_reader_read( at %ld, to_read %u ) -> %R", pos, sizeof buffer, rc );
     }
     else if ( num_read != sizeof buffer )
     {
@@ -286,18 +296,18 @@ rc_t lookup_reader_get( struct lookup_reader * self, uint64_t * key, SBuffer * p
             size_t num_read;
             uint8_t buffer1[ 10 ];
             
-            rc = KFileReadAll( self -> f, self -> pos, buffer1, sizeof buffer1, &num_read );
+            rc = block_reader_read( self -> f, self -> pos, buffer1, sizeof buffer1, &num_read );
             if ( rc != 0 )
             {
                 /* we are not able to read 10 bytes from the file */
-                ErrMsg( "lookup_reader.c lookup_reader_get().KFileReadAll( at %ld, to_read %u ) -> %R", self -> pos, sizeof buffer1, rc );
+                ErrMsg( "lookup_reader.c lookup_reader_get().block_reader_read( at %ld, to_read %u ) -> %R", self -> pos, sizeof buffer1, rc );
             }
             else
             {
                 if ( num_read != sizeof buffer1 )
                 {
                     rc = SILENT_RC( rcVDB, rcNoTarg, rcReading, rcFormat, rcInvalid );
-                    ErrMsg( "lookup_reader.c lookup_reader_get().KFileReadAll( at %ld, to_read %lu vs %lu )", self -> pos, sizeof buffer1, num_read );
+                    ErrMsg( "lookup_reader.c lookup_reader_get().block_reader_read( at %ld, to_read %lu vs %lu )", self -> pos, sizeof buffer1, num_read );
                 }
                 else
                 {
@@ -337,13 +347,13 @@ rc_t lookup_reader_get( struct lookup_reader * self, uint64_t * key, SBuffer * p
                             dst[ 1 ] = buffer1[ 9 ];
                             dst += 2;
 
-                            rc = KFileReadAll( self -> f, self -> pos + 10, dst, to_read, &num_read );
+                            rc = block_reader_read( self -> f, self -> pos + 10, dst, to_read, &num_read );
                             if ( rc != 0 )
-                                ErrMsg( "lookup_reader.c lookup_reader_get().KFileReadAll( at %ld, to_read %u ) -> %R", self -> pos + 10, to_read, rc );
+                                ErrMsg( "lookup_reader.c lookup_reader_get().block_reader_read( at %ld, to_read %u ) -> %R", self -> pos + 10, to_read, rc );
                             else if ( num_read != to_read )
                             {
                                 rc = RC( rcVDB, rcNoTarg, rcReading, rcFormat, rcInvalid );
-                                ErrMsg( "lookup_reader.c lookup_reader_get().KFileReadAll( %ld ) %d vs %d -> %R", self -> pos + 10, num_read, to_read, rc );
+                                ErrMsg( "lookup_reader.c lookup_reader_get().block_reader_read( %ld ) %d vs %d -> %R", self -> pos + 10, num_read, to_read, rc );
                             }
                             else
                             {
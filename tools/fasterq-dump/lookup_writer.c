@@ -25,6 +25,7 @@
 */
 
 #include "lookup_writer.h"
+#include "block_file.h"
 #include "helper.h"
 
 #include <kfs/file.h>
@@ -32,7 +33,7 @@
 
 typedef struct lookup_writer
 {
-    struct KFile * f;
+    struct block_writer * f;    /* block_file.h */
     struct index_writer * idx;
     SBuffer buf;
     uint64_t pos;
@@ -43,7 +44,12 @@ void release_lookup_writer( struct lookup_writer * writer )
 {
     if ( writer != NULL )
     {
-        if ( writer -> f != NULL ) KFileRelease( writer -> f );
+        if ( writer -> f != NULL )
+        {
+            rc_t rc = release_block_writer( writer -> f ); /* block_file.c */
+            if ( rc != 0 )
+                ErrMsg( "release_lookup_writer().release_block_writer() -> %R", rc );
+        }
         release_SBuffer( &writer -> buf );
         free( ( void * ) writer );
     }
@@ -51,7 +57,7 @@ void release_lookup_writer( struct lookup_writer * writer )
 
 static rc_t make_lookup_writer_obj( struct lookup_writer ** writer,
                              struct index_writer * idx,
-                             struct KFile * f )
+                             struct block_writer * f )
 {
     rc_t rc = 0;
     lookup_writer * w = calloc( 1, sizeof * w );
@@ -59,6 +65,7 @@ static rc_t make_lookup_writer_obj( struct lookup_writer ** writer,
     {
         rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
         ErrMsg( "calloc( %d ) -> %R", ( sizeof * w ), rc );
+        release_block_writer( f );
     }
     else
     {
@@ -103,10 +110,15 @@ rc_t make_lookup_writer( KDirectory *dir, struct index_writer * idx,
 
         if ( rc == 0 )
         {
-            rc = make_lookup_writer_obj( writer, idx, f );
+            struct block_writer * bw;
+            rc = make_block_writer( &bw, f ); /* block_file.c, takes ownership of f */
             if ( rc != 0 )
-                KFileRelease( f );
+                ErrMsg( "make_block_writer() -> %R", rc );
+            else
+                rc = make_lookup_writer_obj( writer, idx, bw ); /* owns bw, even on error */
         }
+        else
+            KFileRelease( f );
     }
     va_end ( args );
     return rc;
@@ -117,41 +129,28 @@ rc_t write_packed_to_lookup_writer( struct lookup_writer * writer,
                                     uint64_t key,
                                     const String * bases_as_packed_4na )
 {
-    size_t num_writ;
     /* first write the key ( combination of seq-id and read-id ) */
-    rc_t rc = KFileWriteAll( writer -> f, writer -> pos, &key, sizeof key, &num_writ );
+    rc_t rc = block_writer_write( writer -> f, &key, sizeof key ); /* block_file.c */
     if ( rc != 0 )
     {
-        ErrMsg( "KFileWriteAll( key ) -> %R", rc );
-    }
-    else if ( num_writ != sizeof key )
-    {
-        rc = RC( rcVDB, rcNoTarg, rcWriting, rcFormat, rcInvalid );
-        ErrMsg( "KFileWriteAll( key ) -> %R", rc );
+        ErrMsg( "block_writer_write( key ) -> %R", rc );
     }
     else
     {
         uint64_t start_pos = writer -> pos; /* store the pos to be written later to the index... */
             
-        writer -> pos += num_writ;
+        writer -> pos += sizeof key;
         /* now write the packed 4na ( length + packed data ) */
-        rc = KFileWriteAll( writer -> f,
-                            writer -> pos,
-                            bases_as_packed_4na -> addr,
-                            bases_as_packed_4na -> size,
-                            &num_writ );
+        rc = block_writer_write( writer -> f,
+                                 bases_as_packed_4na -> addr,
+                                 bases_as_packed_4na -> size );
         if ( rc != 0 )
-            ErrMsg( "KFileWriteAll( bases ) -> %R", rc );
-        else if ( num_writ != bases_as_packed_4na -> size )
-        {
-            rc = RC( rcVDB, rcNoTarg, rcWriting, rcFormat, rcInvalid );
-            ErrMsg( "KFileWriteAll( bases ) -> %R", rc );
-        }
+            ErrMsg( "block_writer_write( bases ) -> %R", rc );
         else
         {
             if ( writer -> idx != NULL )
                 rc = write_key( writer -> idx, key, start_pos );
-            writer->pos += num_writ;
+            writer->pos += bases_as_packed_4na -> size;
         }
     }
     return rc;
@@ -114,6 +114,7 @@ static rc_t init_multi_producer( lookup_producer * self,
             cp . first_row          = first_row;
             cp . row_count          = row_count;
             cp . cursor_cache       = cmn -> cursor_cache;
+            cp . cell_reads         = cmn -> cell_reads;
 
             rc = make_raw_read_iter( &cp, &( self -> iter ) );
         }
@@ -231,6 +232,7 @@ static uint64_t find_out_row_count( cmn_params * cmn )
     cp . first_row      = 0;
     cp . row_count      = 0;
     cp . cursor_cache   = cmn -> cursor_cache;
+    cp . cell_reads     = cmn -> cell_reads;
 
     rc = make_raw_read_iter( &cp, &iter ); /* raw_read_iter.c */
     if ( rc == 0 )
@@ -352,7 +354,7 @@ rc_t execute_lookup_production( KDirectory * dir,
     
     if ( rc == 0 )
     {
-        cmn_params cmn = { dir, vdb_mgr, accession, 0, 0, cursor_cache };
+        cmn_params cmn = { dir, vdb_mgr, accession, 0, 0, cursor_cache, false };
         rc = run_producer_pool( &cmn,
                                 merger,
                                 buf_size,
@@ -34,14 +34,23 @@
 #include <os-native.h>
 #include <sysalloc.h>
 
+#include <string.h>
+
 #define HOSTNAMELEN 64
 #define DFLT_HOST_NAME "host"
 #define DFLT_PATH_LEN 4096
+#define MAX_TEMP_DIRS 16
+#define TEMP_DIR_SEPARATOR ','
+
+/* the kind of temp-file, used to decorrelate the directory-choice of sub-, merge- and joined files */
+enum { tk_sub = 0, tk_merge = 1, tk_joined = 2 };
 
 typedef struct temp_dir
 {
     char hostname[ HOSTNAMELEN ];
-    char path[ DFLT_PATH_LEN ];
+    char path[ MAX_TEMP_DIRS ][ DFLT_PATH_LEN ];
+    uint64_t weight[ MAX_TEMP_DIRS ];   /* cumulative, in MB of free space */
+    uint32_t count;
     uint32_t pid;
 } temp_dir;
 
@@ -79,24 +88,102 @@ static rc_t get_pid_and_hostname( temp_dir * self )
 static rc_t generate_dflt_path( temp_dir * self )
 {
     size_t num_writ;
-    return string_printf( self -> path, sizeof self -> path, &num_writ,
+    self -> count = 1;
+    return string_printf( self -> path[ 0 ], sizeof self -> path[ 0 ], &num_writ,
                          "fasterq.tmp.%s.%u/", self -> hostname, self -> pid );
 }
 
-static rc_t generate_sub_path( temp_dir * self, const char * requested )
+static rc_t generate_sub_path( temp_dir * self, const char * requested, size_t len )
 {
     rc_t rc;
     size_t num_writ;
-    bool es = ends_in_slash( requested );
+    char * dst = self -> path[ self -> count ];
+    size_t dst_size = sizeof self -> path[ self -> count ];
+    bool es = ( len > 0 && requested[ len - 1 ] == '/' );
     if ( es )
-        rc = string_printf( self -> path, sizeof self -> path, &num_writ,
-                            "%sfasterq.tmp.%s.%u/", requested, self -> hostname, self -> pid );
+        rc = string_printf( dst, dst_size, &num_writ,
+                            "%.*sfasterq.tmp.%s.%u/", ( uint32_t )len, requested, self -> hostname, self -> pid );
     else
-        rc = string_printf( self -> path, sizeof self -> path, &num_writ,
-                            "%s/fasterq.tmp.%s.%u/", requested, self -> hostname, self -> pid );
+        rc = string_printf( dst, dst_size, &num_writ,
+                            "%.*s/fasterq.tmp.%s.%u/", ( uint32_t )len, requested, self -> hostname, self -> pid );
+    if ( rc == 0 )
+        self -> count++;
     return rc;
 }
 
+/* --temp can be a comma-separated list of directories: 'dir1,dir2,dir3' */
+static rc_t generate_sub_paths( temp_dir * self, const char * requested )
+{
+    rc_t rc = 0;
+    const char * start = requested;
+    while ( rc == 0 && start != NULL )
+    {
+        const char * sep = strchr( start, TEMP_DIR_SEPARATOR );
+        size_t len = ( sep != NULL ) ? ( size_t )( sep - start ) : strlen( start );
+        if ( len > 0 )
+        {
+            if ( self -> count >= MAX_TEMP_DIRS )
+            {
+                rc = RC( rcVDB, rcNoTarg, rcConstructing, rcParam, rcExcessive );
+                ErrMsg( "temp_dir.c generate_sub_paths() more than %u temp-directories -> %R", MAX_TEMP_DIRS, rc );
+            }
+            else
+                rc = generate_sub_path( self, start, len );
+        }
+        start = ( sep != NULL ) ? sep + 1 : NULL;
+    }
+    if ( rc == 0 && self -> count == 0 )
+        rc = generate_dflt_path( self );
+    return rc;
+}
+
+/* weight every directory by the free space on its device, if we cannot tell for one of them: equal weights */
+static void weigh_temp_dirs( temp_dir * self, KDirectory * dir )
+{
+    uint32_t i;
+    uint64_t sum = 0;
+    bool known = true;
+    for ( i = 0; known && i < self -> count; ++i )
+    {
+        const KDirectory * sub;
+        uint64_t free_bytes = 0;
+        uint64_t total_bytes = 0;
+        rc_t rc = KDirectoryOpenDirRead( dir, &sub, false, "%s", self -> path[ i ] );
+        if ( rc == 0 )
+        {
+            rc = KDirectoryGetDiskFreeSpace( sub, &free_bytes, &total_bytes );
+            KDirectoryRelease( sub );
+        }
+        known = ( rc == 0 );
+        sum += ( free_bytes >> 20 ) + 1; /* in MB, never zero */
+        self -> weight[ i ] = sum;
+    }
+    if ( !known )
+    {
+        for ( i = 0; i < self -> count; ++i )
+            self -> weight[ i ] = i + 1;
+    }
+}
+
+/* picks a directory for the id-th file of a kind:
+   the golden-ratio sequence spreads consecutive ids evenly over [ 0 .. 1 ),
+   each directory gets the share of that interval that matches its weight.
+   It is a pure function of ( kind, id ), because the file-names are generated
+   concurrently by the worker-threads, and the same id has to map to the same file. */
+static const char * pick_temp_dir( const temp_dir * self, uint32_t kind, uint32_t id )
+{
+    uint32_t i = 0;
+    if ( self -> count > 1 )
+    {
+        uint64_t total = self -> weight[ self -> count - 1 ];
+        uint64_t frac = ( ( uint64_t )id + ( ( uint64_t )kind << 32 ) ) * 0x9E3779B97F4A7C15ULL;
+        uint64_t pos = ( ( frac >> 32 ) * total ) >> 32;
+        while ( i < self -> count - 1 && self -> weight[ i ] <= pos )
+            ++i;
+    }
+    return self -> path[ i ];
+}
+
 rc_t make_temp_dir( struct temp_dir ** obj, const char * requested, KDirectory * dir )
 {
     rc_t rc = 0;
@@ -121,18 +208,24 @@ rc_t make_temp_dir( struct temp_dir ** obj, const char * requested, KDirectory *
                 if ( requested == NULL )
                     rc = generate_dflt_path( o );
                 else
-                    rc = generate_sub_path( o, requested );
+                    rc = generate_sub_paths( o, requested );
             }
             
             if ( rc == 0 )
             {
-                if ( !dir_exists( dir, "%s", o -> path ) ) /* helper.c */
+                uint32_t i;
+                for ( i = 0; rc == 0 && i < o -> count; ++i )
                 {
-                    KCreateMode create_mode = kcmCreate | kcmParents;
-                    rc = KDirectoryCreateDir ( dir, 0775, create_mode, "%s", o -> path );
-                    if ( rc != 0 )
-                        ErrMsg( "temp_dir.c make_temp_dir().KDirectoryCreateDir( '%s' ) -> %R", o -> path, rc );
+                    if ( !dir_exists( dir, "%s", o -> path[ i ] ) ) /* helper.c */
+                    {
+                        KCreateMode create_mode = kcmCreate | kcmParents;
+                        rc = KDirectoryCreateDir ( dir, 0775, create_mode, "%s", o -> path[ i ] );
+                        if ( rc != 0 )
+                            ErrMsg( "temp_dir.c make_temp_dir().KDirectoryCreateDir( '%s' ) -> %R", o -> path[ i ], rc );
+                    }
                 }
+                if ( rc == 0 )
+                    weigh_temp_dirs( o, dir );
             }
 
             if ( rc == 0 )
@@ -148,10 +241,24 @@ rc_t make_temp_dir( struct temp_dir ** obj, const char * requested, KDirectory *
 const char * get_temp_dir( struct temp_dir * self )
 {
     if ( self != NULL )
-        return self -> path;
+        return self -> path[ 0 ];
     return "unknown";
 }
 
+uint32_t get_temp_dir_count( const struct temp_dir * self )
+{
+    if ( self != NULL )
+        return self -> count;
+    return 0;
+}
+
+const char * get_temp_dir_by_idx( const struct temp_dir * self, uint32_t idx )
+{
+    if ( self != NULL && idx < self -> count )
+        return self -> path[ idx ];
+    return NULL;
+}
+
 rc_t generate_lookup_filename( const struct temp_dir * self, char * dst, size_t dst_size )
 {
     rc_t rc;
@@ -165,7 +272,7 @@ rc_t generate_lookup_filename( const struct temp_dir * self, char * dst, size_t
         size_t num_writ;
         rc = string_printf( dst, dst_size, &num_writ,
                 "%s%s.%u.lookup",
-                self -> path, self -> hostname, self -> pid );
+                self -> path[ 0 ], self -> hostname, self -> pid );
         if ( rc != 0 )
             ErrMsg( "temp_dir.c generate_lookup_filename().printf() -> %R", rc );
                 
@@ -186,7 +293,7 @@ rc_t generate_bg_sub_filename( const struct temp_dir * self, char * dst, size_t
         size_t num_writ;        
         rc = string_printf( dst, dst_size, &num_writ,
                 "%sbg_sub_%s_%u_%u.dat",
-                self -> path, self -> hostname, self -> pid, product_id );
+                pick_temp_dir( self, tk_sub, product_id ), self -> hostname, self -> pid, product_id );
         if ( rc != 0 )
             ErrMsg( "temp_dir.c generate_bg_sub_filename().printf() -> %R", rc );
     }
@@ -206,7 +313,7 @@ rc_t generate_bg_merge_filename( const struct temp_dir * self, char * dst, size_
         size_t num_writ;        
         rc = string_printf( dst, dst_size, &num_writ,
                 "%sbg_merge_%s_%u_%u.dat",
-                self -> path, self -> hostname, self -> pid, product_id );
+                pick_temp_dir( self, tk_merge, product_id ), self -> hostname, self -> pid, product_id );
         if ( rc != 0 )
             ErrMsg( "temp_dir.c generate_bg_sub_filename().printf() -> %R", rc );
     }
@@ -227,7 +334,7 @@ rc_t make_joined_filename( const struct temp_dir * self, char * dst, size_t dst_
     {
         size_t num_writ;
         rc = string_printf( dst, dst_size, &num_writ, "%s%s.%s.%u.%u",
-                                 self -> path,
+                                 pick_temp_dir( self, tk_joined, id ),
                                  accession,
                                  self -> hostname,
                                  self -> pid,
@@ -248,20 +355,26 @@ rc_t remove_temp_dir( const struct temp_dir * self, KDirectory * dir )
     }
     else
     {
-        bool tmp_exists = dir_exists( dir, "%s", self -> path ); /* helper.c */
-        if ( tmp_exists )
+        uint32_t i;
+        rc = 0;
+        for ( i = 0; rc == 0 && i < self -> count; ++i )
         {
-            rc = KDirectoryClearDir ( dir, true, "%s", self -> path );
-            if ( rc != 0 )
-                ErrMsg( "temp_dir.c remove_temp_dir.KDirectoryClearDir( '%s' ) -> %R", self -> path, rc );
-            else
+            const char * path = self -> path[ i ];
+            bool tmp_exists = dir_exists( dir, "%s", path ); /* helper.c */
+            if ( tmp_exists )
             {
-                tmp_exists = dir_exists( dir, "%s", self -> path ); /* helper.c */
-                if ( tmp_exists )
+                rc = KDirectoryClearDir ( dir, true, "%s", path );
+                if ( rc != 0 )
+                    ErrMsg( "temp_dir.c remove_temp_dir.KDirectoryClearDir( '%s' ) -> %R", path, rc );
+                else
                 {
-                    rc = KDirectoryRemove ( dir, true, "%s", self -> path );
-                    if ( rc != 0 )
-                        ErrMsg( "temp_dir.c remove_temp_dir.KDirectoryRemove( '%s' ) -> %R", self -> path, rc );
+                    tmp_exists = dir_exists( dir, "%s", path ); /* helper.c */
+                    if ( tmp_exists )
+                    {
+                        rc = KDirectoryRemove ( dir, true, "%s", path );
+                        if ( rc != 0 )
+                            ErrMsg( "temp_dir.c remove_temp_dir.KDirectoryRemove( '%s' ) -> %R", path, rc );
+                    }
                 }
             }
         }
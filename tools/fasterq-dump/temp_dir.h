@@ -47,6 +47,11 @@ rc_t make_temp_dir( struct temp_dir ** obj, const char * requested, KDirectory *
 
 const char * get_temp_dir( struct temp_dir * self );
 
+/* requested can be a comma-separated list, temp-files are spread over all of them */
+uint32_t get_temp_dir_count( const struct temp_dir * self );
+
+const char * get_temp_dir_by_idx( const struct temp_dir * self, uint32_t idx );
+
 rc_t generate_lookup_filename( const struct temp_dir * self, char * dst, size_t dst_size );
 
 rc_t generate_bg_sub_filename( const struct temp_dir * self, char * dst, size_t dst_size, uint32_t product_id );
@@ -0,0 +1,230 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "bed_file.h"
+
+#include <klib/log.h>
+#include <klib/text.h>
+#include <kfs/directory.h>
+#include <kfs/file.h>
+
+#include <sysalloc.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BED_CHUNK_SIZE ( 64 * 1024 )
+
+typedef struct bed_ctx
+{
+    const char * path;
+    uint64_t line_nr;
+    rc_t ( CC * on_interval ) ( const char * name, uint64_t start, uint64_t end, void * data );
+    void * data;
+} bed_ctx;
+
+
+static bool is_bed_space( char c )
+{
+    return ( c == ' ' || c == '\t' );
+}
+
+
+/* does the line start with word, followed by whitespace or the end of the line? */
+static bool starts_with_word( const char * line, size_t len, const char * word )
+{
+    size_t l = string_size( word );
+    return ( len >= l && memcmp( line, word, l ) == 0 && ( len == l || is_bed_space( line[ l ] ) ) );
+}
+
+
+/* parses a decimal number at line[ *idx ], at least one digit is required */
+static bool bed_number( const char * line, size_t len, size_t * idx, uint64_t * value )
+{
+    size_t i = *idx;
+    uint64_t v = 0;
+    while ( i < len && line[ i ] >= '0' && line[ i ] <= '9' )
+    {
+        v = ( v * 10 ) + ( line[ i ] - '0' );
+        i++;
+    }
+    if ( i == *idx )
+        return false;
+    *idx = i;
+    *value = v;
+    return true;
+}
+
+
+static size_t skip_bed_space( const char * line, size_t len, size_t idx )
+{
+    while ( idx < len && is_bed_space( line[ idx ] ) )
+        idx++;
+    return idx;
+}
+
+
+/* line is not 0-terminated, but writable: the name gets terminated in place */
+static rc_t bed_line( bed_ctx * ctx, char * line, size_t len )
+{
+    size_t name_start, name_end, idx;
+    uint64_t start, end;
+
+    ctx->line_nr++;
+    if ( len > 0 && line[ len - 1 ] == '\r' )
+        len--;
+    idx = skip_bed_space( line, len, 0 );
+    if ( idx == len || line[ idx ] == '#' ||
+         starts_with_word( line + idx, len - idx, "track" ) ||
+         starts_with_word( line + idx, len - idx, "browser" ) )
+        return 0;
+
+    name_start = idx;
+    while ( idx < len && !is_bed_space( line[ idx ] ) )
+        idx++;
+    name_end = idx;
+
+    idx = skip_bed_space( line, len, idx );
+    if ( idx > name_end && bed_number( line, len, &idx, &start ) )
+    {
+        size_t sep = idx;
+        idx = skip_bed_space( line, len, idx );
+        if ( idx > sep && bed_number( line, len, &idx, &end ) &&
+             ( idx == len || is_bed_space( line[ idx ] ) ) && end >= start )
+        {
+            line[ name_end ] = 0;
+            return ctx->on_interval( line + name_start, start, end, ctx->data );
+        }
+    }
+
+    {
+        rc_t rc = RC( rcApp, rcFile, rcParsing, rcFormat, rcInvalid );
+        (void)PLOGERR( klogErr, ( klogErr, rc, "invalid line #$(n) in region-file '$(p)'",
+                                  "n=%lu,p=%s", ctx->line_nr, ctx->path ) );
+        return rc;
+    }
+}
+
+
+/* hands all complete lines in buf to bed_line(), returns how many bytes were consumed */
+static rc_t bed_lines( bed_ctx * ctx, char * buf, size_t filled, size_t * consumed )
+{
+    rc_t rc = 0;
+    size_t line_start = 0;
+    char * nl = memchr( buf, '\n', filled );
+    while ( rc == 0 && nl != NULL )
+    {
+        size_t line_end = ( nl - buf );
+        rc = bed_line( ctx, buf + line_start, line_end - line_start );
+        line_start = line_end + 1;
+        nl = memchr( buf + line_start, '\n', filled - line_start );
+    }
+    *consumed = line_start;
+    return rc;
+}
+
+
+rc_t foreach_bed_interval( const char * path,
+    rc_t ( CC * on_interval ) ( const char * name, uint64_t start, uint64_t end, void * data ),
+    void * data )
+{
+    KDirectory * dir;
+    rc_t rc = KDirectoryNativeDir( &dir );
+    if ( rc != 0 )
+    {
+        LOGERR( klogInt, rc, "KDirectoryNativeDir() failed" );
+    }
+    else
+    {
+        const KFile * f;
+        rc = KDirectoryOpenFileRead( dir, &f, "%s", path );
+        if ( rc != 0 )
+        {
+            (void)PLOGERR( klogErr, ( klogErr, rc, "cannot open region-file '$(p)'", "p=%s", path ) );
+        }
+        else
+        {
+            size_t cap = BED_CHUNK_SIZE;
+            char * buf = malloc( cap );
+            if ( buf == NULL )
+                rc = RC( rcApp, rcFile, rcReading, rcMemory, rcExhausted );
+            else
+            {
+                bed_ctx ctx;
+                uint64_t file_pos = 0;
+                size_t filled = 0;
+                bool eof = false;
+
+                ctx.path = path;
+                ctx.line_nr = 0;
+                ctx.on_interval = on_interval;
+                ctx.data = data;
+
+                while ( rc == 0 && !eof )
+                {
+                    size_t num_read, consumed;
+                    if ( filled == cap )
+                    {
+                        /* a single line does not fit into the buffer */
+                        char * tmp = realloc( buf, cap * 2 );
+                        if ( tmp == NULL )
+                        {
+                            rc = RC( rcApp, rcFile, rcReading, rcMemory, rcExhausted );
+                            break;
+                        }
+                        buf = tmp;
+                        cap *= 2;
+                    }
+                    rc = KFileRead( f, file_pos, buf + filled, cap - filled, &num_read );
+                    if ( rc != 0 )
+                    {
+                        (void)PLOGERR( klogErr, ( klogErr, rc, "cannot read region-file '$(p)'", "p=%s", path ) );
+                    }
+                    else
+                    {
+                        file_pos += num_read;
+                        filled += num_read;
+                        eof = ( num_read == 0 );
+                        rc = bed_lines( &ctx, buf, filled, &consumed );
+                        if ( rc == 0 )
+                        {
+                            filled -= consumed;
+                            if ( filled > 0 )
+                            {
+                                memmove( buf, buf + consumed, filled );
+                                if ( eof ) /* last line without a newline */
+                                    rc = bed_line( &ctx, buf, filled );
+                            }
+                        }
+                    }
+                }
+                free( buf );
+            }
+            KFileRelease( f );
+        }
+        KDirectoryRelease( dir );
+    }
+    return rc;
+}
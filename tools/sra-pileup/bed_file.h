@@ -0,0 +1,49 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#ifndef _h_bed_file_
+#define _h_bed_file_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <klib/rc.h>
+
+/* reads a BED-file ( chrom, chromStart, chromEnd, ... ) line by line,
+   'track'-, 'browser'- and '#'-lines and empty lines are skipped,
+   columns after chromEnd are ignored.
+   the coordinates are handed to on_interval as they are in the file:
+   0-based, start inclusive, end exclusive */
+rc_t foreach_bed_interval( const char * path,
+    rc_t ( CC * on_interval ) ( const char * name, uint64_t start, uint64_t end, void * data ),
+    void * data );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1619,6 +1619,14 @@ rc_t check_rna_splicing_candidates_against_ref( struct ReferenceObj const * ref_
 }
 
 
+/* a D or N operation of at least min_len may be an rna-splice,
+   discover_rna_splicing_candidates() and count_rna_splicing_candidates() have to agree on that */
+static bool is_rna_splicing_candidate( char op_code, uint32_t op_len, uint32_t min_len )
+{
+    return ( ( op_code == 'D' || op_code == 'N' ) && op_len >= min_len );
+}
+
+
 rc_t discover_rna_splicing_candidates( uint32_t cigar_len, const char * cigar, uint32_t min_len, rna_splice_candidates * candidates )
 {
     rc_t rc = 0;
@@ -1634,11 +1642,12 @@ rc_t discover_rna_splicing_candidates( uint32_t cigar_len, const char * cigar, u
 
         candidates->n_cigops = ExplodeCIGAR( cigops, candidates->cigops_len, cigar, cigar_len );
         candidates->count = 0;
+        /* the last of n_cigops is the terminator ExplodeCIGAR() appends, a trailing D or N is looked at */
         for ( op_idx = 0; op_idx < ( candidates->n_cigops - 1 ); op_idx++ )
         {
             char op_code = cigops[ op_idx ].op;
             uint32_t op_len = cigops[ op_idx ].oplen;
-            if ( (op_code == 'D' || op_code == 'N') && op_len >= min_len && candidates->count < MAX_RNA_SPLICE_CANDIDATES )
+            if ( is_rna_splicing_candidate( op_code, op_len, min_len ) && candidates->count < MAX_RNA_SPLICE_CANDIDATES )
             {
                 rna_splice_candidate * rsc = &candidates->candidates[ candidates->count++ ];
                 rsc->ref_offset = ref_offset;
@@ -1655,6 +1664,25 @@ rc_t discover_rna_splicing_candidates( uint32_t cigar_len, const char * cigar, u
 
 
 
+uint32_t count_rna_splicing_candidates( uint32_t cigar_len, const char * cigar, uint32_t min_len )
+{
+    uint32_t i, count = 0, op_len = 0;
+    for ( i = 0; i < cigar_len && count < MAX_RNA_SPLICE_CANDIDATES; ++i )
+    {
+        char c = cigar[ i ];
+        if ( c >= '0' && c <= '9' )
+            op_len = op_len * 10 + ( c - '0' );
+        else
+        {
+            if ( is_rna_splicing_candidate( c, op_len, min_len ) )
+                count++;
+            op_len = 0;
+        }
+    }
+    return count;
+}
+
+
 rc_t change_rna_splicing_cigar( uint32_t cigar_len, char * cigar, rna_splice_candidates * candidates, uint32_t * NM_adjustment )
 {
     rc_t rc = 0;
@@ -126,6 +126,10 @@ typedef struct rna_splice_candidates
 
 rc_t discover_rna_splicing_candidates( uint32_t cigar_len, const char * cigar, uint32_t min_len, rna_splice_candidates * candidates );
 
+/* the number of candidates discover_rna_splicing_candidates() finds, in one pass over the
+   CIGAR-string, without exploding it into an allocated array of operations first */
+uint32_t count_rna_splicing_candidates( uint32_t cigar_len, const char * cigar, uint32_t min_len );
+
 rc_t check_rna_splicing_candidates_against_ref( struct ReferenceObj const * ref_obj,
                                                 uint32_t splice_level,
                                                 INSDC_coord_zero pos,
@@ -54,6 +54,11 @@ const char * ref_usage[] = { "Filter by position on genome.",
                              "\"from\" and \"to\" are 1-based coordinates",
                              NULL };
 
+const char * region_file_usage[] = { "Filter by the regions in this BED-file",
+                                     "(0-based, end exclusive). Each reference",
+                                     "is walked once, skipping the gaps",
+                                     NULL };
+
 const char * outf_usage[] = { "Output will be written to this file",
                               "instead of std-out", NULL };
 
@@ -98,6 +103,7 @@ OptDef CommonOptions[] =
 {
     /*name,           alias,         hfkt, usage-help,    maxcount, needs value, required */
     { OPTION_REF,     ALIAS_REF,     NULL, ref_usage,     0,        true,        false },
+    { OPTION_REGION_FILE, NULL,      NULL, region_file_usage, 1,    true,        false },
     { OPTION_OUTF,    ALIAS_OUTF,    NULL, outf_usage,    1,        true,        false },
     { OPTION_TABLE,   ALIAS_TABLE,   NULL, table_usage,   1,        true,        false },
     { OPTION_GZIP,    ALIAS_GZIP,    NULL, gzip_usage,    1,        false,       false },
@@ -174,6 +180,9 @@ rc_t get_common_options( Args * args, common_options *opts )
     if ( rc == 0 )
         rc = get_str_option( args, OPTION_TIMING, &opts->timing_file );
 
+    if ( rc == 0 )
+        rc = get_str_option( args, OPTION_REGION_FILE, &opts->region_file );
+
     if ( rc == 0 )
     {
         const char * table2use = NULL;
@@ -203,6 +212,7 @@ rc_t get_common_options( Args * args, common_options *opts )
 void print_common_helplines( void )
 {
     HelpOptionLine ( ALIAS_REF, OPTION_REF, "name[:from-to]", ref_usage );
+    HelpOptionLine ( NULL, OPTION_REGION_FILE, "bed-file", region_file_usage );
     HelpOptionLine ( ALIAS_OUTF, OPTION_OUTF, "output-file", outf_usage );
     HelpOptionLine ( ALIAS_TABLE, OPTION_TABLE, "shortcut", table_usage );
     HelpOptionLine ( ALIAS_BZIP, OPTION_BZIP, NULL, bzip_usage );
@@ -266,6 +276,14 @@ rc_t init_ref_regions( BSTree * tree, Args * args )
                 rc = parse_and_add_region( tree, s );
         }
     }
+
+    if ( rc == 0 )
+    {
+        const char * region_file;
+        rc = get_str_option( args, OPTION_REGION_FILE, &region_file );
+        if ( rc == 0 && region_file != NULL )
+            rc = add_regions_from_file( tree, region_file ); /* ref_regions.c */
+    }
     return rc;
 }
 
@@ -26,243 +26,240 @@
 
 #include <klib/printf.h>
 #include <klib/out.h>
+#include <align/reference.h>
 
 #include <os-native.h>
 #include <sysalloc.h>
-#include <ctype.h>
 #include <string.h>
 
 #include "md_flag.h"
 
-struct cigar_t
+/* appends the decimal value to dst, returns false if it does not fit */
+static bool md_put_uint( char * dst, size_t dst_size, size_t * idx, uint32_t value )
 {
-	char * op;
-	int * count;
-	size_t size, length;
-};
-
-
-static void init_cigar_t( struct cigar_t * c, size_t size )
-{
-	if ( c != NULL )
+	char tmp[ 16 ];
+	size_t n = 0;
+	do
 	{
-		c->size = 0;
-		c->length = 0;
-		c->op = malloc( sizeof( c->op[ 0 ] ) * size );
-		if ( c->op != NULL )
-		{
-			c->count = malloc( sizeof( c->count[ 0 ] ) * size );
-			if ( c->count != NULL )
-				c->size = size;
-			else
-				free( ( void * ) c->op );
-		}
-	}
+		tmp[ n++ ] = '0' + ( value % 10 );
+		value /= 10;
+	} while ( value > 0 );
+	if ( *idx + n > dst_size )
+		return false;
+	while ( n > 0 )
+		dst[ ( *idx )++ ] = tmp[ --n ];
+	return true;
 }
 
-static void resize_cigar_t( struct cigar_t * c, size_t new_size )
+
+/* One pass over the textual cigar, the read and the reference: no cigar-array,
+   the MD-value is assembled in dst. Like before only M, I and D are looked at,
+   a missing count means 1, a mismatch is reported even after 0 matches
+   and a delete has to end before the end of the reference. */
+rc_t md_tag_from_cigar_string( const char * cigar_str,
+							   const size_t cigar_len,
+							   const char * read,
+							   const size_t read_len,
+							   const uint8_t * ref,
+							   const INSDC_coord_len ref_len,
+							   char * dst,
+							   const size_t dst_size,
+							   size_t * written,
+							   uint32_t * nm )
 {
-	if ( c != NULL )
+	rc_t rc = 0;
+	if ( cigar_str != NULL && read != NULL && read_len > 0 && ref != NULL && ref_len > 0 &&
+		 dst != NULL && written != NULL )
 	{
-		if ( c->size == 0 )
-			init_cigar_t( c, new_size );
-		else if ( c->size < new_size )
+		size_t idx = 0, cigar_idx, read_idx = 0;
+		INSDC_coord_len ref_idx = 0;
+		uint32_t match_count = 0, edits = 0, count = 0;
+
+		for ( cigar_idx = 0; rc == 0 && cigar_idx < cigar_len && cigar_str[ cigar_idx ] != 0; ++cigar_idx )
 		{
-			char * temp_op = c->op;
-			c->op = realloc( c->op, sizeof( c->op[ 0 ] ) * new_size );
-			if ( c->op != NULL )
+			char c = cigar_str[ cigar_idx ];
+			if ( c >= '0' && c <= '9' )
 			{
-				int * temp_count = c->count;
-				c->count = realloc( c->count, sizeof( c->count[ 0 ] ) * new_size );
-				if ( c->count != NULL )
-					c->size = new_size;
-				else
-					c->count = temp_count;
+				count = ( count * 10 ) + ( c - '0' );
+				continue;
 			}
-			else
-				c->op = temp_op;
-		}
-	}
-}
+			if ( count == 0 ) count = 1;
+			switch ( c )
+			{
+				case 'D' :	if ( match_count > 0 )
+							{
+								if ( !md_put_uint( dst, dst_size, &idx, match_count ) )
+									rc = RC( rcExe, rcNoTarg, rcWriting, rcBuffer, rcInsufficient );
+								match_count = 0;
+							}
+							if ( rc == 0 )
+							{
+								if ( ( ref_idx + count ) >= ref_len )
+									rc = RC( rcExe, rcNoTarg, rcAllocating, rcItem, rcIncomplete );
+								else if ( idx + 1 + count > dst_size )
+									rc = RC( rcExe, rcNoTarg, rcWriting, rcBuffer, rcInsufficient );
+								else
+								{
+									dst[ idx++ ] = '^';
+									memmove( &( dst[ idx ] ), &( ref[ ref_idx ] ), count );
+									idx += count;
+									ref_idx += count;
+									edits += count;
+								}
+							}
+							break;
 
-static void append_to_cigar_t( struct cigar_t * c, char op, int count )
-{
-	if ( c->length < c->size )
-	{
-		c->op[ c->length ] = op;
-		c->count[ c->length ++ ] = count;
-	}
-}
+				case 'I' :	read_idx += count;
+							edits += count;
+							break;
 
-void parse_cigar_t( struct cigar_t * c, const char * cigar_str )
-{
-	if ( c != NULL && cigar_str != NULL && cigar_str[ 0 ] != 0 )
-	{
-		resize_cigar_t( c, strlen( cigar_str ) );
-		if ( c->size > 0 )
-		{
-			int count = 0;
-			while ( *cigar_str != 0 && c->length < c->size )
-			{
-				if ( isdigit( *cigar_str ) )
-				{
-					count = ( count * 10 ) + ( *cigar_str - '0' );
-				}
-				else
-				{
-					if ( count == 0 ) count = 1;
-					append_to_cigar_t( c, *cigar_str, count );
-					count = 0;
-				}
-				cigar_str++;
+				case 'M' :	if ( read_idx + count > read_len || ref_idx + count > ref_len )
+								rc = RC( rcExe, rcNoTarg, rcAllocating, rcItem, rcIncomplete );
+							else
+							{
+								const char * rd = &( read[ read_idx ] );
+								const uint8_t * rf = &( ref[ ref_idx ] );
+								uint32_t i;
+								for ( i = 0; rc == 0 && i < count; ++i )
+								{
+									if ( rd[ i ] == ( char )rf[ i ] )
+										match_count++;
+									else
+									{
+										if ( !md_put_uint( dst, dst_size, &idx, match_count ) || idx >= dst_size )
+											rc = RC( rcExe, rcNoTarg, rcWriting, rcBuffer, rcInsufficient );
+										else
+											dst[ idx++ ] = rf[ i ];
+										match_count = 0;
+										edits++;
+									}
+								}
+								read_idx += count;
+								ref_idx += count;
+							}
+							break;
 			}
+			count = 0;
+		}
+		if ( rc == 0 && match_count > 0 && !md_put_uint( dst, dst_size, &idx, match_count ) )
+			rc = RC( rcExe, rcNoTarg, rcWriting, rcBuffer, rcInsufficient );
+		if ( rc == 0 )
+		{
+			*written = idx;
+			if ( nm != NULL )
+				*nm = edits;
 		}
 	}
+	else
+		rc = RC( rcExe, rcNoTarg, rcAllocating, rcParam, rcIncomplete );
+	return rc;
 }
 
-struct cigar_t * make_cigar_t( const char * cigar_str, const size_t cigar_len )
+
+rc_t kout_md_tag_from_cigar_string( const char * cigar_str,
+									const size_t cigar_len,
+									const char * read,
+									const size_t read_len,
+									const uint8_t * ref,
+									const INSDC_coord_len ref_len )
 {
-	struct cigar_t * res = malloc( sizeof * res );
-	if ( res != NULL )
+	rc_t rc;
+	char local[ 4096 ];
+	char * buf = local;
+	/* every event ( mismatch, delete ) consumes at least one reference-base
+	   and writes at most a 10-digit count plus a base */
+	size_t buf_size = ( ( size_t )ref_len * 12 ) + 12;
+	size_t written;
+
+	if ( buf_size <= sizeof local )
+		buf_size = sizeof local;
+	else
 	{
-		size_t size;
-		if ( cigar_str != NULL && cigar_str[ 0 ] != 0 && cigar_len > 0 )
-			size = cigar_len;
-		else
-			size = 1024;
-		init_cigar_t( res, size );
-		if ( res->size == size )
-			parse_cigar_t( res, cigar_str );
+		buf = malloc( buf_size );
+		if ( buf == NULL )
+			return RC( rcExe, rcNoTarg, rcAllocating, rcMemory, rcExhausted );
 	}
-	return res;
+
+	rc = md_tag_from_cigar_string( cigar_str, cigar_len, read, read_len, ref, ref_len,
+								   buf, buf_size, &written, NULL );
+	if ( rc == 0 )
+		rc = KOutMsg( "\tMD:Z:%.*s", ( uint32_t )written, buf );
+
+	if ( buf != local )
+		free( ( void * ) buf );
+	return rc;
 }
 
 
-void free_cigar_t( struct cigar_t * c )
+/* --------------------------------------------------------------------------- */
+
+/* alignments come sorted by position: one reference-read serves many of them */
+#define MD_REF_WINDOW ( 64 * 1024 )
+
+struct md_ref_cache
 {
-	if ( c != NULL )
-	{
-		if ( c->op != NULL )
-		{
-			free( ( void * ) c->op );
-			c->op = NULL;
-		}
-		if ( c->count != NULL )
-		{
-			free( ( void * ) c->count );
-			c->count = NULL;
-		}
-		free( ( void * ) c );
-	}
-}
+	struct ReferenceObj const * ref_obj;
+	INSDC_coord_zero start;
+	INSDC_coord_len len;
+	size_t size;
+	uint8_t * bases;
+};
 
 
-static rc_t kout_delete( int count, int *match_count,
-						 const uint8_t * ref, const INSDC_coord_len ref_len, int *ref_idx )
+struct md_ref_cache * make_md_ref_cache( void )
 {
-	rc_t rc = 0;
-	
-	if ( *match_count > 0 )
-	{
-		rc = KOutMsg( "%d", *match_count );
-		*match_count = 0;
-	}
-	
-	if ( rc == 0 )
-	{
-		if ( ( *ref_idx + count ) < ref_len )
-		{
-			rc = KOutMsg( "^%.*s", count, &(ref[ *ref_idx ] ) );
-			(*ref_idx) += count;
-		}
-		else
-			rc = RC( rcExe, rcNoTarg, rcAllocating, rcItem, rcIncomplete );
-	}
-	return rc;
+	return calloc( 1, sizeof( struct md_ref_cache ) );
 }
 
 
-static rc_t kout_match( int count, int *match_count,
-						const char * read, size_t read_len, int *read_idx,
-						const uint8_t *ref, const INSDC_coord_len ref_len, int *ref_idx )
+void free_md_ref_cache( struct md_ref_cache * c )
 {
-	rc_t rc = 0;
-	int i;
-	for ( i = 0; i < count && rc == 0; ++i )
+	if ( c != NULL )
 	{
-		if ( *read_idx < read_len && *ref_idx < ref_len )
-		{
-			if ( read[ (*read_idx)++ ] == ref[ *ref_idx ] )
-			{
-				(*match_count)++;
-			}
-			else
-			{
-				rc = KOutMsg( "%d%c", *match_count, ref[ *ref_idx ] );
-				*match_count = 0;
-			}
-			(*ref_idx)++;
-		}
-		else
-			rc = RC( rcExe, rcNoTarg, rcAllocating, rcItem, rcIncomplete );
+		if ( c->bases != NULL )
+			free( ( void * ) c->bases );
+		free( ( void * ) c );
 	}
-	return rc;
 }
 
 
-static rc_t kout_tag( const struct cigar_t * c,
-					  const char * read,
-					  const size_t read_len,
-					  const uint8_t * ref,
-					  const INSDC_coord_len ref_len )
+rc_t md_ref_cache_get( struct md_ref_cache * c,
+					   struct ReferenceObj const * ref_obj,
+					   INSDC_coord_zero pos,
+					   INSDC_coord_len len,
+					   const uint8_t ** bases,
+					   INSDC_coord_len * bases_len )
 {
 	rc_t rc = 0;
-	if ( c != NULL && read != NULL && read_len > 0 && ref != NULL && ref_len > 0 )
+	if ( c == NULL || ref_obj == NULL || bases == NULL || bases_len == NULL )
+		return RC( rcExe, rcNoTarg, rcReading, rcParam, rcNull );
+
+	if ( c->ref_obj != ref_obj || pos < c->start ||
+		 ( ( uint64_t )pos + len ) > ( ( uint64_t )c->start + c->len ) )
 	{
-		rc = KOutMsg( "\tMD:Z:" );
+		INSDC_coord_len to_read = ( len > MD_REF_WINDOW ) ? len : MD_REF_WINDOW;
+		if ( c->size < to_read )
+		{
+			uint8_t * tmp = realloc( c->bases, to_read );
+			if ( tmp == NULL )
+				return RC( rcExe, rcNoTarg, rcAllocating, rcMemory, rcExhausted );
+			c->bases = tmp;
+			c->size = to_read;
+		}
+		c->ref_obj = NULL;
+		rc = ReferenceObj_Read( ref_obj, pos, to_read, c->bases, &c->len );
 		if ( rc == 0 )
 		{
-			int read_idx = 0;
-			int ref_idx = 0;
-			int match_count = 0;
-			int cigar_idx;
-			for ( cigar_idx = 0; cigar_idx < c->length && rc == 0; ++cigar_idx )
-			{
-				int count = c->count[ cigar_idx ];
-				switch ( c->op[ cigar_idx ] )
-				{
-					case 'D' : rc = kout_delete( count, &match_count, ref, ref_len, &ref_idx ); break;
-					
-					case 'I' : read_idx += count; break;
-
-					case 'M' : rc = kout_match( count, &match_count, read, read_len, &read_idx, ref, ref_len, &ref_idx ); break;
-				}
-			}
-			if ( rc == 0 && match_count > 0 )
-				rc = KOutMsg( "%d", match_count );
+			c->ref_obj = ref_obj;
+			c->start = pos;
 		}
 	}
-	else
-		rc = RC( rcExe, rcNoTarg, rcAllocating, rcParam, rcIncomplete );
-	return rc;
-}
-
-
-rc_t kout_md_tag_from_cigar_string( const char * cigar_str,
-									const size_t cigar_len,
-									const char * read,
-									const size_t read_len,
-									const uint8_t * ref,
-									const INSDC_coord_len ref_len )
-{
-	rc_t rc = 0;
-	struct cigar_t * cigar = make_cigar_t( cigar_str, cigar_len );
-	if ( cigar == NULL )
-		rc = RC( rcExe, rcNoTarg, rcAllocating, rcItem, rcIncomplete );
-	else
+	if ( rc == 0 )
 	{
-		rc = kout_tag( cigar, read, read_len, ref, ref_len );
-		free_cigar_t( cigar );
+		/* at the end of the reference the window is shorter */
+		INSDC_coord_len avail = c->len - ( pos - c->start );
+		*bases = &( c->bases[ pos - c->start ] );
+		*bases_len = ( avail < len ) ? avail : len;
 	}
 	return rc;
 }
@@ -34,6 +34,20 @@ extern "C" {
 #include <klib/rc.h>
 #include <insdc/insdc.h>
 
+/* writes the MD-value for a textual cigar into dst; nm ( may be NULL ) receives
+   the edit-distance: mismatches plus inserted and deleted bases */
+rc_t md_tag_from_cigar_string( const char * cigar_str,
+							   const size_t cigar_len,
+							   const char * read,
+							   const size_t read_len,
+							   const uint8_t * ref,
+							   const INSDC_coord_len ref_len,
+							   char * dst,
+							   const size_t dst_size,
+							   size_t * written,
+							   uint32_t * nm );
+
+/* prints "\tMD:Z:<value>" with KOutMsg */
 rc_t kout_md_tag_from_cigar_string( const char * cigar_str,
 									const size_t cigar_len,
 									const char * read,
@@ -41,6 +55,21 @@ rc_t kout_md_tag_from_cigar_string( const char * cigar_str,
 									const uint8_t * ref,
 									const INSDC_coord_len ref_len );
 
+/* a window of reference-bases, re-read only when an alignment leaves it */
+struct md_ref_cache;
+struct ReferenceObj;
+
+struct md_ref_cache * make_md_ref_cache( void );
+
+void free_md_ref_cache( struct md_ref_cache * c );
+
+rc_t md_ref_cache_get( struct md_ref_cache * c,
+					   struct ReferenceObj const * ref_obj,
+					   INSDC_coord_zero pos,
+					   INSDC_coord_len len,
+					   const uint8_t ** bases,
+					   INSDC_coord_len * bases_len );
+
 #ifdef __cplusplus
 }
 #endif
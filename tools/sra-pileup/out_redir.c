@@ -30,8 +30,62 @@
 #include <kfs/buffile.h>
 #include <kfs/bzip.h>
 #include <kfs/gzip.h>
+#include <kproc/lock.h>
+#include <kproc/cond.h>
+#include <kproc/thread.h>
 #include <sysalloc.h>
 
+#include <zlib.h>
+#include <bzlib.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+/* the producer fills a block while the background stage writes / compresses the others */
+#define OUT_REDIR_BLOCK_SIZE ( 1024 * 1024 )
+
+enum out_block_state
+{
+    ob_empty = 0,   /* free, or being filled by the producer */
+    ob_filled,      /* handed to the background stage */
+    ob_packing,     /* a compress-thread works on it */
+    ob_packed       /* compressed, waiting to be written */
+};
+
+typedef struct out_block
+{
+    uint8_t * raw;
+    size_t raw_len;
+    uint8_t * packed;
+    size_t packed_size;
+    size_t packed_len;
+    enum out_block_state state;
+} out_block;
+
+struct out_redir_bg
+{
+    enum out_redir_mode mode;
+    bool parallel;          /* blocks compressed by the packer-threads, or written into one stream */
+    KFile * dst;            /* the plain output-file if parallel, the compressing file otherwise */
+    uint64_t dst_pos;
+
+    KLock * lock;
+    KCondition * changed;   /* broadcast on every change of a block-state */
+
+    out_block * blocks;
+    uint32_t block_count;
+    uint64_t fill_seq;      /* the producer fills blocks[ fill_seq % block_count ] */
+    uint64_t pack_seq;      /* the next block to compress */
+    uint64_t write_seq;     /* the next block to write */
+    bool done;
+    rc_t rc;
+
+    KThread * writer;
+    KThread ** packers;
+    uint32_t packer_count;
+};
+
+
 static rc_t CC out_redir_callback( void * self, const char * buffer, size_t bufsize, size_t * num_writ )
 {
     out_redir * redir = ( out_redir * )self;
@@ -42,11 +96,343 @@ static rc_t CC out_redir_callback( void * self, const char * buffer, size_t bufs
 }
 
 
-rc_t init_out_redir( out_redir * self, enum out_redir_mode mode, const char * filename, size_t bufsize )
+/* =========================================================================================== */
+
+
+/* a complete gzip-member */
+static rc_t gzip_block( out_block * b )
+{
+    rc_t rc = 0;
+    z_stream s;
+    memset( &s, 0, sizeof s );
+    if ( deflateInit2( &s, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY ) != Z_OK )
+        rc = RC( rcApp, rcFile, rcWriting, rcData, rcUnexpected );
+    else
+    {
+        size_t bound = deflateBound( &s, b->raw_len );
+        if ( bound > b->packed_size )
+        {
+            uint8_t * tmp = realloc( b->packed, bound );
+            if ( tmp == NULL )
+                rc = RC( rcApp, rcFile, rcWriting, rcMemory, rcExhausted );
+            else
+            {
+                b->packed = tmp;
+                b->packed_size = bound;
+            }
+        }
+        if ( rc == 0 )
+        {
+            s.next_in = b->raw;
+            s.avail_in = b->raw_len;
+            s.next_out = b->packed;
+            s.avail_out = b->packed_size;
+            if ( deflate( &s, Z_FINISH ) != Z_STREAM_END )
+                rc = RC( rcApp, rcFile, rcWriting, rcData, rcUnexpected );
+            else
+                b->packed_len = s.total_out;
+        }
+        deflateEnd( &s );
+    }
+    return rc;
+}
+
+
+/* a complete bzip2-stream */
+static rc_t bzip2_block( out_block * b )
+{
+    rc_t rc = 0;
+    /* the bzip2-documentation: 1% larger than the input + 600 bytes */
+    size_t bound = b->raw_len + ( b->raw_len / 100 ) + 600;
+    if ( bound > b->packed_size )
+    {
+        uint8_t * tmp = realloc( b->packed, bound );
+        if ( tmp == NULL )
+            rc = RC( rcApp, rcFile, rcWriting, rcMemory, rcExhausted );
+        else
+        {
+            b->packed = tmp;
+            b->packed_size = bound;
+        }
+    }
+    if ( rc == 0 )
+    {
+        unsigned int dst_len = b->packed_size;
+        if ( BZ2_bzBuffToBuffCompress( ( char * )b->packed, &dst_len, ( char * )b->raw, b->raw_len, 9, 0, 0 ) != BZ_OK )
+            rc = RC( rcApp, rcFile, rcWriting, rcData, rcUnexpected );
+        else
+            b->packed_len = dst_len;
+    }
+    return rc;
+}
+
+
+static rc_t CC packer_thread( const KThread * self, void * data )
+{
+    struct out_redir_bg * bg = data;
+
+    KLockAcquire( bg->lock );
+    while ( true )
+    {
+        out_block * b;
+        rc_t rc;
+
+        while ( bg->rc == 0 && !bg->done && bg->pack_seq == bg->fill_seq )
+            KConditionWait( bg->changed, bg->lock );
+        if ( bg->rc != 0 || bg->pack_seq == bg->fill_seq )
+            break;
+
+        b = &bg->blocks[ bg->pack_seq % bg->block_count ];
+        bg->pack_seq++;
+        b->state = ob_packing;
+        KLockUnlock( bg->lock );
+
+        if ( bg->mode == orm_gzip )
+            rc = gzip_block( b );
+        else
+            rc = bzip2_block( b );
+
+        KLockAcquire( bg->lock );
+        b->state = ob_packed;
+        if ( rc != 0 && bg->rc == 0 )
+            bg->rc = rc;
+        KConditionBroadcast( bg->changed );
+    }
+    KLockUnlock( bg->lock );
+    return 0;
+}
+
+
+/* writes the blocks in the order they were filled */
+static rc_t CC writer_thread( const KThread * self, void * data )
+{
+    struct out_redir_bg * bg = data;
+    enum out_block_state ready = bg->parallel ? ob_packed : ob_filled;
+
+    KLockAcquire( bg->lock );
+    while ( true )
+    {
+        out_block * b = &bg->blocks[ bg->write_seq % bg->block_count ];
+        size_t num_writ;
+        rc_t rc;
+
+        while ( bg->rc == 0 &&
+                !( bg->write_seq < bg->fill_seq && b->state == ready ) &&
+                !( bg->done && bg->write_seq == bg->fill_seq ) )
+            KConditionWait( bg->changed, bg->lock );
+        if ( bg->rc != 0 || bg->write_seq == bg->fill_seq )
+            break;
+        KLockUnlock( bg->lock );
+
+        if ( bg->parallel )
+            rc = KFileWriteAll( bg->dst, bg->dst_pos, b->packed, b->packed_len, &num_writ );
+        else
+            rc = KFileWriteAll( bg->dst, bg->dst_pos, b->raw, b->raw_len, &num_writ );
+        bg->dst_pos += num_writ;
+
+        KLockAcquire( bg->lock );
+        b->raw_len = 0;
+        b->state = ob_empty;
+        bg->write_seq++;
+        if ( rc != 0 && bg->rc == 0 )
+            bg->rc = rc;
+        KConditionBroadcast( bg->changed );
+    }
+    KLockUnlock( bg->lock );
+    return 0;
+}
+
+
+/* hands the block the producer filled to the background stage, waits for the next one to be free */
+static rc_t submit_block( struct out_redir_bg * bg )
 {
     rc_t rc;
-    KFile *output_file;
+    out_block * next;
+
+    KLockAcquire( bg->lock );
+    bg->blocks[ bg->fill_seq % bg->block_count ].state = ob_filled;
+    bg->fill_seq++;
+    KConditionBroadcast( bg->changed );
+    next = &bg->blocks[ bg->fill_seq % bg->block_count ];
+    while ( bg->rc == 0 && next->state != ob_empty )
+        KConditionWait( bg->changed, bg->lock );
+    rc = bg->rc;
+    KLockUnlock( bg->lock );
+    return rc;
+}
+
+
+static rc_t CC out_redir_bg_callback( void * self, const char * buffer, size_t bufsize, size_t * num_writ )
+{
+    out_redir * redir = ( out_redir * )self;
+    struct out_redir_bg * bg = redir->bg;
+    rc_t rc = 0;
+    size_t done = 0;
+
+    while ( rc == 0 && done < bufsize )
+    {
+        out_block * b = &bg->blocks[ bg->fill_seq % bg->block_count ];
+        size_t n = OUT_REDIR_BLOCK_SIZE - b->raw_len;
+        if ( n > bufsize - done )
+            n = bufsize - done;
+        memmove( b->raw + b->raw_len, buffer + done, n );
+        b->raw_len += n;
+        done += n;
+        if ( b->raw_len == OUT_REDIR_BLOCK_SIZE )
+            rc = submit_block( bg );
+    }
+    *num_writ = done;
+    redir->pos += done;
+    return rc;
+}
+
+
+/* submits the last block, waits for the threads and releases everything */
+static rc_t finish_out_redir_bg( struct out_redir_bg * bg )
+{
+    rc_t rc;
+    uint32_t i;
+
+    if ( bg->lock != NULL && bg->blocks != NULL )
+    {
+        KLockAcquire( bg->lock );
+        /* no output at all still gives one ( empty ) gzip-member / bzip2-stream */
+        if ( bg->blocks[ bg->fill_seq % bg->block_count ].raw_len > 0 || bg->fill_seq == 0 )
+        {
+            bg->blocks[ bg->fill_seq % bg->block_count ].state = ob_filled;
+            bg->fill_seq++;
+        }
+        bg->done = true;
+        KConditionBroadcast( bg->changed );
+        KLockUnlock( bg->lock );
+    }
+
+    if ( bg->writer != NULL )
+    {
+        KThreadWait( bg->writer, NULL );
+        KThreadRelease( bg->writer );
+    }
+    for ( i = 0; i < bg->packer_count; ++i )
+    {
+        if ( bg->packers[ i ] != NULL )
+        {
+            KThreadWait( bg->packers[ i ], NULL );
+            KThreadRelease( bg->packers[ i ] );
+        }
+    }
+    rc = bg->rc;
+
+    if ( bg->blocks != NULL )
+    {
+        for ( i = 0; i < bg->block_count; ++i )
+        {
+            free( bg->blocks[ i ].raw );
+            free( bg->blocks[ i ].packed );
+        }
+        free( bg->blocks );
+    }
+    free( bg->packers );
+    KConditionRelease( bg->changed );
+    KLockRelease( bg->lock );
+    {
+        /* with one background thread dst is the gzip/bzip2-writer: releasing it
+           writes the last compressed block and the trailer */
+        rc_t rc2 = KFileRelease( bg->dst );
+        if ( rc == 0 )
+            rc = rc2;
+    }
+    free( bg );
+    return rc;
+}
+
+
+/* takes ownership of output_file */
+static rc_t make_out_redir_bg( struct out_redir_bg ** bg, enum out_redir_mode mode,
+                               KFile * output_file, uint32_t compress_threads )
+{
+    rc_t rc = 0;
+    struct out_redir_bg * res = calloc( 1, sizeof *res );
+    if ( res == NULL )
+    {
+        KFileRelease( output_file );
+        return RC( rcApp, rcFile, rcConstructing, rcMemory, rcExhausted );
+    }
+
+    res->mode = mode;
+    res->parallel = ( compress_threads > 1 );
+    if ( res->parallel )
+    {
+        res->dst = output_file;
+        res->packer_count = compress_threads;
+        res->block_count = 2 * compress_threads;
+    }
+    else
+    {
+        /* double buffered: the producer fills one block, the writer compresses the other */
+        switch ( mode )
+        {
+            case orm_gzip  : rc = KFileMakeGzipForWrite( &res->dst, output_file ); break;
+            case orm_bzip2 : rc = KFileMakeBzip2ForWrite( &res->dst, output_file ); break;
+            case orm_uncompressed : break;
+        }
+        KFileRelease( output_file );
+        res->block_count = 2;
+    }
+
+    if ( rc == 0 )
+        rc = KLockMake( &res->lock );
+    if ( rc == 0 )
+        rc = KConditionMake( &res->changed );
+    if ( rc == 0 )
+    {
+        res->blocks = calloc( res->block_count, sizeof res->blocks[ 0 ] );
+        if ( res->packer_count > 0 )
+            res->packers = calloc( res->packer_count, sizeof res->packers[ 0 ] );
+        if ( res->blocks == NULL || ( res->packer_count > 0 && res->packers == NULL ) )
+            rc = RC( rcApp, rcFile, rcConstructing, rcMemory, rcExhausted );
+        else
+        {
+            uint32_t i;
+            for ( i = 0; i < res->block_count && rc == 0; ++i )
+            {
+                res->blocks[ i ].raw = malloc( OUT_REDIR_BLOCK_SIZE );
+                if ( res->blocks[ i ].raw == NULL )
+                    rc = RC( rcApp, rcFile, rcConstructing, rcMemory, rcExhausted );
+            }
+        }
+    }
+    if ( rc == 0 )
+    {
+        uint32_t i;
+        rc = KThreadMake( &res->writer, writer_thread, res );
+        for ( i = 0; i < res->packer_count && rc == 0; ++i )
+            rc = KThreadMake( &res->packers[ i ], packer_thread, res );
+        if ( rc != 0 )
+            LOGERR( klogInt, rc, "cannot start output-compression thread" );
+    }
 
+    if ( rc == 0 )
+        *bg = res;
+    else
+    {
+        if ( res->lock != NULL )
+        {
+            KLockAcquire( res->lock );
+            res->rc = rc;
+            KLockUnlock( res->lock );
+        }
+        finish_out_redir_bg( res );
+    }
+    return rc;
+}
+
+
+/* =========================================================================================== */
+
+
+static rc_t open_output_file( const char * filename, KFile ** output_file )
+{
+    rc_t rc;
     if ( filename != NULL )
     {
         KDirectory *dir;
@@ -55,14 +441,48 @@ rc_t init_out_redir( out_redir * self, enum out_redir_mode mode, const char * fi
             LOGERR( klogInt, rc, "KDirectoryNativeDir() failed" );
         else
         {
-            rc = KDirectoryCreateFile ( dir, &output_file, false, 0664, kcmInit, "%s", filename );
+            rc = KDirectoryCreateFile ( dir, output_file, false, 0664, kcmInit, "%s", filename );
             KDirectoryRelease( dir );
         }
     }
     else
-        rc = KFileMakeStdOut ( &output_file );
+        rc = KFileMakeStdOut ( output_file );
+    return rc;
+}
 
-    if ( rc == 0 )
+
+static rc_t set_out_handler( out_redir * self, KWrtWriter writer )
+{
+    rc_t rc;
+    self->org_writer = KOutWriterGet();
+    self->org_data = KOutDataGet();
+    self->pos = 0;
+    rc = KOutHandlerSet( writer, self );
+    if ( rc != 0 )
+        LOGERR( klogInt, rc, "KOutHandlerSet() failed" );
+    return rc;
+}
+
+
+rc_t init_out_redir_mt( out_redir * self, enum out_redir_mode mode, const char * filename,
+                        size_t bufsize, uint32_t compress_threads )
+{
+    rc_t rc;
+    KFile *output_file;
+
+    self->kfile = NULL;
+    self->bg = NULL;
+    self->org_writer = NULL;
+    rc = open_output_file( filename, &output_file );
+
+    if ( rc == 0 && mode != orm_uncompressed && compress_threads > 0 )
+    {
+        /* the compression runs in the background, the blocks replace the buffering */
+        rc = make_out_redir_bg( &self->bg, mode, output_file, compress_threads );
+        if ( rc == 0 )
+            rc = set_out_handler( self, out_redir_bg_callback );
+    }
+    else if ( rc == 0 )
     {
         KFile *temp_file;
 
@@ -95,12 +515,7 @@ rc_t init_out_redir( out_redir * self, enum out_redir_mode mode, const char * fi
             if ( rc == 0 )
             {
                 self->kfile = output_file;
-                self->org_writer = KOutWriterGet();
-                self->org_data = KOutDataGet();
-                self->pos = 0;
-                rc = KOutHandlerSet( out_redir_callback, self );
-                if ( rc != 0 )
-                    LOGERR( klogInt, rc, "KOutHandlerSet() failed" );
+                rc = set_out_handler( self, out_redir_callback );
             }
         }
     }
@@ -108,13 +523,35 @@ rc_t init_out_redir( out_redir * self, enum out_redir_mode mode, const char * fi
 }
 
 
-void release_out_redir( out_redir * self )
+rc_t init_out_redir( out_redir * self, enum out_redir_mode mode, const char * filename, size_t bufsize )
 {
-    KFileRelease( self->kfile );
+    return init_out_redir_mt( self, mode, filename, bufsize, 0 );
+}
+
+
+rc_t release_out_redir( out_redir * self )
+{
+    rc_t rc;
     if( self->org_writer != NULL )
     {
         KOutHandlerSet( self->org_writer, self->org_data );
     }
     self->org_writer = NULL;
+    /* releasing the file flushes the buffer and the compression */
+    rc = KFileRelease( self->kfile );
+    if ( rc != 0 )
+        LOGERR( klogErr, rc, "writing the output failed" );
+    self->kfile = NULL;
+    if ( self->bg != NULL )
+    {
+        rc_t rc2 = finish_out_redir_bg( self->bg );
+        if ( rc2 != 0 )
+        {
+            LOGERR( klogErr, rc2, "writing the compressed output failed" );
+            if ( rc == 0 )
+                rc = rc2;
+        }
+        self->bg = NULL;
+    }
+    return rc;
 }
-
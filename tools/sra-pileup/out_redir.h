@@ -47,6 +47,11 @@ enum out_redir_mode
 };
 
 
+/* how many threads compress the output, if not disabled */
+#define OUT_REDIR_COMPRESS_THREADS 4
+
+struct out_redir_bg;
+
 /* GLOBAL VARIABLES */
 typedef struct out_redir
 {
@@ -54,11 +59,27 @@ typedef struct out_redir
     void* org_data;
     KFile* kfile;
     uint64_t pos;
+    struct out_redir_bg * bg;   /* background compression, NULL if inline */
 } out_redir;
 
 
+/* compresses inline, on the thread that produces the output */
 rc_t init_out_redir( out_redir * self, enum out_redir_mode mode, const char * filename, size_t bufsize );
 
-void release_out_redir( out_redir * self );
+/* compress_threads for gzip/bzip2 output:
+   0 ... inline, as init_out_redir()
+   1 ... one background thread writes the blocks into one compressed stream
+   n ... n threads compress blocks in parallel, each into a stream of its own:
+         the concatenated gzip-members / bzip2-streams are decoded by gzip/bzip2 as one file */
+rc_t init_out_redir_mt( out_redir * self, enum out_redir_mode mode, const char * filename,
+                        size_t bufsize, uint32_t compress_threads );
+
+/* flushes the output, waits for the background stage to finish:
+   returns the first error of writing or compressing the output */
+rc_t release_out_redir( out_redir * self );
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif
@@ -348,6 +348,8 @@ rc_t pileup_v2( Args * args, pileup_options *options )
             rc = ref_walker_set_interest( walker, interest );
             if ( rc == 0 )
                 rc = ref_walker_set_min_mapq( walker, options->minmapq );
+            if ( rc == 0 )
+                rc = ref_walker_set_prefetch( walker, !options->cmn.no_mt );
         }
 
         /* let the walker call the callbacks while iterating over the sources/ranges */
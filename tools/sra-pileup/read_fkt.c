@@ -25,7 +25,9 @@
 */
 
 #include "read_fkt.h"
+#include <vdb/blob.h>
 #include <sysalloc.h>
+#include <string.h>
 
 /* ------------------------------------------------------------------------------------------------------------------- */
 
@@ -653,6 +655,124 @@ rc_t read_INSDC_dna_text_ptr( int64_t row_id, const VCursor * cursor, uint32_t i
 }
 
 
+/* ------------------------------------------------------------------------------------------------------------------- */
+
+/* the range-variants: one column for a contiguous span of rows, read blob by blob instead of
+   row by row through the cursor. the cells point into the blobs, which are kept in a row_span
+   until it is released */
+
+void row_span_init( row_span * span )
+{
+    VectorInit( &span->blobs, 0, 4 );
+}
+
+
+static void CC release_span_blob( void *item, void *data )
+{
+    VBlobRelease( item );
+}
+
+
+void row_span_release( row_span * span )
+{
+    VectorWhack( &span->blobs, release_span_blob, NULL );
+}
+
+
+static rc_t read_range( int64_t first_row, uint32_t row_count, const VCursor * cursor, uint32_t idx,
+                        size_t elem_size, row_span * span, const void ** ptrs, uint32_t * lens,
+                        const char * hint, const char * type_name )
+{
+    rc_t rc = 0;
+    uint32_t done = 0;
+    if ( idx == INVALID_COLUMN )
+    {
+        rc = RC( rcExe, rcNoTarg, rcReading, rcItem, rcInvalid );
+        (void)PLOGERR( klogInt, ( klogInt, rc, "column idx invalid at row#$(tr) . $(hi) ) $(ty) (range)",
+            "tr=%li,hi=%s,ty=%s", first_row, hint, type_name ) );
+    }
+    while ( rc == 0 && done < row_count )
+    {
+        int64_t row_id = first_row + done;
+        const VBlob * blob;
+        rc = VCursorGetBlobDirect( cursor, &blob, row_id, idx );
+        if ( rc != 0 )
+        {
+            (void)PLOGERR( klogInt, ( klogInt, rc, "VCursorGetBlobDirect( row#$(tr) . idx#$(ti) . $(hi) ) $(ty) failed",
+                "tr=%li,ti=%u,hi=%s,ty=%s", row_id, idx, hint, type_name ) );
+        }
+        else
+        {
+            int64_t blob_first;
+            uint64_t blob_count;
+            rc = VBlobIdRange( blob, &blob_first, &blob_count );
+            if ( rc != 0 )
+            {
+                (void)PLOGERR( klogInt, ( klogInt, rc, "VBlobIdRange( row#$(tr) . idx#$(ti) . $(hi) ) $(ty) failed",
+                    "tr=%li,ti=%u,hi=%s,ty=%s", row_id, idx, hint, type_name ) );
+            }
+            else if ( row_id < blob_first || ( uint64_t )( row_id - blob_first ) >= blob_count )
+            {
+                rc = RC( rcExe, rcNoTarg, rcReading, rcRange, rcInconsistent );
+                (void)PLOGERR( klogInt, ( klogInt, rc, "blob does not contain row#$(tr) . idx#$(ti) . $(hi) ) $(ty)",
+                    "tr=%li,ti=%u,hi=%s,ty=%s", row_id, idx, hint, type_name ) );
+            }
+            else
+            {
+                /* all rows of the span this blob holds */
+                uint64_t in_blob = blob_count - ( row_id - blob_first );
+                uint32_t end = ( in_blob < ( row_count - done ) ) ? done + ( uint32_t )in_blob : row_count;
+                for ( ; rc == 0 && done < end; ++done )
+                {
+                    const void * base;
+                    uint32_t elem_bits, boff, row_len;
+                    rc = VBlobCellData( blob, first_row + done, &elem_bits, &base, &boff, &row_len );
+                    if ( rc != 0 )
+                    {
+                        (void)PLOGERR( klogInt, ( klogInt, rc, "VBlobCellData( row#$(tr) . idx#$(ti) . $(hi) ) $(ty) failed",
+                            "tr=%li,ti=%u,hi=%s,ty=%s", first_row + done, idx, hint, type_name ) );
+                    }
+                    else if ( elem_bits != elem_size * 8 || boff != 0 )
+                    {
+                        /* the caller would read the elements with the wrong size or offset */
+                        rc = RC( rcExe, rcNoTarg, rcReading, rcType, rcInvalid );
+                        (void)PLOGERR( klogInt, ( klogInt, rc, "VBlobCellData( row#$(tr) . idx#$(ti) . $(hi) ) $(ty): $(eb) bits at offset $(bo)",
+                            "tr=%li,ti=%u,hi=%s,ty=%s,eb=%u,bo=%u", first_row + done, idx, hint, type_name, elem_bits, boff ) );
+                    }
+                    else
+                    {
+                        ptrs[ done ] = ( row_len > 0 ) ? base : NULL;
+                        lens[ done ] = row_len;
+                    }
+                }
+            }
+
+            if ( rc == 0 && span != NULL )
+            {
+                rc = VectorAppend( &span->blobs, NULL, blob );
+                if ( rc != 0 )
+                    VBlobRelease( blob );
+            }
+            else
+                VBlobRelease( blob );
+        }
+    }
+    return rc;
+}
+
+
+rc_t read_uint8_ptr_range( int64_t first_row, uint32_t row_count, const VCursor * cursor, uint32_t idx, row_span * span, const uint8_t **res, uint32_t *len, const char * hint )
+{
+    return read_range( first_row, row_count, cursor, idx, sizeof **res, span, (const void**)res, len, hint, "uint8 (ptr)" );
+}
+
+
+rc_t read_INSDC_read_type_ptr_range( int64_t first_row, uint32_t row_count, const VCursor * cursor, uint32_t idx, row_span * span, const INSDC_read_type **res, uint32_t *len, const char * hint )
+{
+    return read_range( first_row, row_count, cursor, idx, sizeof **res, span, (const void**)res, len, hint, "INSDC_read_type (ptr)" );
+}
+
+
 /* ------------------------------------------------------------------------------------------------------------------- */
 
 bool namelist_contains( const KNamelist *names, const char * a_name )
@@ -75,6 +75,20 @@ rc_t read_INSDC_read_type_ptr( int64_t row_id, const VCursor * cursor, uint32_t
 rc_t read_INSDC_read_filter_ptr( int64_t row_id, const VCursor * cursor, uint32_t idx, const INSDC_read_filter **res, uint32_t *len, const char * hint );
 rc_t read_INSDC_dna_text_ptr( int64_t row_id, const VCursor * cursor, uint32_t idx, const INSDC_dna_text **res, uint32_t *len, const char * hint );
 
+/* the blobs the cells of the *_ptr_range() functions point into, valid until released */
+typedef struct row_span
+{
+    Vector blobs;
+} row_span;
+
+void row_span_init( row_span * span );
+void row_span_release( row_span * span );
+
+/* one column for rows first_row ... first_row + row_count - 1, read blob by blob:
+   the cells point into the blobs, which are kept in span */
+rc_t read_uint8_ptr_range( int64_t first_row, uint32_t row_count, const VCursor * cursor, uint32_t idx, row_span * span, const uint8_t **res, uint32_t *len, const char * hint );
+rc_t read_INSDC_read_type_ptr_range( int64_t first_row, uint32_t row_count, const VCursor * cursor, uint32_t idx, row_span * span, const INSDC_read_type **res, uint32_t *len, const char * hint );
+
 bool namelist_contains( const KNamelist * names, const char * a_name );
 rc_t add_column( const VCursor * cursor, const char *colname, uint32_t * idx );
 void add_opt_column( const VCursor * cursor, const KNamelist *names, const char *colname, uint32_t * idx );
@@ -24,6 +24,7 @@
 *
 */
 #include "ref_regions.h"
+#include "bed_file.h"
 
 #include <klib/rc.h>
 #include <klib/out.h>
@@ -159,10 +160,12 @@ static struct reference_region * make_reference_region( const char *name )
 }
 
 
-static int64_t CC cmp_range_wrapper( const void *item, const void *n )
-{   return cmp_range( item, n ); }
+static int64_t CC cmp_range_wrapper( const void ** item, const void ** n, void * data )
+{   return cmp_range( *item, *n ); }
 
 
+/* the ranges are appended unsorted, check_ref_regions() sorts them once:
+   a region-file can have hundreds of thousands of them */
 static rc_t add_ref_region_range( struct reference_region * self, const uint64_t start, const uint64_t end )
 {
     rc_t rc = 0;
@@ -171,9 +174,9 @@ static rc_t add_ref_region_range( struct reference_region * self, const uint64_t
         rc = RC( rcApp, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
     else
     {
-        rc = VectorInsert ( &self->ranges, r, NULL, cmp_range_wrapper );
+        rc = VectorAppend ( &self->ranges, NULL, r );
         if ( rc != 0 )
-            free( r );
+            free_range( r );
     }
     return rc;
 }
@@ -283,72 +286,89 @@ static void free_reference_region( struct reference_region * self )
 }
 
 
+/* the merge-functions compact the sorted ranges into a new vector in one pass,
+   instead of removing the merged ones one by one from the middle of the vector */
+static void replace_ranges( struct reference_region * self, Vector * merged )
+{
+    VectorWhack ( &self->ranges, NULL, NULL );
+    self->ranges = *merged;
+}
+
+
 static void merge_overlapping_ranges( struct reference_region * self )
 {
-    uint32_t n = VectorLength( &self->ranges );
-    uint32_t i = 0;
-    struct reference_range * a = NULL;
-    while ( i < n )
+    uint32_t i, n = VectorLength( &self->ranges );
+    struct reference_range * a = VectorGet ( &self->ranges, 0 );
+    if ( n > 1 )
     {
-        struct reference_range * b = VectorGet ( &self->ranges, i );
-        bool remove = false;
-        if ( a != NULL )
+        Vector merged;
+        VectorInit ( &merged, 0, n );
+        if ( a->start == 0 && a->end == 0 )
         {
-            remove = range_overlapp( a, b );
-            if ( remove )
-            {
-                struct reference_range * r;
-                a->end = b->end;
-                VectorRemove ( &self->ranges, i, (void**)&r );
-                free( r );
-                n--;
-            }
+            /* the whole reference is requested, that covers all the other ranges */
+            for ( i = 1; i < n; ++i )
+                free_range( VectorGet ( &self->ranges, i ) );
+            VectorAppend ( &merged, NULL, a );
         }
-        if ( !remove )
+        else
         {
-            a = b;
-            ++i;
+            VectorAppend ( &merged, NULL, a );
+            for ( i = 1; i < n; ++i )
+            {
+                struct reference_range * b = VectorGet ( &self->ranges, i );
+                /* adjacent ranges are merged too, there is nothing to skip between them */
+                if ( range_overlapp( a, b ) || b->start == a->end + 1 )
+                {
+                    if ( b->end > a->end )
+                        a->end = b->end;
+                    free_range( b );
+                }
+                else
+                {
+                    VectorAppend ( &merged, NULL, b );
+                    a = b;
+                }
+            }
         }
+        replace_ranges( self, &merged );
     }
 }
 
 
 static void merge_close_ranges_and_create_filter( struct reference_region * self, uint64_t merge_diff )
 {
-    uint32_t n = VectorLength( &self->ranges );
-    uint32_t i = 0;
-    struct reference_range * a = NULL;
-    while ( i < n )
+    uint32_t i, n = VectorLength( &self->ranges );
+    struct reference_range * a = VectorGet ( &self->ranges, 0 );
+    if ( n > 1 && !( a->start == 0 && a->end == 0 ) )
     {
-        struct reference_range * b = VectorGet ( &self->ranges, i );
-        bool remove = false;
-        if ( a != NULL )
+        Vector merged;
+        VectorInit ( &merged, 0, n );
+        VectorAppend ( &merged, NULL, a );
+        for ( i = 1; i < n; ++i )
         {
+            struct reference_range * b = VectorGet ( &self->ranges, i );
             /* get the distance between a and b */
             uint64_t d = range_distance( a, b );
-            remove = ( d < merge_diff );
-            if ( remove )
+            if ( d < merge_diff )
             {
-                struct reference_range * r;
-
                 /* add the gap to the skip-vector of a */
                 struct skip_range * sr = make_skip_range( a->end + 1, b->start - 1 );
-                VectorAppend ( &( a->skip ), NULL, sr );
+                if ( sr != NULL )
+                    VectorAppend ( &( a->skip ), NULL, sr );
 
                 /* expand a to merge with b */
                 a->end = b->end;
 
-                /* remove b */
-                VectorRemove ( &self->ranges, i, (void**)&r );
-                free( r );
-                n--;
+                /* b is not needed any more */
+                free_range( b );
+            }
+            else
+            {
+                VectorAppend ( &merged, NULL, b );
+                a = b;
             }
         }
-        if ( !remove )
-        {
-            a = b;
-            ++i;
-        }
+        replace_ranges( self, &merged );
     }
 }
 
@@ -411,6 +431,21 @@ rc_t parse_and_add_region( BSTree * regions, const char * s )
 }
 
 
+static rc_t CC on_bed_interval( const char * name, uint64_t start, uint64_t end, void * data )
+{
+    /* BED is 0-based with an exclusive end, the regions here are 1-based and inclusive */
+    if ( end > start )
+        return add_region( data, name, start + 1, end );
+    return 0;
+}
+
+
+rc_t add_regions_from_file( BSTree * regions, const char * path )
+{
+    return foreach_bed_interval( path, on_bed_interval, regions ); /* bed_file.c */
+}
+
+
 /* =========================================================================================== */
 
 
@@ -451,6 +486,7 @@ static void CC check_refrange_wrapper( BSTNode *n, void *data )
 {
     struct reference_region * rr = ( struct reference_region * )n;
     uint64_t * merge_diff = data;
+    VectorReorder ( &rr->ranges, cmp_range_wrapper, NULL );
     merge_overlapping_ranges( rr );
     if ( *merge_diff > 0 )
         merge_close_ranges_and_create_filter( rr, *merge_diff );
@@ -781,12 +817,14 @@ bool skiplist_is_skip_position( struct skiplist * list, uint64_t pos )
         if ( cur_node != NULL )
         {
             const struct skip_range * curr_skip_range = cur_node->current_skip_range;
-            if ( curr_skip_range != NULL )
+            /* the position can jump over several skip-ranges at once */
+            while ( curr_skip_range != NULL )
             {
                 if ( pos < curr_skip_range->start ) return false;
                 if ( pos <= curr_skip_range->end ) return true;
                 cur_node->current_id++;
-                cur_node->current_skip_range = VectorGet ( &( cur_node->skip_ranges ), cur_node->current_id );
+                curr_skip_range = VectorGet ( &( cur_node->skip_ranges ), cur_node->current_id );
+                cur_node->current_skip_range = curr_skip_range;
             }
         }
     }
@@ -39,6 +39,8 @@ struct skiplist;
 
 rc_t parse_and_add_region( BSTree * regions, const char * s );
 rc_t add_region( BSTree * regions, const char * name, const uint64_t start, const uint64_t end );
+/* adds all intervals of a BED-file */
+rc_t add_regions_from_file( BSTree * regions, const char * path );
 void check_ref_regions( BSTree * regions, uint64_t merge_diff );
 void free_ref_regions( BSTree * regions );
 uint32_t count_ref_regions( BSTree * regions );
@@ -36,6 +36,10 @@
 #include <kfs/directory.h>
 #include <kfs/file.h>
 
+#include <kproc/lock.h>
+#include <kproc/cond.h>
+#include <kproc/thread.h>
+
 #include <vfs/manager.h>
 #include <vfs/path.h>
 
@@ -113,6 +117,7 @@ struct ref_walker
     int32_t min_mapq;
     uint32_t interest;
     uint64_t merge_diff;
+    bool prefetch;      /* load the next reference-window on a helper-thread */
     bool prepared;
     char * spot_group;
 
@@ -381,6 +386,14 @@ rc_t ref_walker_set_merge_diff( struct ref_walker * self, uint64_t merge_diff )
     return 0;
 }
 
+rc_t ref_walker_set_prefetch( struct ref_walker * self, bool prefetch )
+{
+    if ( self == NULL )
+        return RC( rcApp, rcNoTarg, rcAccessing, rcSelf, rcNull );
+    self->prefetch = prefetch;
+    return 0;
+}
+
 rc_t ref_walker_set_interest( struct ref_walker * self, uint32_t interest )
 {
     if ( self == NULL )
@@ -781,164 +794,379 @@ static void CC cur_id_vector_entry_whack( void *item, void *data )
     free( ids );
 }
 
-static rc_t ref_walker_walk_ref_range( struct ref_walker * self, ref_walker_data * rwd )
+
+/* ================================================================================================ */
+/* a loaded reference-window:
+
+   the ReferenceIterator reads all placements of a window when it enters it ( ReferenceIteratorNextWindow ),
+   that is where the time goes on remote or cold data. The loaded window owns its iterator, so it can be
+   loaded on the prefetch-thread and handed over to the walking thread. */
+
+typedef struct ref_window
 {
+    /* the requested range, adjusted to the length of the reference */
+    uint64_t ref_start;
+    uint64_t ref_end;
+
     ReferenceIterator * ref_iter;
-    rc_t rc = AlignMgrMakeReferenceIterator ( self->amgr, &ref_iter, &self->cb_block, self->min_mapq ); /* align/iterator.h */
-    if ( rc == 0 )
+    Vector cur_id_vector;
+
+    /* the reference the iterator has entered, NULL if there is nothing to walk */
+    struct ReferenceObj const * ref_obj;
+
+    /* the first window of the iterator, and the result of entering it */
+    INSDC_coord_zero first_pos;
+    INSDC_coord_len len;
+    rc_t rc_w;
+} ref_window;
+
+
+static void ref_window_release( ref_window * win )
+{
+    if ( win != NULL )
     {
-        /* construct the reference iterator */
+        ReferenceIteratorRelease ( win->ref_iter );
 
-        uint32_t idx, count;
-        uint32_t reflist_options = ref_walker_make_reflist_options( self ); /* above */
-        Vector cur_id_vector;
-        VectorInit ( &cur_id_vector, 0, 12 );
+        /* free cur_id_vector */
+        VectorWhack ( &win->cur_id_vector, cur_id_vector_entry_whack, NULL );
+        free( ( void * ) win );
+    }
+}
 
+
+/* construct the reference-iterator for one window of a reference and load its first window */
+static rc_t ref_window_load( struct ref_walker * self, const char * ref_name, ref_window * win )
+{
+    uint32_t reflist_options = ref_walker_make_reflist_options( self ); /* above */
+    uint32_t idx, count = 0;
+    rc_t rc = AlignMgrMakeReferenceIterator ( self->amgr, &win->ref_iter, &self->cb_block, self->min_mapq ); /* align/iterator.h */
+    if ( rc == 0 )
         rc = VNameListCount ( self->sources, &count );
-        for ( idx = 0; idx < count && rc == 0; ++idx )
+    for ( idx = 0; idx < count && rc == 0; ++idx )
+    {
+        const char * src_name = NULL;
+        rc = VNameListGet ( self->sources, idx, &src_name );
+        if ( rc == 0 && src_name != NULL )
         {
-            const char * src_name = NULL;
-            rc = VNameListGet ( self->sources, idx, &src_name );
-            if ( rc == 0 && src_name != NULL )
+            const VDatabase *db;
+            rc = VDBManagerOpenDBRead ( self->vmgr, &db, self->vschema, "%s", src_name );
+            if ( rc == 0 )
             {
-                const VDatabase *db;
-                rc = VDBManagerOpenDBRead ( self->vmgr, &db, self->vschema, "%s", src_name );
+                const ReferenceList * ref_list;
+                rc = ReferenceList_MakeDatabase( &ref_list, db, reflist_options, 0, NULL, 0 );
                 if ( rc == 0 )
                 {
-                    const ReferenceList * ref_list;
-                    rc = ReferenceList_MakeDatabase( &ref_list, db, reflist_options, 0, NULL, 0 );
+                    const ReferenceObj * ref_obj;
+                    rc = ReferenceList_Find( ref_list, &ref_obj, ref_name, string_size( ref_name ) );
                     if ( rc == 0 )
                     {
-                        const ReferenceObj * ref_obj;
-                        rc = ReferenceList_Find( ref_list, &ref_obj, rwd->ref_name, string_size( rwd->ref_name ) );
+                        INSDC_coord_len len;
+                        rc = ReferenceObj_SeqLength( ref_obj, &len );
                         if ( rc == 0 )
                         {
-                            INSDC_coord_len len;
-                            rc = ReferenceObj_SeqLength( ref_obj, &len );
-                            if ( rc == 0 )
-                            {
-                                if ( rwd->ref_start == 0 )
-                                    rwd->ref_start = 1;
-                                if ( ( rwd->ref_end == 0 )||( rwd->ref_end > len + 1 ) )
-                                    rwd->ref_end = ( len - rwd->ref_start ) + 1;
+                            if ( win->ref_start == 0 )
+                                win->ref_start = 1;
+                            if ( ( win->ref_end == 0 )||( win->ref_end > len + 1 ) )
+                                win->ref_end = ( len - win->ref_start ) + 1;
 
-                                if ( self->interest & RW_INTEREST_PRIM )
-                                    rc = ref_walker_add_iterator( self, rwd->ref_name, rwd->ref_start, rwd->ref_end, src_name, 
-                                            &cur_id_vector, db, ref_obj, ref_iter, TBL_PRIM, primary_align_ids );
+                            if ( self->interest & RW_INTEREST_PRIM )
+                                rc = ref_walker_add_iterator( self, ref_name, win->ref_start, win->ref_end, src_name,
+                                        &win->cur_id_vector, db, ref_obj, win->ref_iter, TBL_PRIM, primary_align_ids );
 
-                                if ( rc == 0 && ( self->interest & RW_INTEREST_SEC ) )
-                                    rc = ref_walker_add_iterator( self, rwd->ref_name, rwd->ref_start, rwd->ref_end, src_name, 
-                                            &cur_id_vector, db, ref_obj, ref_iter, TBL_SEC, secondary_align_ids );
+                            if ( rc == 0 && ( self->interest & RW_INTEREST_SEC ) )
+                                rc = ref_walker_add_iterator( self, ref_name, win->ref_start, win->ref_end, src_name,
+                                        &win->cur_id_vector, db, ref_obj, win->ref_iter, TBL_SEC, secondary_align_ids );
 
-                                if ( rc == 0 && ( self->interest & RW_INTEREST_EV ) )
-                                    rc = ref_walker_add_iterator( self, rwd->ref_name, rwd->ref_start, rwd->ref_end, src_name, 
-                                            &cur_id_vector, db, ref_obj, ref_iter, TBL_EV, evidence_align_ids );
+                            if ( rc == 0 && ( self->interest & RW_INTEREST_EV ) )
+                                rc = ref_walker_add_iterator( self, ref_name, win->ref_start, win->ref_end, src_name,
+                                        &win->cur_id_vector, db, ref_obj, win->ref_iter, TBL_EV, evidence_align_ids );
 
-                            }
-                            ReferenceObj_Release( ref_obj );
                         }
-                        ReferenceList_Release( ref_list );
+                        ReferenceObj_Release( ref_obj );
                     }
-                    VDatabaseRelease( db );
+                    ReferenceList_Release( ref_list );
                 }
+                VDatabaseRelease( db );
             }
         }
+    }
+
+    if ( rc == 0 )
+    {
+        /* because in this strategy, each ref-iter contains only 1 ref-obj, no need for a loop */
+        rc = ReferenceIteratorNextReference( win->ref_iter, NULL, NULL, &win->ref_obj );
+        if ( rc == 0 && win->ref_obj != NULL )
+            win->rc_w = ReferenceIteratorNextWindow ( win->ref_iter, &win->first_pos, &win->len );
+    }
+    return rc;
+}
 
+
+static rc_t ref_window_make( struct ref_walker * self, const char * ref_name,
+                             uint64_t ref_start, uint64_t ref_end, ref_window ** win )
+{
+    rc_t rc;
+    ref_window * o = calloc( 1, sizeof *o );
+    *win = NULL;
+    if ( o == NULL )
+        rc = RC( rcApp, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+    else
+    {
+        VectorInit ( &o->cur_id_vector, 0, 12 );
+        o->ref_start = ref_start;
+        o->ref_end = ref_end;
+        rc = ref_window_load( self, ref_name, o );
         if ( rc == 0 )
+            *win = o;
+        else
+            ref_window_release( o );
+    }
+    return rc;
+}
+
+
+/* ================================================================================================ */
+/* prefetch of reference-windows:
+
+   the windows are loaded in the order they are walked, by one helper-thread. The helper loads the
+   next window only after the walker has taken the previous one, so there are never more than two
+   windows in memory: the one walked, and the one loaded ahead of it. */
+
+typedef struct ref_window_prefetch
+{
+    struct ref_walker * walker;
+    KLock * lock;
+    KCondition * changed;   /* broadcast on every hand-over and at the end of the helper */
+    KThread * thread;
+
+    ref_window * loaded;    /* the window handed over to the walker */
+    rc_t rc;                /* the result of loading it */
+    bool filled;            /* 'loaded' / 'rc' wait for the walker to take them */
+    bool done;              /* the helper has loaded all windows ( or has given up ) */
+    bool quit;              /* the walker does not take any more windows */
+} ref_window_prefetch;
+
+
+/* wait until the walker has taken the previous window, returns false if the walker has quit */
+static bool ref_window_prefetch_wait_empty( ref_window_prefetch * pf )
+{
+    bool res;
+    KLockAcquire( pf->lock );
+    while ( pf->filled && !pf->quit )
+        KConditionWait( pf->changed, pf->lock );
+    res = !pf->quit;
+    KLockUnlock( pf->lock );
+    return res;
+}
+
+
+static rc_t CC ref_window_prefetch_thread( const KThread * thread, void * data )
+{
+    ref_window_prefetch * pf = data;
+    const struct reference_region * region = get_first_ref_node( &pf->walker->regions );
+    bool running = true;
+    while ( region != NULL && running )
+    {
+        uint32_t idx, count = get_ref_node_range_count( region );
+        for ( idx = 0; idx < count && running; ++idx )
         {
-            /* walk the reference iterator */
-            
-            /* because in this strategy, each ref-iter contains only 1 ref-obj, no need for a loop */
-            struct ReferenceObj const * ref_obj;
-            rc = ReferenceIteratorNextReference( ref_iter, NULL, NULL, &ref_obj );
-            if ( rc == 0 && ref_obj != NULL )
+            const struct reference_range * range = get_ref_range( region, idx );
+            if ( range != NULL )
             {
+                running = ref_window_prefetch_wait_empty( pf );
+                if ( running )
+                {
+                    ref_window * win = NULL;
+                    rc_t rc = ref_window_make( pf->walker, get_ref_node_name( region ),
+                                    get_ref_range_start( range ), get_ref_range_end( range ), &win );
+                    KLockAcquire( pf->lock );
+                    pf->loaded = win;
+                    pf->rc = rc;
+                    pf->filled = true;
+                    KConditionBroadcast( pf->changed );
+                    KLockUnlock( pf->lock );
+                }
+            }
+        }
+        region = get_next_ref_node( region );
+    }
+
+    KLockAcquire( pf->lock );
+    pf->done = true;
+    KConditionBroadcast( pf->changed );
+    KLockUnlock( pf->lock );
+    return 0;
+}
+
+
+/* take the next window from the helper, in the order of ref_walker_walk() */
+static rc_t ref_window_prefetch_take( ref_window_prefetch * pf, ref_window ** win )
+{
+    rc_t rc;
+    KLockAcquire( pf->lock );
+    while ( !pf->filled && !pf->done )
+        KConditionWait( pf->changed, pf->lock );
+    if ( pf->filled )
+    {
+        *win = pf->loaded;
+        rc = pf->rc;
+        pf->loaded = NULL;
+        pf->filled = false;
+        KConditionBroadcast( pf->changed );
+    }
+    else
+    {
+        *win = NULL;
+        rc = RC( rcApp, rcNoTarg, rcReading, rcData, rcInsufficient );
+    }
+    KLockUnlock( pf->lock );
+    return rc;
+}
+
+
+static void ref_window_prefetch_finish( ref_window_prefetch * pf )
+{
+    if ( pf != NULL )
+    {
+        KLockAcquire( pf->lock );
+        pf->quit = true;
+        KConditionBroadcast( pf->changed );
+        KLockUnlock( pf->lock );
+
+        KThreadWait( pf->thread, NULL );
+        KThreadRelease( pf->thread );
+
+        /* the walker may have stopped before taking the last window loaded */
+        ref_window_release( pf->loaded );
+        KConditionRelease( pf->changed );
+        KLockRelease( pf->lock );
+        free( ( void * ) pf );
+    }
+}
 
-                if ( self->interest & RW_INTEREST_SEQNAME )
-                    rc = ReferenceObj_Name( ref_obj, &rwd->ref_name );
-                else
-                    rc = ReferenceObj_SeqId( ref_obj, &rwd->ref_name );
 
+/* start the helper, returns NULL if that is not possible: the walker then loads each window itself */
+static ref_window_prefetch * ref_window_prefetch_start( struct ref_walker * self )
+{
+    ref_window_prefetch * res = calloc( 1, sizeof *res );
+    if ( res != NULL )
+    {
+        rc_t rc;
+        res->walker = self;
+        rc = KLockMake( &res->lock );
+        if ( rc == 0 )
+        {
+            rc = KConditionMake( &res->changed );
+            if ( rc == 0 )
+            {
+                rc = KThreadMake( &res->thread, ref_window_prefetch_thread, res );
                 if ( rc == 0 )
+                    return res;
+                KConditionRelease( res->changed );
+            }
+            KLockRelease( res->lock );
+        }
+        LOGERR( klogWarn, rc, "cannot start prefetch of reference-windows" );
+        free( ( void * ) res );
+    }
+    return NULL;
+}
+
+
+/* ================================================================================================ */
+
+
+static rc_t ref_walker_walk_ref_range( struct ref_walker * self, ref_window * win, ref_walker_data * rwd )
+{
+    rc_t rc = 0;
+
+    rwd->ref_start = win->ref_start;
+    rwd->ref_end = win->ref_end;
+
+    /* walk the reference iterator */
+    if ( win->ref_obj != NULL )
+    {
+        ReferenceIterator * ref_iter = win->ref_iter;
+
+        if ( self->interest & RW_INTEREST_SEQNAME )
+            rc = ReferenceObj_Name( win->ref_obj, &rwd->ref_name );
+        else
+            rc = ReferenceObj_SeqId( win->ref_obj, &rwd->ref_name );
+
+        if ( rc == 0 )
+        {
+            rc_t rc_w = win->rc_w, rc_p;
+            while ( rc == 0 && rc_w == 0 )
+            {
+                rc_p = 0;
+                while( rc == 0 && rc_p == 0 )
                 {
-                    INSDC_coord_zero first_pos;
-                    INSDC_coord_len len;
-                    rc_t rc_w = 0, rc_p;
-                    while ( rc == 0 && rc_w == 0 )
+                    rc_p = ReferenceIteratorNextPos ( ref_iter, ( self->interest & RW_INTEREST_SKIP ) );
+                    if ( rc_p == 0 )
                     {
-                        rc_w = ReferenceIteratorNextWindow ( ref_iter, &first_pos, &len );
-                        if ( rc_w == 0 )
+                        rc = ReferenceIteratorPosition ( ref_iter, &rwd->pos, &rwd->depth, &rwd->bin_ref_base );
+                        if ( rwd->depth > 0 && rc == 0 )
                         {
-                            rc_p = 0;
-                            while( rc == 0 && rc_p == 0 )
+                            rc_t rc_sg = 0;
+                            bool skip = false;
+
+                            if ( self->skiplist != NULL )
+                                skip = skiplist_is_skip_position( self->skiplist, rwd->pos + 1 );
+
+                            if ( !skip )
                             {
-                                rc_p = ReferenceIteratorNextPos ( ref_iter, ( self->interest & RW_INTEREST_SKIP ) );
-                                if ( rc_p == 0 )
+                                rwd->ascii_ref_base = _4na_to_ascii( rwd->bin_ref_base, false );
+                                if ( self->on_enter_ref_pos != NULL )
+                                    rc = self->on_enter_ref_pos( rwd );
+
+                                while ( rc_sg == 0 && rc == 0 )
                                 {
-                                    rc = ReferenceIteratorPosition ( ref_iter, &rwd->pos, &rwd->depth, &rwd->bin_ref_base );
-                                    if ( rwd->depth > 0 && rc == 0 )
+                                    rc_sg = ReferenceIteratorNextSpotGroup ( ref_iter, &rwd->spot_group, &rwd->spot_group_len );
+                                    if ( rc_sg == 0 )
                                     {
-                                        rc_t rc_sg = 0;
-                                        bool skip = false;
-
-                                        if ( self->skiplist != NULL )
-                                            skip = skiplist_is_skip_position( self->skiplist, rwd->pos + 1 );
+                                        rc_t rc_pr = 0;
+                                        if ( self->on_enter_spot_group != NULL )
+                                            rc = self->on_enter_spot_group( rwd );
 
-                                        if ( !skip )
+                                        while ( rc == 0 && rc_pr == 0 )
                                         {
-                                            rwd->ascii_ref_base = _4na_to_ascii( rwd->bin_ref_base, false );
-                                            if ( self->on_enter_ref_pos != NULL )
-                                                rc = self->on_enter_ref_pos( rwd );
-
-                                            while ( rc_sg == 0 && rc == 0 )
-                                            {
-                                                rc_sg = ReferenceIteratorNextSpotGroup ( ref_iter, &rwd->spot_group, &rwd->spot_group_len );
-                                                if ( rc_sg == 0 )
-                                                {
-                                                    rc_t rc_pr = 0;
-                                                    if ( self->on_enter_spot_group != NULL )
-                                                        rc = self->on_enter_spot_group( rwd );
-
-                                                    while ( rc == 0 && rc_pr == 0 )
-                                                    {
-                                                        const PlacementRecord * rec;
-                                                        rc_pr = ReferenceIteratorNextPlacement ( ref_iter, &rec );
-                                                        if ( rc_pr == 0 && self->on_alignment != NULL )
-                                                            rc = ref_walker_walk_alignment( self, ref_iter, rec, rwd );
-                                                    }
-
-                                                    if ( self->on_exit_spot_group != NULL )
-                                                        rc = self->on_exit_spot_group( rwd );
-                                                }
-                                            }
-                                            if ( self->on_exit_ref_pos != NULL )
-                                                rc = self->on_exit_ref_pos( rwd );
+                                            const PlacementRecord * rec;
+                                            rc_pr = ReferenceIteratorNextPlacement ( ref_iter, &rec );
+                                            if ( rc_pr == 0 && self->on_alignment != NULL )
+                                                rc = ref_walker_walk_alignment( self, ref_iter, rec, rwd );
                                         }
+
+                                        if ( self->on_exit_spot_group != NULL )
+                                            rc = self->on_exit_spot_group( rwd );
                                     }
-                                    rc = Quitting();
                                 }
+                                if ( self->on_exit_ref_pos != NULL )
+                                    rc = self->on_exit_ref_pos( rwd );
                             }
                         }
+                        rc = Quitting();
                     }
                 }
+                if ( rc == 0 )
+                {
+                    INSDC_coord_zero first_pos;
+                    INSDC_coord_len len;
+                    rc_w = ReferenceIteratorNextWindow ( ref_iter, &first_pos, &len );
+                }
             }
         }
-        ReferenceIteratorRelease ( ref_iter );
-
-        /* free cur_id_vector */
-        VectorWhack ( &cur_id_vector, cur_id_vector_entry_whack, NULL );
     }
     return rc;
 }
 
 
-static rc_t ref_walker_walk_ref_region( struct ref_walker * self, 
-                        const struct reference_region * region, ref_walker_data * rwd )
+static rc_t ref_walker_walk_ref_region( struct ref_walker * self, const struct reference_region * region,
+                                        ref_window_prefetch * pf, ref_walker_data * rwd )
 {
     rc_t rc = 0;
     uint32_t idx, count = get_ref_node_range_count( region );
     rwd->ref_name = get_ref_node_name( region );
-    
+
     rwd->ref_start = 0;
     rwd->ref_end = 0;
     rwd->pos = 0;
@@ -949,7 +1177,7 @@ static rc_t ref_walker_walk_ref_region( struct ref_walker * self,
     rwd->spot_group_len = 0;
     rwd->state = 0;
     rwd->reverse = 0;
-    
+
     if ( self->on_enter_ref != NULL )
         rc = self->on_enter_ref( rwd );
 
@@ -964,21 +1192,34 @@ static rc_t ref_walker_walk_ref_region( struct ref_walker * self,
             const struct reference_range * range = get_ref_range( region, idx );
             if ( range != NULL )
             {
+                ref_window * win = NULL;
                 rwd->ref_start = get_ref_range_start( range );
                 rwd->ref_end = get_ref_range_end( range );
                 if ( self->on_enter_ref_window != NULL )
                     rc = self->on_enter_ref_window( rwd );
+
+                /* every window loaded ahead has to be taken, to keep the helper in step */
+                if ( pf != NULL )
+                {
+                    rc_t rc_l = ref_window_prefetch_take( pf, &win );
+                    if ( rc == 0 )
+                        rc = rc_l;
+                }
+                else if ( rc == 0 )
+                    rc = ref_window_make( self, get_ref_node_name( region ), rwd->ref_start, rwd->ref_end, &win );
+
                 if ( rc == 0 )
                 {
-                    rc = ref_walker_walk_ref_range( self, rwd );
+                    rc = ref_walker_walk_ref_range( self, win, rwd );
                     if ( rc == 0 && self->on_exit_ref_window != NULL )
                         rc = self->on_exit_ref_window( rwd );
                 }
+                ref_window_release( win );
                 rwd->ref_start = 0;
                 rwd->ref_end = 0;
             }
         }
-        
+
         if ( self->on_exit_ref != NULL )
             rc = self->on_exit_ref( rwd );
     }
@@ -1001,15 +1242,20 @@ rc_t ref_walker_walk( struct ref_walker * self, void * data )
         if ( rc == 0 && self->prepared )
         {
             const struct reference_region * region = get_first_ref_node( &self->regions );
+            ref_window_prefetch * pf = NULL;
+            if ( self->prefetch )
+                pf = ref_window_prefetch_start( self );
+
             while ( region != NULL && rc == 0 )
             {
                 ref_walker_data rwd;    /* this record will be passed to all the enter/exit callback's */
                 rwd.data = data;
 
-                rc = ref_walker_walk_ref_region( self, region, &rwd );
+                rc = ref_walker_walk_ref_region( self, region, pf, &rwd );
                 if ( rc == 0 )
                     region = get_next_ref_node( region );
             }
+            ref_window_prefetch_finish( pf );
         }
     }
     return rc;
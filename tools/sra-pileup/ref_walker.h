@@ -119,6 +119,8 @@ typedef struct ref_walker_callbacks
 rc_t ref_walker_set_min_mapq( struct ref_walker * self, int32_t min_mapq );
 rc_t ref_walker_set_spot_group( struct ref_walker * self, const char * spot_group );
 rc_t ref_walker_set_merge_diff( struct ref_walker * self, uint64_t merge_diff );
+/* load the next reference-window on a helper-thread while the current one is walked */
+rc_t ref_walker_set_prefetch( struct ref_walker * self, bool prefetch );
 rc_t ref_walker_set_interest( struct ref_walker * self, uint32_t interest );
 rc_t ref_walker_get_interest( struct ref_walker * self, uint32_t * interest );
 
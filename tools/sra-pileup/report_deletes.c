@@ -26,11 +26,13 @@
 
 #include "report_deletes.h"
 #include "cg_tools.h"
+#include "dyn_string.h"
 
 #include <klib/text.h>
 #include <klib/log.h>
 #include <klib/out.h>
 #include <kfs/file.h>
+#include <kproc/thread.h>
 
 #include <vfs/manager.h>
 #include <vfs/path.h>
@@ -48,6 +50,9 @@
 
 rc_t CC Quitting ( void );
 
+#define DELETES_BATCH_ROWS ( 256 * 1024 )
+
+/* the serial scan, used with --disable-multithreading or a single thread */
 static rc_t cigar_loop( const VCursor *cur,
                         uint32_t cigar_idx,
                         int64_t first,
@@ -74,15 +79,149 @@ static rc_t cigar_loop( const VCursor *cur,
             {
                 rc = KOutMsg( "%d rna-splice-candidates at row #%ld : %.*s\n", candidates.count, row_id, row_len, cigar );
             }
+            if ( candidates.cigops != NULL )
+                free( candidates.cigops );
         }
     }
     return rc;
 }
 
 
+/* one worker: has its own cursor, scans one batch of rows per round into its own buffer */
+typedef struct deletes_worker
+{
+    const VCursor *cur;
+    uint32_t cigar_idx;
+    uint32_t min_len;
+    int64_t first;
+    uint64_t count;
+    struct dyn_string * out;   /* dyn_string.h */
+    KThread * thread;
+    rc_t rc;
+} deletes_worker;
+
+
+static rc_t CC deletes_worker_thread( const KThread *self, void *data )
+{
+    deletes_worker * w = data;
+    rc_t rc = 0;
+    int64_t row_id, last_row = ( w->first + w->count );
+
+    for ( row_id = w->first; ( row_id < last_row ) && ( rc == 0 ) && ( Quitting() == 0 ); row_id++ )
+    {
+        const char * cigar;
+        uint32_t row_len;
+        rc = VCursorCellDataDirect ( w->cur, row_id, w->cigar_idx, NULL, ( const void ** )&cigar, NULL, &row_len );
+        if ( rc == 0 )
+        {
+            uint32_t count = count_rna_splicing_candidates( row_len, cigar, w->min_len ); /* cg_tools.c */
+            if ( count > 0 )
+                rc = print_2_dyn_string( w->out, "%d rna-splice-candidates at row #%ld : %.*s\n",
+                                         count, row_id, row_len, cigar );
+        }
+    }
+    w->rc = rc;
+    return rc;
+}
+
+
+static rc_t make_deletes_worker( deletes_worker * w, const VTable *tab, uint32_t min_len )
+{
+    rc_t rc = VTableCreateCursorRead( tab, &w->cur );
+    if ( rc != 0 )
+        (void)LOGERR( klogErr, rc, "cannot open cursor on table PRIMARY_ALIGNMENT" );
+    else
+    {
+        rc = VCursorAddColumn( w->cur, &w->cigar_idx, "CIGAR_SHORT" );
+        if ( rc != 0 )
+            (void)LOGERR( klogErr, rc, "cannot add CIGAR_SHORT to cursor" );
+        else
+        {
+            rc = VCursorOpen( w->cur );
+            if ( rc != 0 )
+                (void)LOGERR( klogErr, rc, "cannot open cursor" );
+        }
+    }
+    if ( rc == 0 )
+        rc = allocated_dyn_string( &w->out, 64 * 1024 );
+    w->min_len = min_len;
+    return rc;
+}
+
+
+static void release_deletes_worker( deletes_worker * w )
+{
+    if ( w->cur != NULL )
+        VCursorRelease( w->cur );
+    if ( w->out != NULL )
+        free_dyn_string( w->out );
+}
+
+
+/* the row-range is cut into batches, each round gives every worker the next batch,
+   the buffered results are printed in row-order when the round is done */
+static rc_t cigar_loop_mt( const VTable *tab,
+                           int64_t first,
+                           uint64_t count,
+                           uint32_t min_len,
+                           uint32_t num_threads )
+{
+    rc_t rc = 0;
+    deletes_worker * workers = calloc( num_threads, sizeof *workers );
+    if ( workers == NULL )
+        rc = RC ( rcApp, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+    else
+    {
+        uint32_t i;
+        int64_t row_id = first, last_row = ( first + count );
+
+        for ( i = 0; i < num_threads && rc == 0; ++i )
+            rc = make_deletes_worker( &workers[ i ], tab, min_len );
+
+        while ( rc == 0 && row_id < last_row && Quitting() == 0 )
+        {
+            uint32_t started;
+            for ( started = 0; started < num_threads && row_id < last_row && rc == 0; ++started )
+            {
+                deletes_worker * w = &workers[ started ];
+                w->first = row_id;
+                w->count = ( last_row - row_id < DELETES_BATCH_ROWS ) ? ( last_row - row_id ) : DELETES_BATCH_ROWS;
+                w->rc = 0;
+                reset_dyn_string( w->out );
+                row_id += w->count;
+                rc = KThreadMake( &w->thread, deletes_worker_thread, w );
+                if ( rc != 0 )
+                    (void)LOGERR( klogErr, rc, "cannot start worker-thread" );
+            }
+            if ( rc != 0 && started > 0 )
+                started--; /* the last one did not start */
+
+            for ( i = 0; i < started; ++i )
+            {
+                deletes_worker * w = &workers[ i ];
+                rc_t status;
+                KThreadWait( w->thread, &status );
+                KThreadRelease( w->thread );
+                w->thread = NULL;
+                if ( rc == 0 )
+                    rc = w->rc;
+                if ( rc == 0 )
+                    rc = print_dyn_string( w->out );
+            }
+        }
+
+        for ( i = 0; i < num_threads; ++i )
+            release_deletes_worker( &workers[ i ] );
+        free( workers );
+    }
+    return rc;
+}
+
+
 static rc_t report_deletes_db( const VDBManager *vdb_mgr,
                                const char * path,
-                               uint32_t min_len )
+                               uint32_t min_len,
+                               uint32_t num_threads )
 {
     const VDatabase *db;
     rc_t rc = VDBManagerOpenDBRead( vdb_mgr, &db, NULL, "%s", path );
@@ -133,7 +272,10 @@ static rc_t report_deletes_db( const VDBManager *vdb_mgr,
                         }
                         else
                         {
-                            rc = cigar_loop( cur, cigar_idx, first, count, min_len );
+                            if ( num_threads > 1 )
+                                rc = cigar_loop_mt( tab, first, count, min_len, num_threads );
+                            else
+                                rc = cigar_loop( cur, cigar_idx, first, count, min_len );
                         }
                     }
                 }
@@ -150,7 +292,8 @@ static rc_t report_deletes_db( const VDBManager *vdb_mgr,
 static rc_t report_deletes_spec( const VDBManager *vdb_mgr,
                                  VFSManager * vfs_mgr,
                                  const char * spec,
-                                 uint32_t min_len )
+                                 uint32_t min_len,
+                                 uint32_t num_threads )
 {
     rc_t rc = KOutMsg( "\nreporting deletes of '%s'\n", spec );
     if ( rc == 0 )
@@ -177,7 +320,7 @@ static rc_t report_deletes_spec( const VDBManager *vdb_mgr,
                 int path_type = ( VDBManagerPathType ( vdb_mgr, "%s", buffer ) & ~ kptAlias );
                 switch( path_type )
                 {
-                    case kptDatabase : rc = report_deletes_db( vdb_mgr, buffer, min_len ); break;
+                    case kptDatabase : rc = report_deletes_db( vdb_mgr, buffer, min_len, num_threads ); break;
 
                     case kptTable    : KOutMsg( "cannot report deletes on a table-object\n" );
                                         rc = RC ( rcApp, rcNoTarg, rcAccessing, rcParam, rcInvalid );
@@ -200,7 +343,7 @@ static rc_t report_deletes_spec( const VDBManager *vdb_mgr,
 }
 
 
-rc_t report_deletes( Args * args, uint32_t min_len )
+rc_t report_deletes( Args * args, uint32_t min_len, uint32_t num_threads )
 {
     uint32_t count;
     rc_t rc = ArgsParamCount( args, &count );
@@ -245,7 +388,7 @@ rc_t report_deletes( Args * args, uint32_t min_len )
                         }
                         else
                         {
-                            rc = report_deletes_spec( vdb_mgr, vfs_mgr, param, min_len );
+                            rc = report_deletes_spec( vdb_mgr, vfs_mgr, param, min_len, num_threads );
                         }
                     }
                     VFSManagerRelease ( vfs_mgr );
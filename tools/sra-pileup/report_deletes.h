@@ -36,6 +36,7 @@ extern "C" {
 #include <kapp/args.h>
 #include <klib/rc.h>
 
-rc_t report_deletes( Args * args, uint32_t min_len );
+/* num_threads > 1 : the rows are scanned in parallel, the output is the same */
+rc_t report_deletes( Args * args, uint32_t min_len, uint32_t num_threads );
 
 #endif
@@ -31,32 +31,58 @@
 #include <kfs/directory.h>
 #include <kfs/file.h>
 
+#include <stdlib.h>
 #include <string.h>
 
 #include "rna_splice_log.h"
 
+/* an open-addressing table of junctions, keyed by ( pos << 32 ) | len:
+   sorting the keys gives the same ( pos, len ) order the log always had */
+
+#define SPLICE_DICT_INITIAL_BITS 12
+#define SPLICE_DICT_EMPTY_KEY 0xFFFFFFFFFFFFFFFF
+#define SPLICE_DICT_FLUSH_MIN ( 64 * 1024 )
+
+typedef struct splice_dict_slot splice_dict_slot;
+struct splice_dict_slot
+{
+    uint64_t key;
+    uint32_t count;
+    uint32_t intron_type;
+};
+
 typedef struct rna_splice_dict rna_splice_dict;
 struct rna_splice_dict
 {
-    KVector * v;
+    splice_dict_slot * slots;
+    uint32_t bits;
+    uint32_t used;
+    uint32_t flush_at;      /* rna_splice_log_flush() does nothing below this count */
 };
 
 
+static splice_dict_slot * make_splice_dict_slots( uint32_t bits )
+{
+    size_t n = ( ( size_t )1 << bits );
+    splice_dict_slot * res = malloc( n * sizeof * res );
+    if ( res != NULL )
+        memset( res, 0xFF, n * sizeof * res );    /* all keys == SPLICE_DICT_EMPTY_KEY */
+    return res;
+}
+
+
 struct rna_splice_dict * make_rna_splice_dict( void )
 {
-    struct rna_splice_dict * res = NULL;
-    KVector * v;
-    rc_t rc = KVectorMake ( &v );
-    if ( rc == 0 )
+    struct rna_splice_dict * res = calloc( 1, sizeof * res );
+    if ( res != NULL )
     {
-        res = calloc( 1, sizeof * res );
-        if ( res != NULL )
-        {
-            res->v = v;
-        }
-        else
+        res->bits = SPLICE_DICT_INITIAL_BITS;
+        res->flush_at = SPLICE_DICT_FLUSH_MIN;
+        res->slots = make_splice_dict_slots( res->bits );
+        if ( res->slots == NULL )
         {
-            KVectorRelease ( v );
+            free( res );
+            res = NULL;
         }
     }
     return res;
@@ -67,30 +93,71 @@ void free_rna_splice_dict( struct rna_splice_dict * dict )
 {
     if ( dict != NULL )
     {
-        KVectorRelease ( dict->v );
+        free( dict->slots );
         free( dict );
     }
 }
 
 
-typedef struct splice_dict_key splice_dict_key;
-struct splice_dict_key
+static uint64_t splice_dict_key( uint32_t pos, uint32_t len )
 {
-    uint32_t len;
-    uint32_t pos;
-};
+    return ( ( ( uint64_t )pos ) << 32 ) | len;
+}
 
-union dict_key_union
+
+/* returns the slot holding key, or the empty slot where it belongs */
+static splice_dict_slot * splice_dict_probe( splice_dict_slot * slots, uint32_t bits, uint64_t key )
 {
-    uint64_t key;
-    splice_dict_key key_struct;
-};
+    uint64_t mask = ( ( ( uint64_t )1 ) << bits ) - 1;
+    uint64_t idx = ( key * 0x9E3779B97F4A7C15ULL ) >> ( 64 - bits );
+    while ( slots[ idx ].key != key && slots[ idx ].key != SPLICE_DICT_EMPTY_KEY )
+        idx = ( idx + 1 ) & mask;
+    return &( slots[ idx ] );
+}
 
-union dict_value_union
+
+static bool splice_dict_grow( struct rna_splice_dict * dict )
 {
-    uint64_t value;
-    splice_dict_entry entry;
-};
+    uint32_t new_bits = dict->bits + 1;
+    splice_dict_slot * new_slots = make_splice_dict_slots( new_bits );
+    bool res = ( new_slots != NULL );
+    if ( res )
+    {
+        size_t i, n = ( ( size_t )1 << dict->bits );
+        for ( i = 0; i < n; ++i )
+        {
+            if ( dict->slots[ i ].key != SPLICE_DICT_EMPTY_KEY )
+                *( splice_dict_probe( new_slots, new_bits, dict->slots[ i ].key ) ) = dict->slots[ i ];
+        }
+        free( dict->slots );
+        dict->slots = new_slots;
+        dict->bits = new_bits;
+    }
+    return res;
+}
+
+
+/* the slot for ( pos, len ), inserted with a count of 0 if it was not there */
+static splice_dict_slot * splice_dict_upsert( struct rna_splice_dict * dict, uint32_t pos, uint32_t len )
+{
+    uint64_t key = splice_dict_key( pos, len );
+    splice_dict_slot * slot = splice_dict_probe( dict->slots, dict->bits, key );
+    if ( slot->key == SPLICE_DICT_EMPTY_KEY )
+    {
+        /* keep the load below 3/4 */
+        if ( ( ( uint64_t )dict->used + 1 ) * 4 > ( ( ( uint64_t )1 ) << dict->bits ) * 3 )
+        {
+            if ( !splice_dict_grow( dict ) )
+                return NULL;
+            slot = splice_dict_probe( dict->slots, dict->bits, key );
+        }
+        slot->key = key;
+        slot->count = 0;
+        slot->intron_type = INTRON_UNKNOWN;
+        dict->used++;
+    }
+    return slot;
+}
 
 
 bool rna_splice_dict_get( struct rna_splice_dict * dict,
@@ -99,18 +166,12 @@ bool rna_splice_dict_get( struct rna_splice_dict * dict,
     bool res = false;
     if ( dict != NULL )
     {
-        rc_t rc;
-        union dict_key_union ku;
-        union dict_value_union vu;
-
-        ku.key_struct.pos = pos;
-        ku.key_struct.len = len;
-        rc = KVectorGetU64 ( dict->v, ku.key, &(vu.value) );
-        res = ( rc == 0 );
+        splice_dict_slot * slot = splice_dict_probe( dict->slots, dict->bits, splice_dict_key( pos, len ) );
+        res = ( slot->key != SPLICE_DICT_EMPTY_KEY );
         if ( res && entry != NULL )
         {
-            entry->count = vu.entry.count;
-            entry->intron_type = vu.entry.intron_type;
+            entry->count = slot->count;
+            entry->intron_type = slot->intron_type;
         }
     }
     return res;
@@ -122,21 +183,44 @@ void rna_splice_dict_set( struct rna_splice_dict * dict,
 {
     if ( dict != NULL && entry != NULL )
     {
-        union dict_key_union ku;
-        union dict_value_union vu;
-
-        ku.key_struct.pos = pos;
-        ku.key_struct.len = len;
-        vu.entry.count = entry->count;
-        vu.entry.intron_type = entry->intron_type;
-        KVectorSetU64 ( dict->v, ku.key, vu.value );
+        splice_dict_slot * slot = splice_dict_upsert( dict, pos, len );
+        if ( slot != NULL )
+        {
+            slot->count = entry->count;
+            slot->intron_type = entry->intron_type;
+        }
+    }
+}
+
+
+void rna_splice_dict_add( struct rna_splice_dict * dict,
+                          uint32_t pos, uint32_t len, uint32_t intron_type )
+{
+    if ( dict != NULL )
+    {
+        splice_dict_slot * slot = splice_dict_upsert( dict, pos, len );
+        if ( slot != NULL )
+        {
+            /* the first observation decides the intron-type */
+            if ( slot->count == 0 )
+                slot->intron_type = intron_type;
+            slot->count++;
+        }
     }
 }
 
 
+uint32_t rna_splice_dict_count( const struct rna_splice_dict * dict )
+{
+    return ( dict != NULL ) ? dict->used : 0;
+}
+
+
 /* --------------------------------------------------------------------------- */
 
 
+#define SPLICE_LOG_BUFSIZE ( 64 * 1024 )
+
 typedef struct rna_splice_log rna_splice_log;
 struct rna_splice_log
 {
@@ -146,6 +230,10 @@ struct rna_splice_log
 
     char ref_name[ 1024 ];
     uint64_t log_file_pos;
+
+    /* the lines are assembled here and written in large chunks */
+    size_t out_len;
+    uint8_t out[ SPLICE_LOG_BUFSIZE ];
 };
 
 
@@ -176,10 +264,26 @@ struct rna_splice_log * make_rna_splice_log( const char * filename, const char *
 }
 
 
+static rc_t write_out_buffer( struct rna_splice_log * sl )
+{
+    rc_t rc = 0;
+    if ( sl->out_len > 0 )
+    {
+        size_t num_writ;
+        rc = KFileWriteAll( sl->log_file, sl->log_file_pos, sl->out, sl->out_len, &num_writ );
+        if ( rc == 0 )
+            sl->log_file_pos += num_writ;
+        sl->out_len = 0;
+    }
+    return rc;
+}
+
+
 void free_rna_splice_log( struct rna_splice_log * sl )
 {
     if ( sl != NULL )
     {
+        write_out_buffer( sl );
         KFileRelease ( sl->log_file );
         if ( sl->tool_name != NULL ) free( ( void * )sl->tool_name );
         free( ( void * ) sl );
@@ -203,65 +307,50 @@ void rna_splice_log_enter_ref( struct rna_splice_log * sl,
 }
 
 
-static void copy_read_and_reverse_complement( uint8_t * dst, const uint8_t * const src, INSDC_coord_len const count )
-{
-    static char const compl[] = {
-         0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
-         0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
-         0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
-         0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
-         0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
-         0 ,  0 ,  0 ,  0 ,  0 ,  0 , '.',  0 , 
-        '0', '1', '2', '3',  0 ,  0 ,  0 ,  0 , 
-         0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
-         0 , 'T', 'V', 'G', 'H',  0 ,  0 , 'C', 
-        'D',  0 ,  0 , 'M',  0 , 'K', 'N',  0 , 
-         0 ,  0 , 'Y', 'S', 'A', 'A', 'B', 'W', 
-         0 , 'R',  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
-         0 , 'T', 'V', 'G', 'H',  0 ,  0 , 'C', 
-        'D',  0 ,  0 , 'M',  0 , 'K', 'N',  0 , 
-         0 ,  0 , 'Y', 'S', 'A', 'A', 'B', 'W', 
-         0 , 'R',  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
-         0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
-         0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
-         0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
-         0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
-         0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
-         0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
-         0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
-         0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
-         0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
-         0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
-         0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
-         0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
-         0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
-         0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
-         0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
-         0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0
-    };
-
-    INSDC_coord_len i, j;
-    
-    for ( i = 0, j = count - 1; i != count; ++i, --j )
-    {
-        dst[ i ] = compl[ src[ j ] ];
-    }
-}
+static const uint8_t compl[] = {
+     0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
+     0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
+     0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
+     0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
+     0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
+     0 ,  0 ,  0 ,  0 ,  0 ,  0 , '.',  0 , 
+    '0', '1', '2', '3',  0 ,  0 ,  0 ,  0 , 
+     0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
+     0 , 'T', 'V', 'G', 'H',  0 ,  0 , 'C', 
+    'D',  0 ,  0 , 'M',  0 , 'K', 'N',  0 , 
+     0 ,  0 , 'Y', 'S', 'A', 'A', 'B', 'W', 
+     0 , 'R',  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
+     0 , 'T', 'V', 'G', 'H',  0 ,  0 , 'C', 
+    'D',  0 ,  0 , 'M',  0 , 'K', 'N',  0 , 
+     0 ,  0 , 'Y', 'S', 'A', 'A', 'B', 'W', 
+     0 , 'R',  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
+     0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
+     0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
+     0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
+     0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
+     0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
+     0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
+     0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
+     0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
+     0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
+     0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
+     0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
+     0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
+     0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
+     0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
+     0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 , 
+     0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0 ,  0
+};
 
 
 #define PRE_POST_LEN 10
 #define EDGE_LEN ( ( PRE_POST_LEN * 2 ) + 2 )
 
+/* the longest line: ref-name, 3 numbers, intron-type, 2 edges */
+#define SPLICE_LOG_MAX_LINE ( 1024 + 64 + ( 2 * ( EDGE_LEN + 5 ) ) )
 
-static rc_t write_to_file( struct rna_splice_log * sl, const uint8_t * src, size_t len )
-{
-    size_t num_writ;
-    rc_t rc = KFileWriteAll( sl->log_file, sl->log_file_pos, src, len, &num_writ );
-    if ( rc == 0 )
-        sl->log_file_pos += num_writ;
-    return rc;
-}
 
+/* appends 'pre <tab> 2 bases <tab> post' to the out-buffer, reverse-complementing on the fly */
 static rc_t print_edge( struct rna_splice_log * sl,
                         INSDC_coord_zero pos,
                         bool const reverse_complement,
@@ -281,33 +370,42 @@ static rc_t print_edge( struct rna_splice_log * sl,
 
     to_read = pre_len + post_len + 2;
     rc = ReferenceObj_Read( sl->ref_obj, rd_pos, to_read, buffer, &from_ref_obj );
+    if ( rc == 0 && from_ref_obj < pre_len + 2 )
+        rc = RC( rcApp, rcNoTarg, rcReading, rcData, rcInsufficient );
     if ( rc == 0 )
     {
-        uint8_t complement[ EDGE_LEN + 1 ];
-        uint8_t to_write[ EDGE_LEN + 5 ];
-        uint8_t * ref_bytes = buffer;
+        uint8_t * dst = &( sl->out[ sl->out_len ] );
 
         if ( from_ref_obj < to_read )
             post_len -= ( to_read - from_ref_obj );
 
         if ( reverse_complement )
         {
-            copy_read_and_reverse_complement( complement, buffer, from_ref_obj );
-            ref_bytes = complement;
+            /* the reverse-complement is read from the end of the buffer backwards */
+            const uint8_t * src = &( buffer[ from_ref_obj - 1 ] );
+            uint32_t i;
+            for ( i = 0; i < pre_len; ++i )
+                *dst++ = compl[ *src-- ];
+            *dst++ = '\t';
+            *dst++ = compl[ *src-- ];
+            *dst++ = compl[ *src-- ];
+            *dst++ = '\t';
+            for ( i = 0; i < post_len; ++i )
+                *dst++ = compl[ *src-- ];
         }
-        memmove( to_write, ref_bytes, pre_len );
-        to_write[ pre_len ] = '\t';
-        to_write[ pre_len + 1 ] = ref_bytes[ pre_len ];
-        to_write[ pre_len + 2 ] = ref_bytes[ pre_len + 1 ];
-        to_write[ pre_len + 3 ] = '\t';
-        memmove( &( to_write[ pre_len + 4 ] ), &( ref_bytes[ pre_len + 2 ] ), post_len );
-
-        if ( add_newline )
-            to_write[ pre_len + post_len + 4 ] = '\n';
         else
-            to_write[ pre_len + post_len + 4 ] = '\t';
-
-        rc = write_to_file( sl, to_write, pre_len + post_len + 5 );
+        {
+            memmove( dst, buffer, pre_len );
+            dst += pre_len;
+            *dst++ = '\t';
+            *dst++ = buffer[ pre_len ];
+            *dst++ = buffer[ pre_len + 1 ];
+            *dst++ = '\t';
+            memmove( dst, &( buffer[ pre_len + 2 ] ), post_len );
+            dst += post_len;
+        }
+        *dst++ = add_newline ? '\n' : '\t';
+        sl->out_len = ( dst - sl->out );
     }
     return rc;
 }
@@ -321,44 +419,104 @@ static rc_t print_edge( struct rna_splice_log * sl,
 
 static const char intron_type_to_ascii[] = { 'u', '+', '-', 'u' };
 
-static rc_t CC on_dict_key_value( uint64_t key, uint64_t value, void * user_data )
+static rc_t print_junction( struct rna_splice_log * sl, const splice_dict_slot * slot )
 {
     rc_t rc = 0;
-    struct rna_splice_log * sl = ( struct rna_splice_log * )user_data;
-    if ( sl != NULL )
-    {
-        char tmp[ 512 ];
-        size_t num_writ;
-        union dict_key_union ku;
-        union dict_value_union vu;
-        char intron;
-        bool reverse_complement;
+    size_t num_writ;
+    uint32_t pos = ( uint32_t )( slot->key >> 32 );
+    uint32_t len = ( uint32_t )( slot->key & 0xFFFFFFFF );
+    char intron = intron_type_to_ascii[ slot->intron_type & 0x03 ];
+    bool reverse_complement = ( ( slot->intron_type & 0x03 ) == INTRON_REV );
 
-        ku.key = key;
-        vu.value = value;
-        intron = intron_type_to_ascii[ vu.entry.intron_type & 0x03 ];
-        reverse_complement = ( ( vu.entry.intron_type & 0x03 ) == INTRON_REV );
+    if ( sl->out_len + SPLICE_LOG_MAX_LINE > sizeof sl->out )
+        rc = write_out_buffer( sl );
 
-        rc = string_printf ( tmp, sizeof tmp, &num_writ,
+    if ( rc == 0 )
+        rc = string_printf ( ( char * )&( sl->out[ sl->out_len ] ), sizeof sl->out - sl->out_len, &num_writ,
                              "%s\t%u\t%u\t%u\t%c\t",
-                             sl->ref_name, ku.key_struct.pos + 1, ku.key_struct.len, vu.entry.count, intron );
+                             sl->ref_name, pos + 1, len, slot->count, intron );
+    if ( rc == 0 )
+        sl->out_len += num_writ;
+
+    if ( reverse_complement )
+    {
+        if ( rc == 0 )
+            rc = print_edge( sl, pos + len - 2, true, false );
+        if ( rc == 0 )
+            rc = print_edge( sl, pos, true, true );
+    }
+    else
+    {
         if ( rc == 0 )
-            rc = write_to_file( sl, ( uint8_t * )tmp, num_writ );
+            rc = print_edge( sl, pos, false, false );
+        if ( rc == 0 )
+            rc = print_edge( sl, pos + len - 2, false, true );
+    }
+    return rc;
+}
 
-        if ( reverse_complement )
+
+static int cmp_splice_dict_slot( const void * a, const void * b )
+{
+    uint64_t ka = ( ( const splice_dict_slot * )a )->key;
+    uint64_t kb = ( ( const splice_dict_slot * )b )->key;
+    return ( ka < kb ) ? -1 : ( ka > kb ) ? 1 : 0;
+}
+
+
+/* writes every junction starting before 'below' in ( pos, len ) order and removes it from the dict */
+static rc_t drain_rna_splice_dict( struct rna_splice_log * sl, struct rna_splice_dict * dict, uint64_t below )
+{
+    rc_t rc = 0;
+    splice_dict_slot * tmp;
+
+    if ( dict->used == 0 )
+        return 0;
+
+    tmp = malloc( dict->used * sizeof * tmp );
+    if ( tmp == NULL )
+        rc = RC( rcApp, rcNoTarg, rcAllocating, rcMemory, rcExhausted );
+    else
+    {
+        /* the junctions to write go to the front of tmp, the ones to keep to the back */
+        size_t i, n = ( ( size_t )1 << dict->bits );
+        uint32_t n_out = 0, n_keep = 0;
+        for ( i = 0; i < n; ++i )
         {
-            if ( rc == 0 )
-                rc = print_edge( sl, ku.key_struct.pos + ku.key_struct.len - 2, true, false );
-            if ( rc == 0 )
-                rc = print_edge( sl, ku.key_struct.pos, true, true );
+            splice_dict_slot * slot = &( dict->slots[ i ] );
+            if ( slot->key != SPLICE_DICT_EMPTY_KEY )
+            {
+                if ( ( slot->key >> 32 ) < below )
+                    tmp[ n_out++ ] = *slot;
+                else
+                    tmp[ dict->used - ( ++n_keep ) ] = *slot;
+                slot->key = SPLICE_DICT_EMPTY_KEY;
+            }
         }
-        else
+        for ( i = 0; i < n_keep; ++i )
         {
-            if ( rc == 0 )
-                rc = print_edge( sl, ku.key_struct.pos, false, false );
-            if ( rc == 0 )
-                rc = print_edge( sl, ku.key_struct.pos + ku.key_struct.len - 2, false, true );
+            splice_dict_slot * kept = &( tmp[ dict->used - 1 - i ] );
+            *( splice_dict_probe( dict->slots, dict->bits, kept->key ) ) = *kept;
         }
+        dict->used = n_keep;
+
+        qsort( tmp, n_out, sizeof * tmp, cmp_splice_dict_slot );
+        for ( i = 0; rc == 0 && i < n_out; ++i )
+            rc = print_junction( sl, &( tmp[ i ] ) );
+        free( tmp );
+    }
+    return rc;
+}
+
+
+rc_t rna_splice_log_flush( struct rna_splice_log * sl, struct rna_splice_dict * dict, uint32_t below_pos )
+{
+    rc_t rc = 0;
+    if ( sl != NULL && dict != NULL && dict->used >= dict->flush_at )
+    {
+        rc = drain_rna_splice_dict( sl, dict, below_pos );
+        /* if a lot is left over ( long introns ) do not rescan it on every window */
+        dict->flush_at = ( dict->used * 2 > SPLICE_DICT_FLUSH_MIN ) ? dict->used * 2 : SPLICE_DICT_FLUSH_MIN;
     }
     return rc;
 }
@@ -368,7 +526,7 @@ void rna_splice_log_exit_ref( struct rna_splice_log * sl, struct rna_splice_dict
 {
     if ( sl != NULL && dict != NULL )
     {
-        KVectorVisitU64 ( dict->v, false, on_dict_key_value, sl );
+        drain_rna_splice_dict( sl, dict, ( ( uint64_t )1 ) << 32 );
+        write_out_buffer( sl );
     }
 }
-
@@ -62,6 +62,14 @@ void rna_splice_dict_set( struct rna_splice_dict * dict,
                           uint32_t len,
                           const splice_dict_entry * entry );
 
+/* count one more observation of ( pos, len ), the first one sets the intron_type */
+void rna_splice_dict_add( struct rna_splice_dict * dict,
+                          uint32_t pos,
+                          uint32_t len,
+                          uint32_t intron_type );
+
+uint32_t rna_splice_dict_count( const struct rna_splice_dict * dict );
+
 /* --------------------------------------------------------------------------- */
 
 
@@ -76,6 +84,12 @@ void rna_splice_log_enter_ref( struct rna_splice_log * sl,
                                const char * ref_name,
                                struct ReferenceObj const * ref_obj );
 
+/* writes and forgets the junctions starting before below_pos, if the dict has grown
+   large enough to be worth it; all later junctions have to start at or after below_pos */
+rc_t rna_splice_log_flush( struct rna_splice_log * sl,
+                           struct rna_splice_dict * dict,
+                           uint32_t below_pos );
+
 void rna_splice_log_exit_ref( struct rna_splice_log * sl,
                               struct rna_splice_dict * dict );
 
@@ -180,6 +180,10 @@ typedef struct align_table_context
 
     /* the common part repeats for evidence-alignment */
     align_cmn_context eval;
+
+    /* sorted, non-overlapping ranges of a region-file: the placement-iterator covers all of them
+       in one window, only alignments starting inside one of them are dumped ( NULL: no filter ) */
+    const Vector * filter;
 } align_table_context;
 
 
@@ -229,6 +233,7 @@ static void init_align_table_context( align_table_context * const atx,
     atx->ref_obj = ref_obj;
     atx->cig_op_buffer = NULL;
     atx->cig_op_buffer_len = 0;
+    atx->filter = NULL;
     invalidate_all_column_idx( atx );
 }
 
@@ -354,6 +359,7 @@ static rc_t prepare_cmn_table_rows( const samdump_opts * const opts,
 static rc_t prepare_prim_sec_table_cursor( const samdump_opts * const opts,
                                            const VDatabase * db,
                                            const char * table_name,
+                                           size_t cache_size,
                                            align_table_context * const atx )
 {
     const VTable *tbl;
@@ -364,10 +370,10 @@ static rc_t prepare_prim_sec_table_cursor( const samdump_opts * const opts,
     }
     else
     {
-        if ( opts->cursor_cache_size == 0 )
+        if ( cache_size == 0 )
             rc = VTableCreateCursorRead( tbl, &atx->cmn.cursor );
         else
-            rc = VTableCreateCachedCursorRead( tbl, &atx->cmn.cursor, opts->cursor_cache_size );
+            rc = VTableCreateCachedCursorRead( tbl, &atx->cmn.cursor, cache_size );
         if ( rc != 0 )
         {
             (void)PLOGERR( klogInt, ( klogInt, rc, "VTableCreateCursorRead( $(tn) ) failed", "tn=%s", table_name ) );
@@ -432,6 +438,7 @@ static rc_t prepare_prim_sec_table_cursor( const samdump_opts * const opts,
 
 static rc_t prepare_sub_ev_alignment_table_cursor( const samdump_opts * const opts,
                                                    const VDatabase * db,
+                                                   size_t cache_size,
                                                    align_table_context * const atx )
 {
     rc_t rc = add_column( atx->cmn.cursor, COL_EV_ALIGNMENTS, &atx->ev_alignments_idx );
@@ -445,10 +452,10 @@ static rc_t prepare_sub_ev_alignment_table_cursor( const samdump_opts * const op
         }
         else
         {
-            if ( opts->cursor_cache_size == 0 )
+            if ( cache_size == 0 )
                 rc = VTableCreateCursorRead( evidence_alignment_tbl, &atx->eval.cursor );
             else
-                rc = VTableCreateCachedCursorRead( evidence_alignment_tbl, &atx->eval.cursor, opts->cursor_cache_size );
+                rc = VTableCreateCachedCursorRead( evidence_alignment_tbl, &atx->eval.cursor, cache_size );
             if ( rc != 0 )
             {
                 (void)PLOGERR( klogInt, ( klogInt, rc, "VTableCreateCursorRead( $(tn) ) failed", "tn=%s", EV_AL_TABLE ) );
@@ -497,6 +504,7 @@ static rc_t prepare_sub_ev_alignment_table_cursor( const samdump_opts * const op
 static rc_t prepare_evidence_table_cursor( const samdump_opts * const opts,
                                            const VDatabase * db,
                                            const char * table_name,
+                                           size_t cache_size,
                                            align_table_context * const atx )
 {
     const VTable *evidence_interval_tbl;
@@ -507,10 +515,10 @@ static rc_t prepare_evidence_table_cursor( const samdump_opts * const opts,
     }
     else
     {
-        if ( opts->cursor_cache_size == 0 )
+        if ( cache_size == 0 )
             rc = VTableCreateCursorRead( evidence_interval_tbl, &atx->cmn.cursor );
         else
-            rc = VTableCreateCachedCursorRead( evidence_interval_tbl, &atx->cmn.cursor, opts->cursor_cache_size );
+            rc = VTableCreateCachedCursorRead( evidence_interval_tbl, &atx->cmn.cursor, cache_size );
         if ( rc != 0 )
         {
             (void)PLOGERR( klogInt, ( klogInt, rc, "VTableCreateCursorRead( $(tn) ) failed", "tn=%s", table_name ) );
@@ -536,7 +544,7 @@ static rc_t prepare_evidence_table_cursor( const samdump_opts * const opts,
                 rc = add_column( atx->cmn.cursor, COL_PLOIDY, &atx->ploidy_idx ); /* read_fkt.c */
 
             if ( rc == 0 && ( opts->dump_cg_sam || opts->dump_cg_ev_dnb ) )
-                rc = prepare_sub_ev_alignment_table_cursor( opts, db, atx );
+                rc = prepare_sub_ev_alignment_table_cursor( opts, db, cache_size, atx );
 
             if ( rc != 0 )
                 VCursorRelease( atx->cmn.cursor );
@@ -556,6 +564,7 @@ static rc_t add_table_pl_iter( const samdump_opts * const opts,
                                const char * spot_group,
                                const char * table_name,
                                align_id_src id_src_selector,
+                               size_t cache_size,
                                Vector * const context_list )
 {
     rc_t rc = 0;
@@ -582,15 +591,15 @@ static rc_t add_table_pl_iter( const samdump_opts * const opts,
             switch( id_src_selector )
             {
                 case primary_align_ids   :  atx->align_table_type = att_primary;
-                                            rc = prepare_prim_sec_table_cursor( opts, idb->db, table_name, atx );
+                                            rc = prepare_prim_sec_table_cursor( opts, idb->db, table_name, cache_size, atx );
                                             break;
 
                 case secondary_align_ids :  atx->align_table_type = att_secondary;
-                                            rc = prepare_prim_sec_table_cursor( opts, idb->db, table_name, atx );
+                                            rc = prepare_prim_sec_table_cursor( opts, idb->db, table_name, cache_size, atx );
                                             break;
 
                 case evidence_align_ids  :  atx->align_table_type = att_evidence;
-                                            rc = prepare_evidence_table_cursor( opts, idb->db, table_name, atx );
+                                            rc = prepare_evidence_table_cursor( opts, idb->db, table_name, cache_size, atx );
                                             break;
             }
         }
@@ -651,6 +660,7 @@ static rc_t add_pl_iters( const samdump_opts * const opts,
                           INSDC_coord_zero ref_pos,
                           INSDC_coord_len ref_len,
                           const char * spot_group,
+                          size_t cache_size,
                           Vector * const context_list )
 {
     KNamelist *tables;
@@ -664,13 +674,13 @@ static rc_t add_pl_iters( const samdump_opts * const opts,
         if ( opts->dump_primary_alignments && namelist_contains( tables, PRIM_TABLE ) ) /* read_fkt.c */
         {
             rc = add_table_pl_iter( opts, set_iter, ref_obj, idb, ref_pos, ref_len, spot_group, 
-                                    PRIM_TABLE, primary_align_ids, context_list );
+                                    PRIM_TABLE, primary_align_ids, cache_size, context_list );
         }
 
         if ( rc == 0 && opts->dump_secondary_alignments && namelist_contains( tables, SEC_TABLE ) )
         {
             rc = add_table_pl_iter( opts, set_iter, ref_obj, idb, ref_pos, ref_len, spot_group, 
-                                    SEC_TABLE, secondary_align_ids, context_list );
+                                    SEC_TABLE, secondary_align_ids, cache_size, context_list );
         }
 
         if ( rc == 0 )
@@ -685,7 +695,7 @@ static rc_t add_pl_iters( const samdump_opts * const opts,
             if ( b0 || b1 )
             {
                 rc = add_table_pl_iter( opts, set_iter, ref_obj, idb, ref_pos, ref_len, spot_group, 
-                                        EV_INT_TABLE, evidence_align_ids, context_list );
+                                        EV_INT_TABLE, evidence_align_ids, cache_size, context_list );
             }
         }
         KNamelistRelease( tables );
@@ -730,6 +740,7 @@ static rc_t prepare_whole_files( const samdump_opts * const opts,
                                 0,                  /* where it starts on the reference */
                                 ref_len,            /* the whole length of this reference/chromosome */
                                 NULL,               /* no spotgroup re-grouping (yet) */
+                                opts->cursor_cache_size,
                                 context_list
                                 );
                         ReferenceObj_Release( ref_obj );
@@ -748,10 +759,63 @@ typedef struct on_region_ctx
     const samdump_opts * opts;
     input_database * idb;
     PlacementSetIterator * set_iter;
+    size_t cache_size;
     Vector *context_list;
 } on_region_ctx;
 
 
+/* binary search in the sorted, non-overlapping ranges of a region-file */
+static bool filter_contains( const Vector * filter, INSDC_coord_zero pos )
+{
+    uint32_t lo = 0, hi = VectorLength( filter );
+    uint64_t p = pos;
+    while ( lo < hi )
+    {
+        uint32_t mid = lo + ( hi - lo ) / 2;
+        const range * r = VectorGet( filter, mid );
+        if ( p < r->start )
+            hi = mid;
+        else if ( p > r->end )
+            lo = mid + 1;
+        else
+            return true;
+    }
+    return false;
+}
+
+
+/* a region-file: one window from the first to the last range of the reference, the contexts
+   made for it filter by the ranges. this walks the reference once instead of making and
+   walking a placement-iterator for each of possibly hundreds of thousands of ranges */
+static bool add_filtered_window( on_region_ctx * rctx, reference_region * ref_rgn, const ReferenceObj * ref_obj )
+{
+    uint32_t range_count = VectorLength( &ref_rgn->ranges );
+    const range * first = VectorGet( &ref_rgn->ranges, 0 );
+    const range * last = VectorGet( &ref_rgn->ranges, range_count - 1 );
+    uint32_t ctx_idx, ctx_count;
+
+    /* 'whole reference' from the command-line: walk it as before */
+    if ( rctx->opts->region_file == NULL || range_count < 2 || first->whole )
+        return false;
+
+    ctx_count = VectorLength( rctx->context_list );
+    rctx->rc = add_pl_iters( rctx->opts, rctx->set_iter, ref_obj, rctx->idb,
+        first->start,                       /* where the first range starts on the reference */
+        last->end - first->start + 1,       /* up to the end of the last range */
+        NULL,                               /* no spotgroup re-grouping (yet) */
+        rctx->cache_size,
+        rctx->context_list
+        );
+    for ( ctx_idx = ctx_count; ctx_idx < VectorLength( rctx->context_list ); ++ctx_idx )
+    {
+        align_table_context * atx = VectorGet( rctx->context_list, ctx_idx );
+        if ( atx != NULL )
+            atx->filter = &ref_rgn->ranges;
+    }
+    return true;
+}
+
+
 static void CC on_region( BSTNode *n, void *data )
 {
     on_region_ctx * rctx = data;
@@ -760,7 +824,9 @@ static void CC on_region( BSTNode *n, void *data )
         reference_region * ref_rgn = ( reference_region * )n;
         const ReferenceObj * ref_obj;
         rctx->rc = ReferenceList_Find( rctx->idb->reflist, &ref_obj, ref_rgn->name, string_size( ref_rgn->name ) );
-        if ( rctx->rc == 0 )
+        if ( rctx->rc == 0 && add_filtered_window( rctx, ref_rgn, ref_obj ) )
+            ReferenceObj_Release( ref_obj );
+        else if ( rctx->rc == 0 )
         {
             uint32_t range_idx, range_count = VectorLength( &ref_rgn->ranges );
             for ( range_idx = 0; range_idx < range_count && rctx->rc == 0; ++range_idx )
@@ -769,7 +835,7 @@ static void CC on_region( BSTNode *n, void *data )
                 if ( r != NULL )
                 {
                     INSDC_coord_len len;
-                    if ( r->start == 0 && r->end == 0 )
+                    if ( r->whole )
                     {
                         r->start = 1;
                         rctx->rc = ReferenceObj_SeqLength( ref_obj, &len );
@@ -786,6 +852,7 @@ static void CC on_region( BSTNode *n, void *data )
                             r->start,           /* where the range starts on the reference */
                             len,                /* the length of this range */
                             NULL,               /* no spotgroup re-grouping (yet) */
+                            rctx->cache_size,
                             rctx->context_list
                             );
                     }
@@ -812,6 +879,7 @@ static rc_t prepare_regions( const samdump_opts * const opts,
     rctx.rc = 0;
     rctx.opts = opts;
     rctx.set_iter = set_iter;
+    rctx.cache_size = opts->cursor_cache_size;
     rctx.context_list = context_list;
     /* we now loop through all input-databases... */
     for ( db_idx = 0; db_idx < ifs->database_count && rctx.rc == 0; ++db_idx )
@@ -1463,6 +1531,7 @@ static rc_t print_alignment_sam_ps( const samdump_opts * const opts,
                                     INSDC_coord_zero pos,
                                     matecache * const mc,
                                     struct rna_splice_dict * splice_dict,
+                                    struct md_ref_cache * md_cache,
                                     const PlacementRecord * const rec,
                                     const align_table_context * const atx )
 {
@@ -1688,19 +1757,8 @@ static rc_t print_alignment_sam_ps( const samdump_opts * const opts,
                     for ( c_idx = 0; c_idx < candidates.count; c_idx++ )
                     {
                         rna_splice_candidate * candidate = &( candidates.candidates[ c_idx ] );
-                        splice_dict_entry entry;
                         uint32_t intron_pos = pos + candidate->ref_offset;
-                        if ( rna_splice_dict_get( splice_dict, intron_pos, candidate->len, &entry ) )
-                        {
-                            entry.count += 1;
-                            rna_splice_dict_set( splice_dict, intron_pos, candidate->len, &entry );
-                        }
-                        else
-                        {
-                            entry.count = 1;
-                            entry.intron_type = candidate->matched;
-                            rna_splice_dict_set( splice_dict, intron_pos, candidate->len, &entry );
-                        }
+                        rna_splice_dict_add( splice_dict, intron_pos, candidate->len, candidate->matched );
                     }
                 }
 
@@ -1824,20 +1882,14 @@ static rc_t print_alignment_sam_ps( const samdump_opts * const opts,
     /* OPT SAM_FIELD: MD    reports Mismatches and Deletions */
     if ( rc == 0 && opts->with_md_flag )
     {
-        uint8_t * alig_ref = malloc( rec->len );
-        if ( alig_ref == NULL )
-            rc = RC( rcExe, rcNoTarg, rcAllocating, rcMemory, rcExhausted );
-        else
+        const uint8_t * alig_ref;
+        INSDC_coord_len ref_len;
+        rc = md_ref_cache_get( md_cache, rec->ref, pos, rec->len, &alig_ref, &ref_len );
+        if ( rc == 0 )
         {
-            INSDC_coord_len ref_len;
-            rc = ReferenceObj_Read( rec->ref, pos, rec->len, alig_ref, &ref_len );
-            if ( rc == 0 )
-            {
-                rc = kout_md_tag_from_cigar_string( cgc_output.p_cigar.ptr, cgc_output.p_cigar.len, /* cigar */
-                        cgc_output.p_read.ptr, cgc_output.p_read.len,                               /* read */
-                        alig_ref, ref_len );                                                        /* reference */
-            }
-            free( alig_ref );
+            rc = kout_md_tag_from_cigar_string( cgc_output.p_cigar.ptr, cgc_output.p_cigar.len, /* cigar */
+                    cgc_output.p_read.ptr, cgc_output.p_read.len,                               /* read */
+                    alig_ref, ref_len );                                                        /* reference */
         }
     }
     
@@ -1984,6 +2036,7 @@ static rc_t walk_position( const samdump_opts * const opts,
                            INSDC_coord_zero pos,
                            matecache * const mc,
                            struct rna_splice_dict * splice_dict,
+                           struct md_ref_cache * md_cache,
                            INSDC_coord_zero first_pos,
                            INSDC_coord_len len )
 {
@@ -2021,6 +2074,10 @@ static rc_t walk_position( const samdump_opts * const opts,
                         rc = RC( rcExe, rcNoTarg, rcReading, rcParam, rcNull );
                         LOGERR( klogInt, rc, "no placement-record-context available" );
                     }
+                    else if ( atx->filter != NULL && !filter_contains( atx->filter, pos ) )
+                    {
+                        /* starts in a gap between the ranges of a region-file */
+                    }
                     else
                     {
                         if ( opts->output_format == of_sam )
@@ -2028,7 +2085,7 @@ static rc_t walk_position( const samdump_opts * const opts,
                             if ( atx->align_table_type == att_evidence )
                                 rc = print_alignment_sam_ev( opts, ref_name, pos, rec, atx );
                             else
-                                rc = print_alignment_sam_ps( opts, ref_name, pos, mc, splice_dict, rec, atx );
+                                rc = print_alignment_sam_ps( opts, ref_name, pos, mc, splice_dict, md_cache, rec, atx );
                         }
                         else
                             rc = print_alignment_fastx( opts, ref_name, pos, mc, rec, atx );
@@ -2050,6 +2107,7 @@ static rc_t walk_window( const samdump_opts * const opts,
                          const char * ref_name,
                          matecache * const mc,
                          struct rna_splice_dict * splice_dict,
+                         struct md_ref_cache * md_cache,
                          INSDC_coord_zero first_pos,
                          INSDC_coord_len len )
 {
@@ -2070,7 +2128,7 @@ static rc_t walk_window( const samdump_opts * const opts,
             }
             else
             {
-                rc = walk_position( opts, set_iter, ref_name, pos, mc, splice_dict, first_pos, len );
+                rc = walk_position( opts, set_iter, ref_name, pos, mc, splice_dict, md_cache, first_pos, len );
             }
         }
     }
@@ -2079,23 +2137,96 @@ static rc_t walk_window( const samdump_opts * const opts,
 }
 
 
-static rc_t walk_reference( const samdump_opts * const opts,
-                            PlacementSetIterator * const set_iter,
+/* what is kept while the windows of one reference are walked */
+typedef struct ref_walk_ctx
+{
+    struct rna_splice_dict * splice_dict;
+    struct md_ref_cache * md_cache;
+    INSDC_coord_zero flushed_below;
+    bool flush_splice_dict;
+} ref_walk_ctx;
+
+
+static rc_t enter_ref_walk( const samdump_opts * const opts,
+                            ref_walk_ctx * rw,
                             struct ReferenceObj const * ref_obj,
-                            const char * ref_name,
-                            matecache * const mc )
+                            const char * ref_name )
 {
     rc_t rc = 0;
-    struct rna_splice_dict * splice_dict = NULL;
+    rw->splice_dict = NULL;
+    rw->md_cache = NULL;
+    rw->flushed_below = 0;
+    rw->flush_splice_dict = true;
 
     if ( opts->rna_splicing )
     {
-        splice_dict = make_rna_splice_dict();
+        rw->splice_dict = make_rna_splice_dict();
         /* rna-splice-log */
         if ( opts->rna_splice_log != NULL )
             rna_splice_log_enter_ref( opts->rna_splice_log, ref_name, ref_obj );
     }
 
+    if ( opts->with_md_flag )
+    {
+        rw->md_cache = make_md_ref_cache();
+        if ( rw->md_cache == NULL )
+            rc = RC( rcExe, rcNoTarg, rcAllocating, rcMemory, rcExhausted );
+    }
+    return rc;
+}
+
+
+static rc_t enter_ref_window( const samdump_opts * const opts,
+                              ref_walk_ctx * rw,
+                              INSDC_coord_zero first_pos )
+{
+    rc_t rc = 0;
+    /* rna-splice-log: alignments of this and later windows start at first_pos or after,
+       junctions before it are finished - as long as the windows come in order */
+    if ( rw->splice_dict != NULL && opts->rna_splice_log != NULL && rw->flush_splice_dict )
+    {
+        if ( first_pos < rw->flushed_below )
+            rw->flush_splice_dict = false;
+        else
+        {
+            rw->flushed_below = first_pos;
+            rc = rna_splice_log_flush( opts->rna_splice_log, rw->splice_dict, first_pos );
+        }
+    }
+    return rc;
+}
+
+
+static rc_t exit_ref_walk( const samdump_opts * const opts,
+                           ref_walk_ctx * rw,
+                           matecache * const mc,
+                           rc_t rc )
+{
+    if ( rc == 0 && mc != NULL && opts->use_mate_cache )
+        rc = matecache_clear_same_ref( mc );
+
+    if ( rw->splice_dict != NULL )
+    {
+        /* rna-splice-log */
+        if ( opts->rna_splice_log != NULL )
+            rna_splice_log_exit_ref( opts->rna_splice_log, rw->splice_dict );
+        free_rna_splice_dict( rw->splice_dict );
+    }
+    free_md_ref_cache( rw->md_cache );
+
+    return rc;
+}
+
+
+static rc_t walk_reference( const samdump_opts * const opts,
+                            PlacementSetIterator * const set_iter,
+                            struct ReferenceObj const * ref_obj,
+                            const char * ref_name,
+                            matecache * const mc )
+{
+    ref_walk_ctx rw;
+    rc_t rc = enter_ref_walk( opts, &rw, ref_obj, ref_name );
+
     while ( rc == 0 )
     {
         rc = Quitting ();
@@ -2112,22 +2243,40 @@ static rc_t walk_reference( const samdump_opts * const opts,
                 }
             }
             else
-                rc = walk_window( opts, set_iter, ref_name, mc, splice_dict, first_pos, len );
+            {
+                rc = enter_ref_window( opts, &rw, first_pos );
+                if ( rc == 0 )
+                    rc = walk_window( opts, set_iter, ref_name, mc, rw.splice_dict, rw.md_cache, first_pos, len );
+            }
         }
     }
     if ( GetRCState( rc ) == rcDone ) rc = 0;
 
-    if ( rc == 0 && mc != NULL && opts->use_mate_cache )
-        rc = matecache_clear_same_ref( mc );
+    return exit_ref_walk( opts, &rw, mc, rc );
+}
+
 
-    if ( splice_dict != NULL )
+static rc_t get_ref_name( const samdump_opts * const opts,
+                          struct ReferenceObj const * ref_obj,
+                          const char ** ref_name )
+{
+    rc_t rc;
+    if ( opts->use_seqid_as_refname )
     {
-        /* rna-splice-log */
-        if ( opts->rna_splice_log != NULL )
-            rna_splice_log_exit_ref( opts->rna_splice_log, splice_dict );
-        free_rna_splice_dict( splice_dict );
+        rc = ReferenceObj_SeqId( ref_obj, ref_name );
+        if ( rc != 0 )
+        {
+            (void)LOGERR( klogInt, rc, "ReferenceObj_SeqId() failed" );
+        }
+    }
+    else
+    {
+        rc = ReferenceObj_Name( ref_obj, ref_name );
+        if ( rc != 0 )
+        {
+            (void)LOGERR( klogInt, rc, "ReferenceObj_Name() failed" );
+        }
     }
-
     return rc;
 }
 
@@ -2147,11 +2296,7 @@ static rc_t walk_placements( const samdump_opts * const opts,
             if ( ref_obj != NULL )
             {
                 const char * ref_name = NULL;
-                if ( opts->use_seqid_as_refname )
-                    rc = ReferenceObj_SeqId( ref_obj, &ref_name );
-                else
-                    rc = ReferenceObj_Name( ref_obj, &ref_name );
-
+                rc = get_ref_name( opts, ref_obj, &ref_name );
                 if ( rc == 0 )
                 {
 #if _DEBUGGING
@@ -2166,17 +2311,6 @@ static rc_t walk_placements( const samdump_opts * const opts,
                         perf_log_end_sub_section( opts->perf_log );
 #endif
                 }
-                else
-                {
-                    if ( opts->use_seqid_as_refname )
-                    {
-                        (void)LOGERR( klogInt, rc, "ReferenceObj_SeqId() failed" );
-                    }
-                    else
-                    {
-                        (void)LOGERR( klogInt, rc, "ReferenceObj_Name() failed" );
-                    }
-                }
             }
         }
         else if ( GetRCState( rc ) != rcDone )
@@ -2227,6 +2361,7 @@ static rc_t print_all_aligned_spots_of_this_reference( const samdump_opts * cons
                 0,                  /* where it starts on the reference */
                 ref_len,            /* the whole length of this reference/chromosome */
                 NULL,               /* no spotgroup re-grouping (yet) */
+                opts->cursor_cache_size,
                 &context_list
                 );
             if ( rc == 0 )
@@ -2358,6 +2493,539 @@ static rc_t print_selected_aligned_spots( const samdump_opts * const opts,
 }
 
 
+/*
+   strategy #3 for many input-files: one reference at a time, every input-file that has it gets
+   a placement-set-iterator of its own, these are merged by position through a min-heap
+    + ... sorted output like strategy #2, but only the cursors for one reference are open
+    + ... all inputs share one cursor-cache budget, instead of each one having it for itself
+*/
+
+/* one input-file in the merge: its set-iter for the current reference and its current window */
+typedef struct merge_input
+{
+    PlacementSetIterator * set_iter;
+    struct ReferenceObj const * ref_obj;
+    INSDC_coord_zero first_pos;
+    INSDC_coord_len len;
+    INSDC_coord_zero pos;       /* the next position in the window with placements */
+    uint32_t idx;               /* the order of the input-file, breaks ties on the same position */
+    bool has_window;
+    struct md_ref_cache * md_cache; /* an input of its own: each one has a ReferenceObj of its own */
+} merge_input;
+
+
+typedef struct merge_ctx
+{
+    merge_input * inputs;       /* one for every input-file that has the current reference */
+    merge_input ** heap;        /* the inputs of the current window, keyed on ( pos, idx ) */
+    uint32_t count;
+    uint32_t heap_size;
+    Vector context_list;
+} merge_ctx;
+
+
+static bool merge_input_less( const merge_input * a, const merge_input * b )
+{
+    return ( a->pos < b->pos || ( a->pos == b->pos && a->idx < b->idx ) );
+}
+
+
+static void merge_heap_sift_down( merge_ctx * mctx, uint32_t i )
+{
+    merge_input ** heap = mctx->heap;
+    for ( ;; )
+    {
+        uint32_t smallest = i;
+        uint32_t l = 2 * i + 1;
+        uint32_t r = l + 1;
+        if ( l < mctx->heap_size && merge_input_less( heap[ l ], heap[ smallest ] ) )
+            smallest = l;
+        if ( r < mctx->heap_size && merge_input_less( heap[ r ], heap[ smallest ] ) )
+            smallest = r;
+        if ( smallest == i )
+            break;
+        else
+        {
+            merge_input * tmp = heap[ i ];
+            heap[ i ] = heap[ smallest ];
+            heap[ smallest ] = tmp;
+            i = smallest;
+        }
+    }
+}
+
+
+static void merge_heap_push( merge_ctx * mctx, merge_input * mi )
+{
+    merge_input ** heap = mctx->heap;
+    uint32_t i = mctx->heap_size++;
+    heap[ i ] = mi;
+    while ( i > 0 && merge_input_less( heap[ i ], heap[ ( i - 1 ) / 2 ] ) )
+    {
+        uint32_t parent = ( i - 1 ) / 2;
+        heap[ i ] = heap[ parent ];
+        heap[ parent ] = mi;
+        i = parent;
+    }
+}
+
+
+/* the next position of the input on top of the heap, it leaves the heap at the end of its window */
+static rc_t merge_heap_advance( merge_ctx * mctx )
+{
+    merge_input * top = mctx->heap[ 0 ];
+    rc_t rc = PlacementSetIteratorNextAvailPos( top->set_iter, &top->pos, NULL );
+    if ( rc != 0 )
+    {
+        if ( GetRCState( rc ) != rcDone )
+        {
+            LOGERR( klogInt, rc, "PlacementSetIteratorNextAvailPos() failed" );
+        }
+        else
+        {
+            rc = 0;
+            mctx->heap[ 0 ] = mctx->heap[ --mctx->heap_size ];
+        }
+    }
+    if ( rc == 0 )
+        merge_heap_sift_down( mctx, 0 );
+    return rc;
+}
+
+
+static rc_t merge_input_next_window( merge_input * mi )
+{
+    rc_t rc = PlacementSetIteratorNextWindow( mi->set_iter, &mi->first_pos, &mi->len );
+    mi->has_window = ( rc == 0 );
+    if ( rc != 0 )
+    {
+        if ( GetRCState( rc ) != rcDone )
+        {
+            LOGERR( klogInt, rc, "PlacementSetIteratorNextWindow() failed" );
+        }
+        else
+            rc = 0;
+    }
+    return rc;
+}
+
+
+/* all inputs that have this window walk it together, position by position in the order of the heap */
+static rc_t walk_merged_window( const samdump_opts * const opts,
+                                merge_ctx * mctx,
+                                const char * ref_name,
+                                matecache * const mc,
+                                ref_walk_ctx * rw,
+                                INSDC_coord_zero first_pos,
+                                INSDC_coord_len len )
+{
+    rc_t rc = 0;
+    uint32_t idx;
+
+    mctx->heap_size = 0;
+    for ( idx = 0; idx < mctx->count && rc == 0; ++idx )
+    {
+        merge_input * mi = &mctx->inputs[ idx ];
+        if ( mi->has_window && mi->first_pos == first_pos && mi->len == len )
+        {
+            rc = PlacementSetIteratorNextAvailPos( mi->set_iter, &mi->pos, NULL );
+            if ( rc == 0 )
+                merge_heap_push( mctx, mi );
+            else if ( GetRCState( rc ) == rcDone )
+                rc = 0;
+            else
+            {
+                LOGERR( klogInt, rc, "PlacementSetIteratorNextAvailPos() failed" );
+            }
+        }
+    }
+
+    while ( rc == 0 && mctx->heap_size > 0 )
+    {
+        rc = Quitting ();
+        if ( rc == 0 )
+        {
+            merge_input * top = mctx->heap[ 0 ];
+            rc = walk_position( opts, top->set_iter, ref_name, top->pos, mc,
+                                rw->splice_dict, top->md_cache, first_pos, len );
+            if ( rc == 0 )
+                rc = merge_heap_advance( mctx );
+        }
+    }
+
+    /* the inputs of this window move on to their next one */
+    for ( idx = 0; idx < mctx->count && rc == 0; ++idx )
+    {
+        merge_input * mi = &mctx->inputs[ idx ];
+        if ( mi->has_window && mi->first_pos == first_pos && mi->len == len )
+            rc = merge_input_next_window( mi );
+    }
+    return rc;
+}
+
+
+static rc_t walk_merged_reference( const samdump_opts * const opts,
+                                   merge_ctx * mctx,
+                                   struct ReferenceObj const * ref_obj,
+                                   const char * ref_name,
+                                   matecache * const mc )
+{
+    ref_walk_ctx rw;
+    uint32_t idx;
+    rc_t rc = enter_ref_walk( opts, &rw, ref_obj, ref_name );
+
+    for ( idx = 0; idx < mctx->count && rc == 0; ++idx )
+    {
+        merge_input * mi = &mctx->inputs[ idx ];
+        if ( mi->ref_obj != NULL )
+            rc = merge_input_next_window( mi );
+    }
+
+    while ( rc == 0 )
+    {
+        rc = Quitting ();
+        if ( rc == 0 )
+        {
+            /* the window that comes first among the inputs, the same one in all of them most of the time */
+            const merge_input * first = NULL;
+            for ( idx = 0; idx < mctx->count; ++idx )
+            {
+                const merge_input * mi = &mctx->inputs[ idx ];
+                if ( mi->has_window &&
+                     ( first == NULL || mi->first_pos < first->first_pos ||
+                       ( mi->first_pos == first->first_pos && mi->len < first->len ) ) )
+                    first = mi;
+            }
+            if ( first == NULL )
+                break;
+            else
+            {
+                INSDC_coord_zero first_pos = first->first_pos;
+                INSDC_coord_len len = first->len;
+                rc = enter_ref_window( opts, &rw, first_pos );
+                if ( rc == 0 )
+                    rc = walk_merged_window( opts, mctx, ref_name, mc, &rw, first_pos, len );
+            }
+        }
+    }
+
+    return exit_ref_walk( opts, &rw, mc, rc );
+}
+
+
+static rc_t merge_ctx_add_input( merge_ctx * mctx,
+                                 const AlignMgr * const a_mgr,
+                                 uint32_t idx,
+                                 PlacementSetIterator ** set_iter )
+{
+    merge_input * mi = &mctx->inputs[ mctx->count ];
+    rc_t rc = AlignMgrMakePlacementSetIterator( a_mgr, &mi->set_iter );
+    if ( rc != 0 )
+    {
+        (void)LOGERR( klogErr, rc, "cannot create PlacementSetIterator" );
+    }
+    else
+    {
+        mi->ref_obj = NULL;
+        mi->idx = idx;
+        mi->has_window = false;
+        mctx->count++;
+        *set_iter = mi->set_iter;
+    }
+    return rc;
+}
+
+
+/* closes the cursors and releases the set-iters of the current reference */
+static void merge_ctx_clear( merge_ctx * mctx )
+{
+    uint32_t idx;
+    VectorWhack ( &mctx->context_list, destroy_align_table_context, NULL );
+    VectorInit ( &mctx->context_list, 0, 5 );
+    for ( idx = 0; idx < mctx->count; ++idx )
+        PlacementSetIteratorRelease( mctx->inputs[ idx ].set_iter );
+    mctx->count = 0;
+}
+
+
+/* every input has placements for at most one reference, the first one that has some names it */
+static rc_t walk_merged_inputs( const samdump_opts * const opts,
+                                merge_ctx * mctx,
+                                matecache * const mc )
+{
+    rc_t rc = 0;
+    uint32_t idx;
+    struct ReferenceObj const * ref_obj = NULL;
+
+    for ( idx = 0; idx < mctx->count && rc == 0; ++idx )
+    {
+        merge_input * mi = &mctx->inputs[ idx ];
+        rc = PlacementSetIteratorNextReference( mi->set_iter, NULL, NULL, &mi->ref_obj );
+        if ( rc != 0 )
+        {
+            mi->ref_obj = NULL;
+            if ( GetRCState( rc ) == rcDone )
+                rc = 0;
+            else
+            {
+                (void)LOGERR( klogInt, rc, "ReferenceIteratorNextReference() failed" );
+            }
+        }
+        else if ( ref_obj == NULL )
+            ref_obj = mi->ref_obj;
+    }
+
+    if ( rc == 0 && ref_obj != NULL )
+    {
+        const char * ref_name = NULL;
+        rc = get_ref_name( opts, ref_obj, &ref_name );
+        if ( rc == 0 )
+        {
+#if _DEBUGGING
+            if ( opts->perf_log != NULL )
+                perf_log_start_sub_section( opts->perf_log, ref_name );
+#endif
+
+            rc = walk_merged_reference( opts, mctx, ref_obj, ref_name, mc );
+
+#if _DEBUGGING
+            if ( opts->perf_log != NULL )
+                perf_log_end_sub_section( opts->perf_log );
+#endif
+        }
+    }
+    return rc;
+}
+
+
+/* the inputs share the cursor-cache: each one gets its part of it, but not less than a minimum */
+#define MERGE_MIN_CURSOR_CACHE ( 1024 * 1024 )
+
+static size_t merge_cursor_cache_size( const samdump_opts * const opts, const input_files * const ifs )
+{
+    size_t res = opts->cursor_cache_size;
+    if ( res > 0 && ifs->database_count > 1 )
+    {
+        res /= ifs->database_count;
+        if ( res < MERGE_MIN_CURSOR_CACHE )
+            res = ( opts->cursor_cache_size < MERGE_MIN_CURSOR_CACHE ) ? opts->cursor_cache_size : MERGE_MIN_CURSOR_CACHE;
+    }
+    return res;
+}
+
+
+static bool ref_in_earlier_input( const input_files * const ifs, uint32_t db_idx, const char * seq_id )
+{
+    uint32_t idx;
+    for ( idx = 0; idx < db_idx; ++idx )
+    {
+        const input_database * idb = VectorGet( &ifs->dbs, idx );
+        if ( idb != NULL )
+        {
+            const ReferenceObj * ref_obj;
+            if ( ReferenceList_Find( idb->reflist, &ref_obj, seq_id, string_size( seq_id ) ) == 0 )
+            {
+                ReferenceObj_Release( ref_obj );
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+
+/* one reference, named by its seq-id, in all input-files that have it */
+static rc_t print_merged_reference( const samdump_opts * const opts,
+                                    const input_files * const ifs,
+                                    matecache * const mc,
+                                    const AlignMgr * const a_mgr,
+                                    merge_ctx * mctx,
+                                    size_t cache_size,
+                                    const char * seq_id )
+{
+    rc_t rc = 0;
+    uint32_t db_idx;
+    for ( db_idx = 0; db_idx < ifs->database_count && rc == 0; ++db_idx )
+    {
+        const input_database * idb = VectorGet( &ifs->dbs, db_idx );
+        const ReferenceObj * ref_obj;
+        if ( idb != NULL &&
+             ReferenceList_Find( idb->reflist, &ref_obj, seq_id, string_size( seq_id ) ) == 0 )
+        {
+            INSDC_coord_len ref_len;
+            PlacementSetIterator * set_iter;
+            rc = ReferenceObj_SeqLength( ref_obj, &ref_len );
+            if ( rc == 0 )
+                rc = merge_ctx_add_input( mctx, a_mgr, db_idx, &set_iter );
+            if ( rc == 0 )
+                rc = add_pl_iters( opts, set_iter, ref_obj, idb,
+                    0,                  /* where it starts on the reference */
+                    ref_len,            /* the whole length of this reference/chromosome */
+                    NULL,               /* no spotgroup re-grouping (yet) */
+                    cache_size,
+                    &mctx->context_list
+                    );
+            ReferenceObj_Release( ref_obj );
+        }
+    }
+    if ( rc == 0 )
+        rc = walk_merged_inputs( opts, mctx, mc );
+    merge_ctx_clear( mctx );
+    return rc;
+}
+
+
+static rc_t print_merged_whole_files( const samdump_opts * const opts,
+                                      const input_files * const ifs,
+                                      matecache * const mc,
+                                      const AlignMgr * const a_mgr,
+                                      merge_ctx * mctx )
+{
+    rc_t rc = 0;
+    size_t cache_size = merge_cursor_cache_size( opts, ifs );
+    uint32_t db_idx;
+    /* the references in the order they first appear in the input-files, like strategy #2 */
+    for ( db_idx = 0; db_idx < ifs->database_count && rc == 0; ++db_idx )
+    {
+        const input_database * idb = VectorGet( &ifs->dbs, db_idx );
+        if ( idb != NULL )
+        {
+            uint32_t refobj_count;
+            rc = ReferenceList_Count( idb->reflist, &refobj_count );
+            if ( rc == 0 && refobj_count > 0 )
+            {
+                uint32_t ref_idx;
+                for ( ref_idx = 0; ref_idx < refobj_count && rc == 0; ++ref_idx )
+                {
+                    const ReferenceObj * ref_obj;
+                    rc = ReferenceList_Get( idb->reflist, &ref_obj, ref_idx );
+                    if ( rc == 0 && ref_obj != NULL )
+                    {
+                        const char * seq_id;
+                        rc = ReferenceObj_SeqId( ref_obj, &seq_id );
+                        if ( rc == 0 && !ref_in_earlier_input( ifs, db_idx, seq_id ) )
+                            rc = print_merged_reference( opts, ifs, mc, a_mgr, mctx, cache_size, seq_id );
+                        ReferenceObj_Release( ref_obj );
+                    }
+                }
+            }
+        }
+    }
+    return rc;
+}
+
+
+typedef struct on_merged_region_ctx
+{
+    rc_t rc;
+    const samdump_opts * opts;
+    const input_files * ifs;
+    matecache * mc;
+    const AlignMgr * a_mgr;
+    merge_ctx * mctx;
+    size_t cache_size;
+} on_merged_region_ctx;
+
+
+static void CC on_merged_region( BSTNode *n, void *data )
+{
+    on_merged_region_ctx * mrctx = data;
+    if ( mrctx->rc == 0 )
+    {
+        on_region_ctx rctx;
+        uint32_t db_idx;
+
+        rctx.rc = 0;
+        rctx.opts = mrctx->opts;
+        rctx.cache_size = mrctx->cache_size;
+        rctx.context_list = &mrctx->mctx->context_list;
+        for ( db_idx = 0; db_idx < mrctx->ifs->database_count && rctx.rc == 0; ++db_idx )
+        {
+            rctx.idb = VectorGet( &mrctx->ifs->dbs, db_idx );
+            if ( rctx.idb != NULL )
+            {
+                rctx.rc = merge_ctx_add_input( mrctx->mctx, mrctx->a_mgr, db_idx, &rctx.set_iter );
+                if ( rctx.rc == 0 )
+                    on_region( n, &rctx );
+            }
+        }
+        if ( rctx.rc == 0 )
+            rctx.rc = walk_merged_inputs( mrctx->opts, mrctx->mctx, mrctx->mc );
+        merge_ctx_clear( mrctx->mctx );
+        mrctx->rc = rctx.rc;
+    }
+}
+
+
+static rc_t print_merged_regions( const samdump_opts * const opts,
+                                  const input_files * const ifs,
+                                  matecache * const mc,
+                                  const AlignMgr * const a_mgr,
+                                  merge_ctx * mctx )
+{
+    on_merged_region_ctx mrctx;
+
+    mrctx.rc = 0;
+    mrctx.opts = opts;
+    mrctx.ifs = ifs;
+    mrctx.mc = mc;
+    mrctx.a_mgr = a_mgr;
+    mrctx.mctx = mctx;
+    mrctx.cache_size = merge_cursor_cache_size( opts, ifs );
+    BSTreeForEach( ( BSTree * ) &opts->regions, false, on_merged_region, &mrctx );
+    return mrctx.rc;
+}
+
+
+static rc_t print_merged_aligned_spots( const samdump_opts * const opts,
+                                        const input_files * const ifs,
+                                        matecache * const mc,
+                                        const AlignMgr * const a_mgr )
+{
+    rc_t rc = 0;
+    merge_ctx mctx;
+
+    mctx.count = 0;
+    mctx.heap_size = 0;
+    mctx.inputs = calloc( ifs->database_count + 1, sizeof mctx.inputs[ 0 ] );
+    mctx.heap = calloc( ifs->database_count + 1, sizeof mctx.heap[ 0 ] );
+    if ( mctx.inputs == NULL || mctx.heap == NULL )
+    {
+        rc = RC( rcExe, rcNoTarg, rcAllocating, rcMemory, rcExhausted );
+        (void)LOGERR( klogErr, rc, "cannot allocate the inputs of the merge" );
+    }
+    else if ( opts->with_md_flag )
+    {
+        /* the inputs interleave by position: a shared reference-window would be read again and again */
+        uint32_t idx;
+        for ( idx = 0; idx <= ifs->database_count && rc == 0; ++idx )
+        {
+            mctx.inputs[ idx ].md_cache = make_md_ref_cache();
+            if ( mctx.inputs[ idx ].md_cache == NULL )
+                rc = RC( rcExe, rcNoTarg, rcAllocating, rcMemory, rcExhausted );
+        }
+    }
+    if ( rc == 0 )
+    {
+        VectorInit ( &mctx.context_list, 0, 5 );
+        if ( opts->region_count == 0 )
+            rc = print_merged_whole_files( opts, ifs, mc, a_mgr, &mctx );
+        else
+            rc = print_merged_regions( opts, ifs, mc, a_mgr, &mctx );
+        VectorWhack ( &mctx.context_list, destroy_align_table_context, NULL );
+    }
+    free( mctx.heap );
+    if ( mctx.inputs != NULL )
+    {
+        uint32_t idx;
+        for ( idx = 0; idx <= ifs->database_count; ++idx )
+            free_md_ref_cache( mctx.inputs[ idx ].md_cache );
+        free( mctx.inputs );
+    }
+    return rc;
+}
+
+
 /*
    this is called from sam-dump3.c, it prepares the iterators and then walks them
    ---> only entry into this module <--- 
@@ -2389,8 +3057,14 @@ rc_t print_aligned_spots( const samdump_opts * const opts,
             {
                 case dm_one_ref_at_a_time : rc = print_all_aligned_spots_0( opts, ifs, mc, a_mgr ); break;
                 case dm_prepare_all_refs  : rc = print_all_aligned_spots_1( opts, ifs, mc, a_mgr ); break;
+                case dm_merge_inputs      : rc = print_merged_aligned_spots( opts, ifs, mc, a_mgr ); break;
             }
         }
+        else if ( opts->dump_mode == dm_merge_inputs )
+        {
+            /* the regions, one at a time, the inputs merged by position */
+            rc = print_merged_aligned_spots( opts, ifs, mc, a_mgr );
+        }
         else
         {
             /* the user did specify regions to be printed ==> print only the alignments in these regions */
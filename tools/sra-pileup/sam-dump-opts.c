@@ -27,6 +27,7 @@
 
 #include "sam-dump-opts.h"
 #include "perf_log.h"
+#include "bed_file.h"
 
 #include <klib/time.h>
 #include <align/quality-quantizer.h>
@@ -69,7 +70,9 @@ static range * make_range( const uint64_t start, const uint64_t end )
 
 static int64_t cmp_range( const range * a, const range * b )
 {
-    if ( a->start < b->start )
+    if ( a->whole != b->whole )
+        return a->whole ? -1 : 1;
+    else if ( a->start < b->start )
         return -1;
     else if ( a->start > b->start )
         return 1;
@@ -113,7 +116,14 @@ static int64_t CC cmp_range_wrapper( const void *item, const void *n )
 {   return cmp_range( item, n ); }
 
 
-static rc_t add_ref_region_range( reference_region * self, const uint64_t start, const uint64_t end )
+static int64_t CC cmp_range_reorder( const void ** item, const void ** n, void * data )
+{   return cmp_range( *item, *n ); }
+
+
+/* the ranges are appended unsorted, check_ref_region_ranges() sorts them once:
+   a region-file can have hundreds of thousands of them */
+static rc_t add_ref_region_range( reference_region * self, const uint64_t start, const uint64_t end,
+                                  bool whole )
 {
     rc_t rc = 0;
     range *r = make_range( start, end );
@@ -121,7 +131,8 @@ static rc_t add_ref_region_range( reference_region * self, const uint64_t start,
         rc = RC( rcApp, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
     else
     {
-        rc = VectorInsert ( &self->ranges, r, NULL, cmp_range_wrapper );
+        r->whole = whole;
+        rc = VectorAppend ( &self->ranges, NULL, r );
         if ( rc != 0 )
             free( r );
     }
@@ -237,32 +248,37 @@ static void free_reference_region( reference_region * self )
 }
 
 
+/* sorts the ranges and merges the overlapping ones, compacting them into a new vector in one pass;
+   a whole-reference range sorts first and covers all the others */
 static void check_ref_region_ranges( reference_region * self )
 {
-    uint32_t n = VectorLength( &self->ranges );
-    uint32_t i = 0;
-    range *a = NULL;
-    while ( i < n )
-    {
-        range *b = VectorGet ( &self->ranges, i );
-        bool remove = false;
-        if ( a != NULL )
+    uint32_t i, n = VectorLength( &self->ranges );
+    if ( n > 1 )
+    {
+        Vector merged;
+        range *a;
+
+        VectorReorder ( &self->ranges, cmp_range_reorder, NULL );
+        a = VectorGet ( &self->ranges, 0 );
+        VectorInit ( &merged, 0, n );
+        VectorAppend ( &merged, NULL, a );
+        for ( i = 1; i < n; ++i )
         {
-            remove = range_overlapp( a, b );
-            if ( remove )
+            range *b = VectorGet ( &self->ranges, i );
+            if ( a->whole || range_overlapp( a, b ) )
             {
-                range *r;
-                a->end = b->end;
-                VectorRemove ( &self->ranges, i, (void**)&r );
-                free( r );
-                n--;
+                if ( b->end > a->end )
+                    a->end = b->end;
+                free( b );
+            }
+            else
+            {
+                VectorAppend ( &merged, NULL, b );
+                a = b;
             }
         }
-        if ( !remove )
-        {
-            a = b;
-            ++i;
-        }
+        VectorWhack ( &self->ranges, NULL, NULL );
+        self->ranges = merged;
     }
 }
 
@@ -323,7 +339,8 @@ static int64_t CC ref_vs_ref_wrapper( const BSTNode *item, const BSTNode *n )
    return cmp_pchar( a->name, b->name );
 }
 
-static rc_t add_refrange( BSTree * regions, const char * name, const uint64_t start, const uint64_t end )
+static rc_t add_refrange( BSTree * regions, const char * name, const uint64_t start, const uint64_t end,
+                          bool whole )
 {
     rc_t rc;
 
@@ -334,7 +351,7 @@ static rc_t add_refrange( BSTree * regions, const char * name, const uint64_t st
         if ( r == NULL )
             rc = RC( rcApp, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
         else
-            rc = add_ref_region_range( r, start, end );
+            rc = add_ref_region_range( r, start, end, whole );
         if ( rc == 0 )
             rc = BSTreeInsert ( regions, (BSTNode *)r, ref_vs_ref_wrapper );
         if ( rc != 0 )
@@ -342,12 +359,22 @@ static rc_t add_refrange( BSTree * regions, const char * name, const uint64_t st
     }
     else
     {
-        rc = add_ref_region_range( r, start, end );
+        rc = add_ref_region_range( r, start, end, whole );
     }
     return rc;
 }
 
 
+static rc_t CC on_bed_interval( const char * name, uint64_t start, uint64_t end, void * data )
+{
+    /* BED is 0-based with an exclusive end, the ranges here are 0-based and inclusive:
+       'chr 0 1' is ( 0, 0 ), the first base, not the whole reference */
+    if ( end > start )
+        return add_refrange( data, name, start, end - 1, false );
+    return 0;
+}
+
+
 static rc_t parse_and_add_region( BSTree * regions, const char * s )
 {
     rc_t rc = 0;
@@ -366,7 +393,8 @@ static rc_t parse_and_add_region( BSTree * regions, const char * s )
             end_0based = start_0based;
             start_0based = temp;
         }
-        rc = add_refrange( regions, name, start_0based, end_0based );
+        /* 'refname' without a range is the whole reference, 'refname:1-1' its first base */
+        rc = add_refrange( regions, name, start_0based, end_0based, ( start == 0 && end == 0 ) );
     }
     return rc;
 }
@@ -554,20 +582,53 @@ static rc_t get_bool_option( Args * args, const char * name, bool *value )
 }
 
 
+static rc_t gather_region_file( Args * args, samdump_opts * opts )
+{
+    uint32_t count;
+
+    rc_t rc = ArgsOptionCount( args, OPT_REGION_FILE, &count );
+    if ( rc != 0 )
+    {
+        (void)PLOGERR( klogErr, ( klogErr, rc, "error counting comandline option '$(t)'", "t=%s", OPT_REGION_FILE ) );
+    }
+    else if ( count > 0 )
+    {
+        const char * s;
+        rc = ArgsOptionValue( args, OPT_REGION_FILE, 0, (const void **)&s );
+        if ( rc != 0 )
+        {
+            (void)PLOGERR( klogErr, ( klogErr, rc, "error retrieving comandline option '$(t)'", "t=%s", OPT_REGION_FILE ) );
+        }
+        else
+        {
+            opts->region_file = string_dup_measure( s, NULL );
+            if ( opts->region_file == NULL )
+            {
+                rc = RC( rcExe, rcNoTarg, rcValidating, rcMemory, rcExhausted );
+                (void)LOGERR( klogErr, rc, "error storing region-FILE into sam-dump-options" );
+            }
+            else
+                rc = foreach_bed_interval( opts->region_file, on_bed_interval, &opts->regions ); /* bed_file.c */
+        }
+    }
+    return rc;
+}
+
+
 static rc_t gather_region_options( Args * args, samdump_opts * opts )
 {
     uint32_t count;
 
     rc_t rc = ArgsOptionCount( args, OPT_REGION, &count );
+    BSTreeInit( &opts->regions );
     if ( rc != 0 )
     {
         (void)PLOGERR( klogErr, ( klogErr, rc, "error counting comandline option '$(t)'", "t=%s", OPT_REGION ) );
     }
-    else if ( count > 0 )
+    else
     {
         uint32_t i;
 
-        BSTreeInit( &opts->regions );
         for ( i = 0; i < count && rc == 0; ++i )
         {
             const char * s;
@@ -579,6 +640,8 @@ static rc_t gather_region_options( Args * args, samdump_opts * opts )
             else
                 rc = parse_and_add_region( &opts->regions, s );
         }
+        if ( rc == 0 )
+            rc = gather_region_file( args, opts );
         if ( rc == 0 )
         {
             check_ref_regions( &opts->regions );
@@ -940,6 +1003,7 @@ static rc_t gather_int_options( Args * args, samdump_opts * opts )
             {
                 case 0  : opts->dump_mode = dm_one_ref_at_a_time; break;
                 case 1  : opts->dump_mode = dm_prepare_all_refs; break;
+                case 2  : opts->dump_mode = dm_merge_inputs; break;
                 default : opts->dump_mode = dm_one_ref_at_a_time; break;
             }
         }
@@ -1131,6 +1195,17 @@ static rc_t gather_string_options( Args * args, samdump_opts * opts )
             opts->rna_splice_log = make_rna_splice_log( opts->rna_splice_log_file, "sam-dump" );
     }
 
+    rc = get_str_option( args, OPT_UNALIGNED_IDX, &s );
+    if ( rc == 0 && s != NULL )
+    {
+        opts->unaligned_index_dir = string_dup_measure( s, NULL );
+        if ( opts->unaligned_index_dir == NULL )
+        {
+            rc = RC( rcExe, rcNoTarg, rcValidating, rcMemory, rcExhausted );
+            (void)LOGERR( klogErr, rc, "error storing unaligned-index-DIR into sam-dump-options" );
+        }
+    }
+
     rc = get_str_option(args, OPT_NGC, &s);
     if (rc == 0 && s != NULL)
         KConfigSetNgcFile(s);
@@ -1191,13 +1266,10 @@ static rc_t CC report_reference_cb( const char * name, Vector * ranges, void *da
             for ( i = VectorStart( ranges ); i < count && rc == 0; ++i )
             {
                 range *r = VectorGet( ranges, i );
-                if ( r->end == 0 )
-                {
-                    if ( r->start == 0 )
-                        rc = KOutMsg( "\t[ start ... end ]\n" );
-                    else
-                        rc = KOutMsg( "\t[ %u ... ]\n", r->start );
-                }
+                if ( r->whole )
+                    rc = KOutMsg( "\t[ start ... end ]\n" );
+                else if ( r->end == 0 && r->start > 0 )
+                    rc = KOutMsg( "\t[ %u ... ]\n", r->start );
                 else
                     rc = KOutMsg( "\t[ %u ... %u ]\n", r->start, r->end );
             }
@@ -1268,6 +1340,7 @@ void report_options( const samdump_opts * opts )
     {
         case dm_one_ref_at_a_time : KOutMsg( "dump-mode             : one ref at a time\n" ); break;
         case dm_prepare_all_refs  : KOutMsg( "dump-mode             : prepare all refs\n" ); break;
+        case dm_merge_inputs      : KOutMsg( "dump-mode             : merge inputs\n" ); break;
         default                   : KOutMsg( "dump-mode             : unknown\n" ); break;
     }
 
@@ -1347,6 +1420,8 @@ void report_options( const samdump_opts * opts )
     KOutMsg( "rna-splicing          : %s\n",  opts->rna_splicing ? "YES" : "NO" );
     KOutMsg( "rna-splice-level      : %u\n",  opts->rna_splice_level );
     KOutMsg( "rna-splice-log        : %s\n",  opts->rna_splice_log_file );
+    KOutMsg( "unaligned-index       : %s\n",  opts->unaligned_index_dir );
+    KOutMsg( "region-file           : %s\n",  opts->region_file );
 
     KOutMsg( "multithreading        : %s\n",  opts->no_mt ? "NO" : "YES" );  
     KOutMsg( "with-MD-flag          : %s\n",  opts->with_md_flag ? "NO" : "YES" );
@@ -1379,6 +1454,10 @@ void release_options( samdump_opts * opts )
         free( (void*)opts->timing_file );
     if( opts->rna_splice_log_file != NULL )
         free( (void*)opts->rna_splice_log_file );
+    if( opts->unaligned_index_dir != NULL )
+        free( (void*)opts->unaligned_index_dir );
+    if( opts->region_file != NULL )
+        free( (void*)opts->region_file );
 
 #if _DEBUGGING
     if ( opts->perf_log != NULL )
@@ -1429,7 +1508,7 @@ bool is_this_alignment_requested( const samdump_opts * opts, const char *refname
                 range * r = VectorGet ( v, i );
                 if ( r != NULL )
                 {
-                    res = ( ( end >= r->start )&&( start <= r->end ) );
+                    res = ( r->whole || ( ( end >= r->start )&&( start <= r->end ) ) );
                 }
             }
         }
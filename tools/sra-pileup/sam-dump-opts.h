@@ -100,11 +100,14 @@ extern "C" {
 #define OPT_TIMING      "timing"
 #define OPT_MD_FLAG     "with-md-flag"
 #define OPT_NGC         "ngc"
+#define OPT_UNALIGNED_IDX "unaligned-index"
+#define OPT_REGION_FILE "region-file"
 
 typedef struct range
 {
     uint64_t start;
     uint64_t end;
+    bool whole;             /* the whole reference, start and end are set when it is walked */
 } range;
 
 
@@ -150,7 +153,8 @@ enum dump_mode
 {
     /* in case of: aligned reads requested + no regions given */
     dm_one_ref_at_a_time = 0,   /* create a set-iter each for every reference sequentially, put only one reference into it */
-    dm_prepare_all_refs         /* create only ONE set-iter, put ALL references into it */
+    dm_prepare_all_refs,        /* create only ONE set-iter, put ALL references into it */
+    dm_merge_inputs             /* one reference at a time, a set-iter for every input, merged by position */
 };
 
 
@@ -189,6 +193,12 @@ typedef struct samdump_opts
     /* log file for rna-splicing-events */
     const char * rna_splice_log_file;
 
+    /* directory of the unaligned-spot indexes */
+    const char * unaligned_index_dir;
+
+    /* BED-file with regions, each reference is then walked in one window over all of its ranges */
+    const char * region_file;
+
     /* timing-performane-log, created if timing_file given */
     struct perf_log * perf_log;
 
@@ -168,6 +168,14 @@ char const *with_md_flag_usage[]      = { "print MD-flag", NULL };
                             
 char const *ngc_usage[]               = { "PATH to ngc file", NULL };
 
+char const *unaligned_index_usage[]   = { "directory to keep an index of the unaligned spots in",
+                                           "built on the first dump of unaligned spots, used by the next ones",
+                                       NULL };
+
+char const *sd_region_file_usage[]    = { "Filter by the regions in this BED-file (0-based, end exclusive).",
+                                       "Each reference is walked once over all of its regions",
+                                       NULL };
+
 OptDef SamDumpArgs[] =
 {
     { OPT_UNALIGNED,     "u", NULL, sd_unaligned_usage,      0, false, false },  /* print unaligned reads */
@@ -216,6 +224,8 @@ OptDef SamDumpArgs[] =
     { OPT_LEGACY,       NULL, NULL, NULL,                    0, false, false },  /* force legacy code-path */
     { OPT_NEW,          NULL, NULL, NULL,                    0, false, false },   /* force new code-path */
     { OPT_NGC,          NULL, NULL, ngc_usage, 0, true, false },  /* ngc file */
+    { OPT_UNALIGNED_IDX, NULL, NULL, unaligned_index_usage,  0, true,  false },  /* directory of unaligned-indexes */
+    { OPT_REGION_FILE,  NULL, NULL, sd_region_file_usage,    0, true,  false },  /* filter by regions from a BED-file */
     { OPT_TIMING,       NULL, NULL, NULL,                    0, true, false }    /* optional timing */
 };
 
@@ -267,6 +277,8 @@ char const *sd_usage_params[] =
     NULL,                       /* force legacy code path */
     NULL,                       /* force new code path */
     "PATH",                     /* ngc file */
+    "PATH",                     /* unaligned-index directory */
+    "PATH",                     /* region-file */
     NULL                        /* optional timing */
 };
 
@@ -478,7 +490,9 @@ static rc_t samdump_main( Args * args, const samdump_opts * const opts )
         case oc_bzip2 : mode = orm_bzip2; break;
     }
 
-    rc = init_out_redir( &redir, mode, opts->outputfile, opts->output_buffer_size ); /* from out_redir.c */
+    /* gzip/bzip2 is compressed in the background, unless multithreading is disabled */
+    rc = init_out_redir_mt( &redir, mode, opts->outputfile, opts->output_buffer_size,
+                            opts->no_mt ? 0 : OUT_REDIR_COMPRESS_THREADS ); /* from out_redir.c */
     if ( rc == 0 )
     {
         if ( opts->report_options )
@@ -504,7 +518,12 @@ static rc_t samdump_main( Args * args, const samdump_opts * const opts )
             /* ------------------------------------------------------ */
             }
         }
-        release_out_redir( &redir ); /* from out_redir.c */
+        {
+            /* the output is not complete until the compression has finished */
+            rc_t rc2 = release_out_redir( &redir ); /* from out_redir.c */
+            if ( rc == 0 )
+                rc = rc2;
+        }
     }
     return rc;
 }
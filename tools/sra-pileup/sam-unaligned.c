@@ -26,6 +26,7 @@
 
 #include "read_fkt.h"
 #include "sam-unaligned.h"
+#include "unaligned_index.h"
 #include <kapp/main.h>
 #include <sysalloc.h>
 #include <ctype.h>
@@ -177,6 +178,30 @@ static rc_t complain_size_diff( int64_t row_id, const char * txt )
 }
 
 
+/* ALIGNMENT_COUNT of a row: are all, some or none of its reads unaligned */
+static void set_seq_row( const samdump_opts * const opts,
+                         const uint8_t * align_count,
+                         uint32_t len,
+                         seq_row * const row )
+{
+    uint32_t i, n;
+
+    row->nreads = len;
+    for ( i = 0, n = 0; i < len; ++i )
+        if ( align_count[ i ] != 0 )
+            n++;
+    row->fully_unaligned = ( n == 0 );
+    row->partly_unaligned = ( n < len && n > 0 );
+
+    if ( row->partly_unaligned )
+        row->filtered_out = !opts->print_half_unaligned_reads;
+    else if ( row->fully_unaligned )
+        row->filtered_out = !opts->print_fully_unaligned_reads;
+    else
+        row->filtered_out = true;
+}
+
+
 static rc_t read_seq_row( const samdump_opts * const opts,
                           const seq_table_ctx * const stx,
                           const int64_t row_id,
@@ -202,23 +227,86 @@ static rc_t read_seq_row( const samdump_opts * const opts,
            but this one is only 8 bit instead of 64 bit, that means faster */
         rc = read_uint8_ptr( row_id, stx->cursor, stx->align_count_idx, &u8ptr, &len, "ALIGN_COUNT" );
         if ( rc == 0 )
+            set_seq_row( opts, u8ptr, len, row );
+    }
+    return rc;
+}
+
+
+/* the full scans read ALIGNMENT_COUNT ( or READ_TYPE ) for this many rows at once */
+#define SEQ_ROW_BATCH 4096
+
+typedef struct seq_row_batch
+{
+    row_span span;                          /* the blobs the cells point into */
+    int64_t first;
+    uint32_t count;
+    int64_t end;                            /* the rows after the scan are not read */
+    const uint8_t * cells[ SEQ_ROW_BATCH ];
+    uint32_t lens[ SEQ_ROW_BATCH ];
+} seq_row_batch;
+
+
+static seq_row_batch * make_seq_row_batch( int64_t first_row, uint64_t row_count )
+{
+    seq_row_batch * batch = malloc( sizeof * batch );
+    if ( batch != NULL )
+    {
+        row_span_init( &batch->span );
+        batch->first = first_row;
+        batch->count = 0;
+        batch->end = first_row + row_count;
+    }
+    return batch;
+}
+
+
+static void free_seq_row_batch( seq_row_batch * batch )
+{
+    if ( batch != NULL )
+    {
+        row_span_release( &batch->span );
+        free( batch );
+    }
+}
+
+
+/* read_seq_row() for the rows of a scan, the next SEQ_ROW_BATCH rows are read when the row is not in the batch */
+static rc_t read_seq_row_batched( const samdump_opts * const opts,
+                                  const seq_table_ctx * const stx,
+                                  seq_row_batch * batch,
+                                  const int64_t row_id,
+                                  seq_row * const row )
+{
+    rc_t rc = 0;
+    if ( row_id < batch->first || row_id >= batch->first + batch->count )
+    {
+        int64_t left = batch->end - row_id;
+        row_span_release( &batch->span );
+        row_span_init( &batch->span );
+        batch->first = row_id;
+        batch->count = ( left < SEQ_ROW_BATCH ) ? ( uint32_t )left : SEQ_ROW_BATCH;
+        if ( stx->align_count_idx == INVALID_COLUMN )
+            rc = read_INSDC_read_type_ptr_range( row_id, batch->count, stx->cursor, stx->read_type_idx, &batch->span,
+                                                 batch->cells, batch->lens, "READ_TYPE" );
+        else
+            rc = read_uint8_ptr_range( row_id, batch->count, stx->cursor, stx->align_count_idx, &batch->span,
+                                       batch->cells, batch->lens, "ALIGN_COUNT" );
+        if ( rc != 0 )
+            batch->count = 0;
+    }
+    if ( rc == 0 )
+    {
+        uint32_t i = ( uint32_t )( row_id - batch->first );
+        if ( stx->align_count_idx == INVALID_COLUMN )
         {
-            uint32_t i, n;
-
-            row->nreads = len;
-            for ( i = 0, n = 0; i < len; ++i )
-                if ( u8ptr[ i ] != 0 )
-                    n++;
-            row->fully_unaligned = ( n == 0 );
-            row->partly_unaligned = ( n < len && n > 0 );
-
-            if ( row->partly_unaligned )
-                row->filtered_out = !opts->print_half_unaligned_reads;
-            else if ( row->fully_unaligned )
-                row->filtered_out = !opts->print_fully_unaligned_reads;
-            else
-                row->filtered_out = true;
+            row->fully_unaligned = true;
+            row->partly_unaligned = false;
+            row->filtered_out = false;
+            row->nreads = batch->lens[ i ];
         }
+        else
+            set_seq_row( opts, batch->cells[ i ], batch->lens[ i ], row );
     }
     return rc;
 }
@@ -1441,7 +1529,54 @@ static rc_t print_unaligned_database_filtered( const samdump_opts * const opts,
 }
 
 
-/* we are printing from a sra-database, we print all unaligned read we can find */
+/* one row of SEQUENCE: skipped if fully aligned, recorded in the index being built */
+static rc_t dump_unaligned_db_row( const samdump_opts * const opts,
+                                   const seq_table_ctx * const stx,
+                                   const prim_table_ctx * const ptx,
+                                   const matecache * const mc,
+                                   const input_database * const ids,
+                                   const int64_t row_id,
+                                   seq_row_batch * batch,
+                                   struct unaligned_index * builder )
+{
+    rc_t rc = Quitting();
+    if ( rc == 0 )
+    {
+        seq_row row;
+        rc = read_seq_row_batched( opts, stx, batch, row_id, &row );
+        if ( rc == 0 && builder != NULL && ( row.fully_unaligned || row.partly_unaligned ) )
+            rc = unaligned_index_add_row( builder, row_id );
+        if ( rc == 0 && !row.filtered_out )
+        {
+            switch( opts->output_format )
+            {
+                case of_sam   : rc = dump_seq_prim_row_sam( opts, stx, ptx, mc, ids, row_id, row.nreads ); break;
+                case of_fasta : /* fall through intended ! */
+                case of_fastq : rc = dump_seq_row_fastx( opts, stx, row_id, row.nreads ); break;
+            }
+        }
+    }
+    return rc;
+}
+
+
+/* the unaligned-index is only valid for the run with this modification-date */
+static rc_t get_run_mod_date( const input_database * ids, KTime_t * mod_date )
+{
+    const VDBManager * mgr;
+    rc_t rc = VDatabaseOpenManagerRead( ids->db, &mgr );
+    if ( rc == 0 )
+    {
+        rc = VDBManagerGetObjModDate( mgr, mod_date, ids->path );
+        VDBManagerRelease( mgr );
+    }
+    return rc;
+}
+
+
+/* we are printing from a sra-database, we print all unaligned read we can find:
+   with an unaligned-index only the rows it lists are visited, without one ( or with
+   a stale one ) all rows are scanned and the index is written for the next time */
 static rc_t print_unaligned_database_full( const samdump_opts * const opts,
                                            const input_table * const seq,
                                            const input_table * const prim,
@@ -1473,23 +1608,58 @@ static rc_t print_unaligned_database_full( const samdump_opts * const opts,
                 }
                 else
                 {
-                    seq_row row;
-                    for ( row_id = first_row; ( ( row_id - first_row ) < row_count ) && rc == 0; ++row_id )
+                    struct unaligned_index * idx = NULL;
+                    struct unaligned_index * builder = NULL;
+                    seq_row_batch * batch;
+                    KTime_t mod_date = 0;
+
+                    /* without ALIGNMENT_COUNT every row counts as unaligned, an index would not help;
+                       without a modification-date a stale index could not be told apart */
+                    if ( opts->unaligned_index_dir != NULL && stx.align_count_idx != INVALID_COLUMN &&
+                         get_run_mod_date( ids, &mod_date ) == 0 )
                     {
-                        rc = Quitting();
-                        if ( rc == 0 )
+                        unaligned_index_load( opts->unaligned_index_dir, ids->path, mod_date, first_row, row_count, &idx );
+                        if ( idx == NULL )
+                            builder = make_unaligned_index( first_row, row_count );
+                    }
+
+                    if ( idx != NULL )
+                    {
+                        uint64_t run_idx, run_count = unaligned_index_run_count( idx );
+                        for ( run_idx = 0; run_idx < run_count && rc == 0; ++run_idx )
                         {
-                            rc = read_seq_row( opts, &stx, row_id, &row );
-                            if ( rc == 0 && !row.filtered_out )
+                            int64_t start;
+                            uint64_t count;
+                            unaligned_index_get_run( idx, run_idx, &start, &count );
+                            batch = make_seq_row_batch( start, count );
+                            if ( batch == NULL )
+                                rc = RC( rcExe, rcNoTarg, rcAllocating, rcMemory, rcExhausted );
+                            for ( row_id = start; ( ( row_id - start ) < count ) && rc == 0; ++row_id )
+                                rc = dump_unaligned_db_row( opts, &stx, &ptx, mc, ids, row_id, batch, NULL );
+                            free_seq_row_batch( batch );
+                        }
+                        free_unaligned_index( idx );
+                    }
+                    else
+                    {
+                        batch = make_seq_row_batch( first_row, row_count );
+                        if ( batch == NULL )
+                            rc = RC( rcExe, rcNoTarg, rcAllocating, rcMemory, rcExhausted );
+                        for ( row_id = first_row; ( ( row_id - first_row ) < row_count ) && rc == 0; ++row_id )
+                            rc = dump_unaligned_db_row( opts, &stx, &ptx, mc, ids, row_id, batch, builder );
+                        free_seq_row_batch( batch );
+
+                        if ( rc == 0 && builder != NULL )
+                        {
+                            /* not being able to write the index does not fail the dump */
+                            rc_t rc2 = unaligned_index_save( builder, opts->unaligned_index_dir, ids->path, mod_date );
+                            if ( rc2 != 0 )
                             {
-                                switch( opts->output_format )
-                                {
-                                    case of_sam   : rc = dump_seq_prim_row_sam( opts, &stx, &ptx, mc, ids, row_id, row.nreads ); break;
-                                    case of_fasta : /* fall through intended ! */
-                                    case of_fastq : rc = dump_seq_row_fastx( opts, &stx, row_id, row.nreads ); break;
-                                }
+                                (void)PLOGERR( klogWarn, ( klogWarn, rc2, "cannot write unaligned-index for $(tn) into $(dir)",
+                                                           "tn=%s,dir=%s", ids->path, opts->unaligned_index_dir ) );
                             }
                         }
+                        free_unaligned_index( builder );
                     }
                 }
                 if ( opts->output_format == of_sam )
@@ -1527,12 +1697,15 @@ static rc_t print_unaligned_table( const samdump_opts * const opts,
             else
             {
                 seq_row row;
+                seq_row_batch * batch = make_seq_row_batch( first_row, row_count );
+                if ( batch == NULL )
+                    rc = RC( rcExe, rcNoTarg, rcAllocating, rcMemory, rcExhausted );
                 for ( row_id = first_row; ( ( row_id - first_row ) < row_count ) && rc == 0; ++row_id )
                 {
                     rc = Quitting();
                     if ( rc == 0 )
                     {
-                        rc = read_seq_row( opts, &stx, row_id, &row );
+                        rc = read_seq_row_batched( opts, &stx, batch, row_id, &row );
                         if ( rc == 0 && !row.filtered_out )
                         {
                             switch( opts->output_format )
@@ -1544,6 +1717,7 @@ static rc_t print_unaligned_table( const samdump_opts * const opts,
                         }
                     }
                 }
+                free_seq_row_batch( batch );
             }
         }
         VCursorRelease( stx.cursor );
@@ -105,6 +105,8 @@
 
 #define OPTION_NGC "ngc"
 
+#define OPTION_THREADS "threads"
+
 #define OPTION_FUNC    "function"
 #define ALIAS_FUNC     NULL
 
@@ -182,6 +184,8 @@ static const char * func_usage[]            = { "alternative functionality", NUL
 
 static const char * ngc_usage[] = { "path to ngc file", NULL };
 
+static const char * threads_usage[] = { "number of threads for function deletes, default is 8", NULL };
+
 OptDef MyOptions[] =
 {
     /*name,           	alias,         	hfkt,	usage-help,		maxcount, needs value, required */
@@ -197,6 +201,7 @@ OptDef MyOptions[] =
     { OPTION_MERGE,		NULL,			NULL,	merge_usage,	1,        true,        false },
     { OPTION_FUNC,		ALIAS_FUNC,		NULL,	func_usage,		1,        true,        false },
     { OPTION_NGC,       NULL,           NULL,   ngc_usage, 1, true, false },
+    { OPTION_THREADS,   NULL,           NULL,   threads_usage, 1, true, false },
 };
 
 /* =========================================================================================== */
@@ -291,6 +296,9 @@ static rc_t get_pileup_options( Args * args, pileup_options *opts )
 
     if ( rc == 0 )
         rc = get_uint32_option( args, OPTION_MERGE, &opts->merge_dist, 10000 );
+
+    if ( rc == 0 )
+        rc = get_uint32_option( args, OPTION_THREADS, &opts->num_threads, 8 );
         
     if ( rc == 0 )
         rc = get_bool_option( args, OPTION_DUPS, &opts->process_dups, false );
@@ -398,6 +406,7 @@ rc_t CC Usage ( const Args * args )
     HelpOptionLine ( ALIAS_SEQNAME, OPTION_SEQNAME, NULL, seqname_usage );
     HelpOptionLine ( NULL, OPTION_MIN_M, NULL, min_m_usage );
     HelpOptionLine ( NULL, OPTION_MERGE, NULL, merge_usage );
+    HelpOptionLine ( NULL, OPTION_THREADS, NULL, threads_usage );
     HelpOptionLine ( ALIAS_NOQUAL, OPTION_NOQUAL, NULL, no_qual_usage );
 
     HelpOptionLine ( NULL, "function ref",      NULL, func_ref_usage );
@@ -1516,8 +1525,16 @@ static rc_t pileup_main( Args * args, pileup_options *options )
         if ( rc == 0 )
         {
             bool empty = false;
+            uint64_t merge_dist = options->merge_dist;
 
-            check_ref_regions( &regions, options->merge_dist ); /* sanitize input, merge slices... */
+            /* a region-file can have hundreds of thousands of intervals: the pileup walks each
+               reference in one pass over all of them and skips the gaps, instead of starting
+               the iterator again for every interval. only the pileup itself honors the skiplist,
+               the other functions keep the regular merge-distance */
+            if ( options->cmn.region_file != NULL && options->function == sra_pileup_samtools )
+                merge_dist = ( uint64_t )-1;
+
+            check_ref_regions( &regions, merge_dist ); /* sanitize input, merge slices... */
             options->skiplist = skiplist_make( &regions ); /* create skiplist for neighboring slices */
 
             arg_ctx.ranges = &regions;
@@ -1600,7 +1617,9 @@ rc_t CC KMain( int argc, char *argv [] )
                     else
                         mode = orm_uncompressed;
 
-                    rc = init_out_redir( &redir, mode, options.cmn.output_file, 32 * 1024 ); /* from out_redir.c */
+                    /* gzip/bzip2 is compressed in the background, unless multithreading is disabled */
+                    rc = init_out_redir_mt( &redir, mode, options.cmn.output_file, 32 * 1024,
+                                            options.cmn.no_mt ? 0 : OUT_REDIR_COMPRESS_THREADS ); /* from out_redir.c */
                     
                     /*
                     if ( options.cmn.output_file != NULL )
@@ -1621,7 +1640,8 @@ rc_t CC KMain( int argc, char *argv [] )
                         }
                         else if ( options.function == sra_pileup_deletes )
                         {
-                            rc = report_deletes( args, 10 ); /* see above */
+                            rc = report_deletes( args, 10,
+                                    options.cmn.no_mt ? 1 : options.num_threads ); /* report_deletes.c */
                         }
                         else if ( options.function == sra_pileup_test )
                         {
@@ -1639,7 +1659,12 @@ rc_t CC KMain( int argc, char *argv [] )
                     if ( options.cmn.output_file != NULL )
                         release_stdout_redirection();
                     */
-                    release_out_redir( &redir ); /* from out_redir.c */
+                    {
+                        /* the output is not complete until the compression has finished */
+                        rc_t rc2 = release_out_redir( &redir ); /* from out_redir.c */
+                        if ( rc == 0 )
+                            rc = rc2;
+                    }
                     
                     if ( options.skiplist != NULL )
                         skiplist_release( options.skiplist );
@@ -0,0 +1,392 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "stat_window.h"
+
+#include <klib/sort.h>
+
+#include <sysalloc.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INIT_WINDOW_SIZE 50
+#define MAX_SEQLEN_COUNT 500000
+#define INIT_RING_SIZE 64
+
+/* ........................................................................................... */
+
+static rc_t init_tlen_ring( tlen_ring * r, uint32_t init_capacity )
+{
+    rc_t rc = 0;
+    r->values = malloc( sizeof ( r->values[ 0 ] ) * init_capacity );
+    if ( r->values == NULL )
+        rc = RC ( rcApp, rcArgv, rcAccessing, rcMemory, rcExhausted );
+    else
+    {
+        r->capacity = init_capacity;
+        r->head = 0;
+        r->count = 0;
+    }
+    return rc;
+}
+
+
+static void finish_tlen_ring( tlen_ring * r )
+{
+    if ( r->values != NULL )
+    {
+        free( r->values );
+        r->values = NULL;
+    }
+}
+
+
+/* the window grows only when window_max grows, that is rare: unwrap into a bigger buffer */
+static rc_t push_tlen_ring( tlen_ring * r, uint32_t value )
+{
+    rc_t rc = 0;
+    if ( r->count == r->capacity )
+    {
+        uint32_t new_capacity = r->capacity * 2;
+        uint32_t * p = malloc( sizeof ( r->values[ 0 ] ) * new_capacity );
+        if ( p == NULL )
+            rc = RC ( rcApp, rcArgv, rcAccessing, rcMemory, rcExhausted );
+        else
+        {
+            uint32_t tail = r->capacity - r->head;
+            memmove( p, &( r->values[ r->head ] ), tail * sizeof p[ 0 ] );
+            memmove( &( p[ tail ] ), r->values, r->head * sizeof p[ 0 ] );
+            free( r->values );
+            r->values = p;
+            r->capacity = new_capacity;
+            r->head = 0;
+        }
+    }
+    if ( rc == 0 )
+    {
+        r->values[ ( r->head + r->count ) % r->capacity ] = value;
+        r->count++;
+    }
+    return rc;
+}
+
+
+static uint32_t pop_tlen_ring( tlen_ring * r )
+{
+    uint32_t res = 0;
+    if ( r->count > 0 )
+    {
+        res = r->values[ r->head ];
+        r->head = ( r->head + 1 ) % r->capacity;
+        r->count--;
+    }
+    return res;
+}
+
+
+static void inc_last_of_tlen_ring( tlen_ring * r )
+{
+    if ( r->count > 0 )
+        r->values[ ( r->head + r->count - 1 ) % r->capacity ]++;
+}
+
+/* ........................................................................................... */
+
+static rc_t init_tlen_set( tlen_set * s )
+{
+    rc_t rc = 0;
+    memset( s, 0, sizeof *s );
+    s->fine = calloc( TLEN_FINE_COUNT, sizeof ( s->fine[ 0 ] ) );
+    if ( s->fine == NULL )
+        rc = RC ( rcApp, rcArgv, rcAccessing, rcMemory, rcExhausted );
+    s->big_sorted = true;
+    return rc;
+}
+
+
+static void finish_tlen_set( tlen_set * s )
+{
+    if ( s->fine != NULL )
+    {
+        free( s->fine );
+        s->fine = NULL;
+    }
+    if ( s->big != NULL )
+    {
+        free( s->big );
+        s->big = NULL;
+    }
+}
+
+
+/* only the used buckets have to be zeroed */
+static void clear_tlen_set( tlen_set * s )
+{
+    uint32_t b;
+    for ( b = s->lowest; s->in_fine > 0 && b < TLEN_COARSE_COUNT; ++b )
+    {
+        if ( s->coarse[ b ] > 0 )
+        {
+            memset( &( s->fine[ b << TLEN_COARSE_SHIFT ] ), 0,
+                    ( sizeof s->fine[ 0 ] ) << TLEN_COARSE_SHIFT );
+            s->in_fine -= s->coarse[ b ];
+            s->coarse[ b ] = 0;
+        }
+    }
+    s->lowest = 0;
+    s->in_fine = 0;
+    s->big_first = 0;
+    s->big_count = 0;
+    s->big_sorted = true;
+    s->members = 0;
+}
+
+
+static rc_t add_big_to_tlen_set( tlen_set * s, uint32_t value )
+{
+    rc_t rc = 0;
+    if ( s->big_first + s->big_count == s->big_capacity )
+    {
+        if ( s->big_first > 0 )
+        {
+            memmove( s->big, &( s->big[ s->big_first ] ), s->big_count * sizeof s->big[ 0 ] );
+            s->big_first = 0;
+        }
+        else
+        {
+            uint32_t new_capacity = ( s->big_capacity == 0 ) ? INIT_RING_SIZE : s->big_capacity * 2;
+            void * p = realloc( s->big, new_capacity * sizeof s->big[ 0 ] );
+            if ( p == NULL )
+                rc = RC ( rcApp, rcArgv, rcAccessing, rcMemory, rcExhausted );
+            else
+            {
+                s->big = p;
+                s->big_capacity = new_capacity;
+            }
+        }
+    }
+    if ( rc == 0 )
+    {
+        s->big[ s->big_first + s->big_count++ ] = value;
+        s->big_sorted = false;
+    }
+    return rc;
+}
+
+
+static rc_t add_to_tlen_set( tlen_set * s, uint32_t value )
+{
+    rc_t rc = 0;
+    if ( value < TLEN_FINE_COUNT )
+    {
+        uint32_t b = value >> TLEN_COARSE_SHIFT;
+        s->fine[ value ]++;
+        s->coarse[ b ]++;
+        if ( b < s->lowest )
+            s->lowest = b;
+        s->in_fine++;
+    }
+    else
+        rc = add_big_to_tlen_set( s, value );
+    if ( rc == 0 )
+        s->members++;
+    return rc;
+}
+
+
+static void sort_big_of_tlen_set( tlen_set * s )
+{
+    if ( !s->big_sorted )
+    {
+        if ( s->big_count > 1 )
+            ksort_uint32_t ( &( s->big[ s->big_first ] ), s->big_count );
+        s->big_sorted = true;
+    }
+}
+
+
+/* removes the 'count' smallest values */
+static void remove_smallest_from_tlen_set( tlen_set * s, uint32_t count )
+{
+    while ( count > 0 && s->in_fine > 0 )
+    {
+        uint32_t v, end;
+        while ( s->coarse[ s->lowest ] == 0 )
+            s->lowest++;
+        v = s->lowest << TLEN_COARSE_SHIFT;
+        end = v + ( 1 << TLEN_COARSE_SHIFT );
+        for ( ; count > 0 && v < end; ++v )
+        {
+            uint32_t take = s->fine[ v ];
+            if ( take > count )
+                take = count;
+            s->fine[ v ] -= take;
+            s->coarse[ s->lowest ] -= take;
+            s->in_fine -= take;
+            s->members -= take;
+            count -= take;
+        }
+    }
+    if ( count > 0 && s->big_count > 0 )
+    {
+        sort_big_of_tlen_set( s );
+        if ( count > s->big_count )
+            count = s->big_count;
+        s->big_first += count;
+        s->big_count -= count;
+        s->members -= count;
+    }
+}
+
+
+/* the idx-th smallest value ( idx < members ) */
+static uint32_t nth_of_tlen_set( tlen_set * s, uint32_t idx )
+{
+    if ( idx < s->in_fine )
+    {
+        uint32_t b = s->lowest;
+        uint32_t v;
+        while ( idx >= s->coarse[ b ] )
+            idx -= s->coarse[ b++ ];
+        v = b << TLEN_COARSE_SHIFT;
+        while ( idx >= s->fine[ v ] )
+            idx -= s->fine[ v++ ];
+        return v;
+    }
+    sort_big_of_tlen_set( s );
+    return s->big[ s->big_first + ( idx - s->in_fine ) ];
+}
+
+/* ........................................................................................... */
+
+rc_t stat_strand_init( stat_strand * strand )
+{
+    rc_t rc = init_tlen_set( &strand->tlen_w );
+    if ( rc == 0 )
+        rc = init_tlen_ring( &strand->tlen_l, INIT_RING_SIZE );
+    if ( rc == 0 )
+        rc = init_tlen_ring( &strand->zeros, INIT_RING_SIZE );
+    if ( rc == 0 )
+    {
+        strand->alignment_count = 0;
+        strand->window_size = 0;
+        strand->window_max = INIT_WINDOW_SIZE;
+        strand->seq_len_accu_count = 0;
+        strand->seq_len_accu = 0;
+        strand->tlen_w_zeros = 0;
+    }
+    return rc;
+}
+
+
+void stat_strand_finish( stat_strand * strand )
+{
+    finish_tlen_set( &strand->tlen_w );
+    finish_tlen_ring( &strand->tlen_l );
+    finish_tlen_ring( &strand->zeros );
+}
+
+
+void stat_strand_enter_window( stat_strand * strand )
+{
+    /* the zero-counters survive the window-change, they did before too */
+    clear_tlen_set( &strand->tlen_w );
+    strand->tlen_l.head = 0;
+    strand->tlen_l.count = 0;
+}
+
+
+rc_t stat_strand_enter_pos( stat_strand * strand )
+{
+    rc_t rc;
+    if ( ( strand->seq_len_accu_count < MAX_SEQLEN_COUNT ) && ( strand->seq_len_accu_count > 0 ) )
+    {
+        uint64_t w = ( strand->seq_len_accu / strand->seq_len_accu_count );
+        if ( w > strand->window_max )
+            strand->window_max = w;
+    }
+
+    if ( strand->window_size >= strand->window_max )
+    {
+        /* the slice leaving the window takes its count of tlen's with it,
+           the smallest ones, as the sorted array did */
+        if ( strand->tlen_l.count > 0 )
+            remove_smallest_from_tlen_set( &strand->tlen_w, pop_tlen_ring( &strand->tlen_l ) );
+        strand->tlen_w_zeros -= pop_tlen_ring( &strand->zeros );
+    }
+    else
+        strand->window_size++;
+    rc = push_tlen_ring( &strand->tlen_l, 0 );
+    if ( rc == 0 )
+        rc = push_tlen_ring( &strand->zeros, 0 );
+    strand->alignment_count = 0;
+    return rc;
+}
+
+
+rc_t stat_strand_placement( stat_strand * strand, int32_t tlen, uint32_t seq_len )
+{
+    rc_t rc = 0;
+    uint32_t value =  ( tlen < 0 ) ? -tlen : tlen;
+    if ( value != 0 )
+    {
+        rc = add_to_tlen_set( &strand->tlen_w, value );
+        if ( rc == 0 )
+            inc_last_of_tlen_ring( &strand->tlen_l );
+    }
+    else
+    {
+        strand->tlen_w_zeros++;
+        inc_last_of_tlen_ring( &strand->zeros );
+    }
+
+    if ( strand->seq_len_accu_count < MAX_SEQLEN_COUNT )
+    {
+        strand->seq_len_accu += seq_len;
+        strand->seq_len_accu_count++;
+    }
+    return rc;
+}
+
+
+void stat_strand_tlen_stats( stat_strand * strand, uint32_t * zeros,
+                             uint32_t * p10, uint32_t * med, uint32_t * p90 )
+{
+    tlen_set * s = &strand->tlen_w;
+    *zeros = strand->tlen_w_zeros;
+    if ( s->members == 0 )
+    {
+        *p10 = 0;
+        *med = 0;
+        *p90 = 0;
+    }
+    else
+    {
+        *p10 = nth_of_tlen_set( s, ( s->members * 10 ) / 100 );
+        *med = nth_of_tlen_set( s, s->members >> 1 );
+        *p90 = nth_of_tlen_set( s, ( s->members * 90 ) / 100 );
+    }
+}
@@ -0,0 +1,96 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#ifndef _h_stat_window_
+#define _h_stat_window_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <klib/rc.h>
+
+/* the sliding window behind the TLEN-columns of the stat-function ( pileup_stat.c ):
+   - per reference-position in the window: how many non-zero / zero tlen's started/ended there
+     ( 2 ring-buffers, advancing the window is O(1) )
+   - the non-zero tlen's of the whole window as a counting multiset, percentiles are read
+     from it without sorting, adding a value is O(1) */
+
+typedef struct tlen_ring
+{
+    uint32_t * values;
+    uint32_t capacity;
+    uint32_t head;
+    uint32_t count;
+} tlen_ring;
+
+#define TLEN_FINE_COUNT 0x10000
+#define TLEN_COARSE_SHIFT 8
+#define TLEN_COARSE_COUNT ( TLEN_FINE_COUNT >> TLEN_COARSE_SHIFT )
+
+typedef struct tlen_set
+{
+    uint32_t * fine;                            /* one counter per value below TLEN_FINE_COUNT */
+    uint32_t coarse[ TLEN_COARSE_COUNT ];       /* one counter per 256 values */
+    uint32_t lowest;                            /* all coarse counters below this one are zero */
+    uint32_t in_fine;
+    uint32_t * big;                             /* the rare values >= TLEN_FINE_COUNT */
+    uint32_t big_capacity, big_first, big_count;
+    bool big_sorted;
+    uint32_t members;
+} tlen_set;
+
+typedef struct stat_strand
+{
+    uint32_t alignment_count, window_size, window_max, seq_len_accu_count;
+    uint64_t seq_len_accu;
+    tlen_set tlen_w;            /* the non-zero tlen's of all alignments starting/ending in the window */
+    uint32_t tlen_w_zeros;      /* the zero tlen's of them */
+    tlen_ring tlen_l;           /* per position-slice in the window: count of non-zero tlen's */
+    tlen_ring zeros;            /* per position-slice in the window: count of zero tlen's */
+} stat_strand;
+
+rc_t stat_strand_init( stat_strand * strand );
+void stat_strand_finish( stat_strand * strand );
+
+/* entering a new ref-window: the tlen's collected so far are dropped */
+void stat_strand_enter_window( stat_strand * strand );
+
+/* entering a new ref-position: slides the window by one */
+rc_t stat_strand_enter_pos( stat_strand * strand );
+
+/* an alignment starting ( forward ) or ending ( reverse ) at the current position */
+rc_t stat_strand_placement( stat_strand * strand, int32_t tlen, uint32_t seq_len );
+
+/* count of zero-tlen's, 10%-percentil, median and 90%-percentil of the non-zero tlen's */
+void stat_strand_tlen_stats( stat_strand * strand, uint32_t * zeros,
+                             uint32_t * p10, uint32_t * med, uint32_t * p90 );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _h_stat_window_ */
@@ -0,0 +1,409 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "unaligned_index.h"
+
+#include <klib/printf.h>
+#include <klib/text.h>
+#include <klib/time.h>
+#include <kfs/directory.h>
+#include <kfs/file.h>
+
+#include <sysalloc.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define UNALIGNED_INDEX_MAGIC 0x49554453   /* 'SDUI' */
+#define UNALIGNED_INDEX_VERSION 2
+
+/* the file, every number little-endian whatever the host is:
+       magic, version                       2 x 4 bytes
+       first_row, row_count, run_count      3 x 8 bytes
+       modification-date of the run         8 bytes
+       length of the run-path               4 bytes
+       the run-path                         ( not 0-terminated )
+       the runs as start, count             run_count x 16 bytes */
+#define UNALIGNED_INDEX_HDR_SIZE ( 4 + 4 + 8 + 8 + 8 + 8 + 4 )
+#define UNALIGNED_INDEX_RUN_SIZE ( 8 + 8 )
+#define UNALIGNED_INDEX_PATH_SIZE 4096
+#define UNALIGNED_INDEX_CHUNK 1024
+
+typedef struct unaligned_run
+{
+    int64_t start;
+    uint64_t count;
+} unaligned_run;
+
+typedef struct unaligned_index
+{
+    int64_t first_row;
+    uint64_t row_count;
+    uint64_t run_count;
+    uint64_t run_alloc;
+    unaligned_run * runs;
+} unaligned_index;
+
+
+struct unaligned_index * make_unaligned_index( int64_t first_row, uint64_t row_count )
+{
+    struct unaligned_index * res = calloc( 1, sizeof * res );
+    if ( res != NULL )
+    {
+        res->first_row = first_row;
+        res->row_count = row_count;
+    }
+    return res;
+}
+
+
+void free_unaligned_index( struct unaligned_index * idx )
+{
+    if ( idx != NULL )
+    {
+        if ( idx->runs != NULL )
+            free( ( void * ) idx->runs );
+        free( ( void * ) idx );
+    }
+}
+
+
+static rc_t reserve_runs( struct unaligned_index * idx, uint64_t count )
+{
+    if ( count > idx->run_alloc )
+    {
+        uint64_t new_alloc = ( idx->run_alloc == 0 ) ? 1024 : idx->run_alloc * 2;
+        unaligned_run * tmp;
+        if ( new_alloc < count )
+            new_alloc = count;
+        tmp = realloc( idx->runs, new_alloc * sizeof * tmp );
+        if ( tmp == NULL )
+            return RC( rcExe, rcNoTarg, rcAllocating, rcMemory, rcExhausted );
+        idx->runs = tmp;
+        idx->run_alloc = new_alloc;
+    }
+    return 0;
+}
+
+
+rc_t unaligned_index_add_row( struct unaligned_index * idx, int64_t row_id )
+{
+    rc_t rc = 0;
+    if ( idx == NULL )
+        rc = RC( rcExe, rcNoTarg, rcInserting, rcSelf, rcNull );
+    else if ( idx->run_count > 0 &&
+              idx->runs[ idx->run_count - 1 ].start + ( int64_t )idx->runs[ idx->run_count - 1 ].count == row_id )
+    {
+        idx->runs[ idx->run_count - 1 ].count++;
+    }
+    else
+    {
+        rc = reserve_runs( idx, idx->run_count + 1 );
+        if ( rc == 0 )
+        {
+            idx->runs[ idx->run_count ].start = row_id;
+            idx->runs[ idx->run_count ].count = 1;
+            idx->run_count++;
+        }
+    }
+    return rc;
+}
+
+
+uint64_t unaligned_index_run_count( const struct unaligned_index * idx )
+{
+    return ( idx != NULL ) ? idx->run_count : 0;
+}
+
+
+void unaligned_index_get_run( const struct unaligned_index * idx, uint64_t run_idx,
+                              int64_t * start, uint64_t * count )
+{
+    if ( idx != NULL && run_idx < idx->run_count )
+    {
+        *start = idx->runs[ run_idx ].start;
+        *count = idx->runs[ run_idx ].count;
+    }
+    else
+    {
+        *start = 0;
+        *count = 0;
+    }
+}
+
+
+/* '/data/SRR123456.sra/' --> 'SRR123456.sra.unaligned.idx' */
+static rc_t index_file_name( const char * run_path, char * buffer, size_t buffer_size )
+{
+    size_t num_writ, len = string_size( run_path );
+    const char * leaf;
+    while ( len > 0 && run_path[ len - 1 ] == '/' )
+        len--;
+    leaf = string_rchr( run_path, len, '/' );
+    leaf = ( leaf == NULL ) ? run_path : leaf + 1;
+    return string_printf( buffer, buffer_size, &num_writ, "%.*s.unaligned.idx",
+                          ( uint32_t )( len - ( leaf - run_path ) ), leaf );
+}
+
+
+static void put_u32( uint8_t * dst, uint32_t value )
+{
+    uint32_t i;
+    for ( i = 0; i < 4; ++i )
+        dst[ i ] = ( uint8_t )( value >> ( 8 * i ) );
+}
+
+
+static void put_u64( uint8_t * dst, uint64_t value )
+{
+    uint32_t i;
+    for ( i = 0; i < 8; ++i )
+        dst[ i ] = ( uint8_t )( value >> ( 8 * i ) );
+}
+
+
+static uint32_t get_u32( const uint8_t * src )
+{
+    uint32_t i, res = 0;
+    for ( i = 0; i < 4; ++i )
+        res |= ( ( uint32_t )src[ i ] ) << ( 8 * i );
+    return res;
+}
+
+
+static uint64_t get_u64( const uint8_t * src )
+{
+    uint64_t res = 0;
+    uint32_t i;
+    for ( i = 0; i < 8; ++i )
+        res |= ( ( uint64_t )src[ i ] ) << ( 8 * i );
+    return res;
+}
+
+
+/* the identity of the run in the index: the absolute path if run_path exists in
+   the filesystem, the accession as given otherwise */
+static rc_t index_run_identity( const KDirectory * native, const char * run_path,
+                                char * buffer, size_t buffer_size, uint32_t * len )
+{
+    rc_t rc = 0;
+    size_t num_writ, path_len = string_size( run_path );
+    while ( path_len > 1 && run_path[ path_len - 1 ] == '/' )
+        path_len--;
+    if ( ( KDirectoryPathType( native, "%.*s", ( uint32_t )path_len, run_path ) & ~kptAlias ) != kptNotFound )
+        rc = KDirectoryResolvePath( native, true, buffer, buffer_size, "%.*s", ( uint32_t )path_len, run_path );
+    else
+        rc = string_printf( buffer, buffer_size, &num_writ, "%.*s", ( uint32_t )path_len, run_path );
+    if ( rc == 0 )
+        *len = ( uint32_t )string_size( buffer );
+    return rc;
+}
+
+
+static rc_t write_runs( const struct unaligned_index * idx, KFile * f, uint64_t pos )
+{
+    rc_t rc = 0;
+    uint8_t buffer[ UNALIGNED_INDEX_CHUNK * UNALIGNED_INDEX_RUN_SIZE ];
+    uint64_t i = 0;
+    while ( rc == 0 && i < idx->run_count )
+    {
+        size_t num_writ, n = 0;
+        for ( ; n < UNALIGNED_INDEX_CHUNK && i < idx->run_count; ++n, ++i )
+        {
+            put_u64( &buffer[ n * UNALIGNED_INDEX_RUN_SIZE ], ( uint64_t )idx->runs[ i ].start );
+            put_u64( &buffer[ n * UNALIGNED_INDEX_RUN_SIZE + 8 ], idx->runs[ i ].count );
+        }
+        rc = KFileWriteAll( f, pos, buffer, n * UNALIGNED_INDEX_RUN_SIZE, &num_writ );
+        pos += num_writ;
+    }
+    return rc;
+}
+
+
+rc_t unaligned_index_save( const struct unaligned_index * idx, const char * dir,
+                           const char * run_path, KTime_t mod_date )
+{
+    char name[ 4096 ];
+    char tmp_name[ 4096 + 8 ];
+    size_t num_writ;
+    KDirectory * native;
+    rc_t rc;
+
+    if ( idx == NULL || dir == NULL || run_path == NULL )
+        return RC( rcExe, rcNoTarg, rcWriting, rcParam, rcNull );
+
+    rc = index_file_name( run_path, name, sizeof name );
+    if ( rc == 0 )
+        rc = string_printf( tmp_name, sizeof tmp_name, &num_writ, "%s.tmp", name );
+    if ( rc == 0 )
+        rc = KDirectoryNativeDir( &native );
+    if ( rc == 0 )
+    {
+        uint8_t hdr[ UNALIGNED_INDEX_HDR_SIZE + UNALIGNED_INDEX_PATH_SIZE ];
+        uint32_t path_len;
+        rc = index_run_identity( native, run_path, ( char * )&hdr[ UNALIGNED_INDEX_HDR_SIZE ],
+                                 UNALIGNED_INDEX_PATH_SIZE, &path_len );
+        if ( rc == 0 )
+        {
+            KDirectory * idx_dir;
+            put_u32( &hdr[ 0 ], UNALIGNED_INDEX_MAGIC );
+            put_u32( &hdr[ 4 ], UNALIGNED_INDEX_VERSION );
+            put_u64( &hdr[ 8 ], ( uint64_t )idx->first_row );
+            put_u64( &hdr[ 16 ], idx->row_count );
+            put_u64( &hdr[ 24 ], idx->run_count );
+            put_u64( &hdr[ 32 ], ( uint64_t )mod_date );
+            put_u32( &hdr[ 40 ], path_len );
+
+            rc = KDirectoryOpenDirUpdate( native, &idx_dir, false, "%s", dir );
+            if ( rc == 0 )
+            {
+                KFile * f;
+                rc = KDirectoryCreateFile( idx_dir, &f, false, 0664, kcmInit, "%s", tmp_name );
+                if ( rc == 0 )
+                {
+                    rc = KFileWriteAll( f, 0, hdr, UNALIGNED_INDEX_HDR_SIZE + path_len, &num_writ );
+                    if ( rc == 0 )
+                        rc = write_runs( idx, f, UNALIGNED_INDEX_HDR_SIZE + path_len );
+                    KFileRelease( f );
+                    if ( rc == 0 )
+                        rc = KDirectoryRename( idx_dir, true, tmp_name, name );
+                    else
+                        KDirectoryRemove( idx_dir, true, "%s", tmp_name );
+                }
+                KDirectoryRelease( idx_dir );
+            }
+        }
+        KDirectoryRelease( native );
+    }
+    return rc;
+}
+
+
+/* the runs have to be ascending, not overlapping and inside the row-range */
+static bool runs_are_valid( const struct unaligned_index * idx )
+{
+    uint64_t i;
+    int64_t next_free = idx->first_row;
+    for ( i = 0; i < idx->run_count; ++i )
+    {
+        const unaligned_run * r = &idx->runs[ i ];
+        if ( r->start < next_free || r->count == 0 ||
+             ( uint64_t )( r->start - idx->first_row ) + r->count > idx->row_count )
+            return false;
+        next_free = r->start + r->count;
+    }
+    return true;
+}
+
+
+static rc_t read_runs( struct unaligned_index * idx, const KFile * f, uint64_t pos, uint64_t run_count )
+{
+    rc_t rc = reserve_runs( idx, run_count );
+    uint8_t buffer[ UNALIGNED_INDEX_CHUNK * UNALIGNED_INDEX_RUN_SIZE ];
+    while ( rc == 0 && idx->run_count < run_count )
+    {
+        size_t num_read, i, n = UNALIGNED_INDEX_CHUNK;
+        if ( n > run_count - idx->run_count )
+            n = ( size_t )( run_count - idx->run_count );
+        rc = KFileReadAll( f, pos, buffer, n * UNALIGNED_INDEX_RUN_SIZE, &num_read );
+        if ( rc == 0 && num_read != n * UNALIGNED_INDEX_RUN_SIZE )
+            rc = RC( rcExe, rcFile, rcReading, rcData, rcInsufficient );
+        for ( i = 0; rc == 0 && i < n; ++i )
+        {
+            unaligned_run * r = &idx->runs[ idx->run_count++ ];
+            r->start = ( int64_t )get_u64( &buffer[ i * UNALIGNED_INDEX_RUN_SIZE ] );
+            r->count = get_u64( &buffer[ i * UNALIGNED_INDEX_RUN_SIZE + 8 ] );
+        }
+        pos += num_read;
+    }
+    return rc;
+}
+
+
+rc_t unaligned_index_load( const char * dir, const char * run_path, KTime_t mod_date,
+                           int64_t first_row, uint64_t row_count,
+                           struct unaligned_index ** idx )
+{
+    char name[ 4096 ];
+    KDirectory * native;
+    rc_t rc;
+
+    if ( idx == NULL )
+        return RC( rcExe, rcNoTarg, rcReading, rcParam, rcNull );
+    *idx = NULL;
+    if ( dir == NULL || run_path == NULL )
+        return RC( rcExe, rcNoTarg, rcReading, rcParam, rcNull );
+
+    rc = index_file_name( run_path, name, sizeof name );
+    if ( rc == 0 )
+        rc = KDirectoryNativeDir( &native );
+    if ( rc == 0 )
+    {
+        const KFile * f;
+        /* a missing index is not an error, the caller scans */
+        if ( KDirectoryOpenFileRead( native, &f, "%s/%s", dir, name ) == 0 )
+        {
+            char identity[ UNALIGNED_INDEX_PATH_SIZE ];
+            uint8_t hdr[ UNALIGNED_INDEX_HDR_SIZE + UNALIGNED_INDEX_PATH_SIZE ];
+            uint32_t identity_len;
+            uint64_t file_size;
+            size_t num_read;
+            rc = index_run_identity( native, run_path, identity, sizeof identity, &identity_len );
+            if ( rc == 0 )
+                rc = KFileSize( f, &file_size );
+            if ( rc == 0 )
+                rc = KFileReadAll( f, 0, hdr, UNALIGNED_INDEX_HDR_SIZE + identity_len, &num_read );
+            /* a different version, row-range, modification-date or path: stale */
+            if ( rc == 0 &&
+                 num_read == UNALIGNED_INDEX_HDR_SIZE + identity_len &&
+                 get_u32( &hdr[ 0 ] ) == UNALIGNED_INDEX_MAGIC &&
+                 get_u32( &hdr[ 4 ] ) == UNALIGNED_INDEX_VERSION &&
+                 ( int64_t )get_u64( &hdr[ 8 ] ) == first_row &&
+                 get_u64( &hdr[ 16 ] ) == row_count &&
+                 get_u64( &hdr[ 24 ] ) <= row_count &&
+                 ( KTime_t )get_u64( &hdr[ 32 ] ) == mod_date &&
+                 get_u32( &hdr[ 40 ] ) == identity_len &&
+                 memcmp( &hdr[ UNALIGNED_INDEX_HDR_SIZE ], identity, identity_len ) == 0 &&
+                 file_size == UNALIGNED_INDEX_HDR_SIZE + identity_len + get_u64( &hdr[ 24 ] ) * UNALIGNED_INDEX_RUN_SIZE )
+            {
+                struct unaligned_index * res = make_unaligned_index( first_row, row_count );
+                if ( res == NULL )
+                    rc = RC( rcExe, rcNoTarg, rcAllocating, rcMemory, rcExhausted );
+                else
+                {
+                    /* a file changed while being read is stale too */
+                    if ( read_runs( res, f, UNALIGNED_INDEX_HDR_SIZE + identity_len, get_u64( &hdr[ 24 ] ) ) == 0 &&
+                         runs_are_valid( res ) )
+                        *idx = res;
+                    else
+                        free_unaligned_index( res );
+                }
+            }
+            KFileRelease( f );
+        }
+        KDirectoryRelease( native );
+    }
+    return rc;
+}
@@ -0,0 +1,70 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#ifndef _h_unaligned_index_
+#define _h_unaligned_index_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <klib/rc.h>
+#include <klib/time.h>
+
+/* the rows of a SEQUENCE-table that are not fully aligned ( ALIGNMENT_COUNT has
+   a zero for at least one read ), as ascending runs of row-ids;
+   persisted in a directory as '<run-name>.unaligned.idx', in little-endian byte-order,
+   together with the full path and the modification-date of the run it was made for */
+
+struct unaligned_index;
+
+struct unaligned_index * make_unaligned_index( int64_t first_row, uint64_t row_count );
+
+void free_unaligned_index( struct unaligned_index * idx );
+
+/* row_id has to be bigger than the last one added */
+rc_t unaligned_index_add_row( struct unaligned_index * idx, int64_t row_id );
+
+uint64_t unaligned_index_run_count( const struct unaligned_index * idx );
+
+void unaligned_index_get_run( const struct unaligned_index * idx, uint64_t run_idx,
+                              int64_t * start, uint64_t * count );
+
+/* writes the index next to the others in dir, via a temp-file and a rename */
+rc_t unaligned_index_save( const struct unaligned_index * idx, const char * dir,
+                           const char * run_path, KTime_t mod_date );
+
+/* *idx is NULL if there is no index for run_path in dir, or if it was made
+   for a different run-path, modification-date or row-range ( stale ) */
+rc_t unaligned_index_load( const char * dir, const char * run_path, KTime_t mod_date,
+                           int64_t first_row, uint64_t row_count,
+                           struct unaligned_index ** idx );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,885 @@
+/*===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ */
+
+#include "checkpoint.h"
+#include "map-file.h"
+#include "ctx.h"
+#include "caps.h"
+#include "status.h"
+#include "mem.h"
+#include "sra-sort.h"
+
+#include <kdb/manager.h>
+#include <kdb/database.h>
+#include <kdb/table.h>
+#include <kdb/column.h>
+#include <kdb/namelist.h>
+#include <kfs/directory.h>
+#include <kfs/file.h>
+#include <klib/namelist.h>
+#include <klib/vector.h>
+#include <klib/printf.h>
+#include <klib/text.h>
+#include <klib/rc.h>
+
+#include <string.h>
+
+#include "except.h"
+
+FILE_ENTRY ( checkpoint );
+
+
+#define CHECKPOINT_VERS 1
+#define CHECKPOINT_MAGIC "sra-sort checkpoint"
+#define CHECKPOINT_MANIFEST "manifest"
+
+
+/*--------------------------------------------------------------------------
+ * CheckpointTbl
+ *  a table finished by the sort, with the id range it was written with
+ */
+typedef struct CheckpointTbl CheckpointTbl;
+struct CheckpointTbl
+{
+    int64_t first_id;
+    uint64_t count;
+    char name [ 128 ];
+};
+
+
+/*--------------------------------------------------------------------------
+ * CheckpointMap
+ *  a map file with the state it had at the last commit
+ */
+typedef struct CheckpointMap CheckpointMap;
+struct CheckpointMap
+{
+    /* the live map file, NULL when released */
+    MapFile *mf;
+
+    MapFileState state;
+
+    /* 1-based number of the commit that last changed the state,
+       0 if the map was never flushed */
+    uint32_t since;
+
+    char name [ 128 ];
+};
+
+
+/*--------------------------------------------------------------------------
+ * Checkpoint
+ */
+struct Checkpoint
+{
+    /* CheckpointTbl, in order of commit */
+    Vector tbls;
+
+    /* CheckpointMap */
+    Vector maps;
+
+    const char *src_path;
+    const char *dst_path;
+
+    bool resuming;
+    bool finished;
+
+    /* output parameters a resumed run has to share */
+    char params [ 128 ];
+
+    /* checkpoint directory */
+    char path [ 4096 ];
+};
+
+
+static
+void CheckpointMakePath ( const ctx_t *ctx, char *path, size_t size, const char *dst_path )
+{
+    FUNC_ENTRY ( ctx );
+
+    rc_t rc = string_printf ( path, size, NULL, "%s.sra-sort-checkpoint", dst_path );
+    if ( rc != 0 )
+        ERROR ( rc, "checkpoint path for '%s' is too long", dst_path );
+}
+
+static
+void CheckpointMakeParams ( const ctx_t *ctx, char *params, size_t size )
+{
+    FUNC_ENTRY ( ctx );
+
+    const Tool *tp = ctx -> caps -> tool;
+    rc_t rc = string_printf ( params, size, NULL, "%u %u %u %zu %u %u %u",
+        ( tp -> db . cmode & kcmMD5 ) != 0, tp -> col . cmode, tp -> col . checksum, tp -> col . pgsize,
+        tp -> sort_before_old2new, tp -> write_new_to_old, tp -> full_sort );
+    if ( rc != 0 )
+        INTERNAL_ERROR ( rc, "failed to format checkpoint parameters" );
+}
+
+
+/* Exists
+ *  true if an earlier run left a checkpoint for "dst_path"
+ */
+bool CheckpointExists ( const ctx_t *ctx, const char *dst_path )
+{
+    FUNC_ENTRY ( ctx );
+
+    bool exists = false;
+    char path [ 4096 ];
+
+    TRY ( CheckpointMakePath ( ctx, path, sizeof path, dst_path ) )
+    {
+        KDirectory *wd;
+        rc_t rc = KDirectoryNativeDir ( & wd );
+        if ( rc != 0 )
+            SYSTEM_ERROR ( rc, "failed to create native directory" );
+        else
+        {
+            exists = ( KDirectoryPathType ( wd, "%s/%s", path, CHECKPOINT_MANIFEST ) & ~ kptAlias ) == kptFile;
+            KDirectoryRelease ( wd );
+        }
+    }
+
+    return exists;
+}
+
+
+/* WriteManifest
+ *  writes the manifest next to the old one, then renames it over,
+ *  so that a kill while writing leaves the previous manifest intact
+ */
+static
+uint64_t CheckpointWriteLine ( const Checkpoint *self, const ctx_t *ctx,
+    KFile *f, uint64_t pos, const char *fmt, ... )
+{
+    FUNC_ENTRY ( ctx );
+
+    rc_t rc;
+    size_t num_writ;
+    char line [ 4096 + 64 ];
+
+    va_list args;
+    va_start ( args, fmt );
+    rc = string_vprintf ( line, sizeof line, & num_writ, fmt, args );
+    va_end ( args );
+
+    if ( rc != 0 )
+        INTERNAL_ERROR ( rc, "failed to format checkpoint manifest line" );
+    else
+    {
+        rc = KFileWriteAll ( f, pos, line, num_writ, & num_writ );
+        if ( rc != 0 )
+            SYSTEM_ERROR ( rc, "failed to write checkpoint manifest in '%s'", self -> path );
+    }
+
+    return pos + num_writ;
+}
+
+static
+void CheckpointWriteManifest ( const Checkpoint *self, const ctx_t *ctx )
+{
+    FUNC_ENTRY ( ctx );
+
+    KDirectory *wd;
+    rc_t rc = KDirectoryNativeDir ( & wd );
+    if ( rc != 0 )
+        SYSTEM_ERROR ( rc, "failed to create native directory" );
+    else
+    {
+        KFile *f;
+        rc = KDirectoryCreateFile ( wd, & f, false, 0664, kcmInit, "%s/%s.tmp", self -> path, CHECKPOINT_MANIFEST );
+        if ( rc != 0 )
+            SYSTEM_ERROR ( rc, "failed to create checkpoint manifest in '%s'", self -> path );
+        else
+        {
+            uint32_t i, count;
+            uint64_t pos = 0;
+
+            TRY ( pos = CheckpointWriteLine ( self, ctx, f, pos, "%s %u\n", CHECKPOINT_MAGIC, CHECKPOINT_VERS ) )
+            {
+                TRY ( pos = CheckpointWriteLine ( self, ctx, f, pos, "src %s\n", self -> src_path ) )
+                {
+                    TRY ( pos = CheckpointWriteLine ( self, ctx, f, pos, "dst %s\n", self -> dst_path ) )
+                    {
+                        pos = CheckpointWriteLine ( self, ctx, f, pos, "params %s\n", self -> params );
+                    }
+                }
+            }
+
+            count = VectorLength ( & self -> tbls );
+            for ( i = 0; ! FAILED () && i < count; ++ i )
+            {
+                const CheckpointTbl *tbl = VectorGet ( & self -> tbls, i );
+                pos = CheckpointWriteLine ( self, ctx, f, pos, "done %ld %lu %s\n",
+                    tbl -> first_id, tbl -> count, tbl -> name );
+            }
+
+            count = VectorLength ( & self -> maps );
+            for ( i = 0; ! FAILED () && i < count; ++ i )
+            {
+                const CheckpointMap *map = VectorGet ( & self -> maps, i );
+                if ( map -> since != 0 )
+                {
+                    pos = CheckpointWriteLine ( self, ctx, f, pos, "map %u %ld %lu %lu %ld %u %s\n",
+                        map -> since, map -> state . first_id, map -> state . num_ids,
+                        map -> state . num_mapped_ids, map -> state . max_new_id,
+                        map -> state . id_size, map -> name );
+                }
+            }
+
+            KFileRelease ( f );
+
+            if ( ! FAILED () )
+            {
+                char from [ 4096 + 16 ], to [ 4096 + 16 ];
+                rc = string_printf ( from, sizeof from, NULL, "%s/%s.tmp", self -> path, CHECKPOINT_MANIFEST );
+                if ( rc == 0 )
+                    rc = string_printf ( to, sizeof to, NULL, "%s/%s", self -> path, CHECKPOINT_MANIFEST );
+                if ( rc == 0 )
+                    rc = KDirectoryRename ( wd, true, from, to );
+                if ( rc != 0 )
+                    SYSTEM_ERROR ( rc, "failed to replace checkpoint manifest in '%s'", self -> path );
+            }
+        }
+
+        KDirectoryRelease ( wd );
+    }
+}
+
+
+/* LoadManifest
+ *  parses the manifest of an earlier run
+ */
+static
+void CheckpointBadManifest ( const Checkpoint *self, const ctx_t *ctx, const char *line )
+{
+    FUNC_ENTRY ( ctx );
+
+    rc_t rc = RC ( rcExe, rcFile, rcParsing, rcData, rcCorrupt );
+    ERROR ( rc, "bad line in checkpoint manifest of '%s': '%s'", self -> path, line );
+}
+
+static
+void CheckpointParseTbl ( Checkpoint *self, const ctx_t *ctx, const char *line )
+{
+    FUNC_ENTRY ( ctx );
+
+    CheckpointTbl *tbl;
+    TRY ( tbl = MemAlloc ( ctx, sizeof * tbl, true ) )
+    {
+        char *end;
+        tbl -> first_id = strtoi64 ( line, & end, 10 );
+        if ( * end == ' ' )
+            tbl -> count = strtou64 ( end + 1, & end, 10 );
+
+        if ( * end != ' ' || end [ 1 ] == 0 || string_size ( end + 1 ) >= sizeof tbl -> name )
+            CheckpointBadManifest ( self, ctx, line );
+        else
+        {
+            rc_t rc;
+            strcpy ( tbl -> name, end + 1 );
+            rc = VectorAppend ( & self -> tbls, NULL, tbl );
+            if ( rc == 0 )
+                return;
+
+            SYSTEM_ERROR ( rc, "failed to record table '%s' of checkpoint", tbl -> name );
+        }
+
+        MemFree ( ctx, tbl, sizeof * tbl );
+    }
+}
+
+static
+void CheckpointParseMap ( Checkpoint *self, const ctx_t *ctx, const char *line )
+{
+    FUNC_ENTRY ( ctx );
+
+    CheckpointMap *map;
+    TRY ( map = MemAlloc ( ctx, sizeof * map, true ) )
+    {
+        char *end;
+        map -> since = ( uint32_t ) strtou64 ( line, & end, 10 );
+        if ( * end == ' ' )
+            map -> state . first_id = strtoi64 ( end + 1, & end, 10 );
+        if ( * end == ' ' )
+            map -> state . num_ids = strtou64 ( end + 1, & end, 10 );
+        if ( * end == ' ' )
+            map -> state . num_mapped_ids = strtou64 ( end + 1, & end, 10 );
+        if ( * end == ' ' )
+            map -> state . max_new_id = strtoi64 ( end + 1, & end, 10 );
+        if ( * end == ' ' )
+            map -> state . id_size = ( uint32_t ) strtou64 ( end + 1, & end, 10 );
+
+        if ( * end != ' ' || end [ 1 ] == 0 || string_size ( end + 1 ) >= sizeof map -> name ||
+             map -> since == 0 || map -> state . id_size == 0 || map -> state . id_size > 8 )
+        {
+            CheckpointBadManifest ( self, ctx, line );
+        }
+        else
+        {
+            rc_t rc;
+            strcpy ( map -> name, end + 1 );
+            rc = VectorAppend ( & self -> maps, NULL, map );
+            if ( rc == 0 )
+                return;
+
+            SYSTEM_ERROR ( rc, "failed to record map file '%s' of checkpoint", map -> name );
+        }
+
+        MemFree ( ctx, map, sizeof * map );
+    }
+}
+
+static
+void CheckpointParseManifest ( Checkpoint *self, const ctx_t *ctx, char *text )
+{
+    FUNC_ENTRY ( ctx );
+
+    rc_t rc;
+    uint32_t i;
+    char *line, *next;
+
+    for ( i = 0, line = text; ! FAILED () && * line != 0; ++ i, line = next )
+    {
+        next = strchr ( line, '\n' );
+        if ( next == NULL )
+            next = line + strlen ( line );
+        else
+            * next ++ = 0;
+
+        if ( i == 0 )
+        {
+            char magic [ 64 ];
+            string_printf ( magic, sizeof magic, NULL, "%s %u", CHECKPOINT_MAGIC, CHECKPOINT_VERS );
+            if ( strcmp ( line, magic ) != 0 )
+                CheckpointBadManifest ( self, ctx, line );
+        }
+        else if ( strncmp ( line, "src ", 4 ) == 0 )
+        {
+            if ( strcmp ( line + 4, self -> src_path ) != 0 )
+            {
+                rc = RC ( rcExe, rcFile, rcValidating, rcPath, rcInconsistent );
+                ERROR ( rc, "checkpoint '%s' was left by a sort of '%s' - remove it to start over",
+                        self -> path, line + 4 );
+            }
+        }
+        else if ( strncmp ( line, "dst ", 4 ) == 0 )
+        {
+            if ( strcmp ( line + 4, self -> dst_path ) != 0 )
+            {
+                rc = RC ( rcExe, rcFile, rcValidating, rcPath, rcInconsistent );
+                ERROR ( rc, "checkpoint '%s' was left by a sort into '%s' - remove it to start over",
+                        self -> path, line + 4 );
+            }
+        }
+        else if ( strncmp ( line, "params ", 7 ) == 0 )
+        {
+            if ( strcmp ( line + 7, self -> params ) != 0 )
+            {
+                rc = RC ( rcExe, rcFile, rcValidating, rcParam, rcInconsistent );
+                ERROR ( rc, "checkpoint '%s' was left by a sort with other options - "
+                        "remove it to start over", self -> path );
+            }
+        }
+        else if ( strncmp ( line, "done ", 5 ) == 0 )
+            CheckpointParseTbl ( self, ctx, line + 5 );
+        else if ( strncmp ( line, "map ", 4 ) == 0 )
+            CheckpointParseMap ( self, ctx, line + 4 );
+        else
+            CheckpointBadManifest ( self, ctx, line );
+    }
+}
+
+static
+void CheckpointLoadManifest ( Checkpoint *self, const ctx_t *ctx, KDirectory *wd )
+{
+    FUNC_ENTRY ( ctx );
+
+    const KFile *f;
+    rc_t rc = KDirectoryOpenFileRead ( wd, & f, "%s/%s", self -> path, CHECKPOINT_MANIFEST );
+    if ( rc != 0 )
+        SYSTEM_ERROR ( rc, "failed to open checkpoint manifest in '%s'", self -> path );
+    else
+    {
+        uint64_t size;
+        rc = KFileSize ( f, & size );
+        if ( rc != 0 )
+            SYSTEM_ERROR ( rc, "failed to size checkpoint manifest in '%s'", self -> path );
+        else
+        {
+            char *text;
+            TRY ( text = MemAlloc ( ctx, ( size_t ) size + 1, false ) )
+            {
+                size_t num_read;
+                rc = KFileReadAll ( f, 0, text, ( size_t ) size, & num_read );
+                if ( rc != 0 )
+                    SYSTEM_ERROR ( rc, "failed to read checkpoint manifest in '%s'", self -> path );
+                else
+                {
+                    text [ num_read ] = 0;
+                    CheckpointParseManifest ( self, ctx, text );
+                }
+
+                MemFree ( ctx, text, ( size_t ) size + 1 );
+            }
+        }
+
+        KFileRelease ( f );
+    }
+}
+
+
+/* ValidateTbls
+ *  a table counts as finished only if every one of its columns
+ *  made it to disk with the id range recorded on commit.
+ *  returns the number of leading tables that did
+ */
+static
+bool CheckpointValidateTbl ( const Checkpoint *self, const ctx_t *ctx,
+    const KDatabase *db, const CheckpointTbl *tbl )
+{
+    FUNC_ENTRY ( ctx );
+
+    bool valid = false;
+
+    const KTable *t;
+    rc_t rc = KDatabaseOpenTableRead ( db, & t, "%s", tbl -> name );
+    if ( rc == 0 )
+    {
+        KNamelist *names;
+        rc = KTableListCol ( t, & names );
+        if ( rc == 0 )
+        {
+            uint32_t i, count;
+            rc = KNamelistCount ( names, & count );
+            for ( valid = rc == 0 && count != 0, i = 0; valid && i < count; ++ i )
+            {
+                const char *name;
+                const KColumn *col;
+
+                valid = false;
+                rc = KNamelistGet ( names, i, & name );
+                if ( rc == 0 )
+                    rc = KTableOpenColumnRead ( t, & col, "%s", name );
+                if ( rc == 0 )
+                {
+                    int64_t first;
+                    uint64_t num_ids;
+                    rc = KColumnIdRange ( col, & first, & num_ids );
+                    if ( rc == 0 && num_ids == tbl -> count && ( num_ids == 0 || first == tbl -> first_id ) )
+                        valid = true;
+                    else
+                        STATUS ( 2, "column '%s.%s' of checkpoint is incomplete", tbl -> name, name );
+
+                    KColumnRelease ( col );
+                }
+            }
+
+            KNamelistRelease ( names );
+        }
+
+        KTableRelease ( t );
+    }
+
+    return valid;
+}
+
+static
+uint32_t CheckpointValidateTbls ( const Checkpoint *self, const ctx_t *ctx )
+{
+    FUNC_ENTRY ( ctx );
+
+    uint32_t i = 0;
+
+    const KDatabase *db;
+    rc_t rc = KDBManagerOpenDBRead ( ctx -> caps -> kdb, & db, "%s", self -> dst_path );
+    if ( rc != 0 )
+        STATUS ( 2, "destination of checkpoint '%s' cannot be opened", self -> path );
+    else
+    {
+        uint32_t count = VectorLength ( & self -> tbls );
+        for ( ; ! FAILED () && i < count; ++ i )
+        {
+            const CheckpointTbl *tbl = VectorGet ( & self -> tbls, i );
+            if ( ! CheckpointValidateTbl ( self, ctx, db, tbl ) )
+                break;
+        }
+
+        KDatabaseRelease ( db );
+    }
+
+    return i;
+}
+
+/* Truncate
+ *  forgets the tables after the first "valid" ones,
+ *  and the state of maps that changed while copying them
+ */
+static
+void CheckpointTruncate ( Checkpoint *self, const ctx_t *ctx, uint32_t valid )
+{
+    FUNC_ENTRY ( ctx );
+
+    uint32_t i, count;
+
+    while ( VectorLength ( & self -> tbls ) > valid )
+    {
+        CheckpointTbl *tbl;
+        VectorRemove ( & self -> tbls, VectorLength ( & self -> tbls ) - 1, ( void** ) & tbl );
+        STATUS ( 1, "table '%s' of checkpoint is incomplete and will be copied again", tbl -> name );
+        MemFree ( ctx, tbl, sizeof * tbl );
+    }
+
+    count = VectorLength ( & self -> maps );
+    for ( i = 0; i < count; ++ i )
+    {
+        CheckpointMap *map = VectorGet ( & self -> maps, i );
+        if ( map -> since > valid )
+        {
+            map -> since = 0;
+            memset ( & map -> state, 0, sizeof map -> state );
+        }
+    }
+}
+
+
+/* Make
+ *  creates the checkpoint directory for the object being sorted,
+ *  or loads the manifest of an earlier run with the same parameters
+ *  and validates the tables it recorded as finished
+ */
+static
+void CheckpointInit ( Checkpoint *self, const ctx_t *ctx )
+{
+    FUNC_ENTRY ( ctx );
+
+    KDirectory *wd;
+    rc_t rc = KDirectoryNativeDir ( & wd );
+    if ( rc != 0 )
+        SYSTEM_ERROR ( rc, "failed to create native directory" );
+    else
+    {
+        if ( ( KDirectoryPathType ( wd, "%s/%s", self -> path, CHECKPOINT_MANIFEST ) & ~ kptAlias ) == kptFile )
+        {
+            TRY ( CheckpointLoadManifest ( self, ctx, wd ) )
+            {
+                uint32_t valid;
+                TRY ( valid = CheckpointValidateTbls ( self, ctx ) )
+                {
+                    STATUS ( 1, "resuming from checkpoint '%s' with %u finished tables", self -> path, valid );
+                    CheckpointTruncate ( self, ctx, valid );
+                    self -> resuming = true;
+                }
+            }
+        }
+        else
+        {
+            rc = KDirectoryCreateDir ( wd, 0775, kcmOpen | kcmParents, "%s", self -> path );
+            if ( rc != 0 )
+                SYSTEM_ERROR ( rc, "failed to create checkpoint directory '%s'", self -> path );
+            else
+                STATUS ( 2, "writing checkpoint to '%s'", self -> path );
+        }
+
+        KDirectoryRelease ( wd );
+    }
+
+    /* a fresh manifest lets a rerun find the checkpoint,
+       a truncated one keeps a later kill from trusting stale tables */
+    if ( ! FAILED () )
+        CheckpointWriteManifest ( self, ctx );
+}
+
+Checkpoint *CheckpointMake ( const ctx_t *ctx, const char *src_path, const char *dst_path )
+{
+    FUNC_ENTRY ( ctx );
+
+    Checkpoint *ckpt;
+    TRY ( ckpt = MemAlloc ( ctx, sizeof * ckpt, true ) )
+    {
+        VectorInit ( & ckpt -> tbls, 0, 8 );
+        VectorInit ( & ckpt -> maps, 0, 4 );
+        ckpt -> src_path = src_path;
+        ckpt -> dst_path = dst_path;
+
+        TRY ( CheckpointMakePath ( ctx, ckpt -> path, sizeof ckpt -> path, dst_path ) )
+        {
+            TRY ( CheckpointMakeParams ( ctx, ckpt -> params, sizeof ckpt -> params ) )
+            {
+                TRY ( CheckpointInit ( ckpt, ctx ) )
+                {
+                    return ckpt;
+                }
+            }
+        }
+
+        CheckpointRelease ( ckpt, ctx );
+    }
+
+    return NULL;
+}
+
+
+/* Release
+ *  removes the checkpoint directory if the sort was finished
+ */
+static
+void CC CheckpointWhackTbl ( void *item, void *data )
+{
+    const ctx_t *ctx = ( const void* ) data;
+    MemFree ( ctx, item, sizeof ( CheckpointTbl ) );
+}
+
+static
+void CC CheckpointWhackMap ( void *item, void *data )
+{
+    const ctx_t *ctx = ( const void* ) data;
+    MemFree ( ctx, item, sizeof ( CheckpointMap ) );
+}
+
+void CheckpointRelease ( Checkpoint *self, const ctx_t *ctx )
+{
+    FUNC_ENTRY ( ctx );
+
+    if ( self != NULL )
+    {
+        if ( self -> finished )
+        {
+            KDirectory *wd;
+            rc_t rc = KDirectoryNativeDir ( & wd );
+            if ( rc == 0 )
+            {
+                rc = KDirectoryRemove ( wd, true, "%s", self -> path );
+                KDirectoryRelease ( wd );
+            }
+            if ( rc != 0 )
+                WARN ( "failed to remove checkpoint '%s'", self -> path );
+        }
+
+        VectorWhack ( & self -> tbls, CheckpointWhackTbl, ( void* ) ctx );
+        VectorWhack ( & self -> maps, CheckpointWhackMap, ( void* ) ctx );
+        MemFree ( ctx, self, sizeof * self );
+    }
+}
+
+
+/* Resuming
+ *  true if the manifest of an earlier run was loaded
+ */
+bool CheckpointResuming ( const Checkpoint *self )
+{
+    return self != NULL && self -> resuming;
+}
+
+
+/* Path
+ *  the directory holding manifest and map files
+ */
+const char *CheckpointPath ( const Checkpoint *self )
+{
+    return self -> path;
+}
+
+
+/* TableDone
+ *  true if table "name" was finished by an earlier run
+ */
+bool CheckpointTableDone ( const Checkpoint *self, const char *name )
+{
+    if ( self != NULL )
+    {
+        uint32_t i, count = VectorLength ( & self -> tbls );
+        for ( i = 0; i < count; ++ i )
+        {
+            const CheckpointTbl *tbl = VectorGet ( & self -> tbls, i );
+            if ( strcmp ( tbl -> name, name ) == 0 )
+                return true;
+        }
+    }
+
+    return false;
+}
+
+
+/* CommitTable
+ *  flushes all live map files and records table "name"
+ *  with its id range as finished
+ */
+void CheckpointCommitTable ( Checkpoint *self, const ctx_t *ctx,
+    const char *name, int64_t first_id, uint64_t count )
+{
+    FUNC_ENTRY ( ctx );
+
+    uint32_t i, num_maps = VectorLength ( & self -> maps );
+    uint32_t commit = VectorLength ( & self -> tbls ) + 1;
+
+    /* map files first: a table is not finished before
+       the mappings it produced are on disk */
+    for ( i = 0; i < num_maps; ++ i )
+    {
+        CheckpointMap *map = VectorGet ( & self -> maps, i );
+        if ( map -> mf != NULL )
+        {
+            MapFileState state;
+            ON_FAIL ( MapFileSeal ( map -> mf, ctx, & state ) )
+                return;
+
+            if ( map -> since == 0 || memcmp ( & state, & map -> state, sizeof state ) != 0 )
+            {
+                map -> state = state;
+                map -> since = commit;
+            }
+        }
+    }
+
+    if ( string_size ( name ) >= sizeof ( ( CheckpointTbl* ) 0 ) -> name )
+    {
+        rc_t rc = RC ( rcExe, rcTable, rcCommitting, rcName, rcExcessive );
+        INTERNAL_ERROR ( rc, "table name '%s' is too long for checkpoint", name );
+    }
+    else
+    {
+        CheckpointTbl *tbl;
+        TRY ( tbl = MemAlloc ( ctx, sizeof * tbl, true ) )
+        {
+            rc_t rc;
+            tbl -> first_id = first_id;
+            tbl -> count = count;
+            strcpy ( tbl -> name, name );
+
+            rc = VectorAppend ( & self -> tbls, NULL, tbl );
+            if ( rc != 0 )
+            {
+                SYSTEM_ERROR ( rc, "failed to record table '%s' of checkpoint", name );
+                MemFree ( ctx, tbl, sizeof * tbl );
+            }
+            else
+            {
+                TRY ( CheckpointWriteManifest ( self, ctx ) )
+                {
+                    STATUS ( 2, "checkpoint: committed table '%s'", name );
+                }
+            }
+        }
+    }
+}
+
+
+/* AddMap
+ *  registers a map file to be flushed on every commit
+ * DropMap
+ *  called when the map file is released, keeps its last state
+ */
+void CheckpointAddMap ( Checkpoint *self, const ctx_t *ctx,
+    const char *name, MapFile *mf )
+{
+    FUNC_ENTRY ( ctx );
+
+    rc_t rc;
+    CheckpointMap *map;
+    uint32_t i, count = VectorLength ( & self -> maps );
+
+    for ( i = 0; i < count; ++ i )
+    {
+        map = VectorGet ( & self -> maps, i );
+        if ( strcmp ( map -> name, name ) == 0 )
+        {
+            map -> mf = mf;
+            return;
+        }
+    }
+
+    if ( string_size ( name ) >= sizeof map -> name )
+    {
+        rc = RC ( rcExe, rcFile, rcRegistering, rcName, rcExcessive );
+        INTERNAL_ERROR ( rc, "map file name '%s' is too long for checkpoint", name );
+        return;
+    }
+
+    TRY ( map = MemAlloc ( ctx, sizeof * map, true ) )
+    {
+        map -> mf = mf;
+        strcpy ( map -> name, name );
+
+        rc = VectorAppend ( & self -> maps, NULL, map );
+        if ( rc != 0 )
+        {
+            SYSTEM_ERROR ( rc, "failed to record map file '%s' of checkpoint", name );
+            MemFree ( ctx, map, sizeof * map );
+        }
+    }
+}
+
+void CheckpointDropMap ( Checkpoint *self, const MapFile *mf )
+{
+    if ( self != NULL )
+    {
+        uint32_t i, count = VectorLength ( & self -> maps );
+        for ( i = 0; i < count; ++ i )
+        {
+            CheckpointMap *map = VectorGet ( & self -> maps, i );
+            if ( map -> mf == mf )
+                map -> mf = NULL;
+        }
+    }
+}
+
+
+/* FindMap
+ *  returns true with the recorded state of map "name"
+ *  if it was flushed by an earlier run
+ */
+bool CheckpointFindMap ( const Checkpoint *self, const char *name, MapFileState *state )
+{
+    if ( self != NULL )
+    {
+        uint32_t i, count = VectorLength ( & self -> maps );
+        for ( i = 0; i < count; ++ i )
+        {
+            const CheckpointMap *map = VectorGet ( & self -> maps, i );
+            if ( strcmp ( map -> name, name ) == 0 )
+            {
+                /* a map nothing was written to yet is simply created again */
+                if ( map -> since == 0 || map -> state . max_new_id == 0 )
+                    return false;
+
+                * state = map -> state;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+
+/* Finish
+ *  marks the sort as finished
+ */
+void CheckpointFinish ( Checkpoint *self, const ctx_t *ctx )
+{
+    if ( self != NULL )
+        self -> finished = true;
+}
@@ -0,0 +1,120 @@
+/*===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ */
+
+#ifndef _h_sra_sort_checkpoint_
+#define _h_sra_sort_checkpoint_
+
+#ifndef _h_sra_sort_defs_
+#include "sort-defs.h"
+#endif
+
+
+/*--------------------------------------------------------------------------
+ * forwards
+ */
+struct MapFile;
+struct MapFileState;
+
+
+/*--------------------------------------------------------------------------
+ * Checkpoint
+ *  a directory next to the destination object, holding a manifest of
+ *  the finished tables and the id map files they left behind, so that
+ *  a sort that was interrupted can be resumed by running it again
+ */
+typedef struct Checkpoint Checkpoint;
+
+
+/* Exists
+ *  true if an earlier run left a checkpoint for "dst_path"
+ */
+bool CheckpointExists ( const ctx_t *ctx, const char *dst_path );
+
+
+/* Make
+ *  creates the checkpoint directory for the object being sorted,
+ *  or loads the manifest of an earlier run with the same parameters
+ *  and validates the tables it recorded as finished
+ */
+Checkpoint *CheckpointMake ( const ctx_t *ctx, const char *src_path, const char *dst_path );
+
+
+/* Release
+ *  removes the checkpoint directory if the sort was finished
+ */
+void CheckpointRelease ( Checkpoint *self, const ctx_t *ctx );
+
+
+/* Resuming
+ *  true if the manifest of an earlier run was loaded
+ */
+bool CheckpointResuming ( const Checkpoint *self );
+
+
+/* Path
+ *  the directory holding manifest and map files
+ */
+const char *CheckpointPath ( const Checkpoint *self );
+
+
+/* TableDone
+ *  true if table "name" was finished by an earlier run
+ */
+bool CheckpointTableDone ( const Checkpoint *self, const char *name );
+
+
+/* CommitTable
+ *  flushes all live map files and records table "name"
+ *  with its id range as finished
+ */
+void CheckpointCommitTable ( Checkpoint *self, const ctx_t *ctx,
+    const char *name, int64_t first_id, uint64_t count );
+
+
+/* AddMap
+ *  registers a map file to be flushed on every commit
+ * DropMap
+ *  called when the map file is released, keeps its last state
+ */
+void CheckpointAddMap ( Checkpoint *self, const ctx_t *ctx,
+    const char *name, struct MapFile *mf );
+void CheckpointDropMap ( Checkpoint *self, const struct MapFile *mf );
+
+
+/* FindMap
+ *  returns true with the recorded state of map "name"
+ *  if it was flushed by an earlier run
+ */
+bool CheckpointFindMap ( const Checkpoint *self, const char *name, struct MapFileState *state );
+
+
+/* Finish
+ *  marks the sort as finished
+ */
+void CheckpointFinish ( Checkpoint *self, const ctx_t *ctx );
+
+
+#endif
@@ -29,6 +29,8 @@ struct cSRAPair;
 
 #include "csra-pair.h"
 #include "csra-tbl.h"
+#include "ref-alignid-col.h"
+#include "presorted.h"
 #include "meta-pair.h"
 #include "dir-pair.h"
 #include "sra-sort.h"
@@ -100,6 +102,45 @@ TablePair *cSRAPairMakeTablePair ( cSRAPair *self, const ctx_t *ctx,
     return NULL;
 }
 
+/* CheckPresorted
+ *  scans the input before anything is copied. when the sort would hand
+ *  every row its own id back, the tables are copied in row order and the
+ *  sort itself - positions read by alignment id, id maps - is skipped
+ */
+static
+void cSRAPairCheckPresorted ( cSRAPair *self, const ctx_t *ctx )
+{
+    FUNC_ENTRY ( ctx );
+
+    const VCursor *curs;
+    int64_t first_unaligned;
+
+    if ( ctx -> caps -> tool -> full_sort || self -> sequence == NULL || self -> evidence_align != NULL )
+        return;
+
+    STATUS ( 2, "checking whether '%s' is in sorted order", self -> dad . full_spec );
+
+    TRY ( self -> chunk_size = ( uint32_t ) RefTblPairGetChunkSize ( self -> reference, ctx, & curs ) )
+    {
+        VCursorRelease ( curs );
+
+        if ( TablePairAlignIdsPresorted ( self -> reference, ctx,
+                 self -> prim_align, "(I64)PRIMARY_ALIGNMENT_IDS", self -> chunk_size ) &&
+             ( self -> sec_align == NULL || TablePairAlignIdsPresorted ( self -> reference, ctx,
+                 self -> sec_align, "(I64)SECONDARY_ALIGNMENT_IDS", self -> chunk_size ) ) &&
+             TablePairSeqSpotIdsPresorted ( self -> prim_align, ctx, self -> sequence, & first_unaligned ) )
+        {
+            self -> presorted = true;
+            self -> first_unaligned_spot = first_unaligned;
+            STATUS ( 1, "'%s' is already sorted - copying tables in row order", self -> dad . full_spec );
+        }
+        else if ( ! FAILED () )
+        {
+            STATUS ( 2, "'%s' is not in sorted order", self -> dad . full_spec );
+        }
+    }
+}
+
 static
 void cSRAPairExplode ( cSRAPair *self, const ctx_t *ctx )
 {
@@ -151,6 +192,9 @@ void cSRAPairExplode ( cSRAPair *self, const ctx_t *ctx )
 #endif
         }
     }
+
+    if ( ! FAILED () )
+        cSRAPairCheckPresorted ( self, ctx );
 }
 
 static
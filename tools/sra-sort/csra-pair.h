@@ -67,6 +67,13 @@ struct cSRAPair
 
     /* mapping indices */
     struct MapFile *pa_idx, *sa_idx, *seq_idx;
+
+    /* chunk size of the reference table */
+    uint32_t chunk_size;
+
+    /* the input was found in sorted order - tables
+       are copied in row order, without mapping indices */
+    bool presorted;
 };
 
 
@@ -34,6 +34,7 @@ struct cSRATblPair;
 #include "id-mapper-col.h"
 #include "buff-writer.h"
 #include "poslen-col-pair.h"
+#include "glob-poslen.h"
 #include "meta-pair.h"
 #include "map-file.h"
 #include "xcheck.h"
@@ -77,6 +78,22 @@ void cSRATblPairDummyStub ( cSRATblPair *self, const ctx_t *ctx )
 
 /* REFERENCE table
  */
+
+/* MakeAlignIdReader
+ *  the ids of an input in sorted order are copied as they are
+ */
+static
+ColumnReader *cSRATblPairMakeAlignIdReader ( cSRATblPair *self, const ctx_t *ctx,
+    TablePair *align_tbl, MapFile *idx, const char *colspec )
+{
+    FUNC_ENTRY ( ctx );
+
+    if ( self -> csra -> presorted )
+        return TablePairMakeColumnReader ( & self -> dad, ctx, NULL, colspec, true );
+
+    return TablePairMakeAlignIdReader ( & self -> dad, ctx, align_tbl, idx, colspec );
+}
+
 static
 ColumnPair *cSRATblPairMakePrimAlignIdColPair ( cSRATblPair *self, const ctx_t *ctx )
 {
@@ -88,7 +105,7 @@ ColumnPair *cSRATblPairMakePrimAlignIdColPair ( cSRATblPair *self, const ctx_t *
     ColumnReader *reader;
     const char *colspec = "(I64)PRIMARY_ALIGNMENT_IDS";
 
-    TRY ( reader = TablePairMakeAlignIdReader ( & self -> dad, ctx,
+    TRY ( reader = cSRATblPairMakeAlignIdReader ( self, ctx,
               csra -> prim_align, csra -> pa_idx, colspec ) )
     {
         ColumnWriter *writer;
@@ -118,7 +135,7 @@ ColumnPair *cSRATblPairMakeSecAlignIdColPair ( cSRATblPair *self, const ctx_t *c
         ColumnReader *reader;
         const char *colspec = "(I64)SECONDARY_ALIGNMENT_IDS";
 
-        TRY ( reader = TablePairMakeAlignIdReader ( & self -> dad, ctx,
+        TRY ( reader = cSRATblPairMakeAlignIdReader ( self, ctx,
                   csra -> sec_align, csra -> sa_idx, colspec ) )
         {
             ColumnWriter *writer;
@@ -213,6 +230,13 @@ void cSRATblPairWhackMappingIdx ( cSRATblPair * self, const ctx_t * ctx )
     csra -> seq_idx = NULL;
 }
 
+/* PRIMARY_ALIGNMENT.SEQ_SPOT_ID
+ *  the primary table is written in reference position order, and the
+ *  map-writer hands out a new SEQUENCE row-id the first time it sees a spot.
+ *  this relays SEQUENCE in first-alignment order, so that position ordered
+ *  readers walk SEQUENCE mostly sequentially. unaligned spots are appended
+ *  behind the aligned ones by cSRATblPairPreCopySeq.
+ */
 static
 ColumnPair *cSRATblPairMakeSeqSpotIdColPairPrim ( cSRATblPair *self, const ctx_t *ctx )
 {
@@ -290,18 +314,55 @@ ColumnPair *cSRATblPairMakeSeqSpotIdColPair ( cSRATblPair *self, const ctx_t *ct
     return col;
 }
 
+/* SEQ_SPOT_ID of an input in sorted order
+ *  SEQUENCE keeps its row-ids, so the column is copied as it is
+ */
+static
+ColumnPair *cSRATblPairMakeSeqSpotIdColPairPresorted ( cSRATblPair *self, const ctx_t *ctx )
+{
+    FUNC_ENTRY ( ctx );
+
+    ColumnPair *col = NULL;
+
+    ColumnReader *reader;
+    const char *colspec = "(I64)SEQ_SPOT_ID";
+
+    /* we expect this column to be present */
+    TRY ( reader = TablePairMakeColumnReader ( & self -> dad, ctx, NULL, colspec, true ) )
+    {
+        ColumnWriter *writer;
+        TRY ( writer = TablePairMakeColumnWriter ( & self -> dad, ctx, NULL, colspec ) )
+        {
+            col = TablePairMakeColumnPair ( & self -> dad, ctx, reader, writer, colspec, false );
+
+            ColumnWriterRelease ( writer, ctx );
+        }
+
+        ColumnReaderRelease ( reader, ctx );
+    }
+
+    return col;
+}
+
 static
 ColumnPair *cSRATblPairMakePoslenColPair ( cSRATblPair *self, const ctx_t *ctx, const MapFile *idx )
 {
     FUNC_ENTRY ( ctx );
 
     ColumnPair *col = NULL;
+    cSRAPair *csra = self -> csra;
 
     ColumnReader *reader;
     const char *colspec = "(U64)GLOBAL_POSLEN";
 
-    /* we expect this column to be present */
-    TRY ( reader = TablePairMakePoslenColReader ( & self -> dad, ctx, idx, colspec ) )
+    /* we expect this column to be present - an input in sorted order
+       has its positions read in row order, rather than from the index */
+    if ( csra -> presorted )
+        reader = TablePairMakeGlobalPosLenReader ( & self -> dad, ctx, csra -> chunk_size );
+    else
+        reader = TablePairMakePoslenColReader ( & self -> dad, ctx, idx, colspec );
+
+    if ( ! FAILED () )
     {
         ColumnWriter *writer;
         TRY ( writer = TablePairMakePoslenColWriter ( & self -> dad, ctx, NULL, colspec ) )
@@ -323,6 +384,10 @@ void cSRATblPairPreExplodeAlign ( cSRATblPair *self, const ctx_t *ctx )
     FUNC_ENTRY ( ctx );
     cSRAPair *csra = self -> csra;
 
+    /* an input in sorted order keeps its row-ids */
+    if ( csra -> presorted )
+        return;
+
     switch ( self -> align_idx )
     {
     case 1:
@@ -345,12 +410,16 @@ void cSRATblPairExplodeAlign ( cSRATblPair *self, const ctx_t *ctx )
     switch ( self -> align_idx )
     {
     case 1:
-        col = cSRATblPairMakeSeqSpotIdColPairPrim ( self, ctx );
+        col = self -> csra -> presorted ?
+            cSRATblPairMakeSeqSpotIdColPairPresorted ( self, ctx ):
+            cSRATblPairMakeSeqSpotIdColPairPrim ( self, ctx );
         break;
     case 0:
     case 2:
     case 3:
-        col = cSRATblPairMakeSeqSpotIdColPair ( self, ctx );
+        col = self -> csra -> presorted ?
+            cSRATblPairMakeSeqSpotIdColPairPresorted ( self, ctx ):
+            cSRATblPairMakeSeqSpotIdColPair ( self, ctx );
         break;
     default:
         ANNOTATE ( "not going to dignify with an rc - bad align_idx" );
@@ -398,6 +467,10 @@ ColumnPair *cSRATblPairMakeColumnPairAlign ( cSRATblPair *self, const ctx_t *ctx
     ColumnPair *col = NULL;
     ColumnWriter *buffered;
 
+    /* an input in sorted order is written in row order */
+    if ( self -> csra -> presorted )
+        return TablePairMakeColumnPair ( & self -> dad, ctx, reader, writer, colspec, large );
+
     switch ( self -> align_idx )
     {
     case 0:
@@ -533,15 +606,21 @@ ColumnPair *cSRATblPairMakeSeqPrimAlignIdColPair ( cSRATblPair *self, const ctx_
                 ColumnWriter *capture;
                 TRY ( capture = cSRAPairMakeFirstHalfAlignedRowIdCaptureWriter ( csra, ctx, writer ) )
                 {
-                    ColumnWriter *buffered;
-
-                    /* create a buffered writer WITHOUT id-assignment capabilities. */
-                    TRY ( buffered = cSRATblPairMakeBufferedIdRemapColumnWriter ( self, ctx,
-                              capture, csra -> pa_idx, false ) )
+                    /* an input in sorted order is written in row order */
+                    if ( csra -> presorted )
+                        col = TablePairMakeColumnPair ( & self -> dad, ctx, reader, capture, colspec, true );
+                    else
                     {
-                        col = TablePairMakeColumnPair ( & self -> dad, ctx, reader, buffered, colspec, true );
+                        ColumnWriter *buffered;
+
+                        /* create a buffered writer WITHOUT id-assignment capabilities. */
+                        TRY ( buffered = cSRATblPairMakeBufferedIdRemapColumnWriter ( self, ctx,
+                                  capture, csra -> pa_idx, false ) )
+                        {
+                            col = TablePairMakeColumnPair ( & self -> dad, ctx, reader, buffered, colspec, true );
 
-                        ColumnWriterRelease ( buffered, ctx );
+                            ColumnWriterRelease ( buffered, ctx );
+                        }
                     }
 
                     ColumnWriterRelease ( capture, ctx );
@@ -564,18 +643,25 @@ void cSRATblPairPreExplodeSeq ( cSRATblPair *self, const ctx_t *ctx )
     TRY ( TablePairExplode ( & self -> dad, ctx ) )
     {
         cSRAPair *csra = self -> csra;
-        TRY ( csra -> seq_idx = MapFileMake ( ctx, self -> dad . name, true ) )
+
+        /* an input in sorted order keeps its row-ids */
+        if ( ! csra -> presorted )
         {
-            TRY ( MapFileSetIdRange ( csra -> seq_idx, ctx, self -> dad . first_id,
-                      self -> dad . last_excl - self -> dad . first_id ) )
+            TRY ( csra -> seq_idx = MapFileMake ( ctx, self -> dad . name, true ) )
             {
-                ColumnPair *col;
+                MapFileSetIdRange ( csra -> seq_idx, ctx, self -> dad . first_id,
+                    self -> dad . last_excl - self -> dad . first_id );
+            }
+        }
 
-                /* create special case for PRIMARY_ALIGNMENT_ID */
-                TRY ( col = cSRATblPairMakeSeqPrimAlignIdColPair ( self, ctx ) )
-                {
-                    TablePairAddColumnPair ( & self -> dad, ctx, col );
-                }
+        if ( ! FAILED () )
+        {
+            ColumnPair *col;
+
+            /* create special case for PRIMARY_ALIGNMENT_ID */
+            TRY ( col = cSRATblPairMakeSeqPrimAlignIdColPair ( self, ctx ) )
+            {
+                TablePairAddColumnPair ( & self -> dad, ctx, col );
             }
         }
     }
@@ -590,6 +676,10 @@ ColumnPair *cSRATblPairMakeColumnPairSeq ( cSRATblPair *self, const ctx_t *ctx,
     ColumnPair *col = NULL;
     ColumnWriter *buffered;
 
+    /* an input in sorted order is written in row order */
+    if ( self -> csra -> presorted )
+        return TablePairMakeColumnPair ( & self -> dad, ctx, reader, writer, colspec, large );
+
     TRY ( buffered = cSRATblPairMakeBufferedColumnWriter ( self, ctx, writer ) )
     {
         col = TablePairMakeColumnPair ( & self -> dad, ctx, reader, buffered, colspec, large );
@@ -606,6 +696,12 @@ void cSRATblPairPreCopySeq ( cSRATblPair *self, const ctx_t *ctx )
 
     cSRAPair *csra = self -> csra;
 
+    /* unaligned sequences of an input in sorted order are behind
+       the aligned ones already, "first_unaligned_spot" was set
+       when the input was scanned */
+    if ( csra -> presorted )
+        return;
+
     STATUS ( 3, "assigning new row-ids to unaligned sequences" );
     csra -> first_unaligned_spot = MapFileAllocMissingNewIds ( self -> csra -> seq_idx, ctx );
 }
@@ -32,6 +32,7 @@ typedef struct DbPair StdDbPair;
 #include "tbl-pair.h"
 #include "dir-pair.h"
 #include "meta-pair.h"
+#include "checkpoint.h"
 #include "sra-sort.h"
 #include "ctx.h"
 #include "caps.h"
@@ -216,9 +217,31 @@ bool CC DbPairCopyTablePair ( void *item, void *data )
 {
     const ctx_t *ctx = ( const void* ) data;
     FUNC_ENTRY ( ctx );
-    TRY ( TablePairCopy ( item, ctx ) )
+
+    TablePair *tbl = item;
+    Checkpoint *ckpt = ctx -> caps -> tool -> ckpt;
+
+    if ( CheckpointTableDone ( ckpt, tbl -> name ) )
     {
-        return false;
+        /* finished by an earlier run - only what follows the copy
+           is repeated, i.e. the consistency-check of alignments */
+        STATUS ( 2, "table '%s' was finished by an earlier run", tbl -> full_spec );
+        TRY ( TablePairPostCopy ( tbl, ctx ) )
+        {
+            return false;
+        }
+        return true;
+    }
+
+    TRY ( TablePairCopy ( tbl, ctx ) )
+    {
+        if ( ckpt == NULL )
+            return false;
+
+        TRY ( CheckpointCommitTable ( ckpt, ctx, tbl -> name, tbl -> first_id, tbl -> last_excl - tbl -> first_id ) )
+        {
+            return false;
+        }
     }
     return true;
 }
@@ -608,7 +631,13 @@ TablePair *DbPairMakeTablePair ( DbPair *self, const ctx_t *ctx, const char *mem
         {
             VTable *dst;
             const Tool *tp = ctx -> caps -> tool;
-            rc = VDatabaseCreateTable ( self -> ddb, & dst, member, kcmOpen | ( tp -> db . cmode & kcmMD5 ), "%s", name );
+
+            /* a table an earlier run did not finish is started over */
+            KCreateMode cmode = kcmOpen;
+            if ( CheckpointResuming ( tp -> ckpt ) && ! CheckpointTableDone ( tp -> ckpt, name ) )
+                cmode = kcmInit;
+
+            rc = VDatabaseCreateTable ( self -> ddb, & dst, member, cmode | ( tp -> db . cmode & kcmMD5 ), "%s", name );
             if ( rc != 0 )
                 ERROR ( rc, "VDatabaseCreateTable: failed to create %s table '%s.%s'", member, self -> full_spec, name );
             else
@@ -26,6 +26,7 @@
 
 #include "map-file.h"
 #include "idx-mapping.h"
+#include "checkpoint.h"
 #include "ctx.h"
 #include "caps.h"
 #include "status.h"
@@ -38,6 +39,7 @@
 #include <klib/refcount.h>
 #include <klib/sort.h>
 #include <klib/rc.h>
+#include <klib/text.h>
 
 #include <string.h>
 #include <endian.h>
@@ -59,18 +61,160 @@ struct MapFile
     uint64_t num_mapped_ids;
     int64_t max_new_id;
     KFile *f_old, *f_new, *f_pos;
+    /* the files under the buffers, kept only for a checkpoint */
+    KFile *b_old, *b_new, *b_pos;
+    size_t bsize;
     size_t id_size;
+
+    /* mappings held in memory instead of files:
+       ids are bit-packed, poslen is delta-encoded in blocks */
+    uint64_t *m_old, *m_new;
+    size_t m_ids_bytes;
+    uint8_t *m_pos;
+    uint64_t *m_pos_blk;
+    size_t m_pos_size, m_pos_cap, m_pos_blk_bytes;
+    uint64_t m_pos_count, m_pos_last;
+    uint32_t id_bits;
+
+    bool random;
+    bool for_poslen;
+    bool have_forks;
+
     KRefcount refcount;
+    char name [ 64 ];
 };
 
 
+/* memory backend
+ *  an id of "id_bits" bits at index "idx" of a bit-packed array
+ *  the arrays have one word of padding at their end
+ */
+static
+uint64_t bits_get ( const uint64_t *words, uint32_t bits, uint64_t idx )
+{
+    uint64_t bit = idx * bits;
+    uint32_t off = ( uint32_t ) ( bit & 63 );
+    uint64_t val = words [ bit >> 6 ] >> off;
+    if ( off + bits > 64 )
+        val |= words [ ( bit >> 6 ) + 1 ] << ( 64 - off );
+    if ( bits < 64 )
+        val &= ( ( uint64_t ) 1 << bits ) - 1;
+    return val;
+}
+
+static
+void bits_set ( uint64_t *words, uint32_t bits, uint64_t idx, uint64_t val )
+{
+    uint64_t bit = idx * bits;
+    uint32_t off = ( uint32_t ) ( bit & 63 );
+    uint64_t mask = ( bits < 64 ) ? ( ( uint64_t ) 1 << bits ) - 1 : ~ ( uint64_t ) 0;
+    uint64_t *w = & words [ bit >> 6 ];
+
+    val &= mask;
+    w [ 0 ] = ( w [ 0 ] & ~ ( mask << off ) ) | ( val << off );
+    if ( off + bits > 64 )
+    {
+        w [ 1 ] = ( w [ 1 ] & ~ ( mask >> ( 64 - off ) ) ) | ( val >> ( 64 - off ) );
+    }
+}
+
+/* poslen is written in new-id order, i.e. almost sorted - every
+   value is stored as a zig-zag varint of its difference to the one
+   before, restarting at each block so that a read can seek */
+#define POSLEN_BLOCK_IDS 256
+
+static
+size_t poslen_encode ( uint8_t *dst, uint64_t prior, uint64_t val )
+{
+    int64_t diff = ( int64_t ) ( val - prior );
+    uint64_t zz = ( ( uint64_t ) diff << 1 ) ^ ( uint64_t ) ( diff >> 63 );
+    size_t i;
+
+    for ( i = 0; zz >= 0x80; ++ i, zz >>= 7 )
+        dst [ i ] = ( uint8_t ) ( zz | 0x80 );
+    dst [ i ] = ( uint8_t ) zz;
+
+    return i + 1;
+}
+
+static
+size_t poslen_decode ( const uint8_t *src, uint64_t prior, uint64_t *val )
+{
+    uint64_t zz = 0;
+    uint32_t shift;
+    size_t i;
+
+    for ( i = 0, shift = 0; src [ i ] & 0x80; ++ i, shift += 7 )
+        zz |= ( uint64_t ) ( src [ i ] & 0x7F ) << shift;
+    zz |= ( uint64_t ) src [ i ] << shift;
+
+    * val = prior + ( ( zz >> 1 ) ^ ( ~ ( zz & 1 ) + 1 ) );
+    return i + 1;
+}
+
+/* all id maps together stay within the "map_mem_limit" of Tool
+   as well as within the quota of the memory bank */
+static size_t map_mem_in_use;
+
+static
+bool MapFileMemFits ( const ctx_t *ctx, size_t bytes )
+{
+    size_t in_use, quota;
+    const Tool *tp = ctx -> caps -> tool;
+
+    /* the maps of a checkpoint have to be in files */
+    if ( tp -> ckpt != NULL || bytes > tp -> map_mem_limit - map_mem_in_use )
+        return false;
+
+    in_use = MemInUse ( ctx, & quota );
+    return in_use <= quota && bytes <= quota - in_use;
+}
+
+static
+void *MapFileMemAlloc ( const ctx_t *ctx, size_t bytes, bool clear )
+{
+    void *mem = MemAlloc ( ctx, bytes, clear );
+    if ( mem != NULL )
+        map_mem_in_use += bytes;
+    return mem;
+}
+
+static
+void MapFileMemFree ( const ctx_t *ctx, void *mem, size_t bytes )
+{
+    if ( mem != NULL )
+    {
+        MemFree ( ctx, mem, bytes );
+        map_mem_in_use -= bytes;
+    }
+}
+
+static
+void MapFileReleaseMem ( MapFile *self, const ctx_t *ctx )
+{
+    MapFileMemFree ( ctx, self -> m_old, self -> m_ids_bytes );
+    MapFileMemFree ( ctx, self -> m_new, self -> m_ids_bytes );
+    MapFileMemFree ( ctx, self -> m_pos, self -> m_pos_cap );
+    MapFileMemFree ( ctx, self -> m_pos_blk, self -> m_pos_blk_bytes );
+
+    self -> m_old = self -> m_new = self -> m_pos_blk = NULL;
+    self -> m_pos = NULL;
+    self -> m_ids_bytes = self -> m_pos_size = self -> m_pos_cap = self -> m_pos_blk_bytes = 0;
+    self -> m_pos_count = self -> m_pos_last = 0;
+}
+
+
 /* Whack
  */
 static
 void MapFileWhack ( MapFile *self, const ctx_t *ctx )
 {
     FUNC_ENTRY ( ctx );
-    rc_t rc = KFileRelease ( self -> f_old );
+    rc_t rc;
+
+    CheckpointDropMap ( ctx -> caps -> tool -> ckpt, self );
+
+    rc = KFileRelease ( self -> f_old );
     if ( rc != 0 )
         SYSTEM_ERROR ( rc, "KFileRelease failed on old=>new" );
     else
@@ -84,6 +228,12 @@ void MapFileWhack ( MapFile *self, const ctx_t *ctx )
             if ( rc != 0 )
                 ABORT ( rc, "KFileRelease failed on global poslen temp column" );
         }
+
+        KFileRelease ( self -> b_old );
+        KFileRelease ( self -> b_new );
+        KFileRelease ( self -> b_pos );
+
+        MapFileReleaseMem ( self, ctx );
         
         MemFree ( ctx, self, sizeof * self );
     }
@@ -94,27 +244,70 @@ void MapFileWhack ( MapFile *self, const ctx_t *ctx )
  *  creates an id map
  */
 static
-void MapFileMakeFork ( KFile **fp, const ctx_t *ctx, const char *name,
-    KDirectory *wd, const char *tmpdir, int pid, size_t bsize, const char *fork )
+void MapFileMakeCheckpointFork ( KFile **fp, KFile **bp, const ctx_t *ctx, const char *name,
+    KDirectory *wd, const Checkpoint *ckpt, bool restore, size_t bsize, const char *fork )
+{
+    FUNC_ENTRY ( ctx );
+
+    /* the files of a checkpoint have a fixed name and are not unlinked */
+    rc_t rc;
+    const char *path = CheckpointPath ( ckpt );
+
+    if ( restore )
+        rc = KDirectoryOpenFileWrite ( wd, bp, true, "%s/%s.%s", path, name, fork );
+    else
+    {
+        rc = KDirectoryCreateFile ( wd, bp, true,
+            0600, kcmInit | kcmParents, "%s/%s.%s", path, name, fork );
+    }
+    if ( rc != 0 )
+    {
+        SYSTEM_ERROR ( rc, "failed to %s %s id map file '%s' in checkpoint '%s'",
+            restore ? "reopen" : "create", fork, name, path );
+    }
+    else
+    {
+        /* create a read/write buffer file, keeping the backing file
+           so that the buffer can be flushed on every commit */
+        rc = KBufFileMakeWrite ( fp, * bp, true, bsize );
+        if ( rc != 0 )
+        {
+            INTERNAL_ERROR ( rc, "failed to create buffer for %s id map file '%s'", fork, name );
+            KFileRelease ( * bp );
+            * bp = NULL;
+        }
+    }
+}
+
+static
+void MapFileMakeFork ( KFile **fp, KFile **bp, const ctx_t *ctx, const char *name,
+    KDirectory *wd, bool restore, size_t bsize, const char *fork )
 {
     FUNC_ENTRY ( ctx );
 
     /* create temporary KFile */
     rc_t rc;
     KFile *backing;
+    const Tool *tp = ctx -> caps -> tool;
+
+    if ( tp -> ckpt != NULL )
+    {
+        MapFileMakeCheckpointFork ( fp, bp, ctx, name, wd, tp -> ckpt, restore, bsize, fork );
+        return;
+    }
 
     rc = KDirectoryCreateFile ( wd, & backing, true,
-        0600, kcmInit | kcmParents, "%s/sra-sort-%s.%s.%d", tmpdir, name, fork, pid );
+        0600, kcmInit | kcmParents, "%s/sra-sort-%s.%s.%d", tp -> tmpdir, name, fork, tp -> pid );
     if ( rc != 0 )
         SYSTEM_ERROR ( rc, "failed to create %s id map file '%s'", fork, name );
     else
     {
 #if ! WINDOWS
         /* never try to remove files on Windows */
-        if ( ctx -> caps -> tool -> unlink_idx_files )
+        if ( tp -> unlink_idx_files )
         {
             /* unlink KFile */
-            rc = KDirectoryRemove ( wd, false, "%s/sra-sort-%s.%s.%d", tmpdir, name, fork, pid );
+            rc = KDirectoryRemove ( wd, false, "%s/sra-sort-%s.%s.%d", tp -> tmpdir, name, fork, tp -> pid );
             if ( rc != 0 )
                 WARN ( "failed to unlink %s id map file '%s'", fork, name );
         }
@@ -129,47 +322,104 @@ void MapFileMakeFork ( KFile **fp, const ctx_t *ctx, const char *name,
     }
 }
 
+static
+void MapFileMakeFiles ( MapFile *self, const ctx_t *ctx, bool restore )
+{
+    FUNC_ENTRY ( ctx );
+
+    /* create KDirectory */
+    KDirectory *wd;
+    rc_t rc = KDirectoryNativeDir ( & wd );
+    if ( rc != 0 )
+        SYSTEM_ERROR ( rc, "failed to create native directory" );
+    else
+    {
+        const Tool *tp = ctx -> caps -> tool;
+        size_t bsize = self -> random ? tp -> map_file_random_bsize : tp -> map_file_bsize;
+
+        self -> bsize = bsize;
+
+        /* create old=>new id file */
+        TRY ( MapFileMakeFork ( & self -> f_old, & self -> b_old, ctx, self -> name, wd, restore, bsize, "old" ) )
+        {
+            TRY ( MapFileMakeFork ( & self -> f_new, & self -> b_new, ctx, self -> name, wd, restore, 32 * 1024, "new" ) )
+            {
+                if ( self -> for_poslen )
+                    MapFileMakeFork ( & self -> f_pos, & self -> b_pos, ctx, self -> name, wd, restore, 32 * 1024, "pos" );
+
+                if ( ! FAILED () )
+                    self -> have_forks = true;
+                else
+                {
+                    KFileRelease ( self -> f_new );
+                    KFileRelease ( self -> b_new );
+                    self -> f_new = self -> b_new = NULL;
+                }
+            }
+
+            if ( FAILED () )
+            {
+                KFileRelease ( self -> f_old );
+                KFileRelease ( self -> b_old );
+                self -> f_old = self -> b_old = NULL;
+            }
+        }
+
+        KDirectoryRelease ( wd );
+    }
+}
+
 static
 MapFile *MapFileMakeInt ( const ctx_t *ctx, const char *name, bool random, bool for_poslen )
 {
     MapFile *mf;
     TRY ( mf = MemAlloc ( ctx, sizeof * mf, true ) )
     {
-        /* create KDirectory */
-        KDirectory *wd;
-        rc_t rc = KDirectoryNativeDir ( & wd );
-        if ( rc != 0 )
-            SYSTEM_ERROR ( rc, "failed to create native directory" );
-        else
+        const Tool *tp = ctx -> caps -> tool;
+
+        mf -> random = random;
+        mf -> for_poslen = for_poslen;
+        string_copy_measure ( mf -> name, sizeof mf -> name, name );
+
+        /* without a checkpoint, the files are only created
+           by SetIdRange if the map does not fit into memory */
+        if ( tp -> ckpt != NULL )
         {
-            const Tool *tp = ctx -> caps -> tool;
-            size_t bsize = random ? tp -> map_file_random_bsize : tp -> map_file_bsize;
+            /* a map flushed by a checkpoint of an earlier run is reopened */
+            MapFileState state;
+            bool restore = CheckpointFindMap ( tp -> ckpt, name, & state );
 
-            /* create old=>new id file */
-            TRY ( MapFileMakeFork ( & mf -> f_old, ctx, name, wd, tp -> tmpdir, tp -> pid, bsize, "old" ) )
+            TRY ( MapFileMakeFiles ( mf, ctx, restore ) )
             {
-                TRY ( MapFileMakeFork ( & mf -> f_new, ctx, name, wd, tp -> tmpdir, tp -> pid, 32 * 1024, "new" ) )
+                if ( restore )
                 {
-                    if ( for_poslen )
-                        MapFileMakeFork ( & mf -> f_pos, ctx, name, wd, tp -> tmpdir, tp -> pid, 32 * 1024, "pos" );
-
-                    KDirectoryRelease ( wd );
-
-                    if ( ! FAILED () )
-                    {
-                        /* this is our guy */
-                        KRefcountInit ( & mf -> refcount, 1, "MapFile", "make", name );
-                        
-                        return mf;
-                    }
+                    mf -> first_id = state . first_id;
+                    mf -> num_ids = state . num_ids;
+                    mf -> num_mapped_ids = state . num_mapped_ids;
+                    mf -> max_new_id = state . max_new_id;
+                    mf -> id_size = state . id_size;
+                    STATUS ( 2, "reopened id map file '%s' from checkpoint", name );
+                }
 
+                CheckpointAddMap ( tp -> ckpt, ctx, name, mf );
+                if ( FAILED () )
+                {
+                    KFileRelease ( mf -> f_pos );
+                    KFileRelease ( mf -> b_pos );
                     KFileRelease ( mf -> f_new );
+                    KFileRelease ( mf -> b_new );
+                    KFileRelease ( mf -> f_old );
+                    KFileRelease ( mf -> b_old );
                 }
-
-                KFileRelease ( mf -> f_old );
             }
+        }
 
-            KDirectoryRelease ( wd );
+        if ( ! FAILED () )
+        {
+            /* this is our guy */
+            KRefcountInit ( & mf -> refcount, 1, "MapFile", "make", name );
+
+            return mf;
         }
 
         MemFree ( ctx, mf, sizeof * mf );
@@ -250,9 +500,131 @@ MapFile *MapFileDuplicate ( const MapFile *self, const ctx_t *ctx )
 }
 
 
+/* Seal
+ *  writes buffered mappings through to the files of a checkpoint
+ *  and reports the state needed to reopen them
+ */
+static
+void MapFileFlushFork ( KFile **fp, KFile *backing, const ctx_t *ctx, size_t bsize, const char *fork )
+{
+    FUNC_ENTRY ( ctx );
+
+    /* releasing the buffer writes its dirty pages to the backing file */
+    rc_t rc = KFileRelease ( * fp );
+    * fp = NULL;
+    if ( rc != 0 )
+        SYSTEM_ERROR ( rc, "failed to flush %s id map file", fork );
+    else
+    {
+        rc = KBufFileMakeWrite ( fp, backing, true, bsize );
+        if ( rc != 0 )
+            INTERNAL_ERROR ( rc, "failed to recreate buffer for %s id map file", fork );
+    }
+}
+
+void MapFileSeal ( MapFile *self, const ctx_t *ctx, MapFileState *state )
+{
+    rc_t rc;
+    FUNC_ENTRY ( ctx );
+
+    if ( self == NULL )
+    {
+        rc = RC ( rcExe, rcFile, rcCommitting, rcSelf, rcNull );
+        INTERNAL_ERROR ( rc, "bad self" );
+    }
+    else if ( self -> b_old == NULL )
+    {
+        rc = RC ( rcExe, rcFile, rcCommitting, rcFile, rcIncorrect );
+        INTERNAL_ERROR ( rc, "MapFile was not created for a checkpoint" );
+    }
+    else
+    {
+        TRY ( MapFileFlushFork ( & self -> f_old, self -> b_old, ctx, self -> bsize, "old" ) )
+        {
+            TRY ( MapFileFlushFork ( & self -> f_new, self -> b_new, ctx, 32 * 1024, "new" ) )
+            {
+                if ( self -> b_pos != NULL )
+                    MapFileFlushFork ( & self -> f_pos, self -> b_pos, ctx, 32 * 1024, "pos" );
+
+                state -> first_id = self -> first_id;
+                state -> num_ids = self -> num_ids;
+                state -> num_mapped_ids = self -> num_mapped_ids;
+                state -> max_new_id = self -> max_new_id;
+                state -> id_size = ( uint32_t ) self -> id_size;
+            }
+        }
+    }
+}
+
+
+/* ChooseBackend
+ *  keeps the mappings in memory if they fit,
+ *  otherwise creates the files
+ */
+static
+void MapFileChooseBackend ( MapFile *self, const ctx_t *ctx )
+{
+    FUNC_ENTRY ( ctx );
+
+    /* a previous range is forgotten - nothing was written */
+    MapFileReleaseMem ( self, ctx );
+
+    if ( self -> num_ids != 0 )
+    {
+        const Tool *tp = ctx -> caps -> tool;
+
+        size_t ids_bytes = ( size_t ) ( ( ( self -> num_ids * self -> id_bits + 63 ) / 64 + 1 ) * 8 );
+        size_t blk_bytes = self -> for_poslen ?
+            ( size_t ) ( ( self -> num_ids / POSLEN_BLOCK_IDS + 1 ) * sizeof * self -> m_pos_blk ) : 0;
+
+        /* poslen starts out with a guess of 2 bytes per id */
+        size_t pos_bytes = self -> for_poslen ? ( size_t ) ( self -> num_ids * 2 + 16 ) : 0;
+
+        size_t total = ids_bytes * ( tp -> write_new_to_old ? 2 : 1 ) + blk_bytes + pos_bytes;
+
+        if ( MapFileMemFits ( ctx, total ) )
+        {
+            self -> m_ids_bytes = ids_bytes;
+            self -> m_pos_blk_bytes = blk_bytes;
+
+            TRY ( self -> m_old = MapFileMemAlloc ( ctx, ids_bytes, true ) )
+            {
+                if ( tp -> write_new_to_old )
+                    self -> m_new = MapFileMemAlloc ( ctx, ids_bytes, true );
+
+                if ( ! FAILED () && self -> for_poslen )
+                {
+                    TRY ( self -> m_pos_blk = MapFileMemAlloc ( ctx, blk_bytes, false ) )
+                    {
+                        TRY ( self -> m_pos = MapFileMemAlloc ( ctx, pos_bytes, false ) )
+                        {
+                            self -> m_pos_cap = pos_bytes;
+                        }
+                    }
+                }
+
+                if ( ! FAILED () )
+                {
+                    STATUS ( 2, "keeping id map '%s' in memory ( %,zu bytes )", self -> name, total );
+                    return;
+                }
+            }
+
+            /* memory was short after all - use files */
+            CLEAR ();
+            MapFileReleaseMem ( self, ctx );
+        }
+    }
+
+    STATUS ( 2, "keeping id map '%s' in files", self -> name );
+    MapFileMakeFiles ( self, ctx, false );
+}
+
+
 /* SsetIdRange
  *  required second-stage initialization
  *  must be called before any writes occur
+ *  a map reopened from a checkpoint accepts its own range again
  */
 void MapFileSetIdRange ( MapFile *self, const ctx_t *ctx,
     int64_t first_id, uint64_t num_ids )
@@ -267,8 +639,11 @@ void MapFileSetIdRange ( MapFile *self, const ctx_t *ctx,
     }
     else if ( self -> max_new_id != 0 )
     {
-        rc = RC ( rcExe, rcFile, rcUpdating, rcConstraint, rcViolated );
-        INTERNAL_ERROR ( rc, "cannot change id range after writing has begun" );
+        if ( first_id != self -> first_id || num_ids != self -> num_ids )
+        {
+            rc = RC ( rcExe, rcFile, rcUpdating, rcConstraint, rcViolated );
+            INTERNAL_ERROR ( rc, "cannot change id range after writing has begun" );
+        }
     }
     else
     {
@@ -282,6 +657,16 @@ void MapFileSetIdRange ( MapFile *self, const ctx_t *ctx,
             if ( num_ids <= ( ( uint64_t ) 1 ) << ( self -> id_size * 8 ) )
                 break;
         }
+
+        /* the same, in bits */
+        for ( self -> id_bits = 1; self -> id_bits < 64; ++ self -> id_bits )
+        {
+            if ( ( ( num_ids - 1 ) >> self -> id_bits ) == 0 )
+                break;
+        }
+
+        if ( ! self -> have_forks )
+            MapFileChooseBackend ( self, ctx );
     }
 }
 
@@ -322,6 +707,17 @@ void MapFileSetOldToNew ( MapFile *self, const ctx_t *ctx, const IdxMapping *ids
         rc = RC ( rcExe, rcFile, rcWriting, rcRange, rcUndefined );
         INTERNAL_ERROR ( rc, "SetIdRange must be called with a non-empty range" );
     }
+    else if ( self -> m_old != NULL )
+    {
+        size_t i;
+        for ( i = 0; i < count; ++ i )
+        {
+            assert ( ids [ i ] . old_id >= self -> first_id );
+            assert ( ids [ i ] . new_id >= self -> first_id - 1 );
+            bits_set ( self -> m_old, self -> id_bits, ids [ i ] . old_id - self -> first_id,
+                ids [ i ] . new_id - self -> first_id + 1 );
+        }
+    }
     else
     {
         size_t i;
@@ -379,6 +775,17 @@ void MapFileSetNewToOld ( MapFile *self, const ctx_t *ctx, const IdxMapping *ids
     {
         if ( ! ctx -> caps -> tool -> write_new_to_old )
             self -> max_new_id = self -> first_id + count - 1;
+        else if ( self -> m_new != NULL )
+        {
+            size_t i;
+            for ( i = 0; i < count; ++ i )
+            {
+                int64_t new_id = ids [ i ] . new_id - self -> first_id;
+                assert ( new_id >= 0 );
+                bits_set ( self -> m_new, self -> id_bits, new_id, ids [ i ] . old_id - self -> first_id + 1 );
+                self -> max_new_id = new_id + self -> first_id;
+            }
+        }
         else
         {
             size_t i;
@@ -419,7 +826,120 @@ void MapFileSetNewToOld ( MapFile *self, const ctx_t *ctx, const IdxMapping *ids
 
 /* SetPoslen
  *  write global position/length in new-id order
+ *  the memory backend only appends - should it run out of
+ *  memory or be asked to write elsewhere, it moves to a file
  */
+static
+void MapFileSpillPoslen ( MapFile *self, const ctx_t *ctx )
+{
+    FUNC_ENTRY ( ctx );
+
+    KDirectory *wd;
+    rc_t rc = KDirectoryNativeDir ( & wd );
+    if ( rc != 0 )
+        SYSTEM_ERROR ( rc, "failed to create native directory" );
+    else
+    {
+        STATUS ( 2, "moving poslen of id map '%s' from memory to a file", self -> name );
+
+        TRY ( MapFileMakeFork ( & self -> f_pos, & self -> b_pos, ctx, self -> name, wd, false, 32 * 1024, "pos" ) )
+        {
+            uint64_t buff [ 4 * 1024 ];
+            uint64_t i, prior = 0;
+            size_t j, num_writ, off = 0;
+
+            for ( i = 0; i < self -> m_pos_count; i += j )
+            {
+                for ( j = 0; j < sizeof buff / sizeof buff [ 0 ] && i + j < self -> m_pos_count; ++ j )
+                {
+                    if ( ( ( i + j ) % POSLEN_BLOCK_IDS ) == 0 )
+                        prior = 0;
+                    off += poslen_decode ( & self -> m_pos [ off ], prior, & buff [ j ] );
+                    prior = buff [ j ];
+#if __BYTE_ORDER == __BIG_ENDIAN
+                    buff [ j ] = bswap_64 ( buff [ j ] );
+#endif
+                }
+
+                rc = KFileWriteAll ( self -> f_pos, i * sizeof buff [ 0 ], buff, j * sizeof buff [ 0 ], & num_writ );
+                if ( rc == 0 && num_writ != j * sizeof buff [ 0 ] )
+                    rc = RC ( rcExe, rcFile, rcWriting, rcTransfer, rcIncomplete );
+                if ( rc != 0 )
+                {
+                    SYSTEM_ERROR ( rc, "failed to write poslen temporary column" );
+                    break;
+                }
+            }
+
+            MapFileMemFree ( ctx, self -> m_pos, self -> m_pos_cap );
+            MapFileMemFree ( ctx, self -> m_pos_blk, self -> m_pos_blk_bytes );
+            self -> m_pos = NULL;
+            self -> m_pos_blk = NULL;
+            self -> m_pos_size = self -> m_pos_cap = self -> m_pos_blk_bytes = 0;
+        }
+
+        KDirectoryRelease ( wd );
+    }
+}
+
+static
+bool MapFileMemPoslenAppend ( MapFile *self, const ctx_t *ctx, const IdxMapping *ids, size_t count )
+{
+    FUNC_ENTRY ( ctx );
+
+    size_t i;
+
+    /* a varint takes up to 10 bytes */
+    size_t needed = self -> m_pos_size + count * 10;
+
+    if ( self -> m_pos_count != ( uint64_t ) ( self -> max_new_id - self -> first_id + 1 ) ||
+         self -> m_pos_count + count > self -> num_ids )
+    {
+        MapFileSpillPoslen ( self, ctx );
+        return false;
+    }
+
+    if ( needed > self -> m_pos_cap )
+    {
+        uint8_t *m_pos;
+        size_t cap = self -> m_pos_cap + self -> m_pos_cap / 2;
+        if ( cap < needed )
+            cap = needed;
+
+        if ( ! MapFileMemFits ( ctx, cap ) )
+        {
+            MapFileSpillPoslen ( self, ctx );
+            return false;
+        }
+
+        ON_FAIL ( m_pos = MapFileMemAlloc ( ctx, cap, false ) )
+            return false;
+
+        memmove ( m_pos, self -> m_pos, self -> m_pos_size );
+        MapFileMemFree ( ctx, self -> m_pos, self -> m_pos_cap );
+        self -> m_pos = m_pos;
+        self -> m_pos_cap = cap;
+    }
+
+    for ( i = 0; i < count; ++ i )
+    {
+        uint64_t poslen = ids [ i ] . new_id;
+        uint64_t prior = self -> m_pos_last;
+
+        if ( ( self -> m_pos_count % POSLEN_BLOCK_IDS ) == 0 )
+        {
+            self -> m_pos_blk [ self -> m_pos_count / POSLEN_BLOCK_IDS ] = self -> m_pos_size;
+            prior = 0;
+        }
+
+        self -> m_pos_size += poslen_encode ( & self -> m_pos [ self -> m_pos_size ], prior, poslen );
+        self -> m_pos_last = poslen;
+        ++ self -> m_pos_count;
+    }
+
+    return true;
+}
+
 void MapFileSetPoslen ( MapFile *self, const ctx_t *ctx, const IdxMapping *ids, size_t count )
 {
     rc_t rc;
@@ -430,7 +950,7 @@ void MapFileSetPoslen ( MapFile *self, const ctx_t *ctx, const IdxMapping *ids,
         rc = RC ( rcExe, rcFile, rcWriting, rcSelf, rcNull );
         INTERNAL_ERROR ( rc, "bad self reference" );
     }
-    else if ( self -> f_pos == NULL )
+    else if ( ! self -> for_poslen )
     {
         rc = RC ( rcExe, rcFile, rcWriting, rcFile, rcIncorrect );
         INTERNAL_ERROR ( rc, "MapFile must be created with MapFileMakeForPoslen" );
@@ -440,7 +960,9 @@ void MapFileSetPoslen ( MapFile *self, const ctx_t *ctx, const IdxMapping *ids,
         rc = RC ( rcExe, rcFile, rcWriting, rcRange, rcUndefined );
         INTERNAL_ERROR ( rc, "SetIdRange must be called with a non-empty range" );
     }
-    else
+    else if ( self -> m_pos != NULL && MapFileMemPoslenAppend ( self, ctx, ids, count ) )
+        return;
+    else if ( ! FAILED () )
     {
         /* start writing after the last new id recorded */
         uint64_t pos = ( self -> max_new_id - self -> first_id + 1 ) * sizeof ids -> new_id;
@@ -489,7 +1011,7 @@ size_t MapFileReadPoslen ( const MapFile *self, const ctx_t *ctx,
         rc = RC ( rcExe, rcFile, rcReading, rcSelf, rcNull );
         INTERNAL_ERROR ( rc, "bad self reference" );
     }
-    else if ( self -> f_pos == NULL )
+    else if ( ! self -> for_poslen )
     {
         rc = RC ( rcExe, rcFile, rcReading, rcFile, rcIncorrect );
         INTERNAL_ERROR ( rc, "MapFile must be created with MapFileMakeForPoslen" );
@@ -515,6 +1037,31 @@ size_t MapFileReadPoslen ( const MapFile *self, const ctx_t *ctx,
             rc = RC ( rcExe, rcFile, rcReading, rcBuffer, rcNull );
             INTERNAL_ERROR ( rc, "bad buffer parameter" );
         }
+        else if ( self -> m_pos != NULL )
+        {
+            uint64_t idx = ( uint64_t ) ( start_id - self -> first_id );
+
+            /* like a file, only what was written is there */
+            if ( idx + max_count > self -> m_pos_count )
+                max_count = ( idx < self -> m_pos_count ) ? ( size_t ) ( self -> m_pos_count - idx ) : 0;
+
+            if ( max_count != 0 )
+            {
+                /* decode from the start of the block */
+                size_t off = ( size_t ) self -> m_pos_blk [ idx / POSLEN_BLOCK_IDS ];
+                uint64_t i, val, prior = 0;
+
+                for ( i = idx - idx % POSLEN_BLOCK_IDS; i < idx; prior = val, ++ i )
+                    off += poslen_decode ( & self -> m_pos [ off ], prior, & val );
+
+                for ( ; total < max_count; prior = poslen [ total ], ++ total )
+                {
+                    if ( ( ( idx + total ) % POSLEN_BLOCK_IDS ) == 0 )
+                        prior = 0;
+                    off += poslen_decode ( & self -> m_pos [ off ], prior, & poslen [ total ] );
+                }
+            }
+        }
         else
         {
             /* read as many bytes of id as possible */
@@ -572,6 +1119,37 @@ size_t make_missing_entry ( MapFile *self, const ctx_t *ctx,
     return i + 1;
 }
 
+static
+int64_t MapFileMemAllocMissingNewIds ( MapFile *self, const ctx_t *ctx,
+    IdxMapping *missing, size_t max_missing_ids )
+{
+    size_t i;
+    uint64_t idx;
+
+    int64_t max_new_id = self -> max_new_id;
+    int64_t entry_max_new_id = self -> max_new_id;
+
+    for ( i = 0, idx = 0; idx < self -> num_ids; ++ idx )
+    {
+        if ( bits_get ( self -> m_old, self -> id_bits, idx ) == 0 )
+        {
+            ON_FAIL ( i = make_missing_entry ( self, ctx, missing,
+                      i, max_missing_ids, self -> first_id + idx, ++ max_new_id ) )
+                return 0;
+        }
+    }
+
+    if ( i != 0 )
+    {
+        ON_FAIL ( MapFileSetNewToOld ( self, ctx, missing, i ) )
+            return 0;
+    }
+
+    assert ( self -> max_new_id == max_new_id );
+
+    return ( max_new_id != entry_max_new_id ) ? entry_max_new_id + 1 : 0;
+}
+
 int64_t MapFileAllocMissingNewIds ( MapFile *self, const ctx_t *ctx )
 {
     FUNC_ENTRY ( ctx );
@@ -604,143 +1182,159 @@ int64_t MapFileAllocMissingNewIds ( MapFile *self, const ctx_t *ctx )
             /* allocate a buffer of IdxMapping */
             TRY ( missing = MemAlloc ( ctx, sizeof * missing * max_missing_ids, false ) )
             {
-                /* use a scan buffer somewhere around 32K,
-                   to keep page-file cache focused on a few pages */
-                void *scan_buffer;
-                const size_t scan_buffer_size = 32 * 1024;
-                TRY ( scan_buffer = MemAlloc ( ctx, scan_buffer_size, false ) )
+                if ( self -> m_old != NULL )
+                    first_allocated = MapFileMemAllocMissingNewIds ( self, ctx, missing, max_missing_ids );
+                else
                 {
-                    size_t i, num_read;
-                    int64_t new_id, old_id = self -> first_id;
-                    uint64_t eof = self -> num_ids * self -> id_size;
+                    /* use a scan buffer somewhere around 32K,
+                       to keep page-file cache focused on a few pages */
+                    void *scan_buffer;
+                    const size_t scan_buffer_size = 32 * 1024;
+                    TRY ( scan_buffer = MemAlloc ( ctx, scan_buffer_size, false ) )
+                    {
+                        size_t i, num_read;
+                        int64_t new_id, old_id = self -> first_id;
+                        uint64_t eof = self -> num_ids * self -> id_size;
 
-                    /* this guy will be used to assign new ids */
-                    int64_t max_new_id = self -> max_new_id;
-                    int64_t entry_max_new_id = self -> max_new_id;
+                        /* this guy will be used to assign new ids */
+                        int64_t max_new_id = self -> max_new_id;
+                        int64_t entry_max_new_id = self -> max_new_id;
 
+                        /* stored ( 1-based ) ids above this one can only have been
+                           left by an allocation that was interrupted - resuming
+                           from a checkpoint, they are treated as missing and
+                           get the very same ids again */
+                        uint64_t stale = ( uint64_t ) ( entry_max_new_id - self -> first_id + 1 );
 
-                    /* in a loop, read as many ids as possible into scan buffer
-                       the number is dependent upon self->id_size */
-                    for ( i = 0; ; old_id += num_read )
-                    {
-                        size_t j, to_read;
-
-                        /* determine position from old_id */
-                        uint64_t pos = ( old_id - self -> first_id ) * self -> id_size;
-                        if ( pos == eof )
-                            break;
-
-                        /* determine bytes to read - this must be limited
-                           or we risk tricking page-buffer into resizing */
-                        to_read = scan_buffer_size;
-                        if ( pos + to_read > eof )
-                            to_read = ( size_t ) ( eof - pos );
-
-                        /* read as many bytes as we can */
-                        rc = KFileReadAll ( self -> f_old, pos, scan_buffer, to_read, & num_read );
-                        if ( rc != 0 )
-                        {
-                            SYSTEM_ERROR ( rc, "failed to read old=>new map" );
-                            break;
-                        }
 
-                        /* convert to count */                        
-                        num_read /= self -> id_size;
-                        if ( num_read == 0 )
+                        /* in a loop, read as many ids as possible into scan buffer
+                           the number is dependent upon self->id_size */
+                        for ( i = 0; ; old_id += num_read )
                         {
-                            rc = RC ( rcExe, rcFile, rcReading, rcTransfer, rcIncomplete );
-                            SYSTEM_ERROR ( rc, "failed to read old=>new map" );
-                            break;
-                        }
+                            size_t j, to_read;
+
+                            /* determine position from old_id */
+                            uint64_t pos = ( old_id - self -> first_id ) * self -> id_size;
+                            if ( pos == eof )
+                                break;
+
+                            /* determine bytes to read - this must be limited
+                               or we risk tricking page-buffer into resizing */
+                            to_read = scan_buffer_size;
+                            if ( pos + to_read > eof )
+                                to_read = ( size_t ) ( eof - pos );
+
+                            /* read as many bytes as we can */
+                            rc = KFileReadAll ( self -> f_old, pos, scan_buffer, to_read, & num_read );
+                            if ( rc != 0 )
+                            {
+                                SYSTEM_ERROR ( rc, "failed to read old=>new map" );
+                                break;
+                            }
 
-                        /* scan for zeros, and for every zero found,
-                           make entry into IdxMapping table, writing
-                           new-id back to old=>new map */
-                        switch ( self -> id_size )
-                        {
-                        case 1:
-                            for ( j = 0; j < num_read; ++ j )
+                            /* convert to count */                        
+                            num_read /= self -> id_size;
+                            if ( num_read == 0 )
                             {
-                                if ( ( ( const uint8_t* ) scan_buffer ) [ j ] == 0 )
-                                {
-                                    ON_FAIL ( i = make_missing_entry ( self, ctx, missing,
-                                              i, max_missing_ids, old_id + j, ++ max_new_id ) )
-                                        break;
-                                }
+                                rc = RC ( rcExe, rcFile, rcReading, rcTransfer, rcIncomplete );
+                                SYSTEM_ERROR ( rc, "failed to read old=>new map" );
+                                break;
                             }
-                            break;
-                        case 2:
-                            for ( j = 0; j < num_read; ++ j )
+
+                            /* scan for zeros, and for every zero found,
+                               make entry into IdxMapping table, writing
+                               new-id back to old=>new map */
+                            switch ( self -> id_size )
                             {
-                                if ( ( ( const uint16_t* ) scan_buffer ) [ j ] == 0 )
+                            case 1:
+                                for ( j = 0; j < num_read; ++ j )
                                 {
-                                    ON_FAIL ( i = make_missing_entry ( self, ctx, missing,
-                                              i, max_missing_ids, old_id + j, ++ max_new_id ) )
-                                        break;
+                                    if ( ( ( const uint8_t* ) scan_buffer ) [ j ] == 0 ||
+                                         ( ( const uint8_t* ) scan_buffer ) [ j ] > stale )
+                                    {
+                                        ON_FAIL ( i = make_missing_entry ( self, ctx, missing,
+                                                  i, max_missing_ids, old_id + j, ++ max_new_id ) )
+                                            break;
+                                    }
                                 }
-                            }
-                            break;
-                        case 3:
-                            for ( num_read *= 3, j = 0; j < num_read; j += 3 )
-                            {
-                                if ( ( ( const uint8_t* ) scan_buffer ) [ j + 0 ] == 0 &&
-                                     ( ( const uint8_t* ) scan_buffer ) [ j + 1 ] == 0 &&
-                                     ( ( const uint8_t* ) scan_buffer ) [ j + 2 ] == 0 )
+                                break;
+                            case 2:
+                                for ( j = 0; j < num_read; ++ j )
                                 {
-                                    ON_FAIL ( i = make_missing_entry ( self, ctx, missing,
-                                              i, max_missing_ids, old_id + j / 3, ++ max_new_id ) )
-                                        break;
+                                    if ( ( ( const uint16_t* ) scan_buffer ) [ j ] == 0 ||
+                                         ( ( const uint16_t* ) scan_buffer ) [ j ] > stale )
+                                    {
+                                        ON_FAIL ( i = make_missing_entry ( self, ctx, missing,
+                                                  i, max_missing_ids, old_id + j, ++ max_new_id ) )
+                                            break;
+                                    }
                                 }
-                            }
-                            num_read /= 3;
-                            break;
-                        case 4:
-                            for ( j = 0; j < num_read; ++ j )
-                            {
-                                if ( ( ( const uint32_t* ) scan_buffer ) [ j ] == 0 )
+                                break;
+                            case 3:
+                                for ( num_read *= 3, j = 0; j < num_read; j += 3 )
                                 {
-                                    ON_FAIL ( i = make_missing_entry ( self, ctx, missing,
-                                              i, max_missing_ids, old_id + j, ++ max_new_id ) )
-                                        break;
+                                    new_id = ( ( const uint8_t* ) scan_buffer ) [ j + 0 ] |
+                                        ( ( ( const uint8_t* ) scan_buffer ) [ j + 1 ] << 8 ) |
+                                        ( ( ( const uint8_t* ) scan_buffer ) [ j + 2 ] << 16 );
+                                    if ( new_id == 0 || ( uint64_t ) new_id > stale )
+                                    {
+                                        ON_FAIL ( i = make_missing_entry ( self, ctx, missing,
+                                                  i, max_missing_ids, old_id + j / 3, ++ max_new_id ) )
+                                            break;
+                                    }
                                 }
-                            }
-                            break;
-                        case 8:
-                            for ( j = 0; j < num_read; ++ j )
-                            {
-                                if ( ( ( const uint64_t* ) scan_buffer ) [ j ] == 0 )
+                                num_read /= 3;
+                                break;
+                            case 4:
+                                for ( j = 0; j < num_read; ++ j )
                                 {
-                                    ON_FAIL ( i = make_missing_entry ( self, ctx, missing,
-                                              i, max_missing_ids, old_id + j, ++ max_new_id ) )
-                                        break;
+                                    if ( ( ( const uint32_t* ) scan_buffer ) [ j ] == 0 ||
+                                         ( ( const uint32_t* ) scan_buffer ) [ j ] > stale )
+                                    {
+                                        ON_FAIL ( i = make_missing_entry ( self, ctx, missing,
+                                                  i, max_missing_ids, old_id + j, ++ max_new_id ) )
+                                            break;
+                                    }
                                 }
-                            }
-                            break;
-                        default:
-                            for ( num_read *= self -> id_size, j = 0; j < num_read; j += self -> id_size )
-                            {
-                                new_id = 0;
-                                memmove ( & new_id, & ( ( const uint8_t* ) scan_buffer ) [ j ], self -> id_size );
-                                if ( new_id == 0 )
+                                break;
+                            case 8:
+                                for ( j = 0; j < num_read; ++ j )
                                 {
-                                    ON_FAIL ( i = make_missing_entry ( self, ctx, missing,
-                                              i, max_missing_ids, old_id + j / self -> id_size, ++ max_new_id ) )
-                                        break;
+                                    if ( ( ( const uint64_t* ) scan_buffer ) [ j ] == 0 ||
+                                         ( ( const uint64_t* ) scan_buffer ) [ j ] > stale )
+                                    {
+                                        ON_FAIL ( i = make_missing_entry ( self, ctx, missing,
+                                                  i, max_missing_ids, old_id + j, ++ max_new_id ) )
+                                            break;
+                                    }
                                 }
+                                break;
+                            default:
+                                for ( num_read *= self -> id_size, j = 0; j < num_read; j += self -> id_size )
+                                {
+                                    new_id = 0;
+                                    memmove ( & new_id, & ( ( const uint8_t* ) scan_buffer ) [ j ], self -> id_size );
+                                    if ( new_id == 0 || ( uint64_t ) new_id > stale )
+                                    {
+                                        ON_FAIL ( i = make_missing_entry ( self, ctx, missing,
+                                                  i, max_missing_ids, old_id + j / self -> id_size, ++ max_new_id ) )
+                                            break;
+                                    }
+                                }
+                                num_read /= self -> id_size;
                             }
-                            num_read /= self -> id_size;
                         }
-                    }
 
-                    if ( ! FAILED () && i != 0 )
-                        MapFileSetNewToOld ( self, ctx, missing, i );
+                        if ( ! FAILED () && i != 0 )
+                            MapFileSetNewToOld ( self, ctx, missing, i );
 
-                    assert ( FAILED () || self -> max_new_id == max_new_id );
+                        assert ( FAILED () || self -> max_new_id == max_new_id );
 
-                    if ( max_new_id != entry_max_new_id )
-                        first_allocated = entry_max_new_id + 1;
+                        if ( max_new_id != entry_max_new_id )
+                            first_allocated = entry_max_new_id + 1;
 
-                    MemFree ( ctx, scan_buffer, scan_buffer_size );
+                        MemFree ( ctx, scan_buffer, scan_buffer_size );
+                    }
                 }
 
                 MemFree ( ctx, missing, sizeof * missing * max_missing_ids );
@@ -790,6 +1384,22 @@ size_t MapFileReadNewToOld ( const MapFile *self, const ctx_t *ctx,
             rc = RC ( rcExe, rcFile, rcReading, rcBuffer, rcNull );
             INTERNAL_ERROR ( rc, "bad buffer parameter" );
         }
+        else if ( self -> m_new != NULL )
+        {
+            /* like a file, only what was written is there */
+            if ( start_id + max_count > self -> max_new_id + 1 )
+                max_count = ( start_id <= self -> max_new_id ) ? ( size_t ) ( self -> max_new_id + 1 - start_id ) : 0;
+
+            for ( ; total < max_count; ++ total )
+            {
+                int64_t unpacked = bits_get ( self -> m_new, self -> id_bits, start_id - self -> first_id + total );
+                if ( unpacked != 0 )
+                    unpacked += self -> first_id - 1;
+
+                ids [ total ] . old_id = unpacked;
+                ids [ total ] . new_id = start_id + total;
+            }
+        }
         else
         {
             /* read as many bytes of id as possible */
@@ -851,6 +1461,26 @@ size_t MapFileSelectOldToNewPairs ( const MapFile *self, const ctx_t *ctx,
     /* range is start_id to end_excl */
     end_excl = start_id + max_count;
 
+    if ( self -> m_old != NULL )
+    {
+        uint64_t idx;
+        for ( i = 0, idx = 0; idx < self -> num_ids; ++ idx )
+        {
+            int64_t unpacked = bits_get ( self -> m_old, self -> id_bits, idx );
+            if ( unpacked != 0 )
+                unpacked += self -> first_id - 1;
+
+            if ( unpacked >= start_id && unpacked < end_excl )
+            {
+                ids [ i ] . old_id = self -> first_id + idx;
+                ids [ i ] . new_id = unpacked;
+                if ( ++ i == max_count )
+                    break;
+            }
+        }
+        return i;
+    }
+
     /* eof for f_old */
     eof = self -> num_ids * self -> id_size;
 
@@ -933,6 +1563,28 @@ size_t MapFileSelectOldToNewSingle ( const MapFile *self, const ctx_t *ctx,
     /* range is start_id to end_excl */
     end_excl = start_id + max_count;
 
+    if ( self -> m_old != NULL )
+    {
+        uint64_t idx;
+        for ( i = 0, idx = 0; idx < self -> num_ids; ++ idx )
+        {
+            int64_t unpacked = bits_get ( self -> m_old, self -> id_bits, idx );
+            if ( unpacked != 0 )
+                unpacked += self -> first_id - 1;
+
+            if ( unpacked >= start_id && unpacked < end_excl )
+            {
+                ids [ i ] = self -> first_id + idx;
+                assert ( i <= 0xFFFFFFFF );
+                if ( opt_ord != NULL )
+                    opt_ord [ unpacked - start_id ] = ( uint32_t ) i;
+                if ( ++ i == max_count )
+                    break;
+            }
+        }
+        return i;
+    }
+
     /* eof for f_old */
     eof = self -> num_ids * self -> id_size;
 
@@ -1002,6 +1654,38 @@ size_t MapFileSelectOldToNewSingle ( const MapFile *self, const ctx_t *ctx,
  *  returns new id or 0 if not found
  *  optionally allocates a new id if "insert" is true
  */
+static
+int64_t MapFileInsertOldToNew ( MapFile *self, const ctx_t *ctx, int64_t old_id )
+{
+    FUNC_ENTRY ( ctx );
+
+    int64_t new_id = 0;
+
+    /* create a mapping using the last known
+       new id plus one as the id to assign on insert */
+    IdxMapping mapping;
+    mapping . old_id = old_id;
+    mapping . new_id = self -> max_new_id + 1;
+
+    TRY ( MapFileSetOldToNew ( self, ctx, & mapping, 1 ) )
+    {
+        TRY ( MapFileSetNewToOld ( self, ctx, & mapping, 1 ) )
+        {
+            new_id = mapping . new_id;
+
+            if ( self -> num_ids >= 100000 )
+            {
+                uint64_t scaled = ++ self -> num_mapped_ids * 100;
+                uint64_t prior = scaled - 100;
+                if ( ( prior / self -> num_ids ) != ( scaled /= self -> num_ids ) )
+                    STATUS ( 2, "have mapped %lu%% ids", scaled );
+            }
+        }
+    }
+
+    return new_id;
+}
+
 int64_t MapFileMapSingleOldToNew ( MapFile *self, const ctx_t *ctx,
     int64_t old_id, bool insert )
 {
@@ -1021,6 +1705,14 @@ int64_t MapFileMapSingleOldToNew ( MapFile *self, const ctx_t *ctx,
         INTERNAL_ERROR ( rc, "old_id ( %ld ) is not within map range ( %ld .. %ld )",
             old_id, self -> first_id, self -> first_id + self -> num_ids - 1 );
     }
+    else if ( self -> m_old != NULL )
+    {
+        new_id = bits_get ( self -> m_old, self -> id_bits, old_id - self -> first_id );
+        if ( new_id != 0 )
+            new_id += self -> first_id - 1;
+        else if ( insert )
+            new_id = MapFileInsertOldToNew ( self, ctx, old_id );
+    }
     else
     {
         size_t num_read, to_read = self -> id_size;
@@ -1036,29 +1728,7 @@ int64_t MapFileMapSingleOldToNew ( MapFile *self, const ctx_t *ctx,
             if ( new_id != 0 )
                 new_id += self -> first_id - 1;
             else if ( insert )
-            {
-                /* create a mapping using the last known
-                   new id plus one as the id to assign on insert */
-                IdxMapping mapping;
-                mapping . old_id = old_id;
-                mapping . new_id = self -> max_new_id + 1;
-
-                TRY ( MapFileSetOldToNew ( self, ctx, & mapping, 1 ) )
-                {
-                    TRY ( MapFileSetNewToOld ( self, ctx, & mapping, 1 ) )
-                    {
-                        new_id = mapping . new_id;
-
-                        if ( self -> num_ids >= 100000 )
-                        {
-                            uint64_t scaled = ++ self -> num_mapped_ids * 100;
-                            uint64_t prior = scaled - 100;
-                            if ( ( prior / self -> num_ids ) != ( scaled /= self -> num_ids ) )
-                                STATUS ( 2, "have mapped %lu%% ids", scaled );
-                        }
-                    }
-                }
-            }
+                new_id = MapFileInsertOldToNew ( self, ctx, old_id );
         }
     }
 
@@ -45,6 +45,21 @@ struct IdxMapping;
 typedef struct MapFile MapFile;
 
 
+/* State
+ *  the counters needed to reopen map files that were flushed
+ *  by a checkpoint of an earlier run
+ */
+typedef struct MapFileState MapFileState;
+struct MapFileState
+{
+    int64_t first_id;
+    uint64_t num_ids;
+    uint64_t num_mapped_ids;
+    int64_t max_new_id;
+    uint32_t id_size;
+};
+
+
 /* Make
  *  creates an id map
  */
@@ -70,9 +85,20 @@ void MapFileRelease ( const MapFile *self, const ctx_t *ctx );
 MapFile *MapFileDuplicate ( const MapFile *self, const ctx_t *ctx );
 
 
+/* Seal
+ *  writes buffered mappings through to the files of a checkpoint
+ *  and reports the state needed to reopen them
+ */
+void MapFileSeal ( MapFile *self, const ctx_t *ctx, MapFileState *state );
+
+
 /* SetIdRange
  *  required second-stage initialization
  *  must be called before any writes occur
+ *  a map reopened from a checkpoint accepts its own range again
+ *
+ *  decides where the mappings are kept: in memory, bit-packed,
+ *  if they fit into "map_mem_limit" of Tool, otherwise in files
  */
 void MapFileSetIdRange ( MapFile *self, const ctx_t *ctx,
     int64_t first_id, uint64_t num_ids );
@@ -124,6 +150,9 @@ size_t MapFileReadPoslen ( const MapFile *self, const ctx_t *ctx,
  *  need to fill in the remainder.
  *
  *  returns the first newly allocated id
+ *
+ *  ids above the recorded maximum, left by an allocation that
+ *  was interrupted, are allocated again to the same values
  */
 int64_t MapFileAllocMissingNewIds ( MapFile *self, const ctx_t *ctx );
 
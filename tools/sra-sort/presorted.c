@@ -0,0 +1,222 @@
+/*===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ */
+
+#include "presorted.h"
+#include "tbl-pair.h"
+#include "col-pair.h"
+#include "glob-poslen.h"
+#include "ctx.h"
+#include "caps.h"
+#include "except.h"
+#include "status.h"
+
+#include <klib/rc.h>
+
+#include <assert.h>
+
+
+FILE_ENTRY ( presorted );
+
+
+/*--------------------------------------------------------------------------
+ * presorted input
+ */
+
+
+/* ScanAlignIds
+ *  walks the reference rows, and for each id the position of its alignment
+ *  "align_id" is the id expected next, "last_poslen" the position before
+ */
+static
+bool ScanAlignIds ( ColumnReader *ids, ColumnReader *poslen, const ctx_t *ctx,
+    int64_t ref_id, int64_t ref_excl, int64_t align_id, int64_t align_excl, uint32_t chunk_size )
+{
+    FUNC_ENTRY ( ctx );
+
+    uint64_t last_poslen = 0;
+
+    for ( ; ref_id < ref_excl; ++ ref_id )
+    {
+        uint32_t i, elem_bits, boff, row_len;
+        const int64_t *row;
+
+        ON_FAIL ( row = ColumnReaderRead ( ids, ctx, ref_id, & elem_bits, & boff, & row_len ) )
+            return false;
+
+        /* we expect empty rows */
+        if ( row_len == 0 )
+            continue;
+
+        assert ( elem_bits == sizeof row [ 0 ] * 8 );
+        assert ( boff == 0 );
+
+        for ( i = 0; i < row_len; ++ i, ++ align_id )
+        {
+            const uint64_t *pl;
+            uint32_t pl_bits, pl_boff, pl_len;
+
+            if ( align_id == align_excl || row [ i ] != align_id )
+            {
+                STATUS ( 3, "'%s' row %ld holds id %ld where %ld was expected",
+                         ColumnReaderFullSpec ( ids, ctx ), ref_id, row [ i ], align_id );
+                return false;
+            }
+
+            ON_FAIL ( pl = ColumnReaderRead ( poslen, ctx, align_id, & pl_bits, & pl_boff, & pl_len ) )
+                return false;
+
+            assert ( pl_len == 1 );
+            if ( * pl < last_poslen )
+            {
+                STATUS ( 3, "'%s' row %ld is ahead of the row before", ColumnReaderFullSpec ( poslen, ctx ), align_id );
+                return false;
+            }
+            if ( global_to_row_id ( decode_pos_len ( * pl ), chunk_size ) != ref_id )
+            {
+                STATUS ( 3, "'%s' row %ld is listed in reference row %ld, outside of its chunk",
+                         ColumnReaderFullSpec ( poslen, ctx ), align_id, ref_id );
+                return false;
+            }
+
+            last_poslen = * pl;
+        }
+    }
+
+    if ( align_id != align_excl )
+    {
+        STATUS ( 3, "'%s' leaves alignments from id %ld unlisted", ColumnReaderFullSpec ( ids, ctx ), align_id );
+        return false;
+    }
+
+    return true;
+}
+
+
+/* AlignIdsPresorted
+ *  scans REFERENCE.<colspec> together with the positions of "align_tbl"
+ */
+bool TablePairAlignIdsPresorted ( TablePair *self, const ctx_t *ctx,
+    TablePair *align_tbl, const char *colspec, uint32_t chunk_size )
+{
+    FUNC_ENTRY ( ctx );
+
+    bool presorted = false;
+    ColumnReader *ids;
+
+    STATUS ( 3, "scanning '%s.%s' for sorted order", self -> full_spec, colspec );
+
+    TRY ( ids = TablePairMakeColumnReader ( self, ctx, NULL, colspec, true ) )
+    {
+        ColumnReader *poslen;
+        TRY ( poslen = TablePairMakeGlobalPosLenReader ( align_tbl, ctx, chunk_size ) )
+        {
+            int64_t ref_first, align_first;
+            uint64_t ref_count, align_count;
+
+            TRY ( ref_count = ColumnReaderIdRange ( ids, ctx, & ref_first ) )
+            {
+                TRY ( align_count = ColumnReaderIdRange ( poslen, ctx, & align_first ) )
+                {
+                    presorted = ScanAlignIds ( ids, poslen, ctx, ref_first, ref_first + ref_count,
+                        align_first, align_first + align_count, chunk_size );
+                }
+            }
+
+            ColumnReaderRelease ( poslen, ctx );
+        }
+
+        ColumnReaderRelease ( ids, ctx );
+    }
+
+    return presorted && ! FAILED ();
+}
+
+
+/* SeqSpotIdsPresorted
+ *  scans SEQ_SPOT_ID of the primary alignment table
+ */
+bool TablePairSeqSpotIdsPresorted ( TablePair *self, const ctx_t *ctx,
+    TablePair *seq_tbl, int64_t *first_unaligned )
+{
+    FUNC_ENTRY ( ctx );
+
+    bool presorted = false;
+    ColumnReader *spots;
+
+    STATUS ( 3, "scanning '%s.SEQ_SPOT_ID' for first-alignment order", self -> full_spec );
+
+    TRY ( spots = TablePairMakeColumnReader ( seq_tbl, ctx, NULL, "READ_LEN", true ) )
+    {
+        int64_t seq_first;
+        uint64_t seq_count;
+
+        TRY ( seq_count = ColumnReaderIdRange ( spots, ctx, & seq_first ) )
+        {
+            ColumnReaderRelease ( spots, ctx );
+            spots = NULL;
+
+            TRY ( spots = TablePairMakeColumnReader ( self, ctx, NULL, "(I64)SEQ_SPOT_ID", true ) )
+            {
+                int64_t row_id, first;
+                uint64_t count;
+
+                TRY ( count = ColumnReaderIdRange ( spots, ctx, & first ) )
+                {
+                    /* the spot that would be handed the next new id */
+                    int64_t next_spot = seq_first;
+                    int64_t seq_excl = seq_first + ( int64_t ) seq_count;
+
+                    for ( presorted = true, row_id = first; row_id < first + ( int64_t ) count; ++ row_id )
+                    {
+                        uint32_t elem_bits, boff, row_len;
+                        const int64_t *spot;
+
+                        ON_FAIL ( spot = ColumnReaderRead ( spots, ctx, row_id, & elem_bits, & boff, & row_len ) )
+                            break;
+
+                        assert ( row_len == 1 );
+                        if ( * spot < seq_first || * spot > next_spot || * spot >= seq_excl )
+                        {
+                            STATUS ( 3, "'%s' row %ld meets spot %ld before spot %ld",
+                                     ColumnReaderFullSpec ( spots, ctx ), row_id, * spot, next_spot );
+                            presorted = false;
+                            break;
+                        }
+                        if ( * spot == next_spot )
+                            ++ next_spot;
+                    }
+
+                    /* spots never met are unaligned, and keep their ids */
+                    * first_unaligned = ( next_spot < seq_excl ) ? next_spot : 0;
+                }
+            }
+        }
+
+        ColumnReaderRelease ( spots, ctx );
+    }
+
+    return presorted && ! FAILED ();
+}
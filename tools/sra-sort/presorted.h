@@ -0,0 +1,71 @@
+/*===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ */
+
+#ifndef _h_sra_sort_presorted_
+#define _h_sra_sort_presorted_
+
+#ifndef _h_sra_sort_defs_
+#include "sort-defs.h"
+#endif
+
+
+/*--------------------------------------------------------------------------
+ * forwards
+ */
+struct TablePair;
+
+
+/*--------------------------------------------------------------------------
+ * presorted input
+ *  sequential scans that tell whether sorting a cSRA database would
+ *  hand every row its own id back, i.e. the input is already sorted.
+ *  each one stops at the first row out of order.
+ */
+
+
+/* AlignIdsPresorted
+ *  scans REFERENCE.<colspec> together with the positions of "align_tbl"
+ *
+ *  true if the ids of the reference rows, taken in row order, are the
+ *  ids of "align_tbl" from first to last, each alignment is listed in
+ *  the row of its chunk, and positions ascend with length descending.
+ */
+bool TablePairAlignIdsPresorted ( struct TablePair *self, const ctx_t *ctx,
+    struct TablePair *align_tbl, const char *colspec, uint32_t chunk_size );
+
+
+/* SeqSpotIdsPresorted
+ *  scans SEQ_SPOT_ID of the primary alignment table "self"
+ *
+ *  true if spots appear for the first time in row-id order of "seq_tbl",
+ *  i.e. SEQUENCE is in first-alignment order with unaligned spots behind.
+ *  "first_unaligned" [ OUT ] - the first unaligned spot, or 0 if none
+ */
+bool TablePairSeqSpotIdsPresorted ( struct TablePair *self, const ctx_t *ctx,
+    struct TablePair *seq_tbl, int64_t *first_unaligned );
+
+
+#endif /* _h_sra_sort_presorted_ */
@@ -565,7 +565,6 @@ static ColumnReader_vt AlignIdColReader_vt =
 /*--------------------------------------------------------------------------
  * RefTblPair
  */
-static
 size_t RefTblPairGetChunkSize ( TablePair *self, const ctx_t *ctx, const VCursor **cursp )
 {
     FUNC_ENTRY ( ctx );
@@ -37,6 +37,19 @@
  */
 struct MapFile;
 struct TablePair;
+struct VCursor;
+
+
+/*--------------------------------------------------------------------------
+ * RefTblPair
+ */
+
+
+/* GetChunkSize
+ *  reads the chunk size of the REFERENCE table
+ *  returns a cursor onto it in "cursp", to be released by caller
+ */
+size_t RefTblPairGetChunkSize ( struct TablePair *self, const ctx_t *ctx, struct VCursor const **cursp );
 
 
 /*--------------------------------------------------------------------------
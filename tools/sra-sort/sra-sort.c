@@ -30,6 +30,7 @@
 #include "except.h"
 #include "status.h"
 #include "sra-sort.h"
+#include "checkpoint.h"
 
 #include <kapp/main.h>
 #include <kapp/args.h>
@@ -75,12 +76,15 @@ rc_t CC UsageSummary ( const char *prog_name )
 #define OPT_FORCE "force"
 #define OPT_MEM_LIMIT "mem-limit"
 #define OPT_MAP_FILE_BSIZE "map-file-bsize"
+#define OPT_MAP_MEM_LIMIT "map-mem-limit"
 #define OPT_MAX_IDX_IDS "max-idx-ids"
 #define OPT_MAX_REF_IDX_IDS "max-ref-idx-ids"
 #define OPT_MAX_LARGE_IDX_IDS "max-large-idx-ids"
 #define OPT_TEMP_DIR "tempdir"
 #define OPT_MMAP_DIR "mmapdir"
 #define OPT_UNSORTED_OLD_NEW "unsorted-old-new"
+#define OPT_CHECKPOINT "checkpoint"
+#define OPT_FULL_SORT "full-sort"
 
 #define OPT_COLUMN_MD5 "column-md5"
 #define OPT_NO_COLUMN_CHECKSUM "no-column-checksum"
@@ -91,18 +95,24 @@ rc_t CC UsageSummary ( const char *prog_name )
 
 #define OPT_KEEP_IDX_FILES "keep-idx-files"
 #define OPT_IDX_CONSISTENCY_CHECK "idx-cc"
+#define OPT_XCHECK_INJECT "xcheck-inject"
 
 static const char *hlp_ignore_failure [] = { "ignore failure when sorting multiple objects",
                                              "i.e. continue in spite of previous errors", NULL };
 static const char *hlp_force [] = { "force overwrite of existing destination", NULL };
 static const char *hlp_mem_limit [] = { "sets limit on dynamic memory usage", NULL };
 static const char *hlp_map_file_bsize [] = { "sets id map-file cache size", NULL };
+static const char *hlp_map_mem_limit [] = { "sets memory for keeping id maps in memory rather than in files",
+                                            "0 to always use files", NULL };
 static const char *hlp_max_idx_ids [] = { "sets number of join-index ids to process at a time", NULL };
 static const char *hlp_max_ref_idx_ids [] = { "sets number of join-index ids to process within REFERENCE table", NULL };
 static const char *hlp_max_large_idx_ids [] = { "sets number of rows to process with large columns", NULL };
 static const char *hlp_temp_dir [] = { "sets a specific directory to use for temporary files", NULL };
 static const char *hlp_mmap_dir [] = { "sets a specific directory to use for memory-mapped buffers", NULL };
 static const char *hlp_unsorted_old_new [] = { "write old=>new index in unsorted order", NULL };
+static const char *hlp_checkpoint [] = { "keep finished tables and id maps in '<dst-object>.sra-sort-checkpoint'",
+                                         "so that the same command resumes an interrupted sort", NULL };
+static const char *hlp_full_sort [] = { "sort even when the input is found to be in sorted order already", NULL };
 
 static const char *hlp_column_md5 [] = { "generate md5sum compatible checksum files for each column [default]", NULL };
 static const char *hlp_no_column_checksum [] = { "disable generation of column checksums", NULL };
@@ -114,6 +124,8 @@ static const char *hlp_no_blob_checksum [] = { "disable generation of blob check
 #if _DEBUGGING
 static const char *hlp_keep_idx_files [] = { "keep temporary index files for debugging", NULL };
 static const char *hlp_idx_consistency_check [] = { "run consistency check on index files", NULL };
+static const char *hlp_xcheck_inject [] = { "make the consistency-check of REFERENCE against alignments",
+                                            "see a wrong REF_ID on the given alignment row", NULL };
 #endif
 
 static OptDef options [] =
@@ -130,12 +142,15 @@ static OptDef options [] =
   , { OPT_FORCE, "f", NULL, hlp_force, 1, false, false }
   , { OPT_MEM_LIMIT, NULL, NULL, hlp_mem_limit, 1, true, false }
   , { OPT_MAP_FILE_BSIZE, NULL, NULL, hlp_map_file_bsize, 1, true, false }
+  , { OPT_MAP_MEM_LIMIT, NULL, NULL, hlp_map_mem_limit, 1, true, false }
   , { OPT_MAX_IDX_IDS, NULL, NULL, hlp_max_idx_ids, 1, true, false }
   , { OPT_MAX_REF_IDX_IDS, NULL, NULL, hlp_max_ref_idx_ids, 1, true, false }
   , { OPT_MAX_LARGE_IDX_IDS, NULL, NULL, hlp_max_large_idx_ids, 1, true, false }
   , { OPT_TEMP_DIR, NULL, NULL, hlp_temp_dir, 1, true, false }
   , { OPT_MMAP_DIR, NULL, NULL, hlp_mmap_dir, 1, true, false }
   , { OPT_UNSORTED_OLD_NEW, NULL, NULL, hlp_unsorted_old_new, 1, false, false }
+  , { OPT_CHECKPOINT, NULL, NULL, hlp_checkpoint, 1, false, false }
+  , { OPT_FULL_SORT, NULL, NULL, hlp_full_sort, 1, false, false }
 
   , { OPT_COLUMN_MD5, NULL, NULL, hlp_column_md5, 1, false, false }
   , { OPT_NO_COLUMN_CHECKSUM, NULL, NULL, hlp_no_column_checksum, 1, false, false }
@@ -145,6 +160,7 @@ static OptDef options [] =
 #if _DEBUGGING
   , { OPT_KEEP_IDX_FILES, NULL, NULL, hlp_keep_idx_files, 1, false, false }
   , { OPT_IDX_CONSISTENCY_CHECK, NULL, NULL, hlp_idx_consistency_check, 1, false, false }
+  , { OPT_XCHECK_INJECT, NULL, NULL, hlp_xcheck_inject, 1, true, false }
 #endif
 };
 
@@ -154,6 +170,7 @@ static const char *option_params [] =
   , NULL
   , "bytes"
   , "cache-size"
+  , "bytes"
   , "num-ids"
   , "num-ids"
   , "num-ids"
@@ -165,9 +182,12 @@ static const char *option_params [] =
   , NULL
   , NULL
   , NULL
+  , NULL
+  , NULL
 #if _DEBUGGING
   , NULL
   , NULL
+  , "row-id"
 #endif
 };
 
@@ -277,7 +297,7 @@ uint64_t KConfigGetNodeU64 ( const ctx_t *ctx, const char *path, bool *found )
     if ( found == NULL )
         found = & dummy;
 
-    rc = KConfigOpenNodeRead ( ctx -> caps -> cfg, & n, "sra-sort/map_file_bsize" );
+    rc = KConfigOpenNodeRead ( ctx -> caps -> cfg, & n, "%s", path );
     if ( rc == 0 )
     {
         char buff [ 256 ];
@@ -333,6 +353,9 @@ void initialize_params ( const ctx_t *ctx, Caps *caps, Tool *tp, Selection *sel,
     tp -> map_file_bsize = 64 * 1024 * 1024;
     tp -> map_file_random_bsize = tp -> map_file_bsize;
 
+    /* default memory for id maps held in memory */
+    tp -> map_mem_limit = ( size_t ) 1024 * 1024 * 1024;
+
     /* default max index ids to gather at a time */
     tp -> max_ref_idx_ids = tp -> max_large_idx_ids = tp -> max_idx_ids = 256 * 1024 * 1024;
     tp -> max_poslen_ids = 64 * 1024 * 1024;
@@ -375,6 +398,13 @@ tp->write_new_to_old=true;
     tp -> unlink_idx_files = true;
     tp -> idx_consistency_check = false;
 
+    /* normally the sort is not resumable */
+    tp -> checkpoint = false;
+    tp -> ckpt = NULL;
+
+    /* input found in sorted order is copied without sorting */
+    tp -> full_sort = false;
+
 
     /* record them as caps */
     caps -> tool = tp;
@@ -391,6 +421,11 @@ tp->write_new_to_old=true;
     if ( found )
         tp -> map_file_random_bsize = ( size_t ) val;
 
+    ON_FAIL ( val = KConfigGetNodeU64 ( ctx, "sra-sort/map_mem_limit", & found ) )
+        return;
+    if ( found )
+        tp -> map_mem_limit = ( size_t ) val;
+
     ON_FAIL ( val = KConfigGetNodeU64 ( ctx, "sra-sort/max_idx_ids", & found ) )
         return;
     if ( found )
@@ -417,6 +452,11 @@ tp->write_new_to_old=true;
     if ( count != 0 )
         tp -> map_file_random_bsize = ( size_t ) val;
    
+    ON_FAIL ( val = ArgsGetOptU64 ( args, ctx, OPT_MAP_MEM_LIMIT, & count ) )
+        return;
+    if ( count != 0 )
+        tp -> map_mem_limit = ( size_t ) val;
+
     ON_FAIL ( val = ArgsGetOptU64 ( args, ctx, OPT_MAX_IDX_IDS, & count ) )
         return;
     if ( count != 0 )
@@ -447,6 +487,16 @@ tp->write_new_to_old=true;
     if ( count != 0 )
         tp -> sort_before_old2new = false;
 
+    ON_FAIL ( found = ArgsGetOptBool ( args, ctx, OPT_CHECKPOINT, & count ) )
+        return;
+    if ( count != 0 )
+        tp -> checkpoint = true;
+
+    ON_FAIL ( found = ArgsGetOptBool ( args, ctx, OPT_FULL_SORT, & count ) )
+        return;
+    if ( count != 0 )
+        tp -> full_sort = true;
+
     ON_FAIL ( found = ArgsGetOptBool ( args, ctx, OPT_COLUMN_MD5, & count ) )
         return;
     if ( count != 0 )
@@ -492,6 +542,11 @@ tp->write_new_to_old=true;
         return;
     if ( count != 0 )
         tp -> idx_consistency_check = tp -> write_new_to_old = true;
+
+    ON_FAIL ( val = ArgsGetOptU64 ( args, ctx, OPT_XCHECK_INJECT, & count ) )
+        return;
+    if ( count != 0 )
+        tp -> xcheck_inject_row = ( int64_t ) val;
 #endif
 }
 
@@ -525,6 +580,44 @@ void initialize_caps ( const ctx_t *ctx, Caps *caps, Args *args )
     }
 }
 
+/* run_resumable
+ *  run with a checkpoint when asked for one: a checkpoint left by an
+ *  earlier run reopens the destination instead of creating it
+ */
+static
+void run_resumable ( const ctx_t *ctx, Tool *tp )
+{
+    FUNC_ENTRY ( ctx );
+
+    if ( ! tp -> checkpoint )
+        run ( ctx );
+    else
+    {
+        TRY ( tp -> ckpt = CheckpointMake ( ctx, tp -> src_path, tp -> dst_path ) )
+        {
+            KCreateMode db_cmode = tp -> db . cmode;
+            KCreateMode tbl_cmode = tp -> tbl . cmode;
+
+            if ( CheckpointResuming ( tp -> ckpt ) )
+            {
+                tp -> db . cmode = kcmOpen | ( tp -> db . cmode & ~ kcmValueMask );
+                tp -> tbl . cmode = kcmOpen | ( tp -> tbl . cmode & ~ kcmValueMask );
+            }
+
+            TRY ( run ( ctx ) )
+            {
+                CheckpointFinish ( tp -> ckpt, ctx );
+            }
+
+            CheckpointRelease ( tp -> ckpt, ctx );
+            tp -> ckpt = NULL;
+
+            tp -> db . cmode = db_cmode;
+            tp -> tbl . cmode = tbl_cmode;
+        }
+    }
+}
+
 rc_t CC KMain ( int argc, char *argv [] )
 {
     DECLARE_CTX_INFO ();
@@ -672,7 +765,7 @@ rc_t CC KMain ( int argc, char *argv [] )
                                                                 STATUS ( 1, "################################################################" );
 
                                                             tp . dst_path = dst_path;
-                                                            ON_FAIL ( run ( ctx ) )
+                                                            ON_FAIL ( run_resumable ( ctx, & tp ) )
                                                             {
                                                                 if ( ! tp . ignore )
                                                                     break;
@@ -711,7 +804,7 @@ rc_t CC KMain ( int argc, char *argv [] )
                                                             rc = RC ( rcExe, rcArgv, rcParsing, rcArgv, rcIncorrect );
                                                             ERROR ( rc, "source and destination object types are not compatible" );
                                                         }
-                                                        else if ( ! tp . force )
+                                                        else if ( ! tp . force && ! ( tp . checkpoint && CheckpointExists ( ctx, tp . dst_path ) ) )
                                                         {
                                                             rc = RC ( rcExe, targ, rcCopying, targ, rcExists );
                                                             ERROR ( rc, "destination object cannot be overwritten - try again with '-f'" );
@@ -724,7 +817,7 @@ rc_t CC KMain ( int argc, char *argv [] )
                                                     }
 
                                                     if ( ! FAILED () )
-                                                        run ( ctx );
+                                                        run_resumable ( ctx, & tp );
                                                 }
                                             }
                                         }
@@ -47,6 +47,7 @@
  */
 struct DbPair;
 struct TablePair;
+struct Checkpoint;
 
 
 /*--------------------------------------------------------------------------
@@ -85,6 +86,9 @@ struct Tool
     size_t map_file_bsize;
     size_t map_file_random_bsize;
 
+    /* memory for id maps kept in memory rather than in files */
+    size_t map_mem_limit;
+
     /* the number of ids to gather at a time */
     size_t max_ref_idx_ids;
     size_t max_large_idx_ids;
@@ -139,6 +143,18 @@ struct Tool
 
     /* perform consistency check on index */
     bool idx_consistency_check;
+
+    /* alignment row given a wrong REF_ID by the cross-check
+       of REFERENCE against alignments, for testing it */
+    int64_t xcheck_inject_row;
+
+    /* keep finished tables and map files to resume from */
+    bool checkpoint;
+    struct Checkpoint *ckpt;
+
+    /* sort input that is in sorted order already,
+       rather than copying it in row order */
+    bool full_sort;
 };
 
 
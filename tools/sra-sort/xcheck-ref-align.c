@@ -29,16 +29,21 @@
 #include "mem.h"
 #include "except.h"
 #include "status.h"
+#include "sra-sort.h"
 
 #include <kapp/main.h>
 #include <vdb/table.h>
 #include <vdb/cursor.h>
 #include <vdb/vdb-priv.h>
 #include <kproc/thread.h>
+#include <klib/printf.h>
 #include <klib/rc.h>
+#include <atomic.h>
 
 #include <string.h>
 
+/* the whole check runs on a background thread in release builds,
+   its range-workers have threads of their own in every build */
 #if ! _DEBUGGING
 #define USE_BGTHREAD 1
 #endif
@@ -57,7 +62,8 @@ FILE_ENTRY ( xcheck-ref-align );
 static
 int64_t TestReferenceCell ( const ctx_t *ctx,
     const VCursor *ref_curs, uint32_t align_ids_idx,
-    const char *align_name, int64_t ref_row_id, int64_t excl_ref_last_idx )
+    const char *align_name, int64_t ref_row_id, int64_t excl_ref_last_idx,
+    int64_t *first_align_idx )
 {
     FUNC_ENTRY ( ctx );
 
@@ -81,6 +87,13 @@ int64_t TestReferenceCell ( const ctx_t *ctx,
     else
     {
         uint32_t i;
+
+        /* a range of rows checked on its own does not know its first
+           id before its first non-empty row - it is checked later,
+           against the end of the range before */
+        if ( excl_ref_last_idx == 0 && row_len != 0 )
+            * first_align_idx = excl_ref_last_idx = cell [ 0 ];
+
         for ( i = 0; i < row_len; ++ i )
         {
             if ( cell [ i ] != excl_ref_last_idx + i )
@@ -128,119 +141,164 @@ void TestAlignCell ( const ctx_t *ctx,
         rc = RC ( rcExe, rcIndex, rcValidating, rcRange, rcIncorrect );
         ERROR ( rc, "VCursorCellDataDirect - row_len of %u reading row %ld from %s cursor", row_len, align_row_id, align_name );
     }
-    else if ( * cell != ref_row_id )
+    else
     {
-        rc = RC ( rcExe, rcIndex, rcValidating, rcId, rcIncorrect );
-        ERROR ( rc, "%s.REF_ID.%ld: expected id %ld but found %ld",
-                align_name, align_row_id, ref_row_id, cell [ 0 ] );
+        int64_t ref_id = cell [ 0 ];
+#if _DEBUGGING
+        /* an inconsistency injected on purpose */
+        if ( align_row_id == ctx -> caps -> tool -> xcheck_inject_row )
+            ++ ref_id;
+#endif
+        if ( ref_id != ref_row_id )
+        {
+            rc = RC ( rcExe, rcIndex, rcValidating, rcId, rcIncorrect );
+            ERROR ( rc, "%s.REF_ID.%ld: expected id %ld but found %ld",
+                    align_name, align_row_id, ref_row_id, ref_id );
+        }
     }
 }
 
+/*--------------------------------------------------------------------------
+ * CrossCheckRefAlign
+ *  the rows of REFERENCE are split into ranges that are checked
+ *  on their own by a few workers, each with its own pair of cursors.
+ *  each worker walks one range after another, so that memory stays
+ *  bounded by the blobs cached on its cursors. the ranges are then
+ *  chained: each one has to start where the one before left off.
+ */
+#define XCHECK_MAX_WORKERS 4
+#define XCHECK_RANGES_PER_WORKER 4
+#define XCHECK_MIN_RANGE_ROWS 256
+
+typedef struct CrossCheckRange CrossCheckRange;
+struct CrossCheckRange
+{
+    /* rows of REFERENCE */
+    int64_t ref_row_id, excl_ref_last_id;
+
+    /* first alignment id with the REFERENCE row it was found on,
+       and the end of the alignment ids found - all 0 if empty */
+    int64_t first_align_idx, first_align_ref_row_id;
+    int64_t excl_last_align_idx;
+};
+
+typedef struct CrossCheckRefAlign CrossCheckRefAlign;
+struct CrossCheckRefAlign
+{
+    const VTable *ref_tbl, *align_tbl;
+    const char *align_name;
+
+    CrossCheckRange *ranges;
+    uint32_t num_ranges;
+    uint32_t num_workers;
+
+    int64_t align_row_id, excl_align_last_id;
+
+    /* set by the first worker to fail */
+    atomic_t failed;
+};
+
+
 /*--------------------------------------------------------------------------
  * CrossCheckRefAlignCols
- *  performs the cross-check
+ *  performs the cross-check on a range of REFERENCE rows
  */
 static
 void CrossCheckRefAlignCols ( const ctx_t *ctx,
     const VCursor *ref_curs, uint32_t align_ids_idx,
-    const VCursor *align_curs, uint32_t ref_id_idx, const char *align_name )
+    const VCursor *align_curs, uint32_t ref_id_idx,
+    CrossCheckRefAlign *xc, CrossCheckRange *range )
 {
     FUNC_ENTRY ( ctx );
 
-    int64_t ref_row_id, excl_ref_last_id;
-    rc_t rc = VCursorIdRange ( ref_curs, 0, & ref_row_id, ( uint64_t* ) & excl_ref_last_id );
-    if ( rc != 0 )
-        INTERNAL_ERROR ( rc, "VCursorIdRange - failed to establish row range on REFERENCE cursor" );
-    else
+    rc_t rc;
+    const char *align_name = xc -> align_name;
+    int64_t ref_row_id = range -> ref_row_id;
+    int64_t excl_ref_last_id = range -> excl_ref_last_id;
+    int64_t excl_align_last_id = xc -> excl_align_last_id;
+    int64_t align_row_id = 0, excl_last_align_idx = 0;
+
+    for ( ; ref_row_id < excl_ref_last_id; ++ ref_row_id )
     {
-        int64_t align_row_id, excl_align_last_id;
+        int64_t first_align_idx = excl_last_align_idx;
 
-        excl_ref_last_id += ref_row_id;
+        /* rule for bailing out */
+        rc = Quitting ();
+        if ( rc != 0 || FAILED () || atomic_read ( & xc -> failed ) != 0 )
+            return;
 
-        rc = VCursorIdRange ( align_curs, 0, & align_row_id, ( uint64_t* ) & excl_align_last_id );
-        if ( rc != 0 )
-            INTERNAL_ERROR ( rc, "VCursorIdRange - failed to establish row range on %s cursor", align_name );
-        else
+        /* the REFERENCE id cell should be filled purely with sequential ids */
+        TRY ( excl_last_align_idx = TestReferenceCell ( ctx, ref_curs, align_ids_idx,
+                  align_name, ref_row_id, excl_last_align_idx, & range -> first_align_idx ) )
         {
-            int64_t excl_last_align_idx;
-
-            excl_align_last_id += align_row_id;
-
-            for ( excl_last_align_idx = 1; ref_row_id < excl_ref_last_id; ++ ref_row_id )
+            /* the first id of the range */
+            if ( first_align_idx == 0 )
             {
-                int64_t first_align_idx = excl_last_align_idx;
+                if ( excl_last_align_idx == 0 )
+                    continue;
 
-                /* rule for bailing out */
-                rc = Quitting ();
-                if ( rc != 0 || FAILED () )
-                    break;
-
-                /* the REFERENCE id cell should be filled purely with sequential ids */
-                TRY ( excl_last_align_idx = TestReferenceCell ( ctx, ref_curs, align_ids_idx,
-                          align_name, ref_row_id, excl_last_align_idx ) )
-                {
-                    /* the ids must be within the range of the alignment table */
-                    if ( excl_last_align_idx > excl_align_last_id )
-                    {
-                        rc = RC ( rcExe, rcIndex, rcValidating, rcId, rcExcessive );
-                        ERROR ( rc, "REFERENCE.%s_IDS.%ld: references non-existant rows ( %ld .. %ld : max %ld )",
-                                align_name, ref_row_id, first_align_idx, excl_last_align_idx, excl_align_last_id );
-                        break;
-                    }
+                first_align_idx = align_row_id = range -> first_align_idx;
+                range -> first_align_ref_row_id = ref_row_id;
+            }
 
-                    /* this is more of a permanent assert */
-                    if ( first_align_idx != align_row_id )
-                    {
-                        rc = RC ( rcExe, rcIndex, rcValidating, rcId, rcIncorrect );
-                        ERROR ( rc, "REFERENCE.%s_IDS.%ld: expected id %ld but found %ld",
-                                align_name, ref_row_id, first_align_idx, align_row_id );
-                        break;
-                    }
+            /* the ids must be within the range of the alignment table */
+            if ( first_align_idx < xc -> align_row_id || excl_last_align_idx > excl_align_last_id )
+            {
+                rc = RC ( rcExe, rcIndex, rcValidating, rcId, rcExcessive );
+                ERROR ( rc, "REFERENCE.%s_IDS.%ld: references non-existant rows ( %ld .. %ld : max %ld )",
+                        align_name, ref_row_id, first_align_idx, excl_last_align_idx, excl_align_last_id );
+                break;
+            }
 
-                    /* each of the rows in alignment table must point back
-                       to the same row in the REFERENCE table */
-                    for ( ; align_row_id < excl_last_align_idx; ++ align_row_id )
-                    {
-                        ON_FAIL ( TestAlignCell ( ctx, align_curs, ref_id_idx,
-                                      align_name, align_row_id, ref_row_id ) )
-                            break;
-                    }
-                }
+            /* this is more of a permanent assert */
+            if ( first_align_idx != align_row_id )
+            {
+                rc = RC ( rcExe, rcIndex, rcValidating, rcId, rcIncorrect );
+                ERROR ( rc, "REFERENCE.%s_IDS.%ld: expected id %ld but found %ld",
+                        align_name, ref_row_id, first_align_idx, align_row_id );
+                break;
             }
 
-            /* at this point, we must have seen every record */
-            if ( ! FAILED () )
+            /* each of the rows in alignment table must point back
+               to the same row in the REFERENCE table */
+            for ( ; align_row_id < excl_last_align_idx; ++ align_row_id )
             {
-                if ( ref_row_id != excl_ref_last_id )
-                {
-                    rc = RC ( rcExe, rcIndex, rcValidating, rcRange, rcIncomplete );
-                    ERROR ( rc, "REFERENCE.%s_IDS: scan stopped on row %ld of %ld",
-                            align_name, ref_row_id, excl_ref_last_id );
-                }
-                if ( align_row_id != excl_align_last_id )
-                {
-                    rc = RC ( rcExe, rcIndex, rcValidating, rcRange, rcIncomplete );
-                    ERROR ( rc, "%s.REF_ID: scan stopped on row %ld of %ld",
-                            align_name, align_row_id, excl_align_last_id );
-                }
+                ON_FAIL ( TestAlignCell ( ctx, align_curs, ref_id_idx,
+                              align_name, align_row_id, ref_row_id ) )
+                    break;
             }
         }
     }
-}
 
+    /* at this point, we must have seen every record of the range */
+    if ( ! FAILED () )
+    {
+        range -> excl_last_align_idx = excl_last_align_idx;
+
+        if ( ref_row_id != excl_ref_last_id )
+        {
+            rc = RC ( rcExe, rcIndex, rcValidating, rcRange, rcIncomplete );
+            ERROR ( rc, "REFERENCE.%s_IDS: scan stopped on row %ld of %ld",
+                    align_name, ref_row_id, excl_ref_last_id );
+        }
+    }
+}
 
 
 /*--------------------------------------------------------------------------
  * CrossCheckRefAlignCurs
  *  adds columns and opens cursors
+ *  then checks every range of the worker
  */
 static
 void CrossCheckRefAlignCurs ( const ctx_t *ctx,
-    const VCursor *ref_curs, const VCursor *align_curs, const char *align_name )
+    const VCursor *ref_curs, const VCursor *align_curs,
+    CrossCheckRefAlign *xc, uint32_t worker )
 {
     FUNC_ENTRY ( ctx );
 
     uint32_t align_ids_idx;
+    const char *align_name = xc -> align_name;
     rc_t rc = VCursorAddColumn ( ref_curs, & align_ids_idx, "%s_IDS", align_name );
     if ( rc != 0 )
         INTERNAL_ERROR ( rc, "VCursorAddColumn - failed to add column '%s_IDS' to REFERENCE cursor", align_name );
@@ -272,7 +330,13 @@ void CrossCheckRefAlignCurs ( const ctx_t *ctx,
                             INTERNAL_ERROR ( rc, "VCursorSetRowId - failed to set row-id on %s cursor", align_name );
                         else
                         {
-                            CrossCheckRefAlignCols ( ctx, ref_curs, align_ids_idx, align_curs, ref_id_idx, align_name );
+                            uint32_t i;
+                            for ( i = worker; i < xc -> num_ranges; i += xc -> num_workers )
+                            {
+                                ON_FAIL ( CrossCheckRefAlignCols ( ctx, ref_curs, align_ids_idx,
+                                              align_curs, ref_id_idx, xc, & xc -> ranges [ i ] ) )
+                                    break;
+                            }
                         }
                     }
                 }
@@ -283,26 +347,25 @@ void CrossCheckRefAlignCurs ( const ctx_t *ctx,
 
 
 /*--------------------------------------------------------------------------
- * CrossCheckRefAlignTbl
- *  checks REFERENCE.<name>_IDS for properly sorted form
- *  runs a cross-check of REFERENCE.<name>_IDS against <name>.REF_ID
+ * CrossCheckRefAlignWorker
+ *  creates a linked pair of cursors for one worker
  */
 static
-void CrossCheckRefAlignTblInt ( const ctx_t *ctx,
-    const VTable *ref_tbl, const VTable *align_tbl, const char *align_name )
+void CrossCheckRefAlignWorker ( const ctx_t *ctx, CrossCheckRefAlign *xc, uint32_t worker )
 {
     FUNC_ENTRY ( ctx );
 
     rc_t rc;
     const VCursor *ref_curs;
+    const char *align_name = xc -> align_name;
 
-    rc = VTableCreateCursorRead ( ref_tbl, & ref_curs );
+    rc = VTableCreateCursorRead ( xc -> ref_tbl, & ref_curs );
     if ( rc != 0 )
         INTERNAL_ERROR ( rc, "VTableCreateCursorRead - failed to open cursor on REFERENCE table" );
     else
     {
         const VCursor *align_curs;
-        rc = VTableCreateCursorRead ( align_tbl, & align_curs );
+        rc = VTableCreateCursorRead ( xc -> align_tbl, & align_curs );
         if ( rc != 0 )
             INTERNAL_ERROR ( rc, "VTableCreateCursorRead - failed to open cursor on %s table", align_name );
         else
@@ -312,7 +375,7 @@ void CrossCheckRefAlignTblInt ( const ctx_t *ctx,
                 INTERNAL_ERROR ( rc, "VCursorLinkedCursorSet - failed to link cursor on REFERENCE table" );
             else
             {
-                CrossCheckRefAlignCurs ( ctx, ref_curs, align_curs, align_name );
+                CrossCheckRefAlignCurs ( ctx, ref_curs, align_curs, xc, worker );
             }
 
             VCursorRelease ( align_curs );
@@ -320,6 +383,248 @@ void CrossCheckRefAlignTblInt ( const ctx_t *ctx,
 
         VCursorRelease ( ref_curs );
     }
+
+    /* let the others stop */
+    if ( FAILED () )
+        atomic_set ( & xc -> failed, 1 );
+}
+
+typedef struct CrossCheckRefAlignWorkerData CrossCheckRefAlignWorkerData;
+struct CrossCheckRefAlignWorkerData
+{
+    Caps caps;
+    CrossCheckRefAlign *xc;
+    uint32_t worker;
+};
+
+static
+rc_t CC CrossCheckRefAlignWorkerRun ( const KThread *self, void *data )
+{
+    CrossCheckRefAlignWorkerData *pb = data;
+
+    DECLARE_CTX_INFO ();
+    ctx_t thread_ctx = { & pb -> caps, NULL, & ctx_info };
+    const ctx_t *ctx = & thread_ctx;
+
+    CrossCheckRefAlignWorker ( ctx, pb -> xc, pb -> worker );
+
+    return ctx -> rc;
+}
+
+
+/*--------------------------------------------------------------------------
+ * CrossCheckRefAlignIdRange
+ *  the row range of a table, as seen through one of its columns
+ */
+static
+void CrossCheckRefAlignIdRange ( const ctx_t *ctx, const VTable *tbl,
+    const char *tbl_name, const char *col_name, int64_t *first, int64_t *excl_last )
+{
+    FUNC_ENTRY ( ctx );
+
+    const VCursor *curs;
+    rc_t rc = VTableCreateCursorRead ( tbl, & curs );
+    if ( rc != 0 )
+        INTERNAL_ERROR ( rc, "VTableCreateCursorRead - failed to open cursor on %s table", tbl_name );
+    else
+    {
+        uint32_t idx;
+        rc = VCursorAddColumn ( curs, & idx, "%s", col_name );
+        if ( rc != 0 )
+            INTERNAL_ERROR ( rc, "VCursorAddColumn - failed to add column '%s' to %s cursor", col_name, tbl_name );
+        else
+        {
+            rc = VCursorOpen ( curs );
+            if ( rc != 0 )
+                INTERNAL_ERROR ( rc, "VCursorOpen - failed to open cursor on %s table", tbl_name );
+            else
+            {
+                uint64_t count;
+                rc = VCursorIdRange ( curs, 0, first, & count );
+                if ( rc != 0 )
+                    INTERNAL_ERROR ( rc, "VCursorIdRange - failed to establish row range on %s cursor", tbl_name );
+                else
+                    * excl_last = * first + ( int64_t ) count;
+            }
+        }
+
+        VCursorRelease ( curs );
+    }
+}
+
+
+/*--------------------------------------------------------------------------
+ * CrossCheckRefAlignChain
+ *  every range has to continue where the one before left off,
+ *  and together they have to cover the alignment table
+ */
+static
+void CrossCheckRefAlignChain ( const ctx_t *ctx, const CrossCheckRefAlign *xc )
+{
+    FUNC_ENTRY ( ctx );
+
+    rc_t rc;
+    uint32_t i;
+    int64_t align_row_id = xc -> align_row_id;
+
+    for ( i = 0; i < xc -> num_ranges; ++ i )
+    {
+        const CrossCheckRange *range = & xc -> ranges [ i ];
+        if ( range -> excl_last_align_idx != 0 )
+        {
+            if ( range -> first_align_idx != align_row_id )
+            {
+                rc = RC ( rcExe, rcIndex, rcValidating, rcId, rcIncorrect );
+                ERROR ( rc, "REFERENCE.%s_IDS.%ld: expected id %ld but found %ld",
+                        xc -> align_name, range -> first_align_ref_row_id, align_row_id, range -> first_align_idx );
+                return;
+            }
+
+            align_row_id = range -> excl_last_align_idx;
+        }
+    }
+
+    /* at this point, we must have seen every record */
+    if ( align_row_id != xc -> excl_align_last_id )
+    {
+        rc = RC ( rcExe, rcIndex, rcValidating, rcRange, rcIncomplete );
+        ERROR ( rc, "%s.REF_ID: scan stopped on row %ld of %ld",
+                xc -> align_name, align_row_id, xc -> excl_align_last_id );
+    }
+}
+
+
+/*--------------------------------------------------------------------------
+ * CrossCheckRefAlignTbl
+ *  checks REFERENCE.<name>_IDS for properly sorted form
+ *  runs a cross-check of REFERENCE.<name>_IDS against <name>.REF_ID
+ */
+static
+void CrossCheckRefAlignRun ( const ctx_t *ctx, CrossCheckRefAlign *xc )
+{
+    FUNC_ENTRY ( ctx );
+
+    uint32_t i;
+    rc_t rc;
+    KThread *threads [ XCHECK_MAX_WORKERS ];
+    CrossCheckRefAlignWorkerData pbs [ XCHECK_MAX_WORKERS ];
+
+    /* the workers beyond the first get a thread of their own */
+    for ( i = 1; i < xc -> num_workers; ++ i )
+    {
+        threads [ i ] = NULL;
+        TRY ( CapsInit ( & pbs [ i ] . caps, ctx ) )
+        {
+            pbs [ i ] . xc = xc;
+            pbs [ i ] . worker = i;
+
+            rc = KThreadMake ( & threads [ i ], CrossCheckRefAlignWorkerRun, & pbs [ i ] );
+            if ( rc != 0 )
+            {
+                INTERNAL_ERROR ( rc, "failed to start consistency-check worker %u", i );
+                CapsWhack ( & pbs [ i ] . caps, ctx );
+                threads [ i ] = NULL;
+            }
+        }
+
+        if ( FAILED () )
+        {
+            /* the workers already running stop as well */
+            atomic_set ( & xc -> failed, 1 );
+            break;
+        }
+    }
+
+    if ( ! FAILED () )
+        CrossCheckRefAlignWorker ( ctx, xc, 0 );
+
+    /* join the workers that were started */
+    while ( -- i > 0 )
+    {
+        rc_t status;
+
+        rc = KThreadWait ( threads [ i ], & status );
+        if ( rc != 0 )
+            INTERNAL_ERROR ( rc, "failed to wait for consistency-check worker %u", i );
+        else if ( status != 0 && ! FAILED () )
+            ERROR ( status, "consistency-check worker %u failed", i );
+
+        KThreadRelease ( threads [ i ] );
+        CapsWhack ( & pbs [ i ] . caps, ctx );
+    }
+}
+
+static
+void CrossCheckRefAlignTblInt ( const ctx_t *ctx,
+    const VTable *ref_tbl, const VTable *align_tbl, const char *align_name )
+{
+    FUNC_ENTRY ( ctx );
+
+    rc_t rc;
+    char ids_col [ 256 ];
+    CrossCheckRefAlign xc;
+    int64_t ref_row_id, excl_ref_last_id;
+
+    memset ( & xc, 0, sizeof xc );
+    xc . ref_tbl = ref_tbl;
+    xc . align_tbl = align_tbl;
+    xc . align_name = align_name;
+    atomic_set ( & xc . failed, 0 );
+
+    rc = string_printf ( ids_col, sizeof ids_col, NULL, "%s_IDS", align_name );
+    if ( rc != 0 )
+        INTERNAL_ERROR ( rc, "string_printf - failed to build column name '%s_IDS'", align_name );
+    else
+    {
+        TRY ( CrossCheckRefAlignIdRange ( ctx, ref_tbl, "REFERENCE", ids_col, & ref_row_id, & excl_ref_last_id ) )
+        {
+            TRY ( CrossCheckRefAlignIdRange ( ctx, align_tbl, align_name, "REF_ID",
+                      & xc . align_row_id, & xc . excl_align_last_id ) )
+            {
+                uint32_t i;
+                uint64_t per_range;
+                uint64_t ref_rows = ( uint64_t ) ( excl_ref_last_id - ref_row_id );
+
+                /* no more workers than there are rows for */
+                for ( xc . num_workers = XCHECK_MAX_WORKERS; xc . num_workers > 1; -- xc . num_workers )
+                {
+                    if ( ref_rows >= ( uint64_t ) xc . num_workers * XCHECK_MIN_RANGE_ROWS )
+                        break;
+                }
+
+                /* a few ranges per worker even out references of different density */
+                xc . num_ranges = xc . num_workers * XCHECK_RANGES_PER_WORKER;
+                if ( ( uint64_t ) xc . num_ranges > ref_rows )
+                    xc . num_ranges = ( ref_rows == 0 ) ? 1 : ( uint32_t ) ref_rows;
+                per_range = ( ref_rows + xc . num_ranges - 1 ) / xc . num_ranges;
+
+                TRY ( xc . ranges = MemAlloc ( ctx, sizeof * xc . ranges * xc . num_ranges, true ) )
+                {
+                    for ( i = 0; i < xc . num_ranges; ++ i )
+                    {
+                        CrossCheckRange *range = & xc . ranges [ i ];
+
+                        range -> ref_row_id = ref_row_id + ( int64_t ) ( i * per_range );
+                        range -> excl_ref_last_id = range -> ref_row_id + ( int64_t ) per_range;
+                        if ( range -> ref_row_id > excl_ref_last_id )
+                            range -> ref_row_id = excl_ref_last_id;
+                        if ( range -> excl_ref_last_id > excl_ref_last_id )
+                            range -> excl_ref_last_id = excl_ref_last_id;
+                    }
+
+                    STATUS ( 2, "checking %,lu REFERENCE rows against %s in %u ranges on %u workers",
+                             ref_rows, align_name, xc . num_ranges, xc . num_workers );
+
+                    TRY ( CrossCheckRefAlignRun ( ctx, & xc ) )
+                    {
+                        CrossCheckRefAlignChain ( ctx, & xc );
+                    }
+
+                    MemFree ( ctx, xc . ranges, sizeof * xc . ranges * xc . num_ranges );
+                }
+            }
+        }
+    }
 }
 
 #if USE_BGTHREAD
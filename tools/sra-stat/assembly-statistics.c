@@ -30,11 +30,11 @@
 
 #include <kdb/table.h> /* KTable */
 
-#include <klib/container.h> /* BSTNode */
 #include <klib/debug.h> /* DBGMSG */
 #include <klib/log.h> /* LOGERR */
 #include <klib/out.h> /* OUTMSG */
 #include <klib/rc.h>
+#include <klib/sort.h> /* ksort */
 
 #include <vdb/blob.h> /* VBlob */
 #include <vdb/cursor.h> /* VCursor */
@@ -42,25 +42,9 @@
 #include <vdb/table.h> /* VTable */
 #include <vdb/vdb-priv.h> /* VTableOpenKTableRead */
 
-typedef struct {
-    BSTNode n;
-    uint64_t length;
-} Contig;
-
-static void CC ContigWhack ( BSTNode * n, void * data ) {
-    free ( n );
-}
-
-static
-int64_t CC ContigSort ( const BSTNode * item, const BSTNode * n )
-{
-    const Contig * contigl = ( const Contig * ) item;
-    const Contig * contigr = ( const Contig * ) n;
-
-    assert ( contigl && contigr);
-
-    return contigl -> length < contigr -> length;
-}
+/* contigs shorter than that are counted in a histogram,
+   the longer ones ( at most assemblyLength / CONTIG_SHORT of them ) are listed */
+#define CONTIG_SHORT 65536
 
 typedef struct {
     uint64_t assemblyLength;
@@ -69,7 +53,10 @@ typedef struct {
     uint64_t count;
     uint64_t length;
 
-    BSTree bt;
+    uint64_t * shortCount; /* [ CONTIG_SHORT ]: number of contigs per length */
+    uint32_t * longLength; /* lengths >= CONTIG_SHORT, in the order added */
+    size_t longCount;
+    size_t longMax;
 
     uint64_t l50;
     uint64_t n50;
@@ -77,21 +64,14 @@ typedef struct {
     uint64_t n90;
 } Contigs;
 
-static void CC ContigNext ( BSTNode * n, void * data ) {
-    const Contig * contig = ( const Contig * ) n;
-    Contigs * nl = ( Contigs * ) data;
-
-    assert ( contig && nl );
+static void ContigNext ( Contigs * nl, uint64_t length ) {
+    assert ( nl );
 
     ++ nl -> count;
-    nl -> length += contig -> length;
-
-    DBGMSG ( DBG_APP, DBG_COND_1, ( "Contig %lu/%lu: %lu. Total: %lu/%lu\n",
-        nl -> count, nl -> contigLength, contig -> length,
-        nl -> length, nl -> assemblyLength ) );
+    nl -> length += length;
 
     if ( nl -> l50 == 0 && nl -> length * 2 >= nl -> assemblyLength ) {
-        nl -> n50 = contig -> length;
+        nl -> n50 = length;
         nl -> l50 = nl -> count;
         DBGMSG ( DBG_APP, DBG_COND_1, ( "L50: %lu, N50: %lu (%lu>=%lu/2)\n",
             nl -> l50, nl -> n50, nl -> length, nl -> assemblyLength ) );
@@ -100,13 +80,34 @@ static void CC ContigNext ( BSTNode * n, void * data ) {
     if ( nl -> l90 == 0 &&
         .9 * nl -> assemblyLength <= nl -> length )
     {
-        nl -> n90 = contig -> length;
+        nl -> n90 = length;
         nl -> l90 = nl -> count;
         DBGMSG ( DBG_APP, DBG_COND_1, ( "L90: %lu, N90: %lu (%lu*.9>=%lu)\n",
             nl -> l90, nl -> n90, nl -> length, nl -> assemblyLength ) );
     }
 }
 
+/* n contigs of the same length, visited from the longest to the shortest:
+   they are stepped through one by one just when N50 or N90 is among them */
+static void ContigsNext ( Contigs * self, uint64_t length, uint64_t n ) {
+    uint64_t end = 0;
+    uint64_t i = 0;
+
+    assert ( self );
+
+    end = self -> length + length * n;
+    if ( ( self -> l50 != 0 || end * 2 < self -> assemblyLength ) &&
+         ( self -> l90 != 0 || .9 * self -> assemblyLength > end ) )
+    {
+        self -> count += n;
+        self -> length = end;
+        return;
+    }
+
+    for ( i = 0; i < n; ++ i )
+        ContigNext ( self, length );
+}
+
 static void ContigsInit ( Contigs * self ) {
     assert ( self );
 
@@ -114,30 +115,85 @@ static void ContigsInit ( Contigs * self ) {
 }
 
 static rc_t ContigsAdd ( Contigs * self, uint32_t length ) {
-    Contig * contig = ( Contig * ) calloc ( 1, sizeof * contig );
-
     assert ( self );
 
-    if ( contig == NULL )
-        return RC ( rcExe, rcStorage, rcAllocating, rcMemory, rcExhausted );
+    if ( length < CONTIG_SHORT ) {
+        if ( self -> shortCount == NULL ) {
+            self -> shortCount = ( uint64_t * )
+                calloc ( CONTIG_SHORT, sizeof * self -> shortCount );
+            if ( self -> shortCount == NULL )
+                return RC ( rcExe,
+                    rcStorage, rcAllocating, rcMemory, rcExhausted );
+        }
+        ++ self -> shortCount [ length ];
+    }
+    else {
+        if ( self -> longCount == self -> longMax ) {
+            size_t longMax = self -> longMax == 0 ? 1024 : self -> longMax * 2;
+            uint32_t * tmp = ( uint32_t * ) realloc ( self -> longLength,
+                longMax * sizeof * self -> longLength );
+            if ( tmp == NULL )
+                return RC ( rcExe,
+                    rcStorage, rcAllocating, rcMemory, rcExhausted );
+            self -> longLength = tmp;
+            self -> longMax = longMax;
+        }
+        self -> longLength [ self -> longCount ++ ] = length;
+    }
 
     self -> assemblyLength += length;
     ++ self -> contigLength;
 
-    contig -> length = length;
-    return BSTreeInsert ( & self -> bt, ( BSTNode * ) contig, ContigSort );
+    return 0;
+}
+
+static int64_t CC ContigLongerFirst
+    ( const void * item, const void * n, void * data )
+{
+    uint32_t l = * ( const uint32_t * ) item;
+    uint32_t r = * ( const uint32_t * ) n;
+    return l < r ? 1 : ( l > r ? -1 : 0 );
 }
 
+/* the contigs are visited from the longest to the shortest,
+   the same length as one group */
 static void ContigsCalculateStatistics ( Contigs * self ) {
+    size_t i = 0;
+
     assert ( self );
 
-    BSTreeForEach ( & self -> bt, false, ContigNext, self );
+    if ( self -> longCount > 0 ) {
+        ksort ( self -> longLength, self -> longCount,
+            sizeof * self -> longLength, ContigLongerFirst, NULL );
+        while ( i < self -> longCount ) {
+            size_t j = i + 1;
+            while ( j < self -> longCount &&
+                self -> longLength [ j ] == self -> longLength [ i ] )
+            {
+                ++ j;
+            }
+            ContigsNext ( self, self -> longLength [ i ], j - i );
+            i = j;
+        }
+    }
+
+    if ( self -> shortCount != NULL ) {
+        for ( i = CONTIG_SHORT; i > 0; -- i ) {
+            if ( self -> shortCount [ i - 1 ] > 0 )
+                ContigsNext ( self, i - 1, self -> shortCount [ i - 1 ] );
+        }
+    }
 }
 
 static void ContigsFini ( Contigs * self ) {
     assert ( self );
 
-    BSTreeWhack ( & self -> bt, ContigWhack, NULL );
+    free ( self -> shortCount );
+    self -> shortCount = NULL;
+
+    free ( self -> longLength );
+    self -> longLength = NULL;
+    self -> longCount = self -> longMax = 0;
 }
 
 /* Calculate N50, L50 statistics:
@@ -44,6 +44,9 @@
 #include <kfs/directory.h> /* KDirectory */
 #include <kfs/file.h> /* KFile */
 
+#include <kproc/lock.h> /* KLock */
+#include <kproc/thread.h> /* KThread */
+
 #include <klib/checksum.h>
 #include <klib/container.h>
 #include <klib/debug.h> /* DBGMSG */
@@ -1771,6 +1774,208 @@ rc_t CC fileSizeVisitor(const KDirectory* dir,
     return rc;
 }
 
+/* get_size() lists the top directories of the object on the current thread
+   until there are SIZE_DIRS_PER_WORKER of them for every worker,
+   the workers then visit one of the remaining directories at a time;
+   the sizes are added and the first error is taken in the order of the list,
+   so the result does not depend on the order in which the workers finish */
+#define SIZE_MAX_WORKERS 8
+#define SIZE_DIRS_PER_WORKER 4
+
+typedef struct SizeDir {
+    char *path; /* relative to the top directory */
+    uint64_t size;
+    rc_t rc;
+} SizeDir;
+
+typedef struct SizeDirs {
+    const KDirectory *dir;
+    SizeDir *d;
+    uint32_t count;
+    uint32_t allocated;
+    uint32_t next; /* the directories before it are visited */
+    KLock *lock;
+} SizeDirs;
+
+static rc_t SizeDirsAdd(SizeDirs *self, const char *path)
+{
+    assert(self && path);
+
+    if (self->count == self->allocated) {
+        uint32_t allocated = self->allocated == 0 ? 64 : self->allocated * 2;
+        SizeDir *d = realloc(self->d, allocated * sizeof *d);
+        if (d == NULL) {
+            return RC(rcExe, rcStorage, rcAllocating, rcMemory, rcExhausted);
+        }
+        self->d = d;
+        self->allocated = allocated;
+    }
+
+    self->d[self->count].path = strdup(path);
+    if (self->d[self->count].path == NULL) {
+        return RC(rcExe, rcStorage, rcAllocating, rcMemory, rcExhausted);
+    }
+    self->d[self->count].size = 0;
+    self->d[self->count].rc = 0;
+    ++self->count;
+    return 0;
+}
+
+static void SizeDirsWhack(SizeDirs *self)
+{
+    uint32_t i = 0;
+    assert(self);
+    for (i = 0; i < self->count; ++i) {
+        free(self->d[i].path);
+    }
+    free(self->d);
+    memset(self, 0, sizeof *self);
+}
+
+/* lists the next directory: adds the sizes of its files, appends its directories */
+static rc_t SizeDirsSplit(SizeDirs *self, const char *path, SraSizeStats *sizes)
+{
+    KNamelist *names = NULL;
+    uint32_t count = 0;
+    uint32_t i = 0;
+    rc_t rc = 0;
+
+    rc = KDirectoryList(self->dir, &names, NULL, NULL, "%s", path);
+    DISP_RC2(rc, path, "while calling KDirectoryList");
+    if (rc == 0) {
+        rc = KNamelistCount(names, &count);
+        DISP_RC(rc, "while calling KNamelistCount");
+    }
+    for (i = 0; i < count && rc == 0; ++i) {
+        const char *name = NULL;
+        char child[4096] = "";
+        uint32_t type = 0;
+        rc = KNamelistGet(names, i, &name);
+        DISP_RC(rc, "while calling KNamelistGet");
+        if (rc == 0) {
+            rc = string_printf(child, sizeof child, NULL, "%s/%s", path, name);
+            DISP_RC2(rc, name, "while calling string_printf");
+        }
+        if (rc != 0) {
+            break;
+        }
+        type = KDirectoryPathType(self->dir, "%s", child);
+        if (type & kptAlias) {
+            continue;
+        }
+        switch (type) {
+            case kptFile: {
+                uint64_t size = 0;
+                rc = KDirectoryFileSize(self->dir, &size, "%s", child);
+                DISP_RC2(rc, child, "while calling KDirectoryFileSize");
+                if (rc == 0) {
+                    sizes->size += size;
+                    DBGMSG(DBG_APP, DBG_COND_1,
+                        ("File '%s', size %lu\n", child, size));
+                }
+                break;
+            }
+            case kptDir:
+                DBGMSG(DBG_APP, DBG_COND_1, ("Dir '%s'\n", child));
+                rc = SizeDirsAdd(self, child);
+                DISP_RC2(rc, child, "while calling SizeDirsAdd");
+                break;
+            default:
+                rc = RC(rcExe, rcDirectory, rcVisiting, rcType, rcUnexpected);
+                DISP_RC2(rc, child, "during KDirectoryList");
+                break;
+        }
+    }
+    RELEASE(KNamelist, names);
+    return rc;
+}
+
+static rc_t CC SizeDirsRun(const KThread *self, void *data)
+{
+    SizeDirs *dirs = (SizeDirs*) data;
+    assert(dirs);
+    while (true) {
+        SraSizeStats sizes;
+        SizeDir *d = NULL;
+
+        KLockAcquire(dirs->lock);
+        if (dirs->next < dirs->count) {
+            d = &dirs->d[dirs->next++];
+        }
+        KLockUnlock(dirs->lock);
+        if (d == NULL) {
+            break;
+        }
+
+        memset(&sizes, 0, sizeof sizes);
+        d->rc = KDirectoryVisit(dirs->dir, false, fileSizeVisitor, &sizes,
+            "%s", d->path);
+        DISP_RC2(d->rc, d->path, "while calling KDirectoryVisit");
+        d->size = sizes.size;
+        if (d->rc == 0) {
+            d->rc = Quitting();
+        }
+        if (d->rc != 0) {
+            break;
+        }
+    }
+    return 0;
+}
+
+static rc_t SizeDirsCollect(const KDirectory *dir, SraSizeStats *sizes)
+{
+    SizeDirs dirs;
+    uint32_t i = 0;
+    uint32_t started = 0;
+    KThread *threads[SIZE_MAX_WORKERS];
+    rc_t rc = 0;
+
+    memset(&dirs, 0, sizeof dirs);
+    dirs.dir = dir;
+
+    rc = SizeDirsSplit(&dirs, ".", sizes);
+    while (rc == 0 && dirs.next < dirs.count
+        && dirs.count - dirs.next < SIZE_MAX_WORKERS * SIZE_DIRS_PER_WORKER)
+    {
+        const char *path = dirs.d[dirs.next++].path;
+        rc = SizeDirsSplit(&dirs, path, sizes);
+    }
+
+    if (rc == 0) {
+        rc = KLockMake(&dirs.lock);
+        DISP_RC(rc, "while calling KLockMake");
+    }
+    if (rc == 0) {
+        uint32_t workers = dirs.count - dirs.next;
+        if (workers > SIZE_MAX_WORKERS) {
+            workers = SIZE_MAX_WORKERS;
+        }
+        for (i = 0; i < workers && workers > 1; ++i) {
+            if (KThreadMake(&threads[i], SizeDirsRun, &dirs) != 0) {
+                break;
+            }
+            ++started;
+        }
+        /* without workers, and with the directories the workers left */
+        SizeDirsRun(NULL, &dirs);
+        for (i = 0; i < started; ++i) {
+            rc_t status = 0;
+            KThreadWait(threads[i], &status);
+            KThreadRelease(threads[i]);
+        }
+        for (i = 0; i < dirs.count; ++i) {
+            sizes->size += dirs.d[i].size;
+            if (rc == 0) {
+                rc = dirs.d[i].rc;
+            }
+        }
+    }
+
+    RELEASE(KLock, dirs.lock);
+    SizeDirsWhack(&dirs);
+    return rc;
+}
+
 static rc_t GetTableModDate(const VDBManager *mgr,
     KTime_t *mtime, const char *spec)
 {
@@ -1823,6 +2028,61 @@ static rc_t GetTableModDate(const VDBManager *mgr,
     return rc;
 }
 
+typedef struct ArcMd5 {
+    const VTable *vtbl;
+    ArcInfo *arc_info;
+    uint32_t i; /* 0: sra, 1: lite.sra */
+    rc_t rc;
+} ArcMd5;
+
+/* makes one of the archives and calculates its size and md5 */
+static rc_t CC ArcMd5Run(const KThread *self, void *data)
+{
+    ArcMd5 *job = (ArcMd5*) data;
+    ArcInfo *arc_info = NULL;
+    uint32_t i = 0;
+    const KFile* kfile;
+    rc_t rc = 0;
+
+    assert(job);
+    arc_info = job->arc_info;
+    i = job->i;
+
+    arc_info->i[i].tag = i == 0 ? "sra" : "lite.sra";
+    if ((rc = VTableMakeSingleFileArchive(job->vtbl, &kfile, i == 1)) == 0) {
+        MD5State md5;
+        uint64_t pos = 0;
+        uint8_t buffer[256 * 1024];
+        size_t num_read = 0, x;
+
+        MD5StateInit(&md5);
+        do {
+            if( (rc = KFileRead(kfile, pos, buffer, sizeof(buffer), &num_read)) == 0 ) {
+                MD5StateAppend(&md5, buffer, num_read);
+                pos += num_read;
+            }
+            rc = Quitting();
+            if (rc != 0) {
+                LOGMSG(klogWarn, "Interrupted");
+            }
+        } while(rc == 0 && num_read != 0);
+        if (rc == 0 &&
+            (rc = KFileSize(kfile, &arc_info->i[i].size)) == 0)
+        {
+            uint8_t digest[16];
+            MD5StateFinish(&md5, digest);
+            for(pos = 0, x = 0; rc == 0 && pos < sizeof(digest); pos++) {
+                rc = string_printf(&arc_info->i[i].md5[x], sizeof(arc_info->i[i].md5) - x, &num_read, "%02x", digest[pos]);
+                x += num_read;
+            }
+        }
+        KFileRelease(kfile);
+    }
+    job->rc = rc;
+    return rc;
+}
+
+/* both archives are read at the same time, the lite one on a thread of its own */
 static rc_t get_arc_info(const char *path, ArcInfo *arc_info,
     const VDBManager *vmgr, const VTable *vtbl)
 {
@@ -1830,40 +2090,29 @@ static rc_t get_arc_info(const char *path, ArcInfo *arc_info,
     memset(arc_info, 0, sizeof(*arc_info));
 
     if ((rc = GetTableModDate(vmgr, &arc_info->timestamp, path)) == 0 ) {
+        ArcMd5 jobs[2];
+        KThread *lite = NULL;
         uint32_t i;
-        for(i = 0; i < sizeof(arc_info->i) / sizeof(arc_info->i[0]); i++) {
-            const KFile* kfile;
-            arc_info->i[i].tag = i == 0 ? "sra" : "lite.sra";
-            if ((rc = VTableMakeSingleFileArchive(vtbl, &kfile, i == 1)) == 0) {
-                MD5State md5;
-                uint64_t pos = 0;
-                uint8_t buffer[256 * 1024];
-                size_t num_read = 0, x;
-
-                MD5StateInit(&md5);
-                do {
-                    if( (rc = KFileRead(kfile, pos, buffer, sizeof(buffer), &num_read)) == 0 ) {
-                        MD5StateAppend(&md5, buffer, num_read);
-                        pos += num_read;
-                    }
-                    rc = Quitting();
-                    if (rc != 0) {
-                        LOGMSG(klogWarn, "Interrupted");
-                    }
-                } while(rc == 0 && num_read != 0);
-                if (rc == 0 &&
-                    (rc = KFileSize(kfile, &arc_info->i[i].size)) == 0)
-                {
-                    uint8_t digest[16];
-                    MD5StateFinish(&md5, digest);
-                    for(pos = 0, x = 0; rc == 0 && pos < sizeof(digest); pos++) {
-                        rc = string_printf(&arc_info->i[i].md5[x], sizeof(arc_info->i[i].md5) - x, &num_read, "%02x", digest[pos]);
-                        x += num_read;
-                    }
-                }
-                KFileRelease(kfile);
-            }
+        for(i = 0; i < sizeof(jobs) / sizeof(jobs[0]); i++) {
+            jobs[i].vtbl = vtbl;
+            jobs[i].arc_info = arc_info;
+            jobs[i].i = i;
+            jobs[i].rc = 0;
+        }
+        if (KThreadMake(&lite, ArcMd5Run, &jobs[1]) != 0) {
+            lite = NULL;
+        }
+        ArcMd5Run(NULL, &jobs[0]);
+        if (lite != NULL) {
+            rc_t status = 0;
+            KThreadWait(lite, &status);
+            KThreadRelease(lite);
         }
+        else {
+            ArcMd5Run(NULL, &jobs[1]);
+        }
+        /* as it was when the archives were made one after the other */
+        rc = jobs[1].rc;
     }
     return rc;
 }
@@ -1910,8 +2159,8 @@ static rc_t get_size( SraSizeStats* sizes, const VTable *vtbl) {
     memset(sizes, 0, sizeof *sizes);
 
     if (rc == 0) {
-        rc = KDirectoryVisit(dir, false, fileSizeVisitor, sizes, NULL);
-        DISP_RC(rc, "while calling KDirectoryVisit");
+        rc = SizeDirsCollect(dir, sizes);
+        DISP_RC(rc, "while collecting the sizes of the files");
     }
 
     RELEASE(KDirectory, dir);
@@ -3030,6 +3279,191 @@ int64_t CC srastats_sort ( const BSTNode *item, const BSTNode *n )
     return srastats_cmp(ss->spot_group,n);
 }
 
+/* SraStats counters of one spot-group while the table is scanned */
+typedef struct SpotGroupCounts {
+    uint64_t spot_count;
+    uint64_t spot_count_mates;
+    uint64_t bio_len;
+    uint64_t bio_len_mates;
+    uint64_t total_len;
+    uint64_t bad_spot_count;
+    uint64_t bad_bio_len;
+    uint64_t filtered_spot_count;
+    uint64_t filtered_bio_len;
+    uint64_t total_cmp_len;
+} SpotGroupCounts;
+
+/* spot-group names interned into dense ids 0..count-1:
+   the counters of the scan are kept in an array indexed by id
+   and moved into the SraStats-tree once, when the scan is done */
+typedef struct SpotGroups {
+    char ** name;             /* [ id ] */
+    size_t * name_len;        /* [ id ] */
+    SpotGroupCounts * counts; /* [ id ] */
+    uint32_t count;
+    uint32_t capacity;
+
+    uint32_t * slot;          /* open addressing: id + 1, 0 is empty */
+    uint32_t slot_mask;
+
+    uint32_t last;            /* id of the previous spot */
+} SpotGroups;
+
+static uint32_t SpotGroupHash(const char* name, size_t len) {
+    /* FNV-1a */
+    uint32_t h = 2166136261u;
+    size_t i = 0;
+    for (i = 0; i < len; ++i) {
+        h ^= (uint8_t)name[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void SpotGroupsWhack(SpotGroups* self) {
+    uint32_t i = 0;
+    assert(self);
+    for (i = 0; i < self->count; ++i) {
+        free(self->name[i]);
+    }
+    free(self->name);
+    free(self->name_len);
+    free(self->counts);
+    free(self->slot);
+    memset(self, 0, sizeof *self);
+}
+
+static rc_t SpotGroupsRehash(SpotGroups* self, uint32_t nslots) {
+    uint32_t i = 0;
+    uint32_t* slot = calloc(nslots, sizeof *slot);
+    if (slot == NULL) {
+        return RC(rcExe, rcStorage, rcAllocating, rcMemory, rcExhausted);
+    }
+    for (i = 0; i < self->count; ++i) {
+        uint32_t s = SpotGroupHash(self->name[i], self->name_len[i])
+            & (nslots - 1);
+        while (slot[s] != 0) {
+            s = (s + 1) & (nslots - 1);
+        }
+        slot[s] = i + 1;
+    }
+    free(self->slot);
+    self->slot = slot;
+    self->slot_mask = nslots - 1;
+    return 0;
+}
+
+/* returns the counters of the spot-group, adds it when seen for the first time;
+   a run of spots of the same group does not get past the first comparison */
+static rc_t SpotGroupsGet(SpotGroups* self,
+    const char* name, SpotGroupCounts** counts)
+{
+    rc_t rc = 0;
+    size_t len = 0;
+    uint32_t s = 0;
+
+    assert(self && name && counts);
+
+    len = strlen(name);
+    if (self->count > 0 && self->name_len[self->last] == len
+        && memcmp(self->name[self->last], name, len) == 0)
+    {
+        *counts = self->counts + self->last;
+        return 0;
+    }
+
+    if (self->slot == NULL) {
+        rc = SpotGroupsRehash(self, 64);
+        if (rc != 0) {
+            return rc;
+        }
+    }
+
+    for (s = SpotGroupHash(name, len) & self->slot_mask;
+        self->slot[s] != 0; s = (s + 1) & self->slot_mask)
+    {
+        uint32_t id = self->slot[s] - 1;
+        if (self->name_len[id] == len
+            && memcmp(self->name[id], name, len) == 0)
+        {
+            self->last = id;
+            *counts = self->counts + id;
+            return 0;
+        }
+    }
+
+    if (self->count == self->capacity) {
+        uint32_t capacity = self->capacity == 0 ? 64 : self->capacity * 2;
+        char** n = realloc(self->name, capacity * sizeof *n);
+        size_t* l = NULL;
+        SpotGroupCounts* c = NULL;
+        if (n != NULL) {
+            self->name = n;
+            l = realloc(self->name_len, capacity * sizeof *l);
+        }
+        if (l != NULL) {
+            self->name_len = l;
+            c = realloc(self->counts, capacity * sizeof *c);
+        }
+        if (c == NULL) {
+            return RC(rcExe, rcStorage, rcAllocating, rcMemory, rcExhausted);
+        }
+        self->counts = c;
+        self->capacity = capacity;
+    }
+
+    self->name[self->count] = malloc(len + 1);
+    if (self->name[self->count] == NULL) {
+        return RC(rcExe, rcStorage, rcAllocating, rcMemory, rcExhausted);
+    }
+    memmove(self->name[self->count], name, len + 1);
+    self->name_len[self->count] = len;
+    memset(self->counts + self->count, 0, sizeof *self->counts);
+    self->slot[s] = self->count + 1;
+    self->last = self->count++;
+
+    /* keep the table at most half full */
+    if (self->count * 2 > self->slot_mask + 1) {
+        rc = SpotGroupsRehash(self, (self->slot_mask + 1) * 2);
+    }
+
+    *counts = self->counts + self->last;
+    return rc;
+}
+
+/* adds the counters of every spot-group to its node of the SraStats-tree */
+static rc_t SpotGroupsToTree(const SpotGroups* self, BSTree* tr) {
+    uint32_t i = 0;
+
+    assert(self && tr);
+
+    for (i = 0; i < self->count; ++i) {
+        const SpotGroupCounts* c = self->counts + i;
+        SraStats* ss = (SraStats*)BSTreeFind(tr, self->name[i], srastats_cmp);
+        if (ss == NULL) {
+            ss = calloc(1, sizeof(*ss));
+            if (ss == NULL) {
+                return RC(rcExe, rcStorage, rcAllocating,
+                    rcMemory, rcExhausted);
+            }
+            strcpy(ss->spot_group, self->name[i]);
+            BSTreeInsert(tr, (BSTNode*)ss, srastats_sort);
+        }
+        ss->spot_count          += c->spot_count;
+        ss->spot_count_mates    += c->spot_count_mates;
+        ss->bio_len             += c->bio_len;
+        ss->bio_len_mates       += c->bio_len_mates;
+        ss->total_len           += c->total_len;
+        ss->bad_spot_count      += c->bad_spot_count;
+        ss->bad_bio_len         += c->bad_bio_len;
+        ss->filtered_spot_count += c->filtered_spot_count;
+        ss->filtered_bio_len    += c->filtered_bio_len;
+        ss->total_cmp_len       += c->total_cmp_len;
+    }
+
+    return 0;
+}
+
 static rc_t sra_stat(srastat_parms* pb, BSTree* tr,
     SraStatsTotal* total, const Ctx * ctx, const VTable *vtbl)
 {
@@ -3148,6 +3582,7 @@ static rc_t sra_stat(srastat_parms* pb, BSTree* tr,
                 }
                 if (rc == 0) {
                     const KLoadProgressbar *pr = NULL;
+                    SpotGroups groups;
                     bool bad_read_filter = false;
                     bool fixedNReads = true;
                     bool fixedReadLength = true;
@@ -3178,6 +3613,7 @@ static rc_t sra_stat(srastat_parms* pb, BSTree* tr,
                         string_copy_measure ( dSPOT_GROUP, MAX_SPOT_GROUP,
                                               "NULL" );
                     }
+                    memset(&groups, 0, sizeof groups);
 
                     if (pb->start > 0) {
                         start = pb->start;
@@ -3200,7 +3636,7 @@ static rc_t sra_stat(srastat_parms* pb, BSTree* tr,
                     }
 
                     for (spotid = start; spotid < stop && rc == 0; ++spotid) {
-                        SraStats* ss;
+                        SpotGroupCounts* ss;
 
                         const void* base;
                         bitsz_t boff, row_bits;
@@ -3557,20 +3993,9 @@ static rc_t sra_stat(srastat_parms* pb, BSTree* tr,
                                     }
                                 }
 
-                                ss = (SraStats*)BSTreeFind
-                                    (tr, dSPOT_GROUP, srastats_cmp);
-                                if (ss == NULL) {
-                                    ss = calloc(1, sizeof(*ss));
-                                    if (ss == NULL) {
-                                        rc = RC(rcExe, rcStorage, rcAllocating,
-                                            rcMemory, rcExhausted);
-                                        break;
-                                    }
-                                    else {
-                                        strcpy(ss->spot_group, dSPOT_GROUP);
-                                        BSTreeInsert
-                                            (tr, (BSTNode*)ss, srastats_sort);
-                                    }
+                                rc = SpotGroupsGet(&groups, dSPOT_GROUP, &ss);
+                                if (rc != 0) {
+                                    break;
                                 }
                                 ++ss->spot_count;
                                 ++total->spot_count;
@@ -3674,6 +4099,14 @@ static rc_t sra_stat(srastat_parms* pb, BSTree* tr,
                     } /* for (spotid = start; spotid <= stop && rc == 0;
                               ++spotid) */
 
+                    {
+                        rc_t rc2 = SpotGroupsToTree(&groups, tr);
+                        if (rc == 0) {
+                            rc = rc2;
+                        }
+                        SpotGroupsWhack(&groups);
+                    }
+
                     for (spotid = total->bases_count.startALIGNMENT;
                          !pb->quick &&
                            spotid < total->bases_count.stopALIGNMENT && rc == 0;
@@ -715,23 +715,16 @@ bool vdcd_get_first_none_static_column_idx( col_defs* defs, const VCursor * cur,
 }
 
 /* ******************************************************************************************************** */
-typedef struct spread
-{
-	uint64_t count;
-	double sum, sum_sq;
-	int64_t min, max;
-} spread;
-
 
 /*
-	s ... spread * s
+	S ... vdcd_spread * S
 	b ... const void * base
 	l ... uint32_t row_len
 	t ... type ( int64_t, uint64_t ... )
 */
 #define COUNTVALUES( S, b, l, t )							\
 	{														\
-		const t * values = base;							\
+		const t * values = b;								\
 		uint32_t i;											\
 		for ( i = 0; i < l; ++i )							\
 		{													\
@@ -748,6 +741,40 @@ typedef struct spread
 		}													\
 	}														\
 
+void vdcd_spread_init( vdcd_spread * s )
+{
+	s->max = s->sum = s->sum_sq = s->count = 0;
+	s->min = INT64_MAX;
+}
+
+void vdcd_spread_add( vdcd_spread * s, uint32_t domain, uint32_t elem_bits,
+					  const void * base, uint32_t row_len )
+{
+	if ( domain == vtdUint )
+	{
+		/* unsigned int's */
+		switch( elem_bits )
+		{
+			case 64 : COUNTVALUES( s, base, row_len, uint64_t ) break;
+			case 32 : COUNTVALUES( s, base, row_len, uint32_t ) break;
+			case 16 : COUNTVALUES( s, base, row_len, uint16_t ) break;
+			case 8  : COUNTVALUES( s, base, row_len, uint8_t )  break;
+		}
+	}
+	else
+	{
+		/* signed int's */
+		switch( elem_bits )
+		{
+			case 64 : COUNTVALUES( s, base, row_len, int64_t ) break;
+			case 32 : COUNTVALUES( s, base, row_len, int32_t ) break;
+			case 16 : COUNTVALUES( s, base, row_len, int16_t ) break;
+			case 8  : COUNTVALUES( s, base, row_len, int8_t )  break;
+		}
+	}
+}
+#undef COUNTVALUES
+
 static uint64_t round_to_uint64_t( double value )
 {
 	double floor_value = floor( value );
@@ -755,6 +782,32 @@ static uint64_t round_to_uint64_t( double value )
 	return ( uint64_t )x;
 }
 
+rc_t vdcd_spread_print( const char * name, const vdcd_spread * s )
+{
+	rc_t rc = 0;
+	if ( s->count > 0 )
+	{
+		rc = KOutMsg( "\n[%s]\n", name );
+		if ( rc == 0 )
+			rc = KOutMsg( "min    = %,ld\n", s->min );
+		if ( rc == 0 )
+			rc = KOutMsg( "max    = %,ld\n", s->max );
+		if ( rc == 0 )
+			rc = KOutMsg( "count  = %,ld\n", s->count );
+		if ( rc == 0 )
+		{
+			double median = ( s->sum / s->count );
+			rc = KOutMsg( "median = %,ld\n", round_to_uint64_t( median ) );
+			if ( rc == 0 )
+			{
+				double stdev = sqrt( ( ( s->sum_sq - ( s->sum * s->sum ) / s->count ) ) / ( s->count - 1 ) );
+				rc = KOutMsg( "stdev  = %,ld\n", round_to_uint64_t( stdev ) );	
+			}
+		}
+	}
+	return rc;
+}
+
 static rc_t vdcd_collect_spread_col( const struct num_gen * row_set, col_def * cd, const VCursor * cursor )
 {
 	const struct num_gen_iter * iter;
@@ -764,11 +817,9 @@ static rc_t vdcd_collect_spread_col( const struct num_gen * row_set, col_def * c
 		const void * base;
 		uint32_t row_len, elem_bits;
 		int64_t row_id;
-		spread s;
-		spread * sp = &s;
+		vdcd_spread s;
 		
-		s.max = s.sum = s.sum_sq = s.count = 0;
-		s.min = INT64_MAX;
+		vdcd_spread_init( &s );
 		
 		while ( ( rc == 0 ) && num_gen_iterator_next( iter, &row_id, &rc ) )
 		{
@@ -776,58 +827,16 @@ static rc_t vdcd_collect_spread_col( const struct num_gen * row_set, col_def * c
 			if ( rc != 0 )	break;
 			rc = VCursorCellDataDirect( cursor, row_id, cd->idx, &elem_bits, &base, NULL, &row_len );
 			if ( rc == 0 )
-			{
-				if ( cd->type_desc.domain == vtdUint )
-				{
-					/* unsigned int's */
-					switch( elem_bits )
-					{
-						case 64 : COUNTVALUES( sp, base, row_len, uint64_t ) break;
-						case 32 : COUNTVALUES( sp, base, row_len, uint32_t ) break;
-						case 16 : COUNTVALUES( sp, base, row_len, uint16_t ) break;
-						case 8  : COUNTVALUES( sp, base, row_len, uint8_t )  break;
-					}
-				}
-				else
-				{
-					/* signed int's */
-					switch( elem_bits )
-					{
-						case 64 : COUNTVALUES( sp, base, row_len, int64_t ) break;
-						case 32 : COUNTVALUES( sp, base, row_len, int32_t ) break;
-						case 16 : COUNTVALUES( sp, base, row_len, int16_t ) break;
-						case 8  : COUNTVALUES( sp, base, row_len, int8_t )  break;
-					}
-				}
-			}
+				vdcd_spread_add( &s, cd->type_desc.domain, elem_bits, base, row_len );
 		}
 
 		if ( s.count > 0 )
-		{
-			rc = KOutMsg( "\n[%s]\n", cd->name );
-			if ( rc == 0 )
-				rc = KOutMsg( "min    = %,ld\n", s.min );
-			if ( rc == 0 )
-				rc = KOutMsg( "max    = %,ld\n", s.max );
-			if ( rc == 0 )
-				rc = KOutMsg( "count  = %,ld\n", s.count );
-			if ( rc == 0 )
-			{
-				double median = ( s.sum / s.count );
-				rc = KOutMsg( "median = %,ld\n", round_to_uint64_t( median ) );
-				if ( rc == 0 )
-				{
-					double stdev = sqrt( ( ( s.sum_sq - ( s.sum * s.sum ) / s.count ) ) / ( s.count - 1 ) );
-					rc = KOutMsg( "stdev  = %,ld\n", round_to_uint64_t( stdev ) );	
-				}
-			}
-		}
+			rc = vdcd_spread_print( cd->name, &s );
 		
 		num_gen_iterator_destroy( iter );
 	}
 	return rc;
 }
-#undef COUNTVALUES
 
 rc_t vdcd_collect_spread( const struct num_gen * row_set, col_defs * cols, const VCursor * cursor )
 {
@@ -103,6 +103,22 @@ bool vdcd_get_first_none_static_column_idx( col_defs* defs, const VCursor * cur,
 
 uint32_t vdcd_extract_static_columns( col_defs* defs, const VTable *my_table, const size_t str_limit );
 
+/********************************************************************
+spread of the none-zero values of an integer-column, shared by
+vdcd_collect_spread() and the column-statistics in vdb-dump-colstats.c
+********************************************************************/
+typedef struct vdcd_spread
+{
+    uint64_t count;
+    double sum, sum_sq;
+    int64_t min, max;
+} vdcd_spread;
+
+void vdcd_spread_init( vdcd_spread * s );
+void vdcd_spread_add( vdcd_spread * s, uint32_t domain, uint32_t elem_bits,
+                      const void * base, uint32_t row_len );
+rc_t vdcd_spread_print( const char * name, const vdcd_spread * s );
+
 rc_t vdcd_collect_spread( const struct num_gen * row_set, col_defs * cols, const VCursor * cursor );
 
 #ifdef __cplusplus
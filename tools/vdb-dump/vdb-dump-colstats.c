@@ -0,0 +1,935 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "vdb-dump-colstats.h"
+#include "vdb-dump-helper.h"
+
+#include <vdb/manager.h>
+#include <vdb/cursor.h>
+#include <kdb/table.h>
+#include <kdb/column.h>
+
+#include <kfs/directory.h>
+#include <kfs/file.h>
+
+#include <kproc/lock.h>
+#include <kproc/thread.h>
+
+#include <klib/rc.h>
+#include <klib/log.h>
+#include <klib/out.h>
+#include <klib/text.h>
+#include <klib/printf.h>
+
+#include <os-native.h>
+#include <sysalloc.h>
+
+#include <strtol.h>
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+rc_t Quitting( void );
+
+#define VDCS_MAGIC "vdb-dump-stats"
+#define VDCS_MAX_WORKERS 8
+#define VDCS_LINE_SIZE 4096
+
+/* ******************************************************************************************************** */
+/* distinct cells are estimated by keeping the smallest hash-values ( k-minimum-values )                    */
+
+#define VDCS_KMV_SIZE 256
+
+typedef struct vdcs_kmv
+{
+    uint64_t h[ VDCS_KMV_SIZE ];  /* ascending */
+    uint32_t n;
+} vdcs_kmv;
+
+static uint64_t vdcs_hash( const void * data, size_t len )
+{
+    const uint8_t * p = data;
+    uint64_t h = 14695981039346656037ULL;
+    size_t i;
+    for ( i = 0; i < len; ++i )
+    {
+        h ^= p[ i ];
+        h *= 1099511628211ULL;
+    }
+    /* FNV alone leaves the high bits of short cells poorly mixed */
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static void vdcs_kmv_add( vdcs_kmv * k, uint64_t h )
+{
+    uint32_t lo = 0, hi = k->n;
+    if ( k->n == VDCS_KMV_SIZE && h >= k->h[ VDCS_KMV_SIZE - 1 ] )
+        return;
+    while ( lo < hi )
+    {
+        uint32_t mid = ( lo + hi ) / 2;
+        if ( k->h[ mid ] < h )
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if ( lo < k->n && k->h[ lo ] == h )
+        return;
+    if ( k->n < VDCS_KMV_SIZE )
+        k->n++;
+    memmove( &( k->h[ lo + 1 ] ), &( k->h[ lo ] ), ( k->n - 1 - lo ) * sizeof k->h[ 0 ] );
+    k->h[ lo ] = h;
+}
+
+static uint64_t vdcs_kmv_estimate( const vdcs_kmv * k )
+{
+    double fraction;
+    if ( k->n < VDCS_KMV_SIZE )
+        return k->n;
+    fraction = ( double )k->h[ VDCS_KMV_SIZE - 1 ] / 18446744073709551616.0;
+    return ( uint64_t )( ( VDCS_KMV_SIZE - 1 ) / fraction + 0.5 );
+}
+
+/* ******************************************************************************************************** */
+
+static void CC vdcs_destroy_col( void * item, void * data )
+{
+    vdcs_col * col = item;
+    if ( col != NULL )
+    {
+        free( col->name );
+        free( col );
+    }
+}
+
+static vdcs_col * vdcs_append_col( vdcs_stats * stats, const char * name, uint32_t domain )
+{
+    vdcs_col * col = calloc( 1, sizeof *col );
+    if ( col != NULL )
+    {
+        col->name = string_dup_measure( name, NULL );
+        col->domain = domain;
+        vdcd_spread_init( &col->spread );
+        if ( col->name == NULL || VectorAppend( &stats->cols, NULL, col ) != 0 )
+        {
+            vdcs_destroy_col( col, NULL );
+            col = NULL;
+        }
+    }
+    return col;
+}
+
+static vdcs_stats * vdcs_init( void )
+{
+    vdcs_stats * stats = calloc( 1, sizeof *stats );
+    if ( stats != NULL )
+        VectorInit( &stats->cols, 0, 16 );
+    return stats;
+}
+
+void vdcs_release( vdcs_stats * stats )
+{
+    if ( stats != NULL )
+    {
+        VectorWhack( &stats->cols, vdcs_destroy_col, NULL );
+        free( stats );
+    }
+}
+
+const vdcs_col * vdcs_find( const vdcs_stats * stats, const char * name )
+{
+    uint32_t i, n = VectorLength( &stats->cols );
+    for ( i = 0; i < n; ++i )
+    {
+        const vdcs_col * col = VectorGet( &stats->cols, i );
+        if ( col != NULL && strcmp( col->name, name ) == 0 )
+            return col;
+    }
+    return NULL;
+}
+
+static bool vdcs_is_int( uint32_t domain )
+{
+    return ( domain == vtdUint || domain == vtdInt );
+}
+
+/* ******************************************************************************************************** */
+/* the scan: one worker per column at a time, every worker with its own cursor                              */
+
+typedef struct vdcs_job
+{
+    const VTable * tab;
+    const KTable * ktab;
+    KLock * lock;           /* protects next and the opening of cursors and columns */
+    vdcs_stats * stats;
+    bool * failed;          /* per column */
+    size_t cur_cache_size;
+    uint32_t next;
+} vdcs_job;
+
+/*
+	C ... vdcs_col * C
+	b ... const void * base
+	l ... uint32_t row_len
+	t ... type of the elements
+	a ... type to compare in ( int64_t, uint64_t )
+*/
+#define VDCS_MINMAX( C, b, l, t, a )                                        \
+    {                                                                       \
+        const t * values = b;                                               \
+        uint32_t i;                                                         \
+        for ( i = 0; i < l; ++i )                                           \
+        {                                                                   \
+            a value = values[ i ];                                          \
+            if ( (C)->values == 0 || value < ( a )(C)->min ) (C)->min = value; \
+            if ( (C)->values == 0 || value > ( a )(C)->max ) (C)->max = value; \
+            (C)->values++;                                                  \
+        }                                                                   \
+    }
+
+static void vdcs_minmax_add( vdcs_col * col, uint32_t elem_bits, const void * base, uint32_t row_len )
+{
+    if ( col->domain == vtdUint )
+    {
+        switch( elem_bits )
+        {
+            case 64 : VDCS_MINMAX( col, base, row_len, uint64_t, uint64_t ) break;
+            case 32 : VDCS_MINMAX( col, base, row_len, uint32_t, uint64_t ) break;
+            case 16 : VDCS_MINMAX( col, base, row_len, uint16_t, uint64_t ) break;
+            case 8  : VDCS_MINMAX( col, base, row_len, uint8_t, uint64_t )  break;
+        }
+    }
+    else
+    {
+        switch( elem_bits )
+        {
+            case 64 : VDCS_MINMAX( col, base, row_len, int64_t, int64_t ) break;
+            case 32 : VDCS_MINMAX( col, base, row_len, int32_t, int64_t ) break;
+            case 16 : VDCS_MINMAX( col, base, row_len, int16_t, int64_t ) break;
+            case 8  : VDCS_MINMAX( col, base, row_len, int8_t, int64_t )  break;
+        }
+    }
+}
+#undef VDCS_MINMAX
+
+static rc_t vdcs_scan_cells( vdcs_job * job, vdcs_col * col )
+{
+    const VCursor * cur;
+    uint32_t idx;
+    rc_t rc;
+
+    KLockAcquire( job->lock );
+    rc = VTableCreateCachedCursorRead( job->tab, &cur, job->cur_cache_size );
+    if ( rc == 0 )
+    {
+        rc = VCursorAddColumn( cur, &idx, "%s", col->name );
+        if ( rc == 0 )
+            rc = VCursorOpen( cur );
+        if ( rc != 0 )
+            VCursorRelease( cur );
+    }
+    KLockUnlock( job->lock );
+
+    if ( rc == 0 )
+    {
+        rc = VCursorIdRange( cur, idx, &col->first, &col->count );
+        if ( rc == 0 )
+        {
+            vdcs_kmv kmv;
+            int64_t row_id, last = col->first + col->count;
+            bool is_int = vdcs_is_int( col->domain );
+
+            kmv.n = 0;
+            for ( row_id = col->first; rc == 0 && row_id < last; ++row_id )
+            {
+                const void * base;
+                uint32_t elem_bits, boff, row_len;
+                rc = Quitting();
+                if ( rc == 0 )
+                    rc = VCursorCellDataDirect( cur, row_id, idx, &elem_bits, &base, &boff, &row_len );
+                if ( rc == 0 )
+                {
+                    vdcs_kmv_add( &kmv, vdcs_hash( base, ( boff + ( uint64_t )elem_bits * row_len + 7 ) / 8 ) );
+                    if ( is_int )
+                    {
+                        vdcs_minmax_add( col, elem_bits, base, row_len );
+                        vdcd_spread_add( &col->spread, col->domain, elem_bits, base, row_len );
+                    }
+                }
+            }
+            col->distinct = vdcs_kmv_estimate( &kmv );
+        }
+        VCursorRelease( cur );
+    }
+    return rc;
+}
+
+static rc_t vdcs_count_blobs( vdcs_job * job, vdcs_col * col )
+{
+    const KColumn * kcol = NULL;
+    rc_t rc = 0;
+
+    KLockAcquire( job->lock );
+    if ( job->ktab != NULL && KTableOpenColumnRead( job->ktab, &kcol, "%s", col->name ) != 0 )
+        kcol = NULL;
+    KLockUnlock( job->lock );
+
+    if ( kcol != NULL )
+    {
+        int64_t first;
+        uint64_t count;
+        rc = KColumnIdRange( kcol, &first, &count );
+        if ( rc == 0 )
+        {
+            int64_t id = first, last = first + count - 1;
+            col->physical = true;
+            while ( rc == 0 && count > 0 && id <= last )
+            {
+                const KColumnBlob * blob;
+                rc = KColumnOpenBlobRead( kcol, &blob, id );
+                if ( rc == 0 )
+                {
+                    int64_t first_id_in_blob;
+                    uint32_t ids_in_blob;
+                    rc = KColumnBlobIdRange( blob, &first_id_in_blob, &ids_in_blob );
+                    if ( rc == 0 && ids_in_blob == 0 )
+                        rc = RC( rcVDB, rcBlob, rcReading, rcRange, rcEmpty );
+                    if ( rc == 0 )
+                    {
+                        col->blobs++;
+                        id = first_id_in_blob + ids_in_blob;
+                    }
+                    KColumnBlobRelease( blob );
+                }
+            }
+        }
+        KColumnRelease( kcol );
+    }
+    return rc;
+}
+
+static rc_t CC vdcs_worker( const KThread * self, void * data )
+{
+    vdcs_job * job = data;
+    rc_t rc = 0;
+    while ( rc == 0 )
+    {
+        uint32_t i;
+        KLockAcquire( job->lock );
+        i = job->next++;
+        KLockUnlock( job->lock );
+        if ( i >= VectorLength( &job->stats->cols ) )
+            break;
+        else
+        {
+            vdcs_col * col = VectorGet( &job->stats->cols, i );
+            rc_t rc1 = vdcs_scan_cells( job, col );
+            if ( rc1 == 0 )
+                rc1 = vdcs_count_blobs( job, col );
+            if ( rc1 != 0 )
+            {
+                /* a column that cannot be read is left out, the queries read it themselves */
+                job->failed[ i ] = true;
+                rc = Quitting();
+            }
+        }
+    }
+    return rc;
+}
+
+static rc_t vdcs_scan( const p_dump_context ctx, const VTable * tab, vdcs_stats * stats )
+{
+    vdcs_job job;
+    uint32_t n = VectorLength( &stats->cols );
+    rc_t rc = KLockMake( &job.lock );
+    DISP_RC( rc, "KLockMake() failed" );
+    if ( rc == 0 )
+    {
+        job.tab = tab;
+        job.ktab = NULL;
+        job.stats = stats;
+        job.cur_cache_size = ctx->cur_cache_size;
+        job.next = 0;
+        job.failed = calloc( n + 1, sizeof *job.failed );
+        if ( job.failed == NULL )
+            rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+        else
+        {
+            uint32_t i, workers = ctx->disable_multithreading ? 0 : n;
+            KThread * threads[ VDCS_MAX_WORKERS ];
+            uint32_t started = 0;
+
+            /* a table without physical columns has no blobs to count */
+            if ( VTableOpenKTableRead( tab, &job.ktab ) != 0 )
+                job.ktab = NULL;
+
+            if ( workers > VDCS_MAX_WORKERS )
+                workers = VDCS_MAX_WORKERS;
+            for ( i = 0; i < workers && rc == 0; ++i )
+            {
+                rc = KThreadMake( &threads[ i ], vdcs_worker, &job );
+                DISP_RC( rc, "KThreadMake() failed" );
+                if ( rc == 0 )
+                    started++;
+            }
+            /* without threads the columns are scanned here, one after the other */
+            if ( rc == 0 && started == 0 )
+                rc = vdcs_worker( NULL, &job );
+            for ( i = 0; i < started; ++i )
+            {
+                rc_t status;
+                rc_t rc1 = KThreadWait( threads[ i ], &status );
+                if ( rc1 == 0 )
+                    rc1 = status;
+                if ( rc == 0 )
+                    rc = rc1;
+                KThreadRelease( threads[ i ] );
+            }
+
+            for ( i = n; i > 0; --i )
+            {
+                if ( job.failed[ i - 1 ] )
+                {
+                    void * removed;
+                    VectorRemove( &stats->cols, i - 1, &removed );
+                    vdcs_destroy_col( removed, NULL );
+                }
+            }
+
+            if ( job.ktab != NULL )
+                KTableRelease( job.ktab );
+            free( job.failed );
+        }
+        KLockRelease( job.lock );
+    }
+    return rc;
+}
+
+/* the columns and the row-range --id_range reports without -C */
+static rc_t vdcs_build( const p_dump_context ctx, const VTable * tab, vdcs_stats ** stats )
+{
+    rc_t rc = 0;
+    col_defs * cols;
+    vdcs_stats * s = vdcs_init();
+
+    if ( s == NULL || !vdcd_init( &cols, ctx->max_line_len ) )
+    {
+        rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+        DISP_RC( rc, "vdcs_build() failed" );
+    }
+    else
+    {
+        if ( vdcd_extract_from_table( cols, tab ) < 1 )
+            rc = RC( rcVDB, rcNoTarg, rcConstructing, rcParam, rcInvalid );
+        else
+        {
+            const VCursor * cur;
+            rc = VTableCreateCursorRead( tab, &cur );
+            DISP_RC( rc, "VTableCreateCursorRead() failed" );
+            if ( rc == 0 )
+            {
+                if ( vdcd_add_to_cursor( cols, cur ) < 1 )
+                    rc = RC( rcVDB, rcNoTarg, rcConstructing, rcParam, rcInvalid );
+                else
+                {
+                    rc = VCursorOpen( cur );
+                    DISP_RC( rc, "VCursorOpen() failed" );
+                    if ( rc == 0 )
+                    {
+                        rc = VCursorIdRange( cur, 0, &s->first, &s->count );
+                        DISP_RC( rc, "VCursorIdRange() failed" );
+                    }
+                }
+                VCursorRelease( cur );
+            }
+        }
+
+        if ( rc == 0 )
+        {
+            uint32_t i, n = VectorLength( &cols->cols );
+            for ( i = 0; i < n && rc == 0; ++i )
+            {
+                const col_def * cd = VectorGet( &cols->cols, i );
+                if ( cd != NULL && cd->valid && vdcs_append_col( s, cd->name, cd->type_desc.domain ) == NULL )
+                    rc = RC( rcVDB, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+            }
+        }
+        vdcd_destroy( cols );
+
+        if ( rc == 0 )
+            rc = vdcs_scan( ctx, tab, s );
+    }
+
+    if ( rc == 0 )
+        *stats = s;
+    else
+        vdcs_release( s );
+    return rc;
+}
+
+/* ******************************************************************************************************** */
+/* the sidecar-file: tab-separated text, one line per column, complete only with the closing line           */
+
+static rc_t vdcs_file_name( const p_dump_context ctx, char * buffer, size_t buffer_size )
+{
+    size_t num_writ;
+    rc_t rc = string_printf( buffer, buffer_size, &num_writ, "%s%s%s.stats",
+                             ctx->path,
+                             ctx->table != NULL ? "." : "",
+                             ctx->table != NULL ? ctx->table : "" );
+    if ( rc == 0 )
+    {
+        size_t i;
+        for ( i = 0; i < num_writ; ++i )
+        {
+            char c = buffer[ i ];
+            if ( !( ( c >= 'a' && c <= 'z' ) || ( c >= 'A' && c <= 'Z' ) ||
+                    ( c >= '0' && c <= '9' ) || c == '.' || c == '-' || c == '_' ) )
+                buffer[ i ] = '_';
+        }
+    }
+    return rc;
+}
+
+static rc_t vdcs_mod_date( const p_dump_context ctx, const VTable * tab, KTime_t * mtime )
+{
+    const VDBManager * mgr;
+    rc_t rc = VTableOpenManagerRead( tab, &mgr );
+    if ( rc == 0 )
+    {
+        rc = VDBManagerGetObjModDate( mgr, mtime, ctx->path );
+        VDBManagerRelease( mgr );
+    }
+    return rc;
+}
+
+static uint64_t vdcs_double_bits( double value )
+{
+    uint64_t res;
+    memcpy( &res, &value, sizeof res );
+    return res;
+}
+
+static double vdcs_bits_double( uint64_t bits )
+{
+    double res;
+    memcpy( &res, &bits, sizeof res );
+    return res;
+}
+
+typedef struct vdcs_writer
+{
+    KFile * f;
+    uint64_t pos;
+    char line[ VDCS_LINE_SIZE ];
+} vdcs_writer;
+
+static rc_t vdcs_write_line( vdcs_writer * w, const char * fmt, ... )
+{
+    size_t num_writ;
+    rc_t rc;
+    va_list args;
+
+    va_start( args, fmt );
+    rc = string_vprintf( w->line, sizeof w->line, &num_writ, fmt, args );
+    va_end( args );
+    if ( rc == 0 )
+    {
+        size_t written;
+        rc = KFileWriteAll( w->f, w->pos, w->line, num_writ, &written );
+        w->pos += written;
+    }
+    return rc;
+}
+
+static rc_t vdcs_write( const p_dump_context ctx, const vdcs_stats * stats, KTime_t mtime, vdcs_writer * w )
+{
+    uint32_t i, n = VectorLength( &stats->cols );
+    rc_t rc = vdcs_write_line( w, "%s\t%u\n", VDCS_MAGIC, VDCS_VERSION );
+    if ( rc == 0 )
+        rc = vdcs_write_line( w, "path\t%s\n", ctx->path );
+    if ( rc == 0 )
+        rc = vdcs_write_line( w, "table\t%s\n", ctx->table != NULL ? ctx->table : "" );
+    if ( rc == 0 )
+        rc = vdcs_write_line( w, "mtime\t%ld\n", ( int64_t )mtime );
+    if ( rc == 0 )
+        rc = vdcs_write_line( w, "rows\t%ld\t%lu\n", stats->first, stats->count );
+    for ( i = 0; i < n && rc == 0; ++i )
+    {
+        const vdcs_col * col = VectorGet( &stats->cols, i );
+        rc = vdcs_write_line( w, "col\t%s\t%u\t%ld\t%lu\t%u\t%lu\t%lu\t%lu\t%lu\t%lu"
+                                 "\t%lu\t%ld\t%ld\t%lX\t%lX\n",
+                              col->name, col->domain, col->first, col->count,
+                              col->physical ? 1 : 0, col->blobs,
+                              col->values, col->min, col->max, col->distinct,
+                              col->spread.count, col->spread.min, col->spread.max,
+                              vdcs_double_bits( col->spread.sum ),
+                              vdcs_double_bits( col->spread.sum_sq ) );
+    }
+    if ( rc == 0 )
+        rc = vdcs_write_line( w, "end\n" );
+    return rc;
+}
+
+/* written under a temporary name and renamed, concurrent readers never see half a file */
+static rc_t vdcs_save( const p_dump_context ctx, KDirectory * dir, const char * name,
+                       KTime_t mtime, const vdcs_stats * stats )
+{
+    char tmp_path[ VDCS_LINE_SIZE ];
+    char path[ VDCS_LINE_SIZE ];
+    size_t num_writ;
+    rc_t rc = string_printf( path, sizeof path, &num_writ, "%s/%s", ctx->stats_cache, name );
+    if ( rc == 0 )
+        rc = string_printf( tmp_path, sizeof tmp_path, &num_writ, "%s.tmp", path );
+    if ( rc == 0 )
+    {
+        vdcs_writer * w = malloc( sizeof *w );
+        if ( w == NULL )
+            rc = RC( rcVDB, rcNoTarg, rcWriting, rcMemory, rcExhausted );
+        else
+        {
+            rc = KDirectoryCreateFile( dir, &w->f, false, 0664, kcmInit | kcmParents, "%s", tmp_path );
+            if ( rc == 0 )
+            {
+                w->pos = 0;
+                rc = vdcs_write( ctx, stats, mtime, w );
+                {
+                    /* a failed close leaves a file that must not become the sidecar */
+                    rc_t rc2 = KFileRelease( w->f );
+                    if ( rc == 0 )
+                        rc = rc2;
+                }
+                if ( rc == 0 )
+                    rc = KDirectoryRename( dir, true, tmp_path, path );
+                if ( rc != 0 )
+                    KDirectoryRemove( dir, false, "%s", tmp_path );
+            }
+            free( w );
+        }
+    }
+    return rc;
+}
+
+/* splits line at the tabs, returns the number of fields */
+static uint32_t vdcs_split( char * line, char ** fields, uint32_t max_fields )
+{
+    uint32_t n = 0;
+    fields[ n++ ] = line;
+    while ( *line != 0 )
+    {
+        if ( *line == '\t' )
+        {
+            *line = 0;
+            if ( n == max_fields )
+                return max_fields + 1;
+            fields[ n++ ] = line + 1;
+        }
+        line++;
+    }
+    return n;
+}
+
+static bool vdcs_u64( const char * s, uint64_t * value, uint32_t base )
+{
+    char * endp;
+    *value = strtou64( s, &endp, base );
+    return ( endp != s && *endp == 0 );
+}
+
+static bool vdcs_i64( const char * s, int64_t * value )
+{
+    char * endp;
+    *value = strtoi64( s, &endp, 10 );
+    return ( endp != s && *endp == 0 );
+}
+
+static bool vdcs_parse_col( vdcs_stats * stats, char ** f )
+{
+    uint64_t domain, physical, sum, sum_sq;
+    vdcs_col * col;
+
+    if ( !vdcs_u64( f[ 2 ], &domain, 10 ) )
+        return false;
+    col = vdcs_append_col( stats, f[ 1 ], ( uint32_t )domain );
+    if ( col == NULL )
+        return false;
+    if ( !( vdcs_i64( f[ 3 ], &col->first ) &&
+            vdcs_u64( f[ 4 ], &col->count, 10 ) &&
+            vdcs_u64( f[ 5 ], &physical, 10 ) &&
+            vdcs_u64( f[ 6 ], &col->blobs, 10 ) &&
+            vdcs_u64( f[ 7 ], &col->values, 10 ) &&
+            vdcs_u64( f[ 8 ], &col->min, 10 ) &&
+            vdcs_u64( f[ 9 ], &col->max, 10 ) &&
+            vdcs_u64( f[ 10 ], &col->distinct, 10 ) &&
+            vdcs_u64( f[ 11 ], &col->spread.count, 10 ) &&
+            vdcs_i64( f[ 12 ], &col->spread.min ) &&
+            vdcs_i64( f[ 13 ], &col->spread.max ) &&
+            vdcs_u64( f[ 14 ], &sum, 16 ) &&
+            vdcs_u64( f[ 15 ], &sum_sq, 16 ) ) )
+        return false;
+    col->physical = ( physical != 0 );
+    col->spread.sum = vdcs_bits_double( sum );
+    col->spread.sum_sq = vdcs_bits_double( sum_sq );
+    return true;
+}
+
+#define VDCS_COL_FIELDS 16
+
+/* a sidecar of an other version, of an other object or of an older state of it is not valid */
+static bool vdcs_parse( const p_dump_context ctx, KTime_t mtime, char * text, vdcs_stats * stats )
+{
+    char * fields[ VDCS_COL_FIELDS ];
+    uint64_t version;
+    int64_t ts;
+    uint32_t line_nr = 0;
+    bool complete = false;
+
+    while ( *text != 0 && !complete )
+    {
+        char * line = text;
+        char * eol = strchr( text, '\n' );
+        uint32_t n;
+        if ( eol == NULL )
+            return false;
+        *eol = 0;
+        text = eol + 1;
+
+        n = vdcs_split( line, fields, VDCS_COL_FIELDS );
+        switch( line_nr++ )
+        {
+            case 0 : if ( n != 2 || strcmp( fields[ 0 ], VDCS_MAGIC ) != 0 ||
+                          !vdcs_u64( fields[ 1 ], &version, 10 ) || version != VDCS_VERSION )
+                        return false;
+                     break;
+
+            case 1 : if ( n != 2 || strcmp( fields[ 0 ], "path" ) != 0 ||
+                          strcmp( fields[ 1 ], ctx->path ) != 0 )
+                        return false;
+                     break;
+
+            case 2 : if ( n != 2 || strcmp( fields[ 0 ], "table" ) != 0 ||
+                          strcmp( fields[ 1 ], ctx->table != NULL ? ctx->table : "" ) != 0 )
+                        return false;
+                     break;
+
+            case 3 : if ( n != 2 || strcmp( fields[ 0 ], "mtime" ) != 0 ||
+                          !vdcs_i64( fields[ 1 ], &ts ) || ts != ( int64_t )mtime )
+                        return false;
+                     break;
+
+            case 4 : if ( n != 3 || strcmp( fields[ 0 ], "rows" ) != 0 ||
+                          !vdcs_i64( fields[ 1 ], &stats->first ) ||
+                          !vdcs_u64( fields[ 2 ], &stats->count, 10 ) )
+                        return false;
+                     break;
+
+            default : if ( n == 1 && strcmp( fields[ 0 ], "end" ) == 0 )
+                        complete = true;
+                      else if ( n != VDCS_COL_FIELDS || strcmp( fields[ 0 ], "col" ) != 0 ||
+                                !vdcs_parse_col( stats, fields ) )
+                        return false;
+                      break;
+        }
+    }
+    return complete;
+}
+
+static rc_t vdcs_load( const p_dump_context ctx, KDirectory * dir, const char * name,
+                       KTime_t mtime, vdcs_stats ** stats )
+{
+    const KFile * f;
+    rc_t rc = KDirectoryOpenFileRead( dir, &f, "%s/%s", ctx->stats_cache, name );
+    if ( rc == 0 )
+    {
+        uint64_t size;
+        rc = KFileSize( f, &size );
+        if ( rc == 0 )
+        {
+            char * text = malloc( size + 1 );
+            if ( text == NULL )
+                rc = RC( rcVDB, rcNoTarg, rcReading, rcMemory, rcExhausted );
+            else
+            {
+                size_t num_read;
+                rc = KFileReadAll( f, 0, text, size, &num_read );
+                if ( rc == 0 )
+                {
+                    vdcs_stats * s = vdcs_init();
+                    text[ num_read ] = 0;
+                    if ( s == NULL )
+                        rc = RC( rcVDB, rcNoTarg, rcReading, rcMemory, rcExhausted );
+                    else if ( !vdcs_parse( ctx, mtime, text, s ) )
+                    {
+                        rc = RC( rcVDB, rcFile, rcReading, rcData, rcInvalid );
+                        vdcs_release( s );
+                    }
+                    else
+                        *stats = s;
+                }
+                free( text );
+            }
+        }
+        KFileRelease( f );
+    }
+    return rc;
+}
+
+rc_t vdcs_make( const p_dump_context ctx, const VTable * tab, vdcs_stats ** stats )
+{
+    KDirectory * dir = NULL;
+    char name[ VDCS_LINE_SIZE ];
+    KTime_t mtime = 0;
+    rc_t rc;
+
+    *stats = NULL;
+    if ( ctx->stats_cache != NULL )
+    {
+        if ( vdcs_mod_date( ctx, tab, &mtime ) != 0 || vdcs_file_name( ctx, name, sizeof name ) != 0 )
+            LOGMSG( klogWarn, "no modification-date for this object, the statistics are not kept" );
+        else if ( KDirectoryNativeDir( &dir ) != 0 )
+            dir = NULL;
+        else if ( vdcs_load( ctx, dir, name, mtime, stats ) == 0 )
+        {
+            KDirectoryRelease( dir );
+            return 0;
+        }
+    }
+
+    rc = vdcs_build( ctx, tab, stats );
+    if ( rc == 0 && dir != NULL )
+    {
+        rc_t rc1 = vdcs_save( ctx, dir, name, mtime, *stats );
+        if ( rc1 != 0 )
+            PLOGERR( klogWarn, ( klogWarn, rc1, "cannot keep the statistics in '$(dir)'",
+                                 "dir=%s", ctx->stats_cache ) );
+    }
+    if ( dir != NULL )
+        KDirectoryRelease( dir );
+    return rc;
+}
+
+rc_t vdcs_lookup( const p_dump_context ctx, const VTable * tab, vdcs_stats ** stats )
+{
+    KDirectory * dir;
+    char name[ VDCS_LINE_SIZE ];
+    KTime_t mtime;
+    rc_t rc;
+
+    *stats = NULL;
+    if ( ctx->stats_cache == NULL )
+        return 0;
+    rc = vdcs_mod_date( ctx, tab, &mtime );
+    if ( rc == 0 )
+        rc = vdcs_file_name( ctx, name, sizeof name );
+    if ( rc == 0 )
+        rc = KDirectoryNativeDir( &dir );
+    if ( rc == 0 )
+    {
+        /* a missing or stale file is not an error */
+        vdcs_load( ctx, dir, name, mtime, stats );
+        KDirectoryRelease( dir );
+    }
+    return rc;
+}
+
+/* ******************************************************************************************************** */
+
+rc_t vdcs_print_spread( const vdcs_stats * stats, const col_defs * cols,
+                        int64_t first, uint64_t count, bool * done )
+{
+    rc_t rc = 0;
+    uint32_t i, n = VectorLength( &cols->cols );
+
+    *done = false;
+    for ( i = 0; i < n; ++i )
+    {
+        const col_def * cd = VectorGet( &cols->cols, i );
+        if ( cd != NULL && vdcs_is_int( cd->type_desc.domain ) )
+        {
+            const vdcs_col * col = vdcs_find( stats, cd->name );
+            if ( col == NULL || col->domain != cd->type_desc.domain ||
+                 col->first != first || col->count != count )
+                return 0;
+        }
+    }
+
+    for ( i = 0; i < n && rc == 0; ++i )
+    {
+        const col_def * cd = VectorGet( &cols->cols, i );
+        if ( cd != NULL && vdcs_is_int( cd->type_desc.domain ) )
+            rc = vdcd_spread_print( cd->name, &( vdcs_find( stats, cd->name )->spread ) );
+    }
+    *done = ( rc == 0 );
+    return rc;
+}
+
+static rc_t vdcs_print_col( const vdcs_col * col )
+{
+    rc_t rc = KOutMsg( "\n[%s]\n", col->name );
+    if ( rc == 0 )
+    {
+        if ( col->count > 0 )
+            rc = KOutMsg( "rows     = %,ld ... %,ld\n", col->first, col->first + col->count - 1 );
+        else
+            rc = KOutMsg( "rows     = -\n" );
+    }
+    if ( rc == 0 )
+    {
+        if ( col->physical )
+            rc = KOutMsg( "blobs    = %,lu\n", col->blobs );
+        else
+            rc = KOutMsg( "blobs    = -\n" );
+    }
+    if ( rc == 0 && vdcs_is_int( col->domain ) )
+    {
+        rc = KOutMsg( "values   = %,lu\n", col->values );
+        if ( rc == 0 && col->values > 0 )
+        {
+            if ( col->domain == vtdUint )
+                rc = KOutMsg( "min      = %,lu\nmax      = %,lu\n", col->min, col->max );
+            else
+                rc = KOutMsg( "min      = %,ld\nmax      = %,ld\n", ( int64_t )col->min, ( int64_t )col->max );
+        }
+    }
+    if ( rc == 0 )
+        rc = KOutMsg( "distinct = %,lu\n", col->distinct );
+    return rc;
+}
+
+rc_t vdcs_print( const vdcs_stats * stats )
+{
+    uint32_t i, n = VectorLength( &stats->cols );
+    rc_t rc = KOutMsg( "id-range: first-row = %,ld, row-count = %,ld\n", stats->first, stats->count );
+    for ( i = 0; i < n && rc == 0; ++i )
+        rc = vdcs_print_col( VectorGet( &stats->cols, i ) );
+    return rc;
+}
@@ -0,0 +1,92 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#ifndef _h_vdb_dump_colstats_
+#define _h_vdb_dump_colstats_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#if 0
+}
+#endif
+
+#include <vdb/table.h>
+#include <klib/vector.h>
+
+#include "vdb-dump-context.h"
+#include "vdb-dump-coldefs.h"
+
+/********************************************************************
+the column-statistics of a table, made in one pass over all columns
+if ctx->stats_cache names a directory, they are kept there in a
+sidecar-file per object and reused as long as the version of the file
+and the modification-date of the object have not changed
+********************************************************************/
+#define VDCS_VERSION 1
+
+typedef struct vdcs_col
+{
+    char * name;
+    uint32_t domain;
+    int64_t first;          /* row-range of the column */
+    uint64_t count;
+    bool physical;
+    uint64_t blobs;         /* only if physical */
+    uint64_t values;        /* elements of an integer-column */
+    uint64_t min, max;      /* signed or unsigned by domain, if values > 0 */
+    uint64_t distinct;      /* estimated number of different cells */
+    vdcd_spread spread;     /* what --spread reports for the whole column */
+} vdcs_col;
+
+typedef struct vdcs_stats
+{
+    int64_t first;          /* row-range of the table */
+    uint64_t count;
+    Vector cols;            /* vdcs_col * */
+} vdcs_stats;
+
+rc_t vdcs_make( const p_dump_context ctx, const VTable * tab, vdcs_stats ** stats );
+
+/* only what the stats-cache already has: *stats is NULL if there is no valid
+   file for the table, nothing is scanned and nothing is written */
+rc_t vdcs_lookup( const p_dump_context ctx, const VTable * tab, vdcs_stats ** stats );
+void vdcs_release( vdcs_stats * stats );
+
+const vdcs_col * vdcs_find( const vdcs_stats * stats, const char * name );
+
+/* prints the spread of the integer-columns in cols, if all of them are in stats
+   with the row-range first/count, sets done to false otherwise */
+rc_t vdcs_print_spread( const vdcs_stats * stats, const col_defs * cols,
+                        int64_t first, uint64_t count, bool * done );
+
+rc_t vdcs_print( const vdcs_stats * stats );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -109,6 +109,7 @@ static void vdco_init_values( p_dump_context ctx )
     ctx->idx_range = NULL;
     ctx->output_file = NULL;
     ctx->output_path = NULL;
+    ctx->stats_cache = NULL;
     ctx->rows = NULL;
 
     ctx->print_row_id = true;
@@ -141,6 +142,7 @@ static void vdco_init_values( p_dump_context ctx )
     ctx->diff = false;
     ctx->show_spotgroups = false;
     ctx->show_spread = false;
+    ctx->show_col_stats = false;
     ctx->len_spread = false;
     ctx->interactive = false; 
     ctx->append = false;
@@ -223,6 +225,12 @@ rc_t vdco_destroy( p_dump_context ctx )
             ctx->output_file = NULL;
         }
 
+        if ( ctx->stats_cache != NULL )
+        {
+            free( (void*)ctx->stats_cache );
+            ctx->stats_cache = NULL;
+        }
+
         if ( ctx->rows != NULL )
         {
             num_gen_destroy( ctx->rows );
@@ -407,6 +415,22 @@ static rc_t vdco_set_output_path( p_dump_context ctx, const char *src )
 }
 
 
+static rc_t vdco_set_stats_cache( p_dump_context ctx, const char *src )
+{
+    rc_t rc = 0;
+    if ( ( ctx == NULL )||( src == NULL ) )
+    {
+        rc = RC( rcVDB, rcNoTarg, rcWriting, rcParam, rcNull );
+    }
+    if ( rc == 0 )
+    {
+        rc = vdco_set_str( (char**)&(ctx->stats_cache), src );
+        DISP_RC( rc, "vdco_set_str() failed" );
+    }
+    return rc;
+}
+
+
 static bool vdco_set_format( p_dump_context ctx, const char *src )
 {
     if ( ctx == NULL ) return false;
@@ -611,6 +635,7 @@ static void vdco_evaluate_options( const Args *my_args,
     /*ctx->force_sra_schema = vdco_get_bool_option( my_args, OPTION_SRASCHEMA, false );*/
     ctx->merge_ranges = vdco_get_bool_option( my_args, OPTION_MERGE_RANGES, false );
     ctx->show_spread = vdco_get_bool_option( my_args, OPTION_SPREAD, false );
+    ctx->show_col_stats = vdco_get_bool_option( my_args, OPTION_COL_STATS, false );
     ctx->len_spread = vdco_get_bool_option( my_args, OPTION_LEN_SPREAD, false );
     ctx->interactive = vdco_get_bool_option( my_args, OPTION_INTERACTIVE, false );
     ctx->slice_depth = vdco_get_uint16_option( my_args, OPTION_SLICE, 0 );
@@ -635,6 +660,7 @@ static void vdco_evaluate_options( const Args *my_args,
     vdco_set_idx_range( ctx, vdco_get_str_option( my_args, OPTION_IDX_RANGE ) );
     vdco_set_output_file( ctx, vdco_get_str_option( my_args, OPTION_OUT_FILE ) );
     vdco_set_output_path( ctx, vdco_get_str_option( my_args, OPTION_OUT_PATH ) );
+    vdco_set_stats_cache( ctx, vdco_get_str_option( my_args, OPTION_STATS_CACHE ) );
 
     ctx->idx_range_requested = ( ctx->idx_range != NULL );
     vdco_set_schemas( my_args, ctx );
@@ -86,6 +86,8 @@ extern "C" {
 #define OPTION_MERGE_RANGES      "merge-ranges"
 #define OPTION_SPREAD            "spread"
 #define OPTION_APPEND            "append"
+#define OPTION_COL_STATS         "col-stats"
+#define OPTION_STATS_CACHE       "stats-cache"
 
 #define OPTION_SLICE             "slice"
 #define OPTION_INTERACTIVE       "interactive"
@@ -159,6 +161,7 @@ typedef struct dump_context
     const char *row_range;
     const char *output_file;
     const char *output_path;
+    const char *stats_cache;
     struct num_gen * rows;
     bool print_row_id;
     uint16_t lf_after_row;
@@ -203,6 +206,7 @@ typedef struct dump_context
     bool show_spotgroups;
     bool merge_ranges;
     bool show_spread;
+    bool show_col_stats;
     bool interactive;
     bool len_spread;
     bool append;
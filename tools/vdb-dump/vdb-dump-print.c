@@ -26,6 +26,7 @@
 
 #include "vdb-dump-print.h"
 #include "vdb-dump-helper.h"
+#include "vdb-dump-str.h"
 
 #include <klib/rc.h>
 #include <klib/printf.h>
@@ -237,25 +238,39 @@ static rc_t vdp_boolean( vdp_context * vdp_ctx )
 }
 
 
-static const char * uint_hex_fmt = "0x%lX";
-static const char * uint_dec_fmt = "%lu";
-static const char * int_dec_fmt = "%ld";
+static const char * chars_fmt = "%.*s";
 
-
-static rc_t vdp_print_uint64( vdp_context * vdp_ctx, const char * fmt, uint64_t value )
+/* prints len chars of an already formated text: straight into the buffer if it fits,
+   otherwise through vdp_print() which handles the overflow exactly like before */
+static rc_t vdp_print_chars( vdp_context * vdp_ctx, const char * s, size_t len )
 {
+    rc_t rc = 0;
     if ( vdp_ctx->buf == NULL )
-        return KOutMsg( fmt, value );
+        rc = KOutMsg( chars_fmt, ( uint32_t )len, s );
+    else if ( vdp_ctx->buf_size > vdp_ctx->printed_so_far &&
+              vdp_ctx->buf_size - vdp_ctx->printed_so_far > len )
+    {
+        memmove( &( vdp_ctx->buf[ vdp_ctx->printed_so_far ] ), s, len );
+        vdp_ctx->printed_so_far += len;
+        vdp_ctx->buf[ vdp_ctx->printed_so_far ] = 0;
+    }
     else
-        return vdp_print( vdp_ctx, fmt, value );
+        rc = vdp_print( vdp_ctx, chars_fmt, ( uint32_t )len, s );
+    return rc;
 }
 
-static rc_t vdp_print_int64( vdp_context * vdp_ctx, const char * fmt, int64_t value )
+static rc_t vdp_print_uint64( vdp_context * vdp_ctx, bool in_hex, uint64_t value )
 {
-    if ( vdp_ctx->buf == NULL )
-        return KOutMsg( fmt, value );
-    else
-        return vdp_print( vdp_ctx, fmt, value );
+    char tmp[ VDS_MAX_CHARS_FOR_INT64 ];
+    size_t len = in_hex ? vds_format_hex64( tmp, value ) : vds_format_uint64( tmp, value );
+    return vdp_print_chars( vdp_ctx, tmp, len );
+}
+
+static rc_t vdp_print_int64( vdp_context * vdp_ctx, bool in_hex, int64_t value )
+{
+    char tmp[ VDS_MAX_CHARS_FOR_INT64 ];
+    size_t len = in_hex ? vds_format_hex64( tmp, ( uint64_t )value ) : vds_format_int64( tmp, value );
+    return vdp_print_chars( vdp_ctx, tmp, len );
 }
 
 static rc_t vdp_uint( vdp_context * vdp_ctx )
@@ -271,9 +286,7 @@ static rc_t vdp_uint( vdp_context * vdp_ctx )
     }
     else
     {
-        rc = vdp_print_uint64( vdp_ctx,
-                               vdp_ctx->opts->in_hex ? uint_hex_fmt : uint_dec_fmt,
-                               value ) ;
+        rc = vdp_print_uint64( vdp_ctx, vdp_ctx->opts->in_hex, value );
     }
     return rc;
 }
@@ -304,9 +317,7 @@ static rc_t vdp_int( vdp_context * vdp_ctx )
                         value = temp; }
                       break;
         }
-        rc = vdp_print_int64( vdp_ctx,
-                              vdp_ctx->opts->in_hex ? uint_hex_fmt : int_dec_fmt,
-                              value ) ;
+        rc = vdp_print_int64( vdp_ctx, vdp_ctx->opts->in_hex, value );
     }
     return rc;
 }
@@ -314,9 +325,16 @@ static rc_t vdp_int( vdp_context * vdp_ctx )
 
 #define BITSIZE_OF_FLOAT ( sizeof(float) * 8 )
 #define BITSIZE_OF_DOUBLE ( sizeof(double) * 8 )
-static const char * float_fmt = "%e";
 static const char * unknown_float_fmt = "unknown float-type";
 
+/* "%e" through the C-library directly, not through the klib printf-machinery */
+static rc_t vdp_print_double( vdp_context * vdp_ctx, double value )
+{
+    char tmp[ VDS_MAX_CHARS_FOR_DOUBLE ];
+    size_t len = vds_format_double( tmp, value );
+    return vdp_print_chars( vdp_ctx, tmp, len );
+}
+
 static rc_t vdp_float( vdp_context * vdp_ctx )
 {
     rc_t rc;
@@ -329,19 +347,13 @@ static rc_t vdp_float( vdp_context * vdp_ctx )
         {
             float value;
             vdp_move_to_value( &value, vdp_ctx, n_bits );
-            if ( vdp_ctx->buf == NULL )
-                rc = KOutMsg( float_fmt, value );
-            else
-                rc = vdp_print( vdp_ctx, float_fmt, value );
+            rc = vdp_print_double( vdp_ctx, value );
         }
         else if ( n_bits == BITSIZE_OF_DOUBLE )
         {
             double value;
             vdp_move_to_value( &value, vdp_ctx, n_bits );
-            if ( vdp_ctx->buf == NULL )
-                rc = KOutMsg( float_fmt, value );
-            else
-                rc = vdp_print( vdp_ctx, float_fmt, value );
+            rc = vdp_print_double( vdp_ctx, value );
         }
         else
             rc = vdp_print_string( vdp_ctx, unknown_float_fmt );
@@ -532,6 +544,144 @@ static rc_t vdp_print_elem( vdp_context * vdp_ctx )
 }
 
 
+#define INT_CELL_CHUNK 4096
+
+/* reads one byte-aligned element, signed ones are sign-extended to 64 bit */
+static uint64_t vdp_int_cell_value( const uint8_t * p, const uint32_t n_bits, bool is_signed )
+{
+    uint64_t value = 0;
+    switch ( n_bits )
+    {
+        case  8 : { uint8_t temp;
+                    memmove( &temp, p, sizeof temp );
+                    value = is_signed ? ( uint64_t )( int8_t )temp : temp; }
+                  break;
+        case 16 : { uint16_t temp;
+                    memmove( &temp, p, sizeof temp );
+                    value = is_signed ? ( uint64_t )( int16_t )temp : temp; }
+                  break;
+        case 32 : { uint32_t temp;
+                    memmove( &temp, p, sizeof temp );
+                    value = is_signed ? ( uint64_t )( int32_t )temp : temp; }
+                  break;
+        default : memmove( &value, p, sizeof value );
+                  break;
+    }
+    return value;
+}
+
+/* prints a whole cell of 8/16/32/64-bit integers in chunks instead of element by element,
+   *done is false if the cell does not qualify */
+static rc_t vdp_print_int_cell( vdp_context * vdp_ctx, bool * done )
+{
+    rc_t rc = 0;
+    const VTypedesc * type_desc = vdp_ctx->type_desc;
+    uint32_t n_bits = type_desc->intrinsic_bits;
+    bool is_signed = ( type_desc->domain == vtdInt );
+
+    *done = false;
+    if ( ( type_desc->domain != vtdUint && !is_signed ) ||
+         ( type_desc->intrinsic_dim != 1 ) ||
+         ( n_bits != 8 && n_bits != 16 && n_bits != 32 && n_bits != 64 ) ||
+         ( vdp_ctx->opts->translate_sra_types ) )
+        return rc;
+
+    {
+        char chunk[ INT_CELL_CHUNK ];
+        size_t pos = 0;
+        uint32_t n_bytes = n_bits >> 3;
+        const uint8_t * p = ( const uint8_t * )vdp_ctx->base + BYTE_OFFSET( vdp_ctx->offset_in_bits );
+        bool in_hex = vdp_ctx->opts->in_hex;
+        uint32_t i;
+
+        for ( i = 0; i < vdp_ctx->row_len && rc == 0 && !vdp_ctx->buf_filled; ++i, p += n_bytes )
+        {
+            uint64_t value;
+            if ( pos + 2 + VDS_MAX_CHARS_FOR_INT64 > sizeof chunk )
+            {
+                rc = vdp_print_chars( vdp_ctx, chunk, pos );
+                pos = 0;
+            }
+            if ( i > 0 )
+            {
+                chunk[ pos++ ] = ',';
+                chunk[ pos++ ] = ' ';
+            }
+            value = vdp_int_cell_value( p, n_bits, is_signed );
+            if ( in_hex )
+                pos += vds_format_hex64( chunk + pos, value );
+            else if ( is_signed )
+                pos += vds_format_int64( chunk + pos, ( int64_t )value );
+            else
+                pos += vds_format_uint64( chunk + pos, value );
+        }
+        if ( rc == 0 && pos > 0 && !vdp_ctx->buf_filled )
+            rc = vdp_print_chars( vdp_ctx, chunk, pos );
+
+        vdp_ctx->elem_idx = vdp_ctx->row_len;
+        vdp_ctx->offset_in_bits += ( ( uint64_t )n_bits * vdp_ctx->row_len );
+    }
+    *done = true;
+    return rc;
+}
+
+/* the same for a cell of floats/doubles, formated like "%e", not in hex */
+static rc_t vdp_print_float_cell( vdp_context * vdp_ctx, bool * done )
+{
+    rc_t rc = 0;
+    const VTypedesc * type_desc = vdp_ctx->type_desc;
+    uint32_t n_bits = type_desc->intrinsic_bits;
+
+    *done = false;
+    if ( ( type_desc->domain != vtdFloat ) ||
+         ( type_desc->intrinsic_dim != 1 ) ||
+         ( n_bits != BITSIZE_OF_FLOAT && n_bits != BITSIZE_OF_DOUBLE ) ||
+         ( vdp_ctx->opts->in_hex ) )
+        return rc;
+
+    {
+        char chunk[ INT_CELL_CHUNK ];
+        size_t pos = 0;
+        uint32_t n_bytes = n_bits >> 3;
+        const uint8_t * p = ( const uint8_t * )vdp_ctx->base + BYTE_OFFSET( vdp_ctx->offset_in_bits );
+        uint32_t i;
+
+        for ( i = 0; i < vdp_ctx->row_len && rc == 0 && !vdp_ctx->buf_filled; ++i, p += n_bytes )
+        {
+            if ( pos + 2 + VDS_MAX_CHARS_FOR_DOUBLE > sizeof chunk )
+            {
+                rc = vdp_print_chars( vdp_ctx, chunk, pos );
+                pos = 0;
+            }
+            if ( i > 0 )
+            {
+                chunk[ pos++ ] = ',';
+                chunk[ pos++ ] = ' ';
+            }
+            if ( n_bits == BITSIZE_OF_FLOAT )
+            {
+                float value;
+                memmove( &value, p, sizeof value );
+                pos += vds_format_double( chunk + pos, value );
+            }
+            else
+            {
+                double value;
+                memmove( &value, p, sizeof value );
+                pos += vds_format_double( chunk + pos, value );
+            }
+        }
+        if ( rc == 0 && pos > 0 && !vdp_ctx->buf_filled )
+            rc = vdp_print_chars( vdp_ctx, chunk, pos );
+
+        vdp_ctx->elem_idx = vdp_ctx->row_len;
+        vdp_ctx->offset_in_bits += ( ( uint64_t )n_bits * vdp_ctx->row_len );
+    }
+    *done = true;
+    return rc;
+}
+
+
 rc_t vdp_print_cell_cmn( char * buf, size_t buf_size, size_t *num_written,
                          const uint32_t elem_bits, const void * base, uint32_t boff, uint32_t row_len,
                          const VTypedesc * type_desc, vdp_opts * opts )
@@ -565,6 +715,7 @@ rc_t vdp_print_cell_cmn( char * buf, size_t buf_size, size_t *num_written,
         else
         {
             bool print_comma = true;
+            bool done = false;
 
             /* hardcoded printing of dna-bases if the column-type fits */
             vdp_ctx.print_dna_bases = ( opts->print_dna_bases &
@@ -574,7 +725,12 @@ rc_t vdp_print_cell_cmn( char * buf, size_t buf_size, size_t *num_written,
             if ( ( type_desc->domain == vtdBool ) && opts->c_boolean )
                 print_comma = false;
 
-            while( ( vdp_ctx.elem_idx < row_len ) && ( rc == 0 ) && ( !vdp_ctx.buf_filled ) )
+            /* integer- and float-cells are printed in one go, the loop has nothing left to do then */
+            rc = vdp_print_int_cell( &vdp_ctx, &done );
+            if ( rc == 0 && !done )
+                rc = vdp_print_float_cell( &vdp_ctx, &done );
+
+            while( ( !done ) && ( vdp_ctx.elem_idx < row_len ) && ( rc == 0 ) && ( !vdp_ctx.buf_filled ) )
             {
                 uint32_t eidx = vdp_ctx.elem_idx;
 
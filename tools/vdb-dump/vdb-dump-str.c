@@ -213,6 +213,139 @@ rc_t vds_append_str( p_dump_str s, const char *s1 )
 }
 
 
+rc_t vds_append_chars( p_dump_str s, const char *s1, const size_t len )
+{
+    rc_t rc = 0;
+
+    if ( ( s == NULL )||( s1 == NULL ) )
+    {
+        rc = RC( rcVDB, rcNoTarg, rcInserting, rcParam, rcNull );
+    }
+    else if ( len > 0 )
+    {
+        if ( ( s->str_limit > 0 )&&( s->str_len >= s->str_limit ) )
+        {
+            s->truncated = true;
+        }
+        else
+        {
+            rc = vds_inc_buffer( s, len );
+            if ( rc == 0 )
+            {
+                memmove( s->buf + s->str_len, s1, len );
+                s->buf[ s->str_len + len ] = 0;
+                rc = vds_truncate( s, len ); /* adjusts str_len */
+            }
+        }
+    }
+    return rc;
+}
+
+
+/* two decimal digits at a time: "00" ... "99" */
+static const char vds_digit_pairs[ 201 ] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static const char vds_hex_digits[ 17 ] = "0123456789ABCDEF";
+
+size_t vds_format_uint64( char * dst, const uint64_t value )
+{
+    char tmp[ VDS_MAX_CHARS_FOR_INT64 ];
+    char * p = tmp + sizeof tmp;
+    uint64_t v = value;
+    size_t len;
+
+    while ( v >= 100 )
+    {
+        uint32_t i = ( uint32_t )( v % 100 ) * 2;
+        v /= 100;
+        *--p = vds_digit_pairs[ i + 1 ];
+        *--p = vds_digit_pairs[ i ];
+    }
+    if ( v >= 10 )
+    {
+        uint32_t i = ( uint32_t )v * 2;
+        *--p = vds_digit_pairs[ i + 1 ];
+        *--p = vds_digit_pairs[ i ];
+    }
+    else
+        *--p = ( char )( '0' + v );
+
+    len = ( tmp + sizeof tmp ) - p;
+    memmove( dst, p, len );
+    return len;
+}
+
+size_t vds_format_int64( char * dst, const int64_t value )
+{
+    if ( value < 0 )
+    {
+        /* negate as unsigned, that way INT64_MIN does not overflow */
+        dst[ 0 ] = '-';
+        return vds_format_uint64( dst + 1, 0 - ( uint64_t )value ) + 1;
+    }
+    return vds_format_uint64( dst, ( uint64_t )value );
+}
+
+size_t vds_format_hex64( char * dst, const uint64_t value )
+{
+    char tmp[ VDS_MAX_CHARS_FOR_INT64 ];
+    char * p = tmp + sizeof tmp;
+    uint64_t v = value;
+    size_t len;
+
+    do
+    {
+        *--p = vds_hex_digits[ v & 0x0F ];
+        v >>= 4;
+    } while ( v != 0 );
+    *--p = 'x';
+    *--p = '0';
+
+    len = ( tmp + sizeof tmp ) - p;
+    memmove( dst, p, len );
+    return len;
+}
+
+
+size_t vds_format_double( char * dst, const double value )
+{
+    char tmp[ VDS_MAX_CHARS_FOR_DOUBLE ];
+    int len = snprintf( tmp, sizeof tmp, "%e", value );
+    if ( len < 0 )
+        len = 0;
+    else if ( ( size_t )len >= sizeof tmp )
+        len = sizeof tmp - 1;
+    memmove( dst, tmp, len );
+    return len;
+}
+
+
+rc_t vds_append_uint64( p_dump_str s, const uint64_t value, const bool in_hex )
+{
+    char tmp[ VDS_MAX_CHARS_FOR_INT64 ];
+    size_t len = in_hex ? vds_format_hex64( tmp, value ) : vds_format_uint64( tmp, value );
+    return vds_append_chars( s, tmp, len );
+}
+
+
+rc_t vds_append_int64( p_dump_str s, const int64_t value, const bool in_hex )
+{
+    char tmp[ VDS_MAX_CHARS_FOR_INT64 ];
+    size_t len = in_hex ? vds_format_hex64( tmp, ( uint64_t )value ) : vds_format_int64( tmp, value );
+    return vds_append_chars( s, tmp, len );
+}
+
+
 rc_t vds_append_str_no_limit_check( p_dump_str s, const char *s1 )
 {
     rc_t rc;
@@ -73,6 +73,32 @@ rc_t vds_append_fmt( p_dump_str s, const size_t aprox_len, const char *fmt, ...
 /* appends the string, truncates to the limit */
 rc_t vds_append_str( p_dump_str s, const char *s1 );
 
+/* appends len characters of s1, truncates to the limit */
+rc_t vds_append_chars( p_dump_str s, const char *s1, const size_t len );
+
+/* appends a number formated like "%lu", "%ld" or "0x%lX" without
+   going through the printf-machinery, truncates to the limit */
+rc_t vds_append_uint64( p_dump_str s, const uint64_t value, const bool in_hex );
+rc_t vds_append_int64( p_dump_str s, const int64_t value, const bool in_hex );
+
+/* the longest text vds_format_uint64/int64 can produce: "-9223372036854775808" */
+#define VDS_MAX_CHARS_FOR_INT64 24
+
+/* writes the number formated like "%lu" / "%ld" / "0x%lX" into dst
+   ( which has to have room for VDS_MAX_CHARS_FOR_INT64 chars ),
+   does not terminate, returns the number of chars written */
+size_t vds_format_uint64( char * dst, const uint64_t value );
+size_t vds_format_int64( char * dst, const int64_t value );
+size_t vds_format_hex64( char * dst, const uint64_t value );
+
+/* room for the text of "%e" for any double: "-1.797693e+308", "-nan" */
+#define VDS_MAX_CHARS_FOR_DOUBLE 32
+
+/* writes the number formated like "%e" into dst ( which has to have room for
+   VDS_MAX_CHARS_FOR_DOUBLE chars ) with the C-library's snprintf directly,
+   does not terminate, returns the number of chars written */
+size_t vds_format_double( char * dst, const double value );
+
 /* appends the string, does not truncate */
 rc_t vds_append_str_no_limit_check( p_dump_str s, const char *s1 );
 
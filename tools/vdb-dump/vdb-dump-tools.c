@@ -262,9 +262,6 @@ static rc_t vdt_dump_boolean_element( p_dump_str s, const p_dump_src src,
     return rc;
 }
 
-#define MAX_CHARS_FOR_HEX_UINT64 20
-#define MAX_CHARS_FOR_DEC_UINT64 22
-
 /*************************************************************************************
 src         [IN] ... buffer containing the data
 my_col_def  [IN] ... the definition of the column to be dumped
@@ -285,11 +282,8 @@ static rc_t vdt_dump_uint_element( p_dump_str s, const p_dump_src src,
     }
     else
     {
-        if ( src->in_hex )
-            rc = vds_append_fmt( s, MAX_CHARS_FOR_HEX_UINT64, "0x%lX", value );
-        else
-            rc = vds_append_fmt( s, MAX_CHARS_FOR_DEC_UINT64, "%lu", value );
-        DISP_RC( rc, "dump_str_append_fmt() failed" )
+        rc = vds_append_uint64( s, value, src->in_hex );
+        DISP_RC( rc, "dump_str_append_uint64() failed" )
     }
     return rc;
 }
@@ -327,16 +321,12 @@ static rc_t vdt_dump_int_element( p_dump_str s, const p_dump_src src,
                       break;
         }
 
-        if ( src->in_hex )
-            rc = vds_append_fmt( s, MAX_CHARS_FOR_HEX_UINT64, "0x%lX", value );
-        else
-            rc = vds_append_fmt( s, MAX_CHARS_FOR_DEC_UINT64, "%ld", value );
-        DISP_RC( rc, "dump_str_append_fmt() failed" )
+        rc = vds_append_int64( s, value, src->in_hex );
+        DISP_RC( rc, "dump_str_append_int64() failed" )
     }
     return rc;
 }
 
-#define MAX_CHARS_FOR_DOUBLE 26
 #define BITSIZE_OF_FLOAT ( sizeof(float) * 8 )
 #define BITSIZE_OF_DOUBLE ( sizeof(double) * 8 )
 
@@ -357,16 +347,18 @@ static rc_t vdt_dump_float_element( p_dump_str s, const p_dump_src src,
         if ( def->type_desc.intrinsic_bits == BITSIZE_OF_FLOAT )
         {
             float value;
+            char tmp[ VDS_MAX_CHARS_FOR_DOUBLE ];
             vdt_move_to_value( &value, src, def->type_desc.intrinsic_bits );
-            rc = vds_append_fmt( s, MAX_CHARS_FOR_DOUBLE, "%e", value );
-            DISP_RC( rc, "dump_str_append_fmt() failed" )
+            rc = vds_append_chars( s, tmp, vds_format_double( tmp, value ) );
+            DISP_RC( rc, "dump_str_append_chars() failed" )
         }
         else if ( def->type_desc.intrinsic_bits == BITSIZE_OF_DOUBLE )
         {
             double value;
+            char tmp[ VDS_MAX_CHARS_FOR_DOUBLE ];
             vdt_move_to_value( &value, src, def->type_desc.intrinsic_bits );
-            rc = vds_append_fmt( s, MAX_CHARS_FOR_DOUBLE, "%e", value );
-            DISP_RC( rc, "dump_str_append_fmt() failed" )
+            rc = vds_append_chars( s, tmp, vds_format_double( tmp, value ) );
+            DISP_RC( rc, "dump_str_append_chars() failed" )
         }
         else
         {
@@ -393,8 +385,8 @@ static rc_t vdt_dump_base_element( p_dump_str s,
     rc_t rc;
     value1 <<= 1;
     value1 |= value2;
-    rc = vds_append_fmt( s, 1, "%c", dna_chars[ value1 & 0x03 ] );
-    DISP_RC( rc, "dump_str_append_fmt() failed" )
+    rc = vds_append_chars( s, &dna_chars[ value1 & 0x03 ], 1 );
+    DISP_RC( rc, "dump_str_append_chars() failed" )
     return rc;
 }
 
@@ -528,6 +520,190 @@ rc_t vdt_dump_element( const p_dump_src src, const p_col_def def, bool bracket )
 }
 
 
+#define INT_CELL_CHUNK 4096
+
+/* reads one byte-aligned element, signed ones are sign-extended to 64 bit */
+static uint64_t vdt_int_cell_value( const uint8_t * p, const uint32_t n_bits, bool is_signed )
+{
+    uint64_t value = 0;
+    switch ( n_bits )
+    {
+        case  8 : { uint8_t temp;
+                    memmove( &temp, p, sizeof temp );
+                    value = is_signed ? ( uint64_t )( int8_t )temp : temp; }
+                  break;
+        case 16 : { uint16_t temp;
+                    memmove( &temp, p, sizeof temp );
+                    value = is_signed ? ( uint64_t )( int16_t )temp : temp; }
+                  break;
+        case 32 : { uint32_t temp;
+                    memmove( &temp, p, sizeof temp );
+                    value = is_signed ? ( uint64_t )( int32_t )temp : temp; }
+                  break;
+        default : memmove( &value, p, sizeof value );
+                  break;
+    }
+    return value;
+}
+
+/*************************************************************************************
+src         [IN] ... buffer containing the data
+def         [IN] ... the definition of the column to be dumped
+separator   [IN] ... what goes between 2 elements
+done        [OUT] .. true if the cell has been dumped
+
+dumps a whole cell of byte-aligned 8/16/32/64-bit integers in one go:
+the elements are formated into a local chunk which is appended to the
+dump-string each time it fills up, instead of element by element
+through vdt_dump_element(); the output is the same
+*done is false ( and nothing is touched ) if the cell does not qualify
+*************************************************************************************/
+rc_t vdt_dump_int_cell( const p_dump_src src, const p_col_def def,
+                        const char * separator, bool * done )
+{
+    rc_t rc = 0;
+    uint32_t n_bits;
+    bool is_signed;
+
+    *done = false;
+    if ( ( src == NULL )||( def == NULL )||( separator == NULL ) )
+        return RC( rcVDB, rcNoTarg, rcInserting, rcParam, rcNull );
+
+    n_bits = def->type_desc.intrinsic_bits;
+    is_signed = ( def->type_desc.domain == vtdInt );
+    if ( ( def->type_desc.domain != vtdUint && !is_signed )||
+         ( def->type_desc.intrinsic_dim != 1 )||
+         ( n_bits != 8 && n_bits != 16 && n_bits != 32 && n_bits != 64 )||
+         ( BIT_OFFSET( src->offset_in_bits ) != 0 )||
+         ( src->element_idx != 0 )||
+         ( ( src->without_sra_types == false )&&( def->value_trans_fct != NULL ) ) )
+        return 0;
+
+    {
+        char chunk[ INT_CELL_CHUNK ];
+        size_t pos = 0;
+        size_t sep_len = string_size( separator );
+        uint32_t n_bytes = n_bits >> 3;
+        const uint8_t * p = ( const uint8_t * )src->buf + BYTE_OFFSET( src->offset_in_bits );
+        uint32_t i;
+
+        for ( i = 0; i < src->number_of_elements && rc == 0; ++i, p += n_bytes )
+        {
+            uint64_t value;
+            if ( pos + sep_len + VDS_MAX_CHARS_FOR_INT64 > sizeof chunk )
+            {
+                rc = vds_append_chars( &(def->content), chunk, pos );
+                DISP_RC( rc, "dump_str_append_chars() failed" )
+                pos = 0;
+                /* everything after the limit would be dropped anyway */
+                if ( vds_truncated( &(def->content) ) )
+                    break;
+            }
+            if ( i > 0 )
+            {
+                memmove( chunk + pos, separator, sep_len );
+                pos += sep_len;
+            }
+            value = vdt_int_cell_value( p, n_bits, is_signed );
+            if ( src->in_hex )
+                pos += vds_format_hex64( chunk + pos, value );
+            else if ( is_signed )
+                pos += vds_format_int64( chunk + pos, ( int64_t )value );
+            else
+                pos += vds_format_uint64( chunk + pos, value );
+        }
+        if ( rc == 0 && pos > 0 )
+        {
+            rc = vds_append_chars( &(def->content), chunk, pos );
+            DISP_RC( rc, "dump_str_append_chars() failed" )
+        }
+        src->element_idx = src->number_of_elements;
+        src->offset_in_bits += ( n_bits * src->number_of_elements );
+    }
+    *done = true;
+    return rc;
+}
+
+
+/*************************************************************************************
+src         [IN] ... buffer containing the data
+def         [IN] ... the definition of the column to be dumped
+separator   [IN] ... what goes between 2 elements
+done        [OUT] .. true if the cell has been dumped
+
+the same for a whole cell of byte-aligned floats/doubles, formated like "%e"
+*done is false ( and nothing is touched ) if the cell does not qualify,
+floats in hex go through vdt_dump_element() as integers
+*************************************************************************************/
+rc_t vdt_dump_float_cell( const p_dump_src src, const p_col_def def,
+                          const char * separator, bool * done )
+{
+    rc_t rc = 0;
+    uint32_t n_bits;
+
+    *done = false;
+    if ( ( src == NULL )||( def == NULL )||( separator == NULL ) )
+        return RC( rcVDB, rcNoTarg, rcInserting, rcParam, rcNull );
+
+    n_bits = def->type_desc.intrinsic_bits;
+    if ( ( def->type_desc.domain != vtdFloat )||
+         ( def->type_desc.intrinsic_dim != 1 )||
+         ( n_bits != BITSIZE_OF_FLOAT && n_bits != BITSIZE_OF_DOUBLE )||
+         ( src->in_hex )||
+         ( BIT_OFFSET( src->offset_in_bits ) != 0 )||
+         ( src->element_idx != 0 ) )
+        return 0;
+
+    {
+        char chunk[ INT_CELL_CHUNK ];
+        size_t pos = 0;
+        size_t sep_len = string_size( separator );
+        uint32_t n_bytes = n_bits >> 3;
+        const uint8_t * p = ( const uint8_t * )src->buf + BYTE_OFFSET( src->offset_in_bits );
+        uint32_t i;
+
+        for ( i = 0; i < src->number_of_elements && rc == 0; ++i, p += n_bytes )
+        {
+            if ( pos + sep_len + VDS_MAX_CHARS_FOR_DOUBLE > sizeof chunk )
+            {
+                rc = vds_append_chars( &(def->content), chunk, pos );
+                DISP_RC( rc, "dump_str_append_chars() failed" )
+                pos = 0;
+                /* everything after the limit would be dropped anyway */
+                if ( vds_truncated( &(def->content) ) )
+                    break;
+            }
+            if ( i > 0 )
+            {
+                memmove( chunk + pos, separator, sep_len );
+                pos += sep_len;
+            }
+            if ( n_bits == BITSIZE_OF_FLOAT )
+            {
+                float value;
+                memmove( &value, p, sizeof value );
+                pos += vds_format_double( chunk + pos, value );
+            }
+            else
+            {
+                double value;
+                memmove( &value, p, sizeof value );
+                pos += vds_format_double( chunk + pos, value );
+            }
+        }
+        if ( rc == 0 && pos > 0 )
+        {
+            rc = vds_append_chars( &(def->content), chunk, pos );
+            DISP_RC( rc, "dump_str_append_chars() failed" )
+        }
+        src->element_idx = src->number_of_elements;
+        src->offset_in_bits += ( n_bits * src->number_of_elements );
+    }
+    *done = true;
+    return rc;
+}
+
+
 void vdm_clear_recorded_errors( void )
 {
     rc_t rc;
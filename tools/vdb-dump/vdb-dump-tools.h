@@ -53,6 +53,15 @@ typedef dump_src* p_dump_src;
 
 rc_t vdt_dump_element( const p_dump_src src, const p_col_def def, bool bracket );
 
+/* dumps a whole cell of 8/16/32/64-bit integers at once, *done is false if the
+   cell has to go element by element through vdt_dump_element() */
+rc_t vdt_dump_int_cell( const p_dump_src src, const p_col_def def,
+                        const char * separator, bool * done );
+
+/* the same for a cell of floats/doubles, formated like "%e" */
+rc_t vdt_dump_float_cell( const p_dump_src src, const p_col_def def,
+                          const char * separator, bool * done );
+
 void vdm_clear_recorded_errors( void );
 
 rc_t check_table_empty( const VTable * tab );
@@ -75,6 +75,7 @@
 #include "vdb-dump-bin.h"
 #include "vdb-dump-interact.h"
 #include "vdb_info.h"
+#include "vdb-dump-colstats.h"
 
 static const char * row_id_on_usage[]           = { "print row id",                                 NULL };
 static const char * line_feed_usage[]           = { "line-feed's inbetween rows",                   NULL };
@@ -120,6 +121,10 @@ static const char * spotgroup_usage[]           = { "show spotgroups",
 static const char * merge_ranges_usage[]        = { "merge and sort row-ranges",                    NULL };
 static const char * spread_usage[]              = { "show spread of integer values",                NULL };
 static const char * append_usage[]              = { "append to output-file, if output-file used",   NULL };
+static const char * col_stats_usage[]           = { "show row-range, blobs, min/max and distinct",
+                                                    "values of every column",                       NULL };
+static const char * stats_cache_usage[]         = { "keep column-statistics in this directory",
+                                                    "for --id_range, --spread and --col-stats",     NULL };
 static const char * ngc_usage[]                 = { "path to ngc file", NULL };
 
 /* from here on: not mentioned in help */
@@ -176,6 +181,8 @@ OptDef DumpOptions[] =
     { OPTION_MERGE_RANGES,          NULL,                     NULL, merge_ranges_usage,      1, false,  false },
     { OPTION_SPREAD,                NULL,                     NULL, spread_usage,            1, false,  false },
     { OPTION_APPEND,                ALIAS_APPEND,             NULL, append_usage,            1, false,  false },
+    { OPTION_COL_STATS,             NULL,                     NULL, col_stats_usage,         1, false,  false },
+    { OPTION_STATS_CACHE,           NULL,                     NULL, stats_cache_usage,       1, true,   false },
     
     { OPTION_LEN_SPREAD,            NULL,                     NULL, len_spread_usage,        1, false,  false },    
     { OPTION_INTERACTIVE,           NULL,                     NULL, interactive_usage,       1, false,  false },    
@@ -269,6 +276,8 @@ rc_t CC Usage ( const Args * args )
     HelpOptionLine ( NULL,                      OPTION_MERGE_RANGES,    NULL,           merge_ranges_usage );
     HelpOptionLine ( NULL,                      OPTION_SPREAD,          NULL,           spread_usage );
     HelpOptionLine ( ALIAS_APPEND,              OPTION_APPEND,          NULL,           append_usage );
+    HelpOptionLine ( NULL,                      OPTION_COL_STATS,       NULL,           col_stats_usage );
+    HelpOptionLine ( NULL,                      OPTION_STATS_CACHE,     "path",         stats_cache_usage );
     HelpOptionLine ( NULL,                      OPTION_NGC, "path", ngc_usage);
 
     HelpOptionsStandard ();
@@ -375,8 +384,18 @@ static void CC vdm_read_cell_data( void *item, void *data )
         }
         else
         {
+            bool done = false;
+
+            /* integer- and float-cells are formated in one go, the loop below
+               has nothing left to do in this case */
+            r_ctx->rc = vdt_dump_int_cell( &src, my_col_def,
+                                           sra_dump_format ? "," : ", ", &done );
+            if ( r_ctx->rc == 0 && !done )
+                r_ctx->rc = vdt_dump_float_cell( &src, my_col_def,
+                                                 sra_dump_format ? "," : ", ", &done );
+
             /* loop through the elements(dimension's) of a cell */
-            while( ( src.element_idx < src.number_of_elements )&&( r_ctx->rc == 0 ) )
+            while( ( !done )&&( src.element_idx < src.number_of_elements )&&( r_ctx->rc == 0 ) )
             {
                 uint32_t eidx = src.element_idx;
                 if ( ( eidx > 0 )&& ( src.print_dna_bases == false ) && print_comma )
@@ -785,6 +804,7 @@ static rc_t vdm_show_tab_spread( const p_dump_context ctx,
                     {
                         int64_t  first;
                         uint64_t count;
+                        bool whole_table = ( ctx->rows == NULL );
                         rc = VCursorIdRange( cursor, 0, &first, &count );
                         DISP_RC( rc, "VCursorIdRange( spread ) failed" );
                         if ( rc == 0 )
@@ -805,9 +825,19 @@ static rc_t vdm_show_tab_spread( const p_dump_context ctx,
                             
                             if ( rc == 0 )
                             {
+                                bool done = false;
                                 if ( num_gen_empty( ctx->rows ) )
                                     rc = RC( rcExe, rcDatabase, rcReading, rcRange, rcEmpty );
-                                else
+                                else if ( whole_table && ctx->stats_cache != NULL )
+                                {
+                                    vdcs_stats * stats;
+                                    if ( vdcs_make( ctx, my_table, &stats ) == 0 )
+                                    {
+                                        rc = vdcs_print_spread( stats, cols, first, count, &done ); /* is in vdb-dump-colstats.c */
+                                        vdcs_release( stats );
+                                    }
+                                }
+                                if ( rc == 0 && !done )
                                     rc = vdcd_collect_spread( ctx->rows, cols, cursor ); /* is in vdb-dump-coldefs.c */
                             }
                         }
@@ -833,6 +863,33 @@ static rc_t vdm_show_db_spread( const p_dump_context ctx,
     }
     return rc;
 }
+
+static rc_t vdm_show_tab_col_stats( const p_dump_context ctx,
+                                    const VTable *my_table )
+{
+    vdcs_stats * stats;
+    rc_t rc = vdcs_make( ctx, my_table, &stats ); /* is in vdb-dump-colstats.c */
+    DISP_RC( rc, "vdcs_make() failed" );
+    if ( rc == 0 )
+    {
+        rc = vdcs_print( stats );
+        vdcs_release( stats );
+    }
+    return rc;
+}
+
+static rc_t vdm_show_db_col_stats( const p_dump_context ctx,
+                                   const VDatabase *my_database )
+{
+    const VTable *my_table;
+    rc_t rc = open_table_by_path( my_database, ctx->table, &my_table );
+    if ( rc == 0 )
+    {
+        rc = vdm_show_tab_col_stats( ctx, my_table );
+        VTableRelease( my_table );
+    }
+    return rc;
+}
 /* ********************************************************************** */
 
 /********************************************************************
@@ -1363,10 +1420,32 @@ static rc_t vdm_enum_db_columns( const p_dump_context ctx, const VDatabase *my_d
 }
 
 
+/* the column-statistics are made for all columns, without -C/-x and static-only requests */
+static bool vdm_all_columns( const p_dump_context ctx )
+{
+    bool cols_unknown = ( ( ctx->columns == NULL ) || ( string_cmp( ctx->columns, 1, "*", 1, 1 ) == 0 ) );
+    return ( cols_unknown && ctx->excluded_columns == NULL && !ctx->enum_static );
+}
+
 static rc_t vdm_print_tab_id_range( const p_dump_context ctx, const VTable *my_table )
 {
     const VCursor *my_cursor;
-    rc_t rc = VTableCreateCursorRead( my_table, &my_cursor );
+    rc_t rc;
+
+    /* only a stats-cache that is already there: building it would scan every cell,
+       VCursorIdRange() below is cheap */
+    if ( ctx->stats_cache != NULL && vdm_all_columns( ctx ) )
+    {
+        vdcs_stats * stats;
+        if ( vdcs_lookup( ctx, my_table, &stats ) == 0 && stats != NULL ) /* is in vdb-dump-colstats.c */
+        {
+            rc = KOutMsg( "id-range: first-row = %,ld, row-count = %,ld\n", stats->first, stats->count );
+            vdcs_release( stats );
+            return rc;
+        }
+    }
+
+    rc = VTableCreateCursorRead( my_table, &my_cursor );
     DISP_RC( rc, "VTableCreateCursorRead() failed" );
     if ( rc == 0 )
     {
@@ -1844,6 +1923,10 @@ static rc_t vdm_dump_table( const p_dump_context ctx, const VDBManager *my_manag
         {
             rc = vdm_dump_tab_fkt( ctx, my_manager, vdm_show_tab_spread );
         }
+        else if ( ctx->show_col_stats )
+        {
+            rc = vdm_dump_tab_fkt( ctx, my_manager, vdm_show_tab_col_stats );
+        }
         else
         {
             rc = vdm_dump_tab_fkt( ctx, my_manager, vdm_dump_opened_table );
@@ -1987,6 +2070,10 @@ static rc_t vdm_dump_database( const p_dump_context ctx, const VDBManager *my_ma
     {
         rc = vdm_dump_db_fkt( ctx, my_manager, vdm_show_db_spread );
     }
+    else if ( ctx->show_col_stats )
+    {
+        rc = vdm_dump_db_fkt( ctx, my_manager, vdm_show_db_col_stats );
+    }
     else
     {
         rc = vdm_dump_db_fkt( ctx, my_manager, vdm_dump_opened_database );